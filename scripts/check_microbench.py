@@ -0,0 +1,153 @@
+# check_microbench.py
+#
+# Goal:
+# - Gate a firmware microbenchmark run (Stats op MICROBENCH, see "Microbenchmark" in src/main.cpp) against
+#   the baseline committed in bench/microbench-baseline.json, outside the browser.
+# - A case fails when it is slower than its baseline by more than the threshold (the env's "threshold", else
+#   the file's "threshold", 0.15 = 15%). Any failure exits with status 1, so the check can sit in a release script.
+#   A run with no baseline for its env fails too: a gate that cannot compare must not pass.
+#
+# Input: either
+#   - the JSON of a run from the Web UI (?bench) DevTools console:
+#     - the rows returned by `await byteFlusherBench.micro()`  (copy(rows)), or
+#     - the object returned by `byteFlusherBench.saveMicroBaseline(rows)`  ({"<case>": ns, ...}), or
+#   - --native: builds bench/native/microbench.cpp (the same cases on the host stubs, with $CXX or c++) and runs
+#     it --repeat times, keeping each case's fastest value. The env defaults to "native". Host timings depend on
+#     the machine: re-record the native baseline with --update when the gate moves to another one.
+#
+# Usage:
+#   python scripts/check_microbench.py --native
+#   python scripts/check_microbench.py run.json --env nice_nano_v2_compatible_hid_only
+#   python scripts/check_microbench.py run.json --env <env> --update --firmware 1.2.31   (record a baseline)
+#
+# Exit status: 0 = within the threshold, 1 = regression or no baseline for the env, 2 = bad input or build.
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+from pathlib import Path
+import subprocess
+import sys
+import tempfile
+
+ROOT = Path(__file__).resolve().parent.parent
+DEFAULT_BASELINE = ROOT / "bench" / "microbench-baseline.json"
+DEFAULT_THRESHOLD = 0.15
+NATIVE_SOURCE = ROOT / "bench" / "native" / "microbench.cpp"
+NATIVE_ENV = "native"
+
+
+def _load_json(path: Path):
+    try:
+        return json.loads(path.read_text(encoding="utf-8"))
+    except (OSError, ValueError) as e:
+        raise SystemExit(f"check_microbench: cannot read {path}: {e}") from None
+
+
+def _run_cases(run) -> dict[str, float]:
+    # rows: [{"case": name, "ns": median, ...}], or a plain {"<case>": ns} map.
+    if isinstance(run, list):
+        cases = {r.get("case"): r.get("ns") for r in run if isinstance(r, dict)}
+    elif isinstance(run, dict):
+        cases = dict(run)
+    else:
+        cases = {}
+    cases = {k: v for k, v in cases.items() if isinstance(k, str) and isinstance(v, (int, float)) and v > 0}
+    if not cases:
+        raise SystemExit("check_microbench: the run has no microbenchmark cases")
+    return cases
+
+
+def _native_run(repeat: int) -> dict[str, float]:
+    # Same flags as a release build would use; the stubs stand in for the board (see test/README).
+    cxx = os.environ.get("CXX", "c++")
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = Path(tmp) / "microbench"
+        cmd = [cxx, "-std=gnu++17", "-O2", "-I", str(ROOT / "test" / "stubs"), str(NATIVE_SOURCE), "-o", str(exe)]
+        try:
+            subprocess.run(cmd, check=True)
+        except (OSError, subprocess.CalledProcessError) as e:
+            raise SystemExit(f"check_microbench: cannot build {NATIVE_SOURCE}: {e}") from None
+        best: dict[str, float] = {}
+        for _ in range(max(1, repeat)):
+            try:
+                out = subprocess.run([str(exe)], check=True, capture_output=True, text=True).stdout
+                cases = _run_cases(json.loads(out))
+            except (OSError, ValueError, subprocess.CalledProcessError) as e:
+                raise SystemExit(f"check_microbench: native run failed: {e}") from None
+            for name, ns in cases.items():
+                best[name] = min(ns, best.get(name, ns))
+        return best
+
+
+def main(argv: list[str]) -> int:
+    p = argparse.ArgumentParser(description="Compare a firmware microbenchmark run with the committed baseline.")
+    p.add_argument("run", type=Path, nargs="?", help="run JSON (rows from byteFlusherBench.micro() or a {case: ns} map)")
+    p.add_argument("--native", action="store_true", help="build and run bench/native/microbench.cpp instead of reading a run")
+    p.add_argument("--repeat", type=int, default=3, help="--native: runs to take the fastest value of (default 3)")
+    p.add_argument("--env", default=None, help="PlatformIO env the firmware was built with (--native: \"native\")")
+    p.add_argument("--baseline", type=Path, default=DEFAULT_BASELINE)
+    p.add_argument("--threshold", type=float, default=None, help="allowed slowdown (0.15 = 15%%)")
+    p.add_argument("--update", action="store_true", help="store the run as the baseline of --env instead of checking")
+    p.add_argument("--firmware", default=None, help="firmware version recorded with --update")
+    args = p.parse_args(argv)
+    if args.native == (args.run is not None):
+        p.error("give either a run JSON or --native")
+    if args.env is None:
+        if not args.native:
+            p.error("--env is required with a run JSON")
+        args.env = NATIVE_ENV
+
+    cases = _native_run(args.repeat) if args.native else _run_cases(_load_json(args.run))
+    baseline = _load_json(args.baseline) if args.baseline.exists() else {"threshold": DEFAULT_THRESHOLD, "envs": {}}
+    envs = baseline.setdefault("envs", {})
+
+    if args.update:
+        entry = {"firmware": args.firmware, "cases": cases}
+        if "threshold" in (envs.get(args.env) or {}):
+            entry["threshold"] = envs[args.env]["threshold"]
+        envs[args.env] = entry
+        args.baseline.parent.mkdir(parents=True, exist_ok=True)
+        args.baseline.write_text(json.dumps(baseline, indent=2, sort_keys=True) + "\n", encoding="utf-8")
+        print(f"check_microbench: stored {len(cases)} cases as the {args.env} baseline in {args.baseline}")
+        return 0
+
+    env = envs.get(args.env) or {}
+    base_cases = env.get("cases") or {}
+    if not base_cases:
+        print(f"check_microbench: no baseline for {args.env} in {args.baseline}; record one with --update",
+              file=sys.stderr)
+        return 1
+
+    threshold = args.threshold
+    if threshold is None:
+        threshold = float(env.get("threshold", baseline.get("threshold", DEFAULT_THRESHOLD)))
+    failed = []
+    print(f"{'case':<18}{'ns':>10}{'baseline':>10}{'change':>9}")
+    for name in sorted(set(cases) | set(base_cases)):
+        ns = cases.get(name)
+        base = base_cases.get(name)
+        if ns is None:
+            # A case the firmware no longer reports: the baseline has to be re-recorded.
+            print(f"{name:<18}{'-':>10}{base:>10}{'missing':>9}")
+            failed.append(name)
+            continue
+        if base is None:
+            print(f"{name:<18}{ns:>10}{'-':>10}{'new':>9}")
+            continue
+        ratio = ns / base
+        ok = ratio <= 1 + threshold
+        print(f"{name:<18}{ns:>10}{base:>10}{(ratio - 1) * 100:>+8.1f}%{'' if ok else '  FAIL'}")
+        if not ok:
+            failed.append(name)
+
+    if failed:
+        print(f"check_microbench: {len(failed)} case(s) over {threshold * 100:.0f}%: {', '.join(failed)}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
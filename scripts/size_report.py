@@ -0,0 +1,101 @@
+# post:size_report.py
+#
+# Goal:
+# - Print a RAM/Flash size report for every env at the end of the build, so builds with different
+#   feature flags (BF_FEATURE_xxx, BF_RX_BUFFER_SIZE; see "Build features" in src/main.cpp) can be compared.
+# - Section totals come from `size -A`, the largest RAM/Flash symbols from `nm --size-sort`.
+# - The report is also written next to the firmware as size_report.txt.
+#
+# Only reads the linked ELF; a missing toolchain tool prints a note instead of failing the build.
+
+from __future__ import annotations
+
+from pathlib import Path
+import subprocess
+
+Import("env")
+
+# Section names of the Adafruit nRF52 linker script (.data is stored in Flash and copied to RAM).
+FLASH_SECTIONS = (".text", ".ARM.exidx", ".data", ".rodata")
+RAM_SECTIONS = (".data", ".bss", ".heap", ".stack_dummy")
+TOP_SYMBOLS = 12
+
+
+def _tool(name: str) -> str:
+    # PlatformIO sets SIZETOOL (arm-none-eabi-size); nm lives next to it.
+    size_tool = env.subst("$SIZETOOL") or "arm-none-eabi-size"
+    return size_tool[: -len("size")] + name if size_tool.endswith("size") else name
+
+
+def _run(args: list[str]) -> str | None:
+    try:
+        return subprocess.run(args, check=True, capture_output=True, text=True).stdout
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def _section_sizes(elf: Path) -> dict[str, int]:
+    out = _run([_tool("size"), "-A", str(elf)])
+    sizes: dict[str, int] = {}
+    for line in (out or "").splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".") and parts[1].isdigit():
+            sizes[parts[0]] = int(parts[1])
+    return sizes
+
+
+def _top_symbols(elf: Path) -> tuple[list[tuple[int, str]], list[tuple[int, str]]]:
+    out = _run([_tool("nm"), "--size-sort", "--demangle", "--print-size", str(elf)])
+    ram: list[tuple[int, str]] = []
+    flash: list[tuple[int, str]] = []
+    for line in (out or "").splitlines():
+        parts = line.split(maxsplit=3)
+        if len(parts) < 4:
+            continue
+        size = int(parts[1], 16)
+        kind = parts[2].lower()
+        if kind in ("b", "d"):
+            ram.append((size, parts[3]))
+        elif kind in ("t", "r"):
+            flash.append((size, parts[3]))
+    ram.sort(reverse=True)
+    flash.sort(reverse=True)
+    return ram[:TOP_SYMBOLS], flash[:TOP_SYMBOLS]
+
+
+def _feature_flags() -> list[str]:
+    flags = []
+    for item in env.get("CPPDEFINES", []):
+        name, value = (item if isinstance(item, (list, tuple)) else (item, None))[:2]
+        if str(name).startswith("BF_"):
+            flags.append(f"{name}={value}" if value is not None else str(name))
+    return sorted(flags)
+
+
+def size_report(target, source, env) -> None:
+    elf = Path(str(target[0]))
+    sizes = _section_sizes(elf)
+    if not sizes:
+        print("[size_report] size tool not available; skipping")
+        return
+
+    flash = sum(sizes.get(s, 0) for s in FLASH_SECTIONS)
+    ram = sum(sizes.get(s, 0) for s in RAM_SECTIONS if s != ".heap")
+    ram_top, flash_top = _top_symbols(elf)
+
+    lines = [
+        f"== ByteFlusher size report: {env['PIOENV']} ==",
+        f"features: {', '.join(_feature_flags()) or '(defaults: all on)'}",
+        f"flash: {flash} bytes (" + ", ".join(f"{s} {sizes.get(s, 0)}" for s in FLASH_SECTIONS) + ")",
+        f"ram (static): {ram} bytes (" + ", ".join(f"{s} {sizes.get(s, 0)}" for s in RAM_SECTIONS) + ")",
+        "largest RAM symbols:",
+        *[f"  {size:7d}  {name}" for size, name in ram_top],
+        "largest Flash symbols:",
+        *[f"  {size:7d}  {name}" for size, name in flash_top],
+    ]
+    report = "\n".join(lines)
+    print(report)
+    (elf.parent / "size_report.txt").write_text(report + "\n", encoding="utf-8")
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_report)
@@ -14,14 +14,82 @@ extern "C" void enterSerialDfu(void);
 static constexpr bool kEnableUsbCdcSerialLog = false;
 
 // 펌웨어 버전 (메이저.마이너.패치)
-static const char* kFirmwareVersion = "1.2.0";
+static const char* kFirmwareVersion = "1.2.36";
+
+// -----------------------------
+// Build features (PlatformIO env별 build_flags)
+// -----------------------------
+// 기본 빌드는 모든 기능을 켠다. env의 build_flags에 -D BF_FEATURE_xxx=0을 주면 그 기능을 뺀다.
+// - 빠진 기능의 GATT characteristic은 등록하지 않는다(웹은 구버전 펌웨어처럼 "characteristic 없음"으로 다룬다).
+// - 빠진 기능은 #if BF_FEATURE_xxx로 컴파일에서 뺀다: 상태/버퍼, 콜백, BLECharacteristic 객체까지
+//   이미지와 RAM에 남지 않는다.
+// - 버퍼 크기도 env에서 고른다: BF_RX_BUFFER_SIZE(Flush 큐), BF_MACRO_BUFFER_SIZE(매크로 큐).
+// - BF_BLE_OBSERVERS: writer 외에 status만 구독하는 추가 연결 수(0이면 예전처럼 1대만).
+// 빌드별 RAM/Flash 사용량은 scripts/size_report.py가 빌드 끝에 출력한다.
+#ifndef BF_FEATURE_MACRO
+#define BF_FEATURE_MACRO 1       // Macro char, 매크로 큐, Macro VM
+#endif
+#ifndef BF_FEATURE_MOUSE
+#define BF_FEATURE_MOUSE 1       // Mouse Jiggler, Auto Scroll(Scroll char)
+#endif
+#ifndef BF_FEATURE_NICKNAME
+#define BF_FEATURE_NICKNAME 1    // Nickname char, Flash 저장
+#endif
+#ifndef BF_FEATURE_CACHE
+#define BF_FEATURE_CACHE 1       // Payload cache char(재생은 macro TYPE_CACHED)
+#endif
+#ifndef BF_FEATURE_ESTIMATE
+#define BF_FEATURE_ESTIMATE 1    // Estimate char(dry-run)
+#endif
+#ifndef BF_FEATURE_JOURNAL
+#define BF_FEATURE_JOURNAL 1     // Power-loss journal
+#endif
+#ifndef BF_FEATURE_STATS
+#define BF_FEATURE_STATS 1       // Stats char(fault-injection 벤치마크, microbenchmark)
+#endif
+#ifndef BF_FEATURE_TARGET
+#define BF_FEATURE_TARGET 1      // Target char(Lock LED back-channel)
+#endif
+#ifndef BF_FEATURE_PROFILES
+#define BF_FEATURE_PROFILES 1    // Timing profiles, USB 호스트 auto-select
+#endif
+#ifndef BF_FEATURE_CLIP_PASTE
+#define BF_FEATURE_CLIP_PASTE 1  // Clipboard paste transport(Windows)
+#endif
+#ifndef BF_FEATURE_DOCS
+#define BF_FEATURE_DOCS 1        // Doc char(diff 재타이핑용 문서 스냅샷)
+#endif
+#ifndef BF_RX_BUFFER_SIZE
+#define BF_RX_BUFFER_SIZE 512
+#endif
+#ifndef BF_MACRO_BUFFER_SIZE
+#define BF_MACRO_BUFFER_SIZE 512
+#endif
+#ifndef BF_BLE_OBSERVERS
+#define BF_BLE_OBSERVERS 2
+#endif
+
+// 캐시된 payload는 macro 큐(TYPE_CACHED)로만 재생된다.
+#if BF_FEATURE_CACHE && !BF_FEATURE_MACRO
+#error "BF_FEATURE_CACHE needs BF_FEATURE_MACRO"
+#endif
+// status/job의 바이트 수는 u16이다.
+static_assert(BF_RX_BUFFER_SIZE >= 64 && BF_RX_BUFFER_SIZE <= 32768, "BF_RX_BUFFER_SIZE out of range");
+static_assert(BF_MACRO_BUFFER_SIZE >= 64 && BF_MACRO_BUFFER_SIZE <= 32768, "BF_MACRO_BUFFER_SIZE out of range");
+// 연결마다 SoftDevice RAM을 쓴다.
+static_assert(BF_BLE_OBSERVERS >= 0 && BF_BLE_OBSERVERS <= 4, "BF_BLE_OBSERVERS out of range");
 
 static void start_advertising();
 
 // BLE 연결 정책
-// - Control PC는 동시에 1대만 허용한다.
-// - 이미 연결된 상태에서는 광고를 중지하고, 추가 연결 시도는 즉시 끊는다.
+// - 동시에 kBleMaxConnections대까지 연결한다. 그중 writer(Control PC)는 1대뿐이다.
+// - writer는 writer가 없을 때 처음 write한 연결이다. 끊길 때까지 모든 write(flush/config/macro 등)를 독점한다.
+// - 나머지는 observer: status를 구독하고 read만 한다. observer의 write는 거절한다.
+// - 자리가 남아 있으면 연결 중에도 광고를 이어 가고, 다 차면 광고를 멈춘다.
+static constexpr uint8_t kBleObserverMax = BF_BLE_OBSERVERS;
+static constexpr uint8_t kBleMaxConnections = 1 + kBleObserverMax;
 static volatile uint16_t g_control_conn_handle = BLE_CONN_HANDLE_INVALID;
+static bool ble_write_allowed(uint16_t conn_hdl);
 
 // -----------------------------
 // BLE Nickname (Flash persisted)
@@ -29,10 +97,12 @@ static volatile uint16_t g_control_conn_handle = BLE_CONN_HANDLE_INVALID;
 // - Web UI에서 닉네임을 설정하면 보드 내부 Flash에 저장한다.
 // - 저장/로드 실패 시에도 기존 기능(전송/타이핑)은 영향 없이 동작해야 한다.
 static constexpr size_t kDeviceNicknameMaxLen = 12;
+#if BF_FEATURE_NICKNAME
 static char g_device_nickname[kDeviceNicknameMaxLen + 1] = {0};
+static const char* kDeviceNicknameFilePath = "/bf_nick.txt";
+#endif
 static bool g_storage_ready = false;
 static bool g_storage_tried = false;
-static const char* kDeviceNicknameFilePath = "/bf_nick.txt";
 
 static bool storage_try_begin() {
   if (g_storage_tried) return g_storage_ready;
@@ -70,6 +140,7 @@ static void sanitize_nickname_to(char* out, size_t out_size, const char* in) {
   out[o] = 0;
 }
 
+#if BF_FEATURE_NICKNAME
 static void set_device_nickname_runtime(const char* nickname_ascii) {
   char sanitized[kDeviceNicknameMaxLen + 1] = {0};
   sanitize_nickname_to(sanitized, sizeof(sanitized), nickname_ascii);
@@ -112,6 +183,7 @@ static void try_save_device_nickname_to_flash() {
   f.write(reinterpret_cast<const uint8_t*>(g_device_nickname), strlen(g_device_nickname));
   f.close();
 }
+#endif
 
 static const char* build_ble_device_name() {
   // 동일 기기가 여러 대일 때, 광고 이름만으로도 구분 가능하게 한다.
@@ -121,17 +193,378 @@ static const char* build_ble_device_name() {
   const uint32_t suffix32 = (id0 ^ id1);
 
   static char name[32];
+#if BF_FEATURE_NICKNAME
   if (g_device_nickname[0] != 0) {
     // 닉네임이 있으면 이름이 길어지므로 suffix는 4자리로 유지한다.
     const uint16_t suffix16 = static_cast<uint16_t>(suffix32 & 0xFFFFu);
     snprintf(name, sizeof(name), "ByteFlusher-%s-%04X", g_device_nickname, suffix16);
-  } else {
-    // 닉네임이 없으면 다중 장치 구분을 위해 8자리 suffix.
-    snprintf(name, sizeof(name), "ByteFlusher-%08lX", static_cast<unsigned long>(suffix32));
+    return name;
   }
+#endif
+  // 닉네임이 없으면 다중 장치 구분을 위해 8자리 suffix.
+  snprintf(name, sizeof(name), "ByteFlusher-%08lX", static_cast<unsigned long>(suffix32));
   return name;
 }
 
+#if BF_FEATURE_CACHE
+// -----------------------------
+// SHA-256 (payload cache 검증용)
+// -----------------------------
+struct Sha256 {
+  uint32_t state[8];
+  uint64_t bit_len;
+  uint8_t block[64];
+  uint8_t block_len;
+};
+
+static const uint32_t kSha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t sha256_rotr(uint32_t x, uint8_t n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_transform(Sha256& c, const uint8_t* p) {
+  uint32_t w[64];
+  for (uint8_t i = 0; i < 16; i++) {
+    w[i] = (static_cast<uint32_t>(p[i * 4]) << 24) | (static_cast<uint32_t>(p[i * 4 + 1]) << 16) |
+           (static_cast<uint32_t>(p[i * 4 + 2]) << 8) | static_cast<uint32_t>(p[i * 4 + 3]);
+  }
+  for (uint8_t i = 16; i < 64; i++) {
+    const uint32_t s0 = sha256_rotr(w[i - 15], 7) ^ sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32_t s1 = sha256_rotr(w[i - 2], 17) ^ sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = c.state[0], b = c.state[1], cc = c.state[2], d = c.state[3];
+  uint32_t e = c.state[4], f = c.state[5], g = c.state[6], h = c.state[7];
+  for (uint8_t i = 0; i < 64; i++) {
+    const uint32_t s1 = sha256_rotr(e, 6) ^ sha256_rotr(e, 11) ^ sha256_rotr(e, 25);
+    const uint32_t ch = (e & f) ^ (~e & g);
+    const uint32_t t1 = h + s1 + ch + kSha256K[i] + w[i];
+    const uint32_t s0 = sha256_rotr(a, 2) ^ sha256_rotr(a, 13) ^ sha256_rotr(a, 22);
+    const uint32_t maj = (a & b) ^ (a & cc) ^ (b & cc);
+    const uint32_t t2 = s0 + maj;
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = cc;
+    cc = b;
+    b = a;
+    a = t1 + t2;
+  }
+  c.state[0] += a;
+  c.state[1] += b;
+  c.state[2] += cc;
+  c.state[3] += d;
+  c.state[4] += e;
+  c.state[5] += f;
+  c.state[6] += g;
+  c.state[7] += h;
+}
+
+static void sha256_init(Sha256& c) {
+  static const uint32_t kInit[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  memcpy(c.state, kInit, sizeof(kInit));
+  c.bit_len = 0;
+  c.block_len = 0;
+}
+
+static void sha256_update(Sha256& c, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    c.block[c.block_len++] = data[i];
+    if (c.block_len == 64) {
+      sha256_transform(c, c.block);
+      c.bit_len += 512;
+      c.block_len = 0;
+    }
+  }
+}
+
+static void sha256_final(Sha256& c, uint8_t out[32]) {
+  c.bit_len += static_cast<uint64_t>(c.block_len) * 8u;
+  c.block[c.block_len++] = 0x80;
+  if (c.block_len > 56) {
+    while (c.block_len < 64) c.block[c.block_len++] = 0;
+    sha256_transform(c, c.block);
+    c.block_len = 0;
+  }
+  while (c.block_len < 56) c.block[c.block_len++] = 0;
+  for (int8_t i = 7; i >= 0; --i) {
+    c.block[c.block_len++] = static_cast<uint8_t>(c.bit_len >> (i * 8));
+  }
+  sha256_transform(c, c.block);
+  for (uint8_t i = 0; i < 8; i++) {
+    out[i * 4] = static_cast<uint8_t>(c.state[i] >> 24);
+    out[i * 4 + 1] = static_cast<uint8_t>(c.state[i] >> 16);
+    out[i * 4 + 2] = static_cast<uint8_t>(c.state[i] >> 8);
+    out[i * 4 + 3] = static_cast<uint8_t>(c.state[i]);
+  }
+}
+#endif
+
+// -----------------------------
+// CRC-32 (IEEE, journal / 통계용)
+// -----------------------------
+// state는 0xFFFFFFFF에서 시작하고, 최종 값은 ~state.
+static uint32_t crc32_update(uint32_t state, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    state ^= data[i];
+    for (uint8_t k = 0; k < 8; k++) state = (state >> 1) ^ (0xEDB88320u & (0u - (state & 1u)));
+  }
+  return state;
+}
+
+#if BF_FEATURE_CACHE
+// -----------------------------
+// Payload cache (content-addressed, Flash persisted)
+// -----------------------------
+// - 파일 모드 부트스트랩처럼 매번 같은 payload를 BLE로 다시 보내지 않도록,
+//   SHA-256을 키로 InternalFS에 저장해두고 "cached H 타이핑" 명령으로 재생한다.
+// - 용량이 작으므로(InternalFS) 개수/총량 상한을 두고 LRU로 밀어낸다.
+// - 저장 실패/손상 시에는 miss로 취급한다(웹은 원래대로 바이트를 보낸다).
+// - 인덱스/파일은 HID task에서만 건드린다(cache write는 요청만 넘기고, 재생도 HID task에서 한다).
+static const char* kPayloadCacheDir = "/bfc";
+static const char* kPayloadCacheIndexPath = "/bfc/index.bin";
+static const char* kPayloadCacheTmpPath = "/bfc/tmp.bin";
+static constexpr uint8_t kPayloadCacheMaxEntries = 4;
+static constexpr uint32_t kPayloadCacheBudgetBytes = 12 * 1024;
+
+// Cache characteristic 결과 코드
+static constexpr uint8_t kCacheResultOk = 0;
+static constexpr uint8_t kCacheResultMiss = 1;
+static constexpr uint8_t kCacheResultNoSpace = 2;
+static constexpr uint8_t kCacheResultHashMismatch = 3;
+static constexpr uint8_t kCacheResultIoError = 4;
+static constexpr uint8_t kCacheResultBadRequest = 5;
+static constexpr uint8_t kCacheResultBusy = 6;  // 앞 요청을 아직 처리 중
+
+struct PayloadCacheEntry {
+  uint8_t hash[32];
+  uint32_t size;
+  uint32_t last_used;
+};
+
+static PayloadCacheEntry g_cache_entries[kPayloadCacheMaxEntries];
+static uint8_t g_cache_entry_count = 0;
+static uint32_t g_cache_use_tick = 0;
+static bool g_cache_loaded = false;
+
+// 진행 중인 저장(BEGIN -> DATA* -> COMMIT)
+static bool g_cache_store_active = false;
+static uint8_t g_cache_store_hash[32];
+static uint32_t g_cache_store_size = 0;
+static uint32_t g_cache_store_received = 0;
+static Sha256 g_cache_store_sha;
+
+// 재생 중인 항목(evict 금지). -1이면 없음.
+static volatile int8_t g_cache_play_entry = -1;
+
+static void payload_cache_entry_path(const uint8_t* hash, char* out, size_t out_size) {
+  // 파일명은 hash 앞 16바이트(32 hex)로 충분하다(전체 hash는 index에 보관/비교).
+  static const char kHex[] = "0123456789abcdef";
+  char hex[33];
+  for (uint8_t i = 0; i < 16; i++) {
+    hex[i * 2] = kHex[hash[i] >> 4];
+    hex[i * 2 + 1] = kHex[hash[i] & 0x0F];
+  }
+  hex[32] = 0;
+  snprintf(out, out_size, "%s/%s.bin", kPayloadCacheDir, hex);
+}
+
+static void payload_cache_save_index() {
+  InternalFS.remove(kPayloadCacheIndexPath);
+  if (g_cache_entry_count == 0) return;
+  File f(InternalFS.open(kPayloadCacheIndexPath, FILE_O_WRITE));
+  if (!f) return;
+  f.write(reinterpret_cast<const uint8_t*>(g_cache_entries), sizeof(PayloadCacheEntry) * g_cache_entry_count);
+  f.close();
+}
+
+static bool payload_cache_ready() {
+  if (!storage_try_begin()) return false;
+  if (g_cache_loaded) return true;
+  g_cache_loaded = true;
+
+  InternalFS.mkdir(kPayloadCacheDir);
+  g_cache_entry_count = 0;
+  File f(InternalFS.open(kPayloadCacheIndexPath, FILE_O_READ));
+  if (f) {
+    while (g_cache_entry_count < kPayloadCacheMaxEntries) {
+      PayloadCacheEntry e;
+      if (f.read(&e, sizeof(e)) != static_cast<int>(sizeof(e))) break;
+      g_cache_entries[g_cache_entry_count++] = e;
+    }
+    f.close();
+  }
+
+  // index에만 있고 파일이 없는 항목은 버린다(전원 차단 등).
+  uint8_t o = 0;
+  for (uint8_t i = 0; i < g_cache_entry_count; i++) {
+    char path[48];
+    payload_cache_entry_path(g_cache_entries[i].hash, path, sizeof(path));
+    if (!InternalFS.exists(path)) continue;
+    if (g_cache_entries[i].last_used > g_cache_use_tick) g_cache_use_tick = g_cache_entries[i].last_used;
+    g_cache_entries[o++] = g_cache_entries[i];
+  }
+  if (o != g_cache_entry_count) {
+    g_cache_entry_count = o;
+    payload_cache_save_index();
+  }
+  return true;
+}
+
+static int8_t payload_cache_find(const uint8_t* hash) {
+  if (!payload_cache_ready()) return -1;
+  for (uint8_t i = 0; i < g_cache_entry_count; i++) {
+    if (memcmp(g_cache_entries[i].hash, hash, 32) == 0) return static_cast<int8_t>(i);
+  }
+  return -1;
+}
+
+static uint32_t payload_cache_used_bytes() {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < g_cache_entry_count; i++) total += g_cache_entries[i].size;
+  return total;
+}
+
+static void payload_cache_touch(uint8_t index) {
+  g_cache_entries[index].last_used = ++g_cache_use_tick;
+  payload_cache_save_index();
+}
+
+static void payload_cache_remove_at(uint8_t index) {
+  char path[48];
+  payload_cache_entry_path(g_cache_entries[index].hash, path, sizeof(path));
+  InternalFS.remove(path);
+  for (uint8_t i = index; i + 1 < g_cache_entry_count; i++) {
+    g_cache_entries[i] = g_cache_entries[i + 1];
+  }
+  g_cache_entry_count--;
+  // 재생 중인 항목의 index가 당겨졌으면 따라간다.
+  if (g_cache_play_entry > static_cast<int8_t>(index)) g_cache_play_entry--;
+}
+
+static bool payload_cache_evict_lru() {
+  int8_t victim = -1;
+  for (uint8_t i = 0; i < g_cache_entry_count; i++) {
+    if (static_cast<int8_t>(i) == g_cache_play_entry) continue;
+    if (victim < 0 || g_cache_entries[i].last_used < g_cache_entries[victim].last_used) {
+      victim = static_cast<int8_t>(i);
+    }
+  }
+  if (victim < 0) return false;
+  payload_cache_remove_at(static_cast<uint8_t>(victim));
+  return true;
+}
+
+static uint8_t payload_cache_store_begin(const uint8_t* hash, uint32_t size) {
+  g_cache_store_active = false;
+  if (!payload_cache_ready()) return kCacheResultIoError;
+  if (size == 0 || size > kPayloadCacheBudgetBytes) return kCacheResultNoSpace;
+
+  const int8_t existing = payload_cache_find(hash);
+  if (existing >= 0) {
+    payload_cache_touch(static_cast<uint8_t>(existing));
+    return kCacheResultOk;
+  }
+
+  // 공간 확보(LRU). 재생 중인 항목은 남긴다.
+  bool evicted = false;
+  while (g_cache_entry_count >= kPayloadCacheMaxEntries ||
+         payload_cache_used_bytes() + size > kPayloadCacheBudgetBytes) {
+    if (!payload_cache_evict_lru()) {
+      if (evicted) payload_cache_save_index();
+      return kCacheResultNoSpace;
+    }
+    evicted = true;
+  }
+  if (evicted) payload_cache_save_index();
+
+  InternalFS.remove(kPayloadCacheTmpPath);
+  memcpy(g_cache_store_hash, hash, 32);
+  g_cache_store_size = size;
+  g_cache_store_received = 0;
+  sha256_init(g_cache_store_sha);
+  g_cache_store_active = true;
+  return kCacheResultOk;
+}
+
+static uint8_t payload_cache_store_append(const uint8_t* data, uint16_t len) {
+  if (!g_cache_store_active) return kCacheResultBadRequest;
+  if (g_cache_store_received + len > g_cache_store_size) {
+    g_cache_store_active = false;
+    InternalFS.remove(kPayloadCacheTmpPath);
+    return kCacheResultBadRequest;
+  }
+
+  File f(InternalFS.open(kPayloadCacheTmpPath, FILE_O_WRITE));
+  if (!f) {
+    g_cache_store_active = false;
+    return kCacheResultIoError;
+  }
+  const size_t written = f.write(data, len);
+  f.close();
+  if (written != len) {
+    g_cache_store_active = false;
+    InternalFS.remove(kPayloadCacheTmpPath);
+    return kCacheResultIoError;
+  }
+
+  sha256_update(g_cache_store_sha, data, len);
+  g_cache_store_received += len;
+  return kCacheResultOk;
+}
+
+static uint8_t payload_cache_store_commit() {
+  if (!g_cache_store_active) return kCacheResultBadRequest;
+  g_cache_store_active = false;
+
+  uint8_t digest[32];
+  sha256_final(g_cache_store_sha, digest);
+  if (g_cache_store_received != g_cache_store_size || memcmp(digest, g_cache_store_hash, 32) != 0) {
+    InternalFS.remove(kPayloadCacheTmpPath);
+    return kCacheResultHashMismatch;
+  }
+
+  char path[48];
+  payload_cache_entry_path(g_cache_store_hash, path, sizeof(path));
+  InternalFS.remove(path);
+  if (!InternalFS.rename(kPayloadCacheTmpPath, path)) {
+    InternalFS.remove(kPayloadCacheTmpPath);
+    return kCacheResultIoError;
+  }
+
+  PayloadCacheEntry& e = g_cache_entries[g_cache_entry_count++];
+  memcpy(e.hash, g_cache_store_hash, 32);
+  e.size = g_cache_store_size;
+  e.last_used = ++g_cache_use_tick;
+  payload_cache_save_index();
+  return kCacheResultOk;
+}
+
+static uint8_t payload_cache_clear() {
+  if (!payload_cache_ready()) return kCacheResultIoError;
+  g_cache_store_active = false;
+  InternalFS.remove(kPayloadCacheTmpPath);
+  for (int8_t i = static_cast<int8_t>(g_cache_entry_count) - 1; i >= 0; --i) {
+    if (i == g_cache_play_entry) continue;
+    payload_cache_remove_at(static_cast<uint8_t>(i));
+  }
+  payload_cache_save_index();
+  return kCacheResultOk;
+}
+#endif
+
 // -----------------------------
 // BLE UUID (현재 사용값)
 // -----------------------------
@@ -139,15 +572,51 @@ static const char* kFlusherServiceUuid = "f3641400-00b0-4240-ba50-05ca45bf8abc";
 static const char* kFlushTextCharUuid = "f3641401-00b0-4240-ba50-05ca45bf8abc";
 static const char* kConfigCharUuid = "f3641402-00b0-4240-ba50-05ca45bf8abc";
 static const char* kStatusCharUuid = "f3641403-00b0-4240-ba50-05ca45bf8abc";
+#if BF_FEATURE_MACRO
 // Macro / special keys (Windows automation)
 // - Separate characteristic to avoid impacting text flusher protocol.
 static const char* kMacroCharUuid = "f3641404-00b0-4240-ba50-05ca45bf8abc";
+#endif
 // Bootloader entry (button-less firmware upload)
 // - Request from Control PC(BLE) to reboot into Serial DFU bootloader.
 static const char* kBootloaderCharUuid = "f3641405-00b0-4240-ba50-05ca45bf8abc";
+#if BF_FEATURE_NICKNAME
 // Device nickname (persisted, optional)
 static const char* kNicknameCharUuid = "f3641406-00b0-4240-ba50-05ca45bf8abc";
+#endif
+#if BF_FEATURE_MOUSE
 static const char* kScrollCharUuid = "f3641407-00b0-4240-ba50-05ca45bf8abc";
+#endif
+#if BF_FEATURE_CACHE
+// Payload cache (content-addressed, persisted)
+static const char* kCacheCharUuid = "f3641408-00b0-4240-ba50-05ca45bf8abc";
+#endif
+#if BF_FEATURE_ESTIMATE
+// Keystroke cost dry-run (estimate)
+static const char* kEstimateCharUuid = "f3641409-00b0-4240-ba50-05ca45bf8abc";
+#endif
+// Job queue (multi-session)
+static const char* kJobCharUuid = "f364140a-00b0-4240-ba50-05ca45bf8abc";
+#if BF_FEATURE_JOURNAL
+// Power-loss journal (resume after reset)
+static const char* kJournalCharUuid = "f364140b-00b0-4240-ba50-05ca45bf8abc";
+#endif
+#if BF_FEATURE_STATS
+// Flush statistics (fault-injection benchmark)
+static const char* kStatsCharUuid = "f364140c-00b0-4240-ba50-05ca45bf8abc";
+#endif
+#if BF_FEATURE_TARGET
+// Target back-channel (Lock LED ACK/NACK frames)
+static const char* kTargetCharUuid = "f364140d-00b0-4240-ba50-05ca45bf8abc";
+#endif
+#if BF_FEATURE_PROFILES
+// Timing profiles (persisted, USB host auto-select)
+static const char* kProfileCharUuid = "f364140e-00b0-4240-ba50-05ca45bf8abc";
+#endif
+#if BF_FEATURE_DOCS
+// Document snapshots (diff retyping)
+static const char* kDocCharUuid = "f364140f-00b0-4240-ba50-05ca45bf8abc";
+#endif
 
 // Flush Text 패킷 포맷(LE)
 // - [sessionId(2)][seq(2)][payload...]
@@ -167,6 +636,27 @@ static volatile uint16_t g_typing_delay_ms = kDefaultTypingDelayMs;
 static volatile uint16_t g_mode_switch_delay_ms = kDefaultModeSwitchDelayMs;
 static volatile uint16_t g_key_press_delay_ms = kDefaultKeyPressDelayMs;
 
+// 키 종류별 입력 후 대기(typingDelay 대체). 가장 비싼 키(셸의 Enter 등)에 맞춰 전부 느리게 치지 않도록,
+// 종류마다 따로 정할 수 있다. kKeyClassDelayFollow면 g_typing_delay_ms를 따른다(기본값).
+enum KeyClass : uint8_t {
+  kKeyClassPlain = 0,        // 일반 키
+  kKeyClassShifted = 1,      // Shift 조합
+  kKeyClassEnter = 2,
+  kKeyClassTab = 3,
+  kKeyClassJamo = 4,         // 한글 모드에서 치는 자모 키
+  kKeyClassAfterSwitch = 5,  // 한/영 전환 직후 첫 키(자기 종류의 값과 큰 쪽을 쓴다)
+  kKeyClassCount = 6,
+};
+static constexpr uint16_t kKeyClassDelayFollow = 0xFFFF;
+static volatile uint16_t g_key_class_delay_ms[kKeyClassCount] = {
+    kKeyClassDelayFollow, kKeyClassDelayFollow, kKeyClassDelayFollow,
+    kKeyClassDelayFollow, kKeyClassDelayFollow, kKeyClassDelayFollow};
+
+static inline uint16_t key_class_delay_ms(uint8_t cls) {
+  const uint16_t v = g_key_class_delay_ms[cls];
+  return v == kKeyClassDelayFollow ? g_typing_delay_ms : v;
+}
+
 // Pause/Resume (런타임)
 // - true면 RX 버퍼를 소비(타이핑)하지 않는다.
 // - 정확성 우선: 버퍼가 full일 때는 write(with response)가 블로킹되며 웹 전송도 멈춘다.
@@ -184,6 +674,21 @@ static volatile bool g_abort_requested = false;
 // 0=RightAlt(기본), 1=LeftAlt, 2=RightCtrl, 3=LeftCtrl, 4=RightGUI, 5=LeftGUI, 6=CapsLock
 static volatile uint8_t g_toggle_key = 0;
 
+// config write의 타이밍/전환키/키 종류별 대기도 loop에서 적용한다.
+// BLE task에서 바로 바꾸면 타이핑 중인 문자가 다른 전환키/대기로 끝날 수 있다(한/영 모드가 어긋난다).
+struct ConfigRequest {
+  uint16_t typing_delay_ms;
+  uint16_t mode_switch_delay_ms;
+  uint16_t key_press_delay_ms;
+  bool has_toggle_key;
+  uint8_t toggle_key;
+  bool has_key_class_table;
+  uint16_t key_class_delay_ms[kKeyClassCount];
+};
+static ConfigRequest g_config_request = {};
+static volatile bool g_config_pending = false;
+
+#if BF_FEATURE_MOUSE
 // -----------------------------
 // Mouse Jiggler (화면잠금 방지)
 // -----------------------------
@@ -201,6 +706,87 @@ static uint32_t g_last_flush_activity_ms = 0;
 static volatile bool g_scroll_active = false;
 static volatile uint16_t g_scroll_interval_ms = 100;
 static uint32_t g_scroll_last_ms = 0;
+#endif
+
+// -----------------------------
+// BLE 연결 파라미터 (작업 중 fast / 유휴 시 relaxed)
+// -----------------------------
+// 작업 중에는 최소 interval(7.5ms)로 처리량을, 유휴 시에는 긴 interval + slave latency로 전력을 아낀다.
+// 단위: interval 1.25ms, supervision timeout 10ms
+// (timeout > (1 + latency) * max_interval * 2 를 만족해야 한다)
+static constexpr ble_gap_conn_params_t kConnParamsFast = {6, 12, 0, 400};      // 7.5~15ms, 4s
+static constexpr ble_gap_conn_params_t kConnParamsRelaxed = {80, 120, 4, 600}; // 100~150ms, latency 4, 6s
+static constexpr uint32_t kConnRelaxAfterMs = 5000;      // 유휴가 이만큼 이어지면 relaxed로 내린다
+static constexpr uint32_t kConnRequestRetryMs = 500;     // 요청 실패(BUSY 등) 시 재시도 간격
+
+enum class ConnProfile : uint8_t { None = 0, Fast = 1, Relaxed = 2 };
+
+static volatile bool g_conn_job_started = false;  // BLE 콜백이 작업 시작을 표시한다
+static ConnProfile g_conn_profile = ConnProfile::None;  // 마지막으로 요청이 받아들여진 프로필
+static uint32_t g_conn_last_busy_ms = 0;
+static uint32_t g_conn_last_request_ms = 0;
+// Central과 협상된 현재 값(status로 내보낸다)
+static uint16_t g_conn_interval = 0;  // 1.25ms 단위
+static uint16_t g_conn_latency = 0;
+static uint16_t g_conn_timeout = 0;   // 10ms 단위
+
+#if BF_FEATURE_STATS
+// -----------------------------
+// Flush 통계 (fault-injection 벤치마크)
+// -----------------------------
+// 웹 벤치마크(web/bench.js)가 중복/ACK 유실/재연결/pause 폭주/abort를 일부러 일으키고,
+// 실제로 적재/타이핑된 결과를 이 카운터로 확인한다(goodput, 정체 시간, 바이트 단위 정확성).
+// - text_crc: 디코더에 들어간 Flush 바이트의 CRC-32 (= 웹이 보낸 텍스트와 같아야 한다)
+// - key_crc: 키보드 report([modifier][keys 6]) 스트림의 CRC-32 (= 장애 없는 실행과 같아야 한다)
+// 카운터는 생산자(BLE task)/소비자(HID task)가 필드를 나눠 쓴다(32비트 쓰기는 원자적).
+struct FlushStats {
+  uint32_t packets_accepted;  // 적재한(또는 응답을 미룬) Flush 패킷
+  uint32_t packets_ignored;   // 중복/재전송/순서 밖 패킷(응답만)
+  uint32_t packets_deferred;  // 응답을 미룬 패킷
+  uint32_t busy_rejects;      // 오래 못 적재해서 busy로 거절한 패킷
+  uint32_t stall_ms;          // 응답을 미룬 시간 합계
+  uint32_t text_bytes;        // 타이핑한 Flush 바이트
+  uint32_t text_crc;          // CRC-32 state
+  uint32_t key_reports;       // 키보드 report 수
+  uint32_t key_crc;           // CRC-32 state
+};
+
+static FlushStats g_stats = {0, 0, 0, 0, 0, 0, 0xFFFFFFFF, 0, 0xFFFFFFFF};
+static uint32_t g_stats_started_ms = 0;
+// true면 키보드 report를 보내지 않고 세기만 한다(대상 PC에 입력하지 않고 벤치마크).
+static volatile bool g_hid_muted = false;
+#else
+static constexpr bool g_hid_muted = false;  // Stats char가 없으면 mute도 없다.
+#endif
+
+// -----------------------------
+// HID emitter task
+// -----------------------------
+// 타이핑/마우스(HID 출력)는 전용 FreeRTOS task 하나에서만 한다.
+// - BLE 콜백은 큐에 넣고 task notification으로 깨우기만 한다(콜백에서 타이핑하지 않는다).
+// - 큐가 꽉 차면 콜백은 기다리지 않고 ATT 응답을 미룬다(Deferred write response 참고).
+// - 할 일이 없으면 notification을 기다리며 잠든다(다음 지글러/스크롤/status 시각까지).
+//   잠든 동안 FreeRTOS idle task가 돌아 CPU가 저전력 대기로 내려간다.
+static TaskHandle_t g_hid_task = nullptr;
+static constexpr uint32_t kIdleWaitMaxMs = 1000;
+static constexpr uint32_t kHidTaskStackWords = 1024;  // 4KB (캐시 재생의 LittleFS 읽기 포함)
+// 키 눌림 유지/입력 간격이 다른 작업(flash write 등) 때문에 늘어나지 않도록 높게 둔다.
+// 대부분의 시간은 delay()/notification 대기로 블록되므로 BLE 처리를 굶기지 않는다.
+static constexpr UBaseType_t kHidTaskPriority = TASK_PRIO_HIGH;
+
+static inline void hid_task_wake() {
+  if (g_hid_task) xTaskNotifyGive(g_hid_task);
+}
+
+// HID task를 ms 동안 재운다(콜백이 깨우면 일찍 돌아온다). task가 없으면(loop 폴백) delay로 기다린다.
+static inline void hid_task_sleep_ms(uint32_t ms) {
+  if (ms == 0) return;
+  if (!g_hid_task) {
+    delay(ms);
+    return;
+  }
+  ulTaskNotifyTake(pdTRUE, ms2tick(ms));
+}
 
 // -----------------------------
 // 디버그(USB CDC Serial)
@@ -243,9 +829,17 @@ static uint8_t const kHidReportDescriptor[] = {
 static constexpr uint8_t kReportIdKeyboard = 1;
 static constexpr uint8_t kReportIdMouse = 2;
 
+#if BF_FEATURE_TARGET || BF_FEATURE_PROFILES
+static void hid_set_report_cb(uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize);
+#endif
+
 static void hid_begin() {
   usb_hid.setPollInterval(2);
   usb_hid.setReportDescriptor(kHidReportDescriptor, sizeof(kHidReportDescriptor));
+#if BF_FEATURE_TARGET || BF_FEATURE_PROFILES
+  // 키보드 LED output report(Lock LED back-channel, 호스트 지문)
+  usb_hid.setReportCallback(NULL, hid_set_report_cb);
+#endif
   usb_hid.begin();
 }
 
@@ -253,6 +847,333 @@ static inline bool hid_ready() {
   return TinyUSBDevice.mounted() && usb_hid.ready();
 }
 
+// -----------------------------
+// USB suspend / remote wakeup
+// -----------------------------
+// Target PC가 잠들면(화면 잠금 후 절전 등) 호스트가 USB 버스를 suspend하고, 그동안 HID report를 보낼 수 없다
+// (mounted()는 true로 남고 usb_hid.ready()만 false가 된다).
+// - 칠 것이 남아 있으면(pause 아님) remote wakeup으로 호스트를 깨우고, kUsbResumeTimeoutMs 동안 재개를 기다린다.
+//   호스트가 remote wakeup을 허용하지 않았거나 깨어나지 않으면 kUsbWakeupRetryMs마다 다시 시도한다.
+// - suspend 상태는 status(byte 14)로 알린다. 웹은 전송을 멈추고, 큐의 바이트는 그대로 두었다가 재개 후 이어서 친다.
+// - 키 누름과 뗌 사이에 suspend되면 report를 보내기 전에 호스트를 깨우고 기다린다(hid_wait_endpoint).
+static constexpr uint32_t kUsbResumeTimeoutMs = 3000;
+static constexpr uint32_t kUsbWakeupRetryMs = 30000;
+static constexpr uint8_t kUsbStateSuspended = 0x01;
+static constexpr uint8_t kUsbStateWakeupPending = 0x02;  // remote wakeup을 보냈고 재개를 기다리는 중
+static constexpr uint8_t kUsbStateWakeupRefused = 0x04;  // 호스트가 remote wakeup을 허용하지 않았다
+
+struct UsbSuspendState {
+  bool suspended;
+  bool wakeup_pending;
+  bool wakeup_refused;
+  bool report_failed;  // suspend 중에 키보드 report를 못 보냈다(재개 후 release를 보낸다)
+  uint32_t since_ms;
+  uint32_t wakeup_ms;
+};
+
+static UsbSuspendState g_usb_suspend = {false, false, false, false, 0, 0};
+
+static void notify_status_if_needed(bool force);
+
+static inline bool usb_bus_suspended() {
+  return TinyUSBDevice.mounted() && TinyUSBDevice.suspended();
+}
+
+static uint8_t usb_state_flags() {
+  const UsbSuspendState st = g_usb_suspend;
+  uint8_t flags = 0;
+  if (st.suspended) flags |= kUsbStateSuspended;
+  if (st.wakeup_pending) flags |= kUsbStateWakeupPending;
+  if (st.wakeup_refused) flags |= kUsbStateWakeupRefused;
+  return flags;
+}
+
+static void usb_request_wakeup(uint32_t now) {
+  g_usb_suspend.wakeup_ms = now;
+  // 호스트가 SET_FEATURE(DEVICE_REMOTE_WAKEUP)로 허용했을 때만 보내진다.
+  const bool sent = TinyUSBDevice.remoteWakeup();
+  g_usb_suspend.wakeup_pending = sent;
+  g_usb_suspend.wakeup_refused = !sent;
+  log_line(sent ? "USB remote wakeup" : "USB remote wakeup not allowed by host");
+  notify_status_if_needed(true);
+}
+
+// 버스 상태가 바뀌면 HID task를 깨운다(TinyUSB device task에서 호출된다).
+// suspend/분리 중에는 task가 notification을 기다리며 잠들어 있고, 재개/mount가 그 잠을 끝낸다.
+extern "C" void tud_mount_cb(void) { hid_task_wake(); }
+extern "C" void tud_umount_cb(void) { hid_task_wake(); }
+extern "C" void tud_suspend_cb(bool /*remote_wakeup_en*/) { hid_task_wake(); }
+extern "C" void tud_resume_cb(void) { hid_task_wake(); }
+
+// report를 보내야 하는데 버스가 suspend되어 있으면 호스트를 깨우고 재개를 기다린다(최대 kUsbResumeTimeoutMs).
+static bool usb_wake_host_and_wait() {
+  const uint32_t started = millis();
+  if (!g_usb_suspend.wakeup_pending || (started - g_usb_suspend.wakeup_ms) >= kUsbResumeTimeoutMs) {
+    usb_request_wakeup(started);
+  }
+  for (;;) {
+    if (!usb_bus_suspended()) return TinyUSBDevice.mounted();
+    const uint32_t elapsed = millis() - started;
+    if (elapsed >= kUsbResumeTimeoutMs) return false;
+    // tud_resume_cb가 깨운다(BLE 콜백이 먼저 깨우면 남은 시간만큼 다시 잔다).
+    hid_task_sleep_ms(kUsbResumeTimeoutMs - elapsed);
+  }
+}
+
+// -----------------------------
+// HID report arbiter
+// -----------------------------
+// 키보드/마우스 report는 모두 여기를 거친다(HID task 전용).
+// - interrupt endpoint는 하나뿐이라, 이전 report가 아직 전송 중일 때(usb_hid.ready()==false) 보내면 버려진다.
+//   키보드 report는 endpoint가 빌 때까지 기다렸다 보낸다(버리거나 덮어쓰지 않는다).
+//   기다리는 동안은 task를 재운다(poll 간격 2ms). 포기하는 것은 USB가 빠졌을 때와
+//   suspend된 호스트가 깨어나지 않았을 때뿐이다(후자는 재개 후 release를 보낸다).
+// - 마우스 이동/스크롤은 delta를 모아(coalesce) 두었다가 키보드 report 사이의 빈 시간에 한 report로 보낸다.
+//   키보드가 우선이므로 느린 타이핑 중에 auto-scroll을 켜도 키 입력이 깨지지 않는다.
+// - 키 누름 유지/입력 간격 대기(hid_wait_ms) 동안 밀린 마우스 report와 auto-scroll 틱을 처리한다.
+static constexpr uint32_t kHidEndpointPollMs = 1;
+static uint32_t g_last_key_report_ms = 0;  // 마지막 키보드 report(in-band WAIT_IDLE 기준)
+#if BF_FEATURE_MOUSE
+static constexpr uint32_t kHidMouseSlackMs = 4;        // 남은 대기가 이보다 짧으면 마우스를 끼워 넣지 않는다(poll 2ms)
+static int16_t g_hid_mouse_dx = 0;
+static int16_t g_hid_mouse_scroll = 0;
+
+static void try_auto_scroll();
+#endif
+
+static bool hid_wait_endpoint() {
+  for (;;) {
+    // 기다리는 사이에 suspend될 수도 있으므로 매번 확인한다.
+    if (usb_bus_suspended() && !usb_wake_host_and_wait()) {
+      g_usb_suspend.report_failed = true;
+      return false;
+    }
+    if (!TinyUSBDevice.mounted()) return false;
+    if (usb_hid.ready()) return true;
+    hid_task_sleep_ms(kHidEndpointPollMs);
+  }
+}
+
+#if BF_FEATURE_STATS
+static void hid_count_keyboard(uint8_t modifier, const uint8_t keycodes[6]) {
+  uint8_t report[7];
+  report[0] = modifier;
+  memcpy(&report[1], keycodes, 6);
+  g_stats.key_reports++;
+  g_stats.key_crc = crc32_update(g_stats.key_crc, report, sizeof(report));
+}
+#endif
+
+static bool hid_report_keyboard(uint8_t modifier, const uint8_t keycodes[6]) {
+#if BF_FEATURE_STATS
+  hid_count_keyboard(modifier, keycodes);
+#endif
+  g_last_key_report_ms = millis();
+  if (g_hid_muted) return true;
+  if (!hid_wait_endpoint()) return false;
+  uint8_t keys[6];
+  memcpy(keys, keycodes, sizeof(keys));
+  return usb_hid.keyboardReport(kReportIdKeyboard, modifier, keys);
+}
+
+static bool hid_report_keyboard_release() {
+#if BF_FEATURE_STATS
+  static const uint8_t kNoKeys[6] = {0};
+  hid_count_keyboard(0, kNoKeys);
+#endif
+  g_last_key_report_ms = millis();
+  if (g_hid_muted) return true;
+  if (!hid_wait_endpoint()) return false;
+  return usb_hid.keyboardRelease(kReportIdKeyboard);
+}
+
+#if BF_FEATURE_MOUSE
+static inline int8_t hid_take_delta(int16_t& pending) {
+  const int16_t v = pending < -127 ? -127 : (pending > 127 ? 127 : pending);
+  pending = static_cast<int16_t>(pending - v);
+  return static_cast<int8_t>(v);
+}
+
+// 모아둔 마우스 delta를 endpoint가 비어 있을 때만 보낸다(기다리지 않는다).
+static void hid_flush_mouse() {
+  if (g_hid_mouse_dx == 0 && g_hid_mouse_scroll == 0) return;
+  if (!hid_ready()) return;
+  const int16_t dx = g_hid_mouse_dx;
+  const int16_t scroll = g_hid_mouse_scroll;
+  const int8_t x = hid_take_delta(g_hid_mouse_dx);
+  const int8_t v = hid_take_delta(g_hid_mouse_scroll);
+  if (!usb_hid.mouseReport(kReportIdMouse, 0, x, 0, v, 0)) {
+    g_hid_mouse_dx = dx;
+    g_hid_mouse_scroll = scroll;
+  }
+}
+
+static inline int16_t hid_add_delta(int16_t pending, int8_t d) {
+  const int32_t v = static_cast<int32_t>(pending) + d;
+  return static_cast<int16_t>(v < -1024 ? -1024 : (v > 1024 ? 1024 : v));
+}
+
+static void hid_queue_mouse_move(int8_t dx) {
+  g_hid_mouse_dx = hid_add_delta(g_hid_mouse_dx, dx);
+  hid_flush_mouse();
+}
+
+static void hid_queue_mouse_scroll(int8_t v) {
+  g_hid_mouse_scroll = hid_add_delta(g_hid_mouse_scroll, v);
+  hid_flush_mouse();
+}
+#endif
+
+// delay() 대신 쓴다: 키보드 타이밍은 그대로 두고, 남는 시간에 마우스 report를 끼워 넣는다.
+// 기다리는 동안 task는 notification 대기로 잠든다(마우스 일이 있으면 그 시각에 깨어난다).
+static void hid_wait_ms(uint32_t ms) {
+  const uint32_t started = millis();
+  for (;;) {
+    const uint32_t elapsed = millis() - started;
+    if (elapsed >= ms) return;
+    uint32_t remaining = ms - elapsed;
+#if BF_FEATURE_MOUSE
+    if (remaining > kHidMouseSlackMs) {
+      try_auto_scroll();
+      hid_flush_mouse();
+    }
+    if (g_hid_mouse_dx != 0 || g_hid_mouse_scroll != 0) {
+      // endpoint가 바빠 못 보낸 delta: 다음 poll에 다시 보낸다.
+      if (remaining > kHidEndpointPollMs) remaining = kHidEndpointPollMs;
+    } else if (g_scroll_active) {
+      // 다음 auto-scroll 틱까지
+      const uint32_t since = millis() - g_scroll_last_ms;
+      const uint32_t tick = since >= g_scroll_interval_ms ? kHidEndpointPollMs : g_scroll_interval_ms - since;
+      if (tick < remaining) remaining = tick;
+    }
+#endif
+    hid_task_sleep_ms(remaining);
+  }
+}
+
+// -----------------------------
+// Lock LED back-channel (Target -> 장치)
+// -----------------------------
+// 호스트는 Lock 키 상태가 바뀔 때마다 모든 키보드에 LED output report를 보낸다.
+// Target PC의 PowerShell helper(bf_led)가 Num/Scroll Lock을 토글해 chunk마다 ACK/NACK 프레임을 보내면,
+// 장치는 set_report 콜백에서 이를 복원해 Target characteristic으로 웹에 알린다.
+// - 심볼: Scroll Lock 변화 = 1, Num Lock 변화 = 0 (Caps Lock은 한/영 전환키로 쓸 수 있어 무시한다)
+// - 프레임(16비트, MSB first): [sync 1011(4)][kind(1): 1=ACK 0=NACK][chunk seq(8)][check(3)]
+//   check = (v + (v >> 3) + (v >> 6)) & 7, v = (kind << 8) | seq
+// - 최근 16심볼을 밀어가며(sliding) sync+check가 맞을 때만 프레임으로 인정한다.
+//   두 LED가 한 report에서 같이 바뀌거나 심볼 간격이 길면 쌓인 심볼을 버린다.
+// Target char가 빠지면(BF_FEATURE_TARGET=0) 프레임 복원은 빠지고 호스트 지문용 기록만 남는다.
+#if BF_FEATURE_TARGET || BF_FEATURE_PROFILES
+#if BF_FEATURE_TARGET
+static constexpr uint32_t kLedSymbolGapMs = 1000;
+static constexpr uint16_t kLedFrameSync = 0xB;
+static constexpr uint8_t kLedFrameQueueSize = 16;  // 2의 거듭제곱
+
+struct LedFrame {
+  uint8_t kind;  // 1=ACK, 0=NACK
+  uint8_t seq;
+};
+
+// 생산자: USB(TinyUSB) task의 set_report 콜백 / 소비자: HID task
+static LedFrame g_led_frames[kLedFrameQueueSize];
+static volatile uint8_t g_led_frame_head = 0;
+static volatile uint8_t g_led_frame_tail = 0;
+static uint16_t g_led_shift = 0;
+static uint8_t g_led_bits = 0;
+static uint32_t g_led_last_symbol_ms = 0;
+#endif
+static volatile uint8_t g_led_state = 0;  // 마지막 LED 상태(KEYBOARD_LED_*)
+static bool g_led_state_known = false;
+// 호스트 지문(Timing profiles 참고): mount 후 처음 받은 LED 상태와 report 개수(7에서 멈춤)
+static volatile uint8_t g_led_first_state = 0;
+static volatile uint8_t g_led_report_count = 0;
+
+#if BF_FEATURE_TARGET
+
+static inline uint8_t led_frame_check(uint16_t v) {
+  return static_cast<uint8_t>((v + (v >> 3) + (v >> 6)) & 7u);
+}
+
+static void led_push_symbol(uint8_t bit, uint32_t now_ms) {
+  if (g_led_bits > 0 && (now_ms - g_led_last_symbol_ms) > kLedSymbolGapMs) g_led_bits = 0;
+  g_led_last_symbol_ms = now_ms;
+  g_led_shift = static_cast<uint16_t>((g_led_shift << 1) | bit);
+  if (g_led_bits < 16) g_led_bits++;
+  if (g_led_bits < 16) return;
+
+  const uint16_t frame = g_led_shift;
+  const uint16_t v = static_cast<uint16_t>((frame >> 3) & 0x1FFu);
+  if ((frame >> 12) != kLedFrameSync || led_frame_check(v) != (frame & 7u)) return;
+
+  g_led_bits = 0;
+  const uint8_t head = g_led_frame_head;
+  const uint8_t next = static_cast<uint8_t>((head + 1) & (kLedFrameQueueSize - 1));
+  if (next == g_led_frame_tail) return;  // 소비가 밀리면 버린다(웹은 타임아웃 후 재전송)
+  g_led_frames[head].kind = static_cast<uint8_t>(v >> 8);
+  g_led_frames[head].seq = static_cast<uint8_t>(v & 0xFF);
+  g_led_frame_head = next;
+  hid_task_wake();
+}
+#endif
+
+static void led_on_output_report(uint8_t leds, uint32_t now_ms) {
+  if (g_led_report_count < 7) g_led_report_count++;
+  if (!g_led_state_known) {
+    g_led_state_known = true;
+    g_led_state = leds;
+    g_led_first_state = leds;
+    return;
+  }
+#if BF_FEATURE_TARGET
+  const uint8_t changed = static_cast<uint8_t>((g_led_state ^ leds) & (KEYBOARD_LED_NUMLOCK | KEYBOARD_LED_SCROLLLOCK));
+  g_led_state = leds;
+  if (changed == 0) return;
+  if (changed == (KEYBOARD_LED_NUMLOCK | KEYBOARD_LED_SCROLLLOCK)) {
+    g_led_bits = 0;
+    return;
+  }
+  led_push_symbol((changed & KEYBOARD_LED_SCROLLLOCK) ? 1 : 0, now_ms);
+#else
+  (void)now_ms;
+#endif
+}
+
+static void hid_set_report_cb(uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize) {
+  if (report_type != HID_REPORT_TYPE_OUTPUT || !buffer || bufsize == 0) return;
+  // TinyUSB 버전에 따라 report ID가 버퍼 앞에 남아 있을 수 있다.
+  if (report_id == 0 && bufsize >= 2 && buffer[0] == kReportIdKeyboard) {
+    led_on_output_report(buffer[1], millis());
+    return;
+  }
+  if (report_id != kReportIdKeyboard && report_id != 0) return;
+  led_on_output_report(buffer[0], millis());
+}
+
+#if BF_FEATURE_PROFILES
+// USB가 빠지면(호스트가 바뀔 수 있다) 지문용 기록과 쌓인 심볼을 버린다.
+static void led_reset_host_state() {
+  noInterrupts();
+  g_led_state_known = false;
+  g_led_first_state = 0;
+  g_led_report_count = 0;
+#if BF_FEATURE_TARGET
+  g_led_bits = 0;
+#endif
+  interrupts();
+}
+#endif
+
+#if BF_FEATURE_TARGET
+static bool led_pop_frame(LedFrame* out) {
+  const uint8_t tail = g_led_frame_tail;
+  if (tail == g_led_frame_head) return false;
+  *out = g_led_frames[tail];
+  g_led_frame_tail = static_cast<uint8_t>((tail + 1) & (kLedFrameQueueSize - 1));
+  return true;
+}
+#endif
+#endif
+
 static void hid_send_key(uint8_t modifier, uint8_t keycode) {
   if (!hid_ready()) {
     return;
@@ -261,10 +1182,14 @@ static void hid_send_key(uint8_t modifier, uint8_t keycode) {
   uint8_t keycodes[6] = {0};
   keycodes[0] = keycode;
 
-  usb_hid.keyboardReport(kReportIdKeyboard, modifier, keycodes);
-  delay(g_key_press_delay_ms);
-  usb_hid.keyboardRelease(kReportIdKeyboard);
-  delay(g_key_press_delay_ms);
+  hid_report_keyboard(modifier, keycodes);
+  hid_wait_ms(g_key_press_delay_ms);
+  hid_report_keyboard_release();
+  hid_wait_ms(g_key_press_delay_ms);
+}
+
+static void hid_send_combo(uint8_t modifier, uint8_t keycode) {
+  hid_send_key(modifier, keycode);
 }
 
 static void hid_tap_modifier(uint8_t modifier) {
@@ -273,11 +1198,11 @@ static void hid_tap_modifier(uint8_t modifier) {
     return;
   }
 
-  uint8_t keycodes[6] = {0};
-  usb_hid.keyboardReport(kReportIdKeyboard, modifier, keycodes);
-  delay(g_key_press_delay_ms);
-  usb_hid.keyboardRelease(kReportIdKeyboard);
-  delay(g_key_press_delay_ms);
+  const uint8_t keycodes[6] = {0};
+  hid_report_keyboard(modifier, keycodes);
+  hid_wait_ms(g_key_press_delay_ms);
+  hid_report_keyboard_release();
+  hid_wait_ms(g_key_press_delay_ms);
 }
 
 static void hid_tap_toggle_key() {
@@ -474,8 +1399,41 @@ static bool ascii_to_hid(char c, uint8_t& modifier, uint8_t& keycode) {
 // -----------------------------
 // 한/영 전환 + 한글(두벌식) 타이핑
 // -----------------------------
-static bool g_is_korean_mode = false;
-static bool g_prev_was_cr = false;
+// 키 입력 비용(dry-run) 집계. ms는 현재 장치 타이밍 설정 기준이다.
+struct TypingCost {
+  uint32_t bytes;
+  uint32_t keystrokes;
+  uint32_t mode_switches;
+  uint32_t typing_ms;       // 키 입력 후 대기(typingDelay)
+  uint32_t key_press_ms;    // 키 눌림/뗌 유지(keyPressDelay x2)
+  uint32_t mode_switch_ms;  // 한/영 전환 후 대기(modeSwitchDelay)
+  uint32_t replaced;        // 키보드로 칠 수 없어 '?'로 바꾼 문자 수
+  uint32_t wait_ms;         // in-band WAIT/WAIT_IDLE 대기
+  // 타이밍과 무관한 키 수: 다른 타이밍으로 ms를 다시 계산할 때 쓴다(typing_cost_ms).
+  uint32_t class_keys[kKeyClassCount];   // 종류별 키 수(전환 직후 첫 키 제외)
+  uint32_t settle_keys[kKeyClassCount];  // 전환 직후 첫 키(자기 종류 값과 AfterSwitch 값 중 큰 쪽)
+  uint32_t chord_keys;                   // in-band CHORD(typingDelay)
+};
+
+// 디코더 상태(UTF-8/CRLF/한영모드).
+// - cost가 있으면 dry-run: HID 출력/delay 없이 같은 규칙으로 비용만 센다.
+// - 실제 타이핑은 g_typing 하나만 쓴다.
+struct TypingState {
+  bool korean_mode;
+  bool prev_was_cr;
+  uint32_t utf8_cp;
+  uint8_t utf8_need;
+  TypingCost* cost;
+  // in-band 제어 시퀀스(0xFF [op] [args]) 파싱 상태
+  uint8_t ctl_state = 0;    // 0: 텍스트, 1: op 대기, 2: 인자 수집 중
+  uint8_t ctl_op = 0;
+  uint8_t ctl_need = 0;     // 남은 인자 바이트 수
+  uint8_t ctl_len = 0;
+  uint8_t ctl_args[4] = {};
+  bool after_switch = false;  // 한/영 전환 직후(다음 키에 kKeyClassAfterSwitch 대기)
+};
+
+static TypingState g_typing = {false, false, 0, 0, nullptr};
 
 // 두벌식 매핑(SD Flusher 테이블 기반)
 static const char* const kChoData[19] = {
@@ -487,47 +1445,84 @@ static const char* const kJungData[21] = {
 static const char* const kJongData[28] = {"",  "r", "R", "rt", "s", "sw", "sg", "e", "f", "fr", "fa", "fq", "ft", "fx", "fv", "fg",
                                          "a", "q", "qt", "t",  "T", "d",  "w", "c", "z",  "x",  "v",  "g"};
 
-static void switch_to_korean() {
-  if (g_is_korean_mode) {
+static void typing_toggle_mode(TypingState& st) {
+  st.after_switch = true;
+  if (st.cost) {
+    st.cost->mode_switches++;
+    st.cost->key_press_ms += 2u * g_key_press_delay_ms;
+    st.cost->mode_switch_ms += g_mode_switch_delay_ms;
     return;
   }
   // Target PC에서 선택된 전환키가 한/영 전환으로 설정되어 있다는 전제
   hid_tap_toggle_key();
-  delay(g_mode_switch_delay_ms);
-  g_is_korean_mode = true;
+  hid_wait_ms(g_mode_switch_delay_ms);
 }
 
-static void switch_to_english() {
-  if (!g_is_korean_mode) {
+static void switch_to_korean(TypingState& st) {
+  if (st.korean_mode) {
     return;
   }
-  hid_tap_toggle_key();
-  delay(g_mode_switch_delay_ms);
-  g_is_korean_mode = false;
+  typing_toggle_mode(st);
+  st.korean_mode = true;
 }
 
-static void type_ascii_char(char c) {
-  uint8_t modifier = 0;
-  uint8_t keycode = 0;
-  if (!ascii_to_hid(c, modifier, keycode)) {
-    // 매핑이 없는 ASCII는 '?'로 대체
-    ascii_to_hid('?', modifier, keycode);
+static void switch_to_english(TypingState& st) {
+  if (!st.korean_mode) {
+    return;
   }
-  hid_send_key(modifier, keycode);
-  delay(g_typing_delay_ms);
+  typing_toggle_mode(st);
+  st.korean_mode = false;
 }
 
-static void type_keys(const char* keys) {
+// 이 키를 친 뒤 기다릴 시간(키 종류별 표). 한글 모드에서 치는 키는 모두 자모다
+// (ASCII는 영어로 전환한 뒤 친다).
+static uint16_t typing_key_delay_ms(TypingState& st, char c, uint8_t modifier) {
+  uint8_t cls = kKeyClassPlain;
+  if (st.korean_mode) cls = kKeyClassJamo;
+  else if (c == '\n' || c == '\r') cls = kKeyClassEnter;
+  else if (c == '\t') cls = kKeyClassTab;
+  else if ((modifier & KEYBOARD_MODIFIER_LEFTSHIFT) != 0) cls = kKeyClassShifted;
+  uint16_t ms = key_class_delay_ms(cls);
+  if (st.cost) (st.after_switch ? st.cost->settle_keys : st.cost->class_keys)[cls]++;
+  if (st.after_switch) {
+    st.after_switch = false;
+    const uint16_t settle = key_class_delay_ms(kKeyClassAfterSwitch);
+    if (settle > ms) ms = settle;
+  }
+  return ms;
+}
+
+static void type_ascii_char(TypingState& st, char c) {
+  uint8_t modifier = 0;
+  uint8_t keycode = 0;
+  const bool mapped = ascii_to_hid(c, modifier, keycode);
+  if (!mapped) {
+    // 매핑이 없는 ASCII는 '?'로 대체
+    ascii_to_hid('?', modifier, keycode);
+  }
+  const uint16_t wait_ms = typing_key_delay_ms(st, c, modifier);
+  if (st.cost) {
+    if (!mapped) st.cost->replaced++;
+    st.cost->keystrokes++;
+    st.cost->key_press_ms += 2u * g_key_press_delay_ms;
+    st.cost->typing_ms += wait_ms;
+    return;
+  }
+  hid_send_key(modifier, keycode);
+  hid_wait_ms(wait_ms);
+}
+
+static void type_keys(TypingState& st, const char* keys) {
   for (int i = 0; keys[i] != '\0'; i++) {
     // 매핑 문자열은 ASCII 키 시퀀스이므로 영어 모드에서 타이핑한다.
     // (한글 모드에서 알파벳을 누르면 자모가 입력되어야 한다.)
     // 단, 이 함수는 '이미 한국어 모드' 상태에서 호출된다.
     // 따라서 여기서는 모드 전환을 하지 않는다.
-    type_ascii_char(keys[i]);
+    type_ascii_char(st, keys[i]);
   }
 }
 
-static void type_korean_syllable(uint16_t unicode) {
+static void type_korean_syllable(TypingState& st, uint16_t unicode) {
   // 한글 음절(가~힣)만 처리
   const uint16_t kKoreanStart = 0xAC00;
   const uint16_t kKoreanEnd = 0xD7A3;
@@ -541,17 +1536,17 @@ static void type_korean_syllable(uint16_t unicode) {
   const int jong = code % 28;
 
   if (cho >= 0 && cho < 19) {
-    type_keys(kChoData[cho]);
+    type_keys(st, kChoData[cho]);
   }
   if (jung >= 0 && jung < 21) {
-    type_keys(kJungData[jung]);
+    type_keys(st, kJungData[jung]);
   }
   if (jong > 0 && jong < 28) {
-    type_keys(kJongData[jong]);
+    type_keys(st, kJongData[jong]);
   }
 }
 
-static void type_codepoint(uint32_t cp) {
+static void type_codepoint(TypingState& st, uint32_t cp) {
   // ASCII 제어문자/기본 문자
   if (cp <= 0x7F) {
     const char c = static_cast<char>(cp);
@@ -560,83 +1555,249 @@ static void type_codepoint(uint32_t cp) {
     if (c == '\r') {
       // CR 단독도 줄바꿈으로 취급한다.
       // 단, 바로 뒤에 LF가 오면 CRLF로 보고 LF는 무시(엔터 중복 방지).
-      g_prev_was_cr = true;
-      switch_to_english();
-      type_ascii_char('\n');
+      st.prev_was_cr = true;
+      switch_to_english(st);
+      type_ascii_char(st, '\n');
       return;
     }
     if (c == '\n') {
-      if (g_prev_was_cr) {
+      if (st.prev_was_cr) {
         // CRLF: 이미 CR에서 엔터를 쳤으므로 LF는 무시
-        g_prev_was_cr = false;
+        st.prev_was_cr = false;
         return;
       }
       // 한글 모드에서 엔터가 어색한 케이스가 있어서 영어로 돌려 엔터
-      switch_to_english();
-      type_ascii_char('\n');
+      switch_to_english(st);
+      type_ascii_char(st, '\n');
       return;
     }
     if (c == '\t') {
-      g_prev_was_cr = false;
-      switch_to_english();
-      type_ascii_char('\t');
+      st.prev_was_cr = false;
+      switch_to_english(st);
+      type_ascii_char(st, '\t');
       return;
     }
 
-    g_prev_was_cr = false;
-    switch_to_english();
-    type_ascii_char(c);
+    st.prev_was_cr = false;
+    switch_to_english(st);
+    type_ascii_char(st, c);
     return;
   }
 
-  g_prev_was_cr = false;
+  st.prev_was_cr = false;
 
   // 한글 음절(가~힣)
   if (cp >= 0xAC00 && cp <= 0xD7A3) {
-    switch_to_korean();
-    type_korean_syllable(static_cast<uint16_t>(cp));
+    switch_to_korean(st);
+    type_korean_syllable(st, static_cast<uint16_t>(cp));
     return;
   }
 
   // 그 외 유니코드는 현재 입력 정책이 애매하므로 '?'로 대체
   // (현재 입력 텍스트는 ASCII + 한글 음절로 제한하는 것을 권장)
-  switch_to_english();
-  type_ascii_char('?');
+  if (st.cost) st.cost->replaced++;
+  switch_to_english(st);
+  type_ascii_char(st, '?');
+}
+
+
+// -----------------------------
+// In-band 제어 시퀀스 (flush 바이트 스트림 안)
+// -----------------------------
+// 텍스트와 같은 순서로 처리해야 하는 대기/단축키/한영 강제를 macro 채널과 웹 sleep 대신 스트림에 넣는다.
+// 형식: [0xFF][op][args...]
+// - 0xFF는 UTF-8에 나오지 않는 바이트라 텍스트와 겹치지 않는다.
+// - op와 인자 바이트는 모두 bit7=1이다(값은 하위 7bit). 그래서 시퀀스 안에 '\n'/ASCII가 없고,
+//   journal checkpoint, 클립보드 구간, 캐시 재생의 줄 단위 처리가 시퀀스를 줄로 착각하지 않는다.
+// - 값(u14)은 2바이트: [0x80 | (v & 0x7F)][0x80 | (v >> 7)]
+// - bit7=0 바이트가 중간에 오면 시퀀스를 버리고 그 바이트를 텍스트로 처리한다. 알 수 없는 op는 무시한다.
+//
+// Ops:
+//   0x81 WAIT      [ms(u14)]         장치에서 ms만큼 대기(다음 바이트를 치지 않는다)
+//   0x82 CHORD     [mod(u14)][key(u14)]  chord 1회(한/영 모드는 바꾸지 않는다)
+//   0x83 MODE      [m(u14)]          0: 영어 강제, 1: 한글 강제, 2/3: 키 입력 없이 영어/한글로 간주(호스트 상태 재동기화)
+//   0x84 WAIT_IDLE [quiet(u14)]      마지막 키보드 report가 호스트로 나가고 quiet ms 동안 키 입력이 없을 때까지 대기
+static constexpr uint8_t kInbandEscape = 0xFF;
+static constexpr uint8_t kInbandVersion = 1;
+
+enum InbandOp : uint8_t {
+  kInbandWait = 0x81,
+  kInbandChord = 0x82,
+  kInbandMode = 0x83,
+  kInbandWaitIdle = 0x84,
+};
+
+// WAIT/WAIT_IDLE은 HID task를 막지 않는다: 상태만 걸어 두고 hid_task_iteration이 시간이 될 때까지 텍스트를 멈춘다.
+struct InbandWait {
+  bool active;
+  bool idle;  // true: WAIT_IDLE(마지막 키보드 report 기준)
+  uint32_t started_ms;
+  uint16_t ms;
+};
+
+static InbandWait g_inband_wait = {false, false, 0, 0};
+
+static uint8_t inband_arg_bytes(uint8_t op) {
+  switch (op) {
+    case kInbandWait:
+    case kInbandMode:
+    case kInbandWaitIdle:
+      return 2;
+    case kInbandChord:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+static inline uint16_t inband_u14(const uint8_t* p) {
+  return static_cast<uint16_t>((p[0] & 0x7F) | ((p[1] & 0x7F) << 7));
+}
+
+static void inband_run(TypingState& st) {
+  const uint16_t a = inband_u14(&st.ctl_args[0]);
+  switch (st.ctl_op) {
+    case kInbandWait:
+    case kInbandWaitIdle:
+      if (st.cost) {
+        st.cost->wait_ms += a;
+        return;
+      }
+      g_inband_wait = {true, st.ctl_op == kInbandWaitIdle, millis(), a};
+      return;
+    case kInbandChord: {
+      const uint8_t modifier = static_cast<uint8_t>(a);
+      const uint8_t keycode = static_cast<uint8_t>(inband_u14(&st.ctl_args[2]));
+      st.prev_was_cr = false;
+      if (st.cost) {
+        st.cost->keystrokes++;
+        st.cost->chord_keys++;
+        st.cost->key_press_ms += 2u * g_key_press_delay_ms;
+        st.cost->typing_ms += g_typing_delay_ms;
+        return;
+      }
+      hid_send_key(modifier, keycode);
+      hid_wait_ms(g_typing_delay_ms);
+      return;
+    }
+    case kInbandMode:
+      if (a == 0) switch_to_english(st);
+      else if (a == 1) switch_to_korean(st);
+      else if (a == 2 || a == 3) st.korean_mode = (a == 3);
+      return;
+    default:
+      return;
+  }
+}
+
+static void inband_reset(TypingState& st) {
+  st.ctl_state = 0;
+  st.ctl_op = 0;
+  st.ctl_need = 0;
+  st.ctl_len = 0;
+}
+
+// 시퀀스 진행 중의 바이트. false면 시퀀스가 깨졌으므로 호출자가 b를 텍스트로 다시 처리한다.
+static bool inband_feed(TypingState& st, uint8_t b) {
+  if ((b & 0x80) == 0) {
+    inband_reset(st);
+    return false;
+  }
+  if (st.ctl_state == 1) {
+    st.ctl_op = b;
+    st.ctl_need = inband_arg_bytes(b);
+    st.ctl_len = 0;
+    if (st.ctl_need == 0) {
+      // 알 수 없는 op(인자 길이를 모른다): 무시
+      inband_reset(st);
+      return true;
+    }
+    st.ctl_state = 2;
+    return true;
+  }
+  st.ctl_args[st.ctl_len++] = b;
+  if (--st.ctl_need == 0) {
+    inband_run(st);
+    inband_reset(st);
+  }
+  return true;
+}
+
+// HID task: in-band 대기 중이면 true(다음 바이트를 치지 않는다).
+static bool inband_wait_in_loop() {
+  if (!g_inband_wait.active) return false;
+  const uint32_t now = millis();
+  if (g_inband_wait.idle) {
+    // 호스트가 마지막 report를 아직 가져가지 않았으면 그때부터 센다.
+    if (!g_hid_muted && !usb_hid.ready()) return true;
+    if (now - g_last_key_report_ms < g_inband_wait.ms) return true;
+  } else if (now - g_inband_wait.started_ms < g_inband_wait.ms) {
+    return true;
+  }
+  g_inband_wait.active = false;
+  return false;
 }
 
-// UTF-8 스트림 디코더 상태
-static uint32_t g_utf8_cp = 0;
-static uint8_t g_utf8_need = 0;
+// idle_wait용: in-band 대기가 끝날 때까지 남은 시간(없으면 UINT32_MAX)
+static uint32_t inband_wait_ms(uint32_t now) {
+  if (!g_inband_wait.active) return UINT32_MAX;
+  if (g_inband_wait.idle && !g_hid_muted && !usb_hid.ready()) return 1;
+  const uint32_t from = g_inband_wait.idle ? g_last_key_report_ms : g_inband_wait.started_ms;
+  const uint32_t elapsed = now - from;
+  return elapsed >= g_inband_wait.ms ? 0 : g_inband_wait.ms - elapsed;
+}
 
 static void reset_input_state_no_keystroke() {
   // Stop(즉시 폐기) 시 정확성 우선:
   // - 기존 버퍼 내용을 버린다.
   // - UTF-8/CRLF/한글모드 내부 상태만 초기화한다(추가 키 입력은 하지 않는다).
-  g_utf8_cp = 0;
-  g_utf8_need = 0;
-  g_prev_was_cr = false;
-  g_is_korean_mode = false;
+  g_typing.utf8_cp = 0;
+  g_typing.utf8_need = 0;
+  g_typing.prev_was_cr = false;
+  g_typing.korean_mode = false;
+  g_typing.after_switch = false;
+  inband_reset(g_typing);
+  g_inband_wait.active = false;
 }
 
-static void process_input_byte(uint8_t b) {
-  if (g_utf8_need == 0) {
+// UTF-8 스트림 디코더
+static void process_input_byte(TypingState& st, uint8_t b) {
+  if (st.cost) st.cost->bytes++;
+
+  if (b == kInbandEscape) {
+    // 끝나지 않은 UTF-8 문자/시퀀스는 버리고 새 시퀀스를 시작한다.
+    st.utf8_cp = 0;
+    st.utf8_need = 0;
+    inband_reset(st);
+    st.ctl_state = 1;
+    return;
+  }
+  if (st.ctl_state != 0) {
+    if (inband_feed(st, b)) return;
+    // 깨진 시퀀스: 현재 바이트는 텍스트로 재해석(bytes는 한 번만 센다)
+    if (st.cost) st.cost->bytes--;
+    process_input_byte(st, b);
+    return;
+  }
+
+  if (st.utf8_need == 0) {
     if (b < 0x80) {
-      type_codepoint(b);
+      type_codepoint(st, b);
       return;
     }
     if ((b & 0xE0) == 0xC0) {
-      g_utf8_cp = (b & 0x1F);
-      g_utf8_need = 1;
+      st.utf8_cp = (b & 0x1F);
+      st.utf8_need = 1;
       return;
     }
     if ((b & 0xF0) == 0xE0) {
-      g_utf8_cp = (b & 0x0F);
-      g_utf8_need = 2;
+      st.utf8_cp = (b & 0x0F);
+      st.utf8_need = 2;
       return;
     }
     if ((b & 0xF8) == 0xF0) {
-      g_utf8_cp = (b & 0x07);
-      g_utf8_need = 3;
+      st.utf8_cp = (b & 0x07);
+      st.utf8_need = 3;
       return;
     }
 
@@ -646,59 +1807,116 @@ static void process_input_byte(uint8_t b) {
 
   if ((b & 0xC0) != 0x80) {
     // 깨진 UTF-8: 상태 리셋
-    g_utf8_cp = 0;
-    g_utf8_need = 0;
-    // 현재 바이트는 새 시작으로 재해석
-    process_input_byte(b);
+    st.utf8_cp = 0;
+    st.utf8_need = 0;
+    // 현재 바이트는 새 시작으로 재해석(bytes는 한 번만 센다)
+    if (st.cost) st.cost->bytes--;
+    process_input_byte(st, b);
     return;
   }
 
-  g_utf8_cp = (g_utf8_cp << 6) | (b & 0x3F);
-  g_utf8_need--;
-  if (g_utf8_need == 0) {
-    type_codepoint(g_utf8_cp);
-    g_utf8_cp = 0;
+  st.utf8_cp = (st.utf8_cp << 6) | (b & 0x3F);
+  st.utf8_need--;
+  if (st.utf8_need == 0) {
+    type_codepoint(st, st.utf8_cp);
+    st.utf8_cp = 0;
   }
 }
 
+static inline void process_input_byte(uint8_t b) {
+  process_input_byte(g_typing, b);
+}
+
+static inline uint32_t typing_cost_total_ms(const TypingCost& c) {
+  return c.typing_ms + c.key_press_ms + c.mode_switch_ms + c.wait_ms;
+}
+
 static inline uint16_t le16(const uint8_t* p) {
   return static_cast<uint16_t>(p[0]) | (static_cast<uint16_t>(p[1]) << 8);
 }
 
+static inline uint32_t le32(const uint8_t* p) {
+  return static_cast<uint32_t>(le16(&p[0])) | (static_cast<uint32_t>(le16(&p[2])) << 16);
+}
+
 static inline uint16_t clamp_u16(uint16_t v, uint16_t min_v, uint16_t max_v) {
   if (v < min_v) return min_v;
   if (v > max_v) return max_v;
   return v;
 }
 
-static void rb_clear();
-static void stash_clear();
+static void jobs_restart(uint16_t session_id);
+static void job_publish_state();
+#if BF_FEATURE_MACRO
+static void macro_clear();
+static void macro_vm_reset();
+#endif
+#if BF_FEATURE_CACHE
+static void payload_cache_play_stop();
+#endif
+static void deferred_write_discard();
+static void hid_task(void* arg);
 static void notify_status_if_needed(bool force);
+#if BF_FEATURE_CACHE
+static void journal_note_cache_byte(uint8_t b);
+#endif
+static void journal_note_text_byte(uint16_t session_id, uint8_t b);
+#if BF_FEATURE_CLIP_PASTE
+static void journal_note_pasted_text(uint16_t session_id, const uint8_t* data, uint16_t len);
+#endif
+static void journal_request_discard(uint16_t session_id);
+static void journal_discard_session(uint16_t session_id);
+#if BF_FEATURE_JOURNAL
+static void journal_publish_state();
+#endif
+#if BF_FEATURE_PROFILES
+static void profile_reapply();
+static void profile_publish_state();
+#endif
+static bool is_flush_idle();
+
+// 키 종류별 대기 표의 한 칸(u16 LE). 0xFFFF(typingDelay를 따름)는 그대로 둔다.
+static inline uint16_t key_class_delay_from_le(const uint8_t* p) {
+  const uint16_t v = le16(p);
+  return v == kKeyClassDelayFollow ? v : clamp_u16(v, 0, 1000);
+}
 
-static void config_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+static void config_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
   // 포맷(호환):
   // - LE u16 * 3 => [typingDelayMs][modeSwitchDelayMs][keyPressDelayMs]
   // - + u8(선택) => [toggleKey]
   // - + u8(선택) => [flags]
   //   - flags bit0: paused
   //   - flags bit1: abort(즉시 폐기)
+  // - + LE u16 * 6(선택) => 키 종류별 대기 [plain][shifted][enter][tab][jamo][afterSwitch]
+  //   - 0xFFFF: typingDelay를 따른다. 표가 없는 write(pause/abort 등)는 표를 바꾸지 않는다.
   if (len < 6) {
     return;
   }
 
-  const uint16_t typing_ms = le16(&data[0]);
-  const uint16_t mode_ms = le16(&data[2]);
-  const uint16_t press_ms = le16(&data[4]);
-
-  g_typing_delay_ms = clamp_u16(typing_ms, 0, 1000);
-  g_mode_switch_delay_ms = clamp_u16(mode_ms, 0, 3000);
-  g_key_press_delay_ms = clamp_u16(press_ms, 0, 300);
+  ConfigRequest req = {};
+  req.typing_delay_ms = clamp_u16(le16(&data[0]), 0, 1000);
+  req.mode_switch_delay_ms = clamp_u16(le16(&data[2]), 0, 3000);
+  req.key_press_delay_ms = clamp_u16(le16(&data[4]), 0, 300);
 
   if (len >= 7) {
     const uint8_t toggle = data[6];
-    g_toggle_key = static_cast<uint8_t>(toggle <= 6 ? toggle : 0);
+    req.has_toggle_key = true;
+    req.toggle_key = static_cast<uint8_t>(toggle <= 6 ? toggle : 0);
   }
 
+  if (len >= 8 + 2 * kKeyClassCount) {
+    req.has_key_class_table = true;
+    for (uint8_t i = 0; i < kKeyClassCount; i++) req.key_class_delay_ms[i] = key_class_delay_from_le(&data[8 + 2 * i]);
+  }
+
+  // 설정은 loop에서 적용한다(타이핑 중인 문자 사이에서 바꾸지 않는다).
+  noInterrupts();
+  g_config_request = req;
+  g_config_pending = true;
+  interrupts();
+
   if (len >= 8) {
     const uint8_t flags = data[7];
 
@@ -712,6 +1930,7 @@ static void config_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, u
       g_pause_change_pending = true;
     }
   }
+  hid_task_wake();
 }
 
 static void apply_pending_controls_in_loop() {
@@ -719,18 +1938,46 @@ static void apply_pending_controls_in_loop() {
   bool pending = false;
   bool target = false;
   bool abort_now = false;
+  bool config_now = false;
+  ConfigRequest config = {};
   noInterrupts();
   pending = g_pause_change_pending;
   target = g_pause_target;
   abort_now = g_abort_requested;
+  config_now = g_config_pending;
+  if (config_now) config = g_config_request;
   g_pause_change_pending = false;
   g_abort_requested = false;
+  g_config_pending = false;
   interrupts();
 
+  if (config_now) {
+    g_typing_delay_ms = config.typing_delay_ms;
+    g_mode_switch_delay_ms = config.mode_switch_delay_ms;
+    g_key_press_delay_ms = config.key_press_delay_ms;
+    if (config.has_toggle_key) g_toggle_key = config.toggle_key;
+    if (config.has_key_class_table) {
+      for (uint8_t i = 0; i < kKeyClassCount; i++) g_key_class_delay_ms[i] = config.key_class_delay_ms[i];
+    }
+  }
+
   if (abort_now) {
     g_paused = false;
-    rb_clear();
-    stash_clear();
+    // 대기 중인 job 전체를 버린다.
+    jobs_restart(0);
+    job_publish_state();
+    // Stop한 작업은 재부팅 후에도 이어서 치지 않는다.
+    journal_request_discard(0);
+    // 응답 대기 중인(parked) 패킷도 버린다(웹은 Stop 이후 더 보내지 않는다).
+    deferred_write_discard();
+    // Stop은 매크로(특히 실행 중인 VM 프로그램)도 함께 멈춰야 한다.
+#if BF_FEATURE_MACRO
+    macro_clear();
+    macro_vm_reset();
+#endif
+#if BF_FEATURE_CACHE
+    payload_cache_play_stop();
+#endif
     reset_input_state_no_keystroke();
     notify_status_if_needed(true);
   }
@@ -744,12 +1991,14 @@ static void apply_pending_controls_in_loop() {
   }
 }
 
+#if BF_FEATURE_MACRO
 // -----------------------------
 // Macro queue (BLE write -> loop)
 // -----------------------------
 // Format (byte stream): [cmd(u8)][len(u8)][payload...]
 // Commands are executed in the main loop to avoid blocking BLE callbacks.
-constexpr size_t kMacroBufferSize = 256;
+// NOTE: 링버퍼 실사용 용량은 size-1이므로, 최대 프레임(2 + 255)이 들어가도록 512로 둔다.
+constexpr size_t kMacroBufferSize = BF_MACRO_BUFFER_SIZE;
 static uint8_t macro_buf[kMacroBufferSize];
 static volatile size_t macro_head = 0;
 static volatile size_t macro_tail = 0;
@@ -767,6 +2016,12 @@ static inline uint16_t macro_used_bytes() {
   return static_cast<uint16_t>(kMacroBufferSize - (tail - head));
 }
 
+static inline uint16_t macro_free_bytes() {
+  const uint16_t used = macro_used_bytes();
+  const uint16_t cap = static_cast<uint16_t>(kMacroBufferSize - 1);
+  return static_cast<uint16_t>(cap - (used <= cap ? used : cap));
+}
+
 static bool macro_push(uint8_t b) {
   size_t next = macro_next(macro_head);
   if (next == macro_tail) {
@@ -796,14 +2051,475 @@ static void macro_drop(uint16_t n) {
   interrupts();
 }
 
-static void hid_send_combo(uint8_t modifier, uint8_t keycode) {
-  hid_send_key(modifier, keycode);
+static void macro_clear() {
+  noInterrupts();
+  macro_tail = macro_head;
+  interrupts();
+}
+
+// -----------------------------
+// Macro VM (bytecode program)
+// -----------------------------
+// Macro cmd 0x08(RUN_PROGRAM)의 payload를 작은 바이트코드 프로그램으로 실행한다.
+// - loop 1회에 1 스텝만 실행하므로 pause/abort가 프로그램 중간에도 즉시 먹힌다.
+// - 프로그램은 로드 시 전체를 검증한다(알 수 없는 opcode/잘린 operand/잘못된 jump 대상이면 실행하지 않음).
+// - 루프는 레지스터 카운터(DJNZ)와 전체 스텝 상한으로 항상 유한하게 끝난다.
+// - 종료/중단 시 DOWN으로 눌러둔 키는 모두 release한다.
+//
+// Opcodes (operand는 LE, jump 대상은 프로그램 내 byte offset):
+//   0x00 END
+//   0x01 TAP    [mod][key]          chord 1회 (DOWN 중인 키와 합쳐서 누른다)
+//   0x02 DOWN   [mod][key]          누른 상태 유지(최대 6키)
+//   0x03 UP     [mod][key]          해제 (mod=0,key=0이면 전부 해제)
+//   0x04 TYPE   [n][ascii * n]      영어 모드로 ASCII 타이핑
+//   0x05 SLEEP  [ms(u16)]
+//   0x06 SLEEPR [r]                 레지스터 값(ms)만큼 대기
+//   0x07 SET    [r][v(u16)]
+//   0x08 TAPN   [mod][key][count]   chord count회 반복
+//   0x09 DJNZ   [r][target]         r-- 후 r!=0이면 target으로 점프
+//   0x0A JMP    [target]
+//   0x0B ENGLISH                    영어 모드 강제
+static constexpr uint8_t kMacroVmVersion = 1;
+static constexpr size_t kMacroVmProgramMax = 255;
+static constexpr uint8_t kMacroVmRegisterCount = 4;
+static constexpr uint32_t kMacroVmMaxSteps = 50000;
+
+enum MacroVmOp : uint8_t {
+  kVmEnd = 0x00,
+  kVmTap = 0x01,
+  kVmDown = 0x02,
+  kVmUp = 0x03,
+  kVmType = 0x04,
+  kVmSleep = 0x05,
+  kVmSleepReg = 0x06,
+  kVmSet = 0x07,
+  kVmTapN = 0x08,
+  kVmDjnz = 0x09,
+  kVmJmp = 0x0A,
+  kVmEnglish = 0x0B,
+};
+
+struct MacroVm {
+  uint8_t program[kMacroVmProgramMax];
+  uint8_t length;
+  uint8_t pc;
+  bool active;
+  uint16_t regs[kMacroVmRegisterCount];
+  uint32_t steps;
+
+  // 여러 스텝에 걸쳐 실행되는 명령(TYPE/TAPN/SLEEP)의 진행 상태
+  uint8_t progress;
+  uint32_t sleep_started_ms;
+  uint16_t sleep_ms;
+
+  uint8_t held_modifier;
+  uint8_t held_keys[6];
+};
+
+static MacroVm g_macro_vm;
+
+// 명령 길이(opcode 포함). 알 수 없는 opcode는 0.
+static uint16_t macro_vm_insn_size(const uint8_t* p, uint16_t remaining) {
+  switch (p[0]) {
+    case kVmEnd:
+    case kVmEnglish:
+      return 1;
+    case kVmSleepReg:
+    case kVmJmp:
+      return 2;
+    case kVmTap:
+    case kVmDown:
+    case kVmUp:
+    case kVmSleep:
+    case kVmDjnz:
+      return 3;
+    case kVmSet:
+    case kVmTapN:
+      return 4;
+    case kVmType:
+      return remaining >= 2 ? static_cast<uint16_t>(2u + p[1]) : 2;
+    default:
+      return 0;
+  }
+}
+
+static bool macro_vm_validate(const uint8_t* prog, uint16_t len) {
+  // 1st pass: 명령 경계 표시, 2nd pass: jump 대상/레지스터 검사
+  uint8_t boundary[(kMacroVmProgramMax + 8) / 8] = {0};
+  uint16_t pc = 0;
+  while (pc < len) {
+    const uint16_t size = macro_vm_insn_size(&prog[pc], static_cast<uint16_t>(len - pc));
+    if (size == 0 || pc + size > len) return false;
+    boundary[pc / 8] |= static_cast<uint8_t>(1u << (pc % 8));
+    pc = static_cast<uint16_t>(pc + size);
+  }
+
+  pc = 0;
+  while (pc < len) {
+    const uint8_t* p = &prog[pc];
+    uint8_t target = 0xFF;
+    uint8_t reg = 0;
+    switch (p[0]) {
+      case kVmSleepReg:
+        reg = p[1];
+        break;
+      case kVmSet:
+        reg = p[1];
+        break;
+      case kVmDjnz:
+        reg = p[1];
+        target = p[2];
+        break;
+      case kVmJmp:
+        target = p[1];
+        break;
+      default:
+        break;
+    }
+    if (reg >= kMacroVmRegisterCount) return false;
+    if (target != 0xFF) {
+      if (target >= len) return false;
+      if ((boundary[target / 8] & (1u << (target % 8))) == 0) return false;
+    }
+    pc = static_cast<uint16_t>(pc + macro_vm_insn_size(p, static_cast<uint16_t>(len - pc)));
+  }
+  return true;
+}
+
+static void macro_vm_send_held() {
+  if (!hid_ready()) return;
+  hid_report_keyboard(g_macro_vm.held_modifier, g_macro_vm.held_keys);
+  hid_wait_ms(g_key_press_delay_ms);
+}
+
+static void macro_vm_release_all() {
+  const bool any_held = g_macro_vm.held_modifier != 0 || g_macro_vm.held_keys[0] != 0;
+  g_macro_vm.held_modifier = 0;
+  memset(g_macro_vm.held_keys, 0, sizeof(g_macro_vm.held_keys));
+  if (any_held && hid_ready()) {
+    hid_report_keyboard_release();
+    hid_wait_ms(g_key_press_delay_ms);
+  }
+}
+
+static void macro_vm_key_down(uint8_t modifier, uint8_t keycode) {
+  g_macro_vm.held_modifier |= modifier;
+  if (keycode != 0) {
+    for (uint8_t i = 0; i < 6; i++) {
+      if (g_macro_vm.held_keys[i] == keycode) break;
+      if (g_macro_vm.held_keys[i] == 0) {
+        g_macro_vm.held_keys[i] = keycode;
+        break;
+      }
+    }
+  }
+  macro_vm_send_held();
+}
+
+static void macro_vm_key_up(uint8_t modifier, uint8_t keycode) {
+  if (modifier == 0 && keycode == 0) {
+    macro_vm_release_all();
+    return;
+  }
+  g_macro_vm.held_modifier &= static_cast<uint8_t>(~modifier);
+  if (keycode != 0) {
+    // 빈 칸 없이 앞으로 당긴다.
+    uint8_t o = 0;
+    for (uint8_t i = 0; i < 6; i++) {
+      if (g_macro_vm.held_keys[i] != keycode) g_macro_vm.held_keys[o++] = g_macro_vm.held_keys[i];
+    }
+    while (o < 6) g_macro_vm.held_keys[o++] = 0;
+  }
+  macro_vm_send_held();
+}
+
+static void macro_vm_tap(uint8_t modifier, uint8_t keycode) {
+  if (g_macro_vm.held_modifier == 0 && g_macro_vm.held_keys[0] == 0) {
+    hid_send_combo(modifier, keycode);
+    return;
+  }
+  if (!hid_ready()) return;
+
+  // DOWN 중인 키를 유지한 채 chord를 누르고, 다시 held 상태로 돌린다.
+  uint8_t keycodes[6];
+  memcpy(keycodes, g_macro_vm.held_keys, sizeof(keycodes));
+  for (uint8_t i = 0; i < 6 && keycode != 0; i++) {
+    if (keycodes[i] == 0 || keycodes[i] == keycode) {
+      keycodes[i] = keycode;
+      break;
+    }
+  }
+  hid_report_keyboard(static_cast<uint8_t>(g_macro_vm.held_modifier | modifier), keycodes);
+  hid_wait_ms(g_key_press_delay_ms);
+  macro_vm_send_held();
+}
+
+static void macro_vm_reset() {
+  macro_vm_release_all();
+  g_macro_vm.active = false;
+  g_macro_vm.length = 0;
+  g_macro_vm.pc = 0;
+  g_macro_vm.progress = 0;
+  g_macro_vm.sleep_ms = 0;
+}
+
+static bool macro_vm_load_from_queue(uint8_t len) {
+  // payload는 호출 시점에 큐에 모두 들어와 있다.
+  uint8_t tmp[kMacroVmProgramMax];
+  for (uint8_t i = 0; i < len; i++) {
+    tmp[i] = macro_peek(i);
+  }
+  macro_drop(len);
+
+  if (len == 0 || !macro_vm_validate(tmp, len)) {
+    log_line("Macro VM: invalid program");
+    return false;
+  }
+
+  macro_vm_reset();
+  memcpy(g_macro_vm.program, tmp, len);
+  g_macro_vm.length = len;
+  memset(g_macro_vm.regs, 0, sizeof(g_macro_vm.regs));
+  g_macro_vm.steps = 0;
+  g_macro_vm.active = true;
+  return true;
+}
+
+static void macro_vm_begin_sleep(uint16_t ms) {
+  g_macro_vm.sleep_ms = ms;
+  g_macro_vm.sleep_started_ms = millis();
+}
+
+// 프로그램 실행 중이면 true(= 텍스트보다 먼저 처리 중)를 반환한다.
+static bool macro_vm_step() {
+  if (!g_macro_vm.active) return false;
+
+  if (g_macro_vm.sleep_ms > 0) {
+    // 남은 시간은 idle_wait가 잔다(macro_wait_ms).
+    if (millis() - g_macro_vm.sleep_started_ms < g_macro_vm.sleep_ms) return true;
+    g_macro_vm.sleep_ms = 0;
+  }
+
+  if (g_macro_vm.pc >= g_macro_vm.length) {
+    macro_vm_reset();
+    return true;
+  }
+
+  if (++g_macro_vm.steps > kMacroVmMaxSteps) {
+    log_line("Macro VM: step limit");
+    macro_vm_reset();
+    return true;
+  }
+
+  const uint8_t pc = g_macro_vm.pc;
+  const uint8_t* p = &g_macro_vm.program[pc];
+  uint16_t next = static_cast<uint16_t>(pc + macro_vm_insn_size(p, static_cast<uint16_t>(g_macro_vm.length - pc)));
+
+  switch (p[0]) {
+    case kVmEnd:
+      macro_vm_reset();
+      return true;
+    case kVmTap:
+      macro_vm_tap(p[1], p[2]);
+      break;
+    case kVmDown:
+      macro_vm_key_down(p[1], p[2]);
+      break;
+    case kVmUp:
+      macro_vm_key_up(p[1], p[2]);
+      break;
+    case kVmType: {
+      const uint8_t n = p[1];
+      if (g_macro_vm.progress == 0) {
+        macro_vm_release_all();
+        switch_to_english(g_typing);
+      }
+      if (g_macro_vm.progress < n) {
+        type_ascii_char(g_typing, static_cast<char>(p[2 + g_macro_vm.progress]));
+        g_macro_vm.progress++;
+      }
+      if (g_macro_vm.progress < n) return true;
+      g_macro_vm.progress = 0;
+      break;
+    }
+    case kVmSleep:
+      macro_vm_begin_sleep(le16(&p[1]));
+      break;
+    case kVmSleepReg:
+      macro_vm_begin_sleep(g_macro_vm.regs[p[1]]);
+      break;
+    case kVmSet:
+      g_macro_vm.regs[p[1]] = le16(&p[2]);
+      break;
+    case kVmTapN: {
+      const uint8_t count = p[3];
+      if (count > 0) {
+        macro_vm_tap(p[1], p[2]);
+        g_macro_vm.progress++;
+        if (g_macro_vm.progress < count) return true;
+      }
+      g_macro_vm.progress = 0;
+      break;
+    }
+    case kVmDjnz: {
+      uint16_t& r = g_macro_vm.regs[p[1]];
+      if (r > 0) r--;
+      if (r != 0) next = p[2];
+      break;
+    }
+    case kVmJmp:
+      next = p[1];
+      break;
+    case kVmEnglish:
+      switch_to_english(g_typing);
+      break;
+    default:
+      // validate에서 걸러지므로 이론상 도달하지 않는다.
+      macro_vm_reset();
+      return true;
+  }
+
+  g_macro_vm.pc = static_cast<uint8_t>(next <= g_macro_vm.length ? next : g_macro_vm.length);
+  if (next >= g_macro_vm.length && g_macro_vm.sleep_ms == 0) {
+    macro_vm_reset();
+  }
+  return true;
+}
+
+#if BF_FEATURE_CACHE
+// -----------------------------
+// Payload cache 재생 (macro cmd 0x09 TYPE_CACHED)
+// -----------------------------
+// 캐시된 payload를 텍스트 채널과 같은 디코더(process_input_byte)로 1바이트씩 타이핑한다.
+// - 줄바꿈 뒤에는 line delay만큼 대기한다(웹의 commandDelay/lineDelay 대체).
+// - 매크로 슬롯에서 실행되므로 재생이 끝날 때까지 RX 텍스트는 대기한다(순서 보장).
+static constexpr uint8_t kCachePlayBufferSize = 64;
+static uint32_t g_cache_play_offset = 0;
+static uint32_t g_cache_play_size = 0;
+static uint16_t g_cache_play_line_delay_ms = 0;
+static uint8_t g_cache_play_buf[kCachePlayBufferSize];
+static uint8_t g_cache_play_buf_len = 0;
+static uint8_t g_cache_play_buf_pos = 0;
+static uint32_t g_cache_play_sleep_started_ms = 0;
+static bool g_cache_play_sleeping = false;
+static uint8_t g_cache_last_op = 0;
+static uint8_t g_cache_last_result = kCacheResultOk;
+static uint8_t g_cache_op_count = 0;
+
+static void payload_cache_publish_state();
+
+static void payload_cache_play_stop() {
+  g_cache_play_entry = -1;
+  g_cache_play_buf_len = 0;
+  g_cache_play_buf_pos = 0;
+  g_cache_play_sleeping = false;
+}
+
+static bool payload_cache_play_begin(const uint8_t* hash, uint16_t line_delay_ms) {
+  const int8_t index = payload_cache_find(hash);
+  if (index < 0) return false;
+
+  payload_cache_play_stop();
+  g_cache_play_entry = index;
+  g_cache_play_offset = 0;
+  g_cache_play_size = g_cache_entries[index].size;
+  g_cache_play_line_delay_ms = line_delay_ms;
+  payload_cache_touch(static_cast<uint8_t>(index));
+  return true;
+}
+
+static bool payload_cache_play_refill() {
+  char path[48];
+  payload_cache_entry_path(g_cache_entries[g_cache_play_entry].hash, path, sizeof(path));
+  File f(InternalFS.open(path, FILE_O_READ));
+  if (!f) return false;
+  f.seek(g_cache_play_offset);
+  const uint32_t remaining = g_cache_play_size - g_cache_play_offset;
+  const uint16_t want = static_cast<uint16_t>(remaining < kCachePlayBufferSize ? remaining : kCachePlayBufferSize);
+  const int n = f.read(g_cache_play_buf, want);
+  f.close();
+  if (n <= 0) return false;
+  g_cache_play_buf_len = static_cast<uint8_t>(n);
+  g_cache_play_buf_pos = 0;
+  return true;
+}
+
+// 재생 중이면 true(= 텍스트보다 먼저 처리 중)를 반환한다.
+static bool payload_cache_play_step() {
+  if (g_cache_play_entry < 0) return false;
+
+  // 캐시된 payload 안의 in-band WAIT/WAIT_IDLE(남은 시간은 idle_wait가 잔다)
+  if (inband_wait_in_loop()) return true;
+
+  if (g_cache_play_sleeping) {
+    if (millis() - g_cache_play_sleep_started_ms < g_cache_play_line_delay_ms) return true;
+    g_cache_play_sleeping = false;
+  }
+
+  if (g_cache_play_offset >= g_cache_play_size) {
+    payload_cache_play_stop();
+    payload_cache_publish_state();
+    // 끝까지 쳤으므로 재개할 것이 없다.
+    journal_request_discard(0);
+    return true;
+  }
+
+  if (g_cache_play_buf_pos >= g_cache_play_buf_len && !payload_cache_play_refill()) {
+    // 읽기 실패: 남은 부분을 추측해서 치지 않는다.
+    log_line("Payload cache: read failed");
+    g_cache_last_result = kCacheResultIoError;
+    payload_cache_play_stop();
+    payload_cache_publish_state();
+    return true;
+  }
+
+  const uint8_t b = g_cache_play_buf[g_cache_play_buf_pos++];
+  g_cache_play_offset++;
+  journal_note_cache_byte(b);
+  process_input_byte(b);
+
+  if ((b == '\n' || b == '\r') && g_cache_play_line_delay_ms > 0) {
+    g_cache_play_sleeping = true;
+    g_cache_play_sleep_started_ms = millis();
+  }
+  return true;
+}
+#endif
+
+// idle_wait용: VM SLEEP/캐시 재생 줄 간격이 끝날 때까지 남은 시간(없으면 UINT32_MAX)
+// 캐시 안의 in-band WAIT는 inband_wait_ms가 센다.
+static uint32_t macro_wait_ms(uint32_t now) {
+  if (g_macro_vm.active && g_macro_vm.sleep_ms > 0) {
+    const uint32_t elapsed = now - g_macro_vm.sleep_started_ms;
+    return elapsed >= g_macro_vm.sleep_ms ? 0 : g_macro_vm.sleep_ms - elapsed;
+  }
+#if BF_FEATURE_CACHE
+  if (g_cache_play_entry >= 0 && g_cache_play_sleeping) {
+    const uint32_t elapsed = now - g_cache_play_sleep_started_ms;
+    return elapsed >= g_cache_play_line_delay_ms ? 0 : g_cache_play_line_delay_ms - elapsed;
+  }
+#endif
+  return UINT32_MAX;
+}
+
+// VM/캐시 재생이 시간이 되기를 기다리는 중이면 true
+static bool macro_waiting() {
+#if BF_FEATURE_CACHE
+  if (g_cache_play_entry >= 0 && g_inband_wait.active) return true;
+#endif
+  return macro_wait_ms(millis()) != UINT32_MAX;
 }
 
 static bool macro_try_process_one() {
   if (!hid_ready()) return false;
   if (g_paused) return false;
 
+  // 실행 중인 프로그램/캐시 재생이 있으면 끝날 때까지 다음 매크로/텍스트보다 우선한다.
+  if (macro_vm_step()) return true;
+#if BF_FEATURE_CACHE
+  if (payload_cache_play_step()) return true;
+#endif
+
   const uint16_t used = macro_used_bytes();
   if (used < 2) return false;
 
@@ -827,11 +2543,11 @@ static bool macro_try_process_one() {
       break;
     case 0x04: {  // TYPE_ASCII
       // Macro typing is intended for OS dialogs/CLI; keep it in English mode.
-      switch_to_english();
+      switch_to_english(g_typing);
       for (uint8_t i = 0; i < len; i++) {
         const char c = static_cast<char>(macro_peek(0));
         macro_drop(1);
-        type_ascii_char(c);
+        type_ascii_char(g_typing, c);
       }
       return true;
     }
@@ -844,13 +2560,36 @@ static bool macro_try_process_one() {
       }
       macro_drop(len);
       if (ms > 0) {
-        delay(ms);
+        hid_wait_ms(ms);
       }
       return true;
     }
     case 0x06:  // FORCE_ENGLISH (best-effort)
-      switch_to_english();
+      switch_to_english(g_typing);
       break;
+    case 0x08:  // RUN_PROGRAM (Macro VM bytecode)
+      macro_vm_load_from_queue(len);
+      return true;
+#if BF_FEATURE_CACHE
+    case 0x09: {  // TYPE_CACHED [sha256(32)][lineDelayMs(u16 LE)]
+      uint8_t hash[32];
+      uint16_t line_delay_ms = 0;
+      if (len >= 32) {
+        for (uint8_t i = 0; i < 32; i++) hash[i] = macro_peek(i);
+        if (len >= 34) line_delay_ms = static_cast<uint16_t>(macro_peek(32) | (macro_peek(33) << 8));
+      }
+      macro_drop(len);
+      g_cache_last_op = 0x09;
+      g_cache_op_count++;
+      if (len < 32) {
+        g_cache_last_result = kCacheResultBadRequest;
+      } else {
+        g_cache_last_result = payload_cache_play_begin(hash, line_delay_ms) ? kCacheResultOk : kCacheResultMiss;
+      }
+      payload_cache_publish_state();
+      return true;
+    }
+#endif
     default:
       // Unknown command: consume payload and ignore.
       break;
@@ -862,54 +2601,17 @@ static bool macro_try_process_one() {
   }
   return true;
 }
+#endif
 
 // -----------------------------
 // RX 버퍼 (BLE write -> loop)
 // -----------------------------
 // 기본값은 작게 시작하고, 유실이 보이면 웹에서 Delay를 올리는 방식으로 안정화한다.
-constexpr size_t kRxBufferSize = 512;
+constexpr size_t kRxBufferSize = BF_RX_BUFFER_SIZE;
 static uint8_t rx_buf[kRxBufferSize];
 static volatile size_t rx_head = 0;
 static volatile size_t rx_tail = 0;
 
-// Pause stash
-// - pause 상태에서 RX 링버퍼가 full이면, BLE write 콜백이 무한 대기할 수 있다.
-// - 정확성 우선: 데이터를 버리지 않고, 오래된 바이트를 stash로 옮겨 RX에 공간을 만든다.
-// - resume 후에는 stash -> RX 순으로 소비하여 원래 순서를 보장한다.
-constexpr size_t kPauseStashSize = 512;
-static uint8_t stash_buf[kPauseStashSize];
-static volatile size_t stash_head = 0;
-static volatile size_t stash_tail = 0;
-
-static inline size_t stash_next(size_t v) {
-  return (v + 1) % kPauseStashSize;
-}
-
-static inline bool stash_push(uint8_t b) {
-  const size_t next = stash_next(stash_head);
-  if (next == stash_tail) {
-    return false;
-  }
-  stash_buf[stash_head] = b;
-  stash_head = next;
-  return true;
-}
-
-static inline bool stash_pop(uint8_t& out) {
-  if (stash_tail == stash_head) {
-    return false;
-  }
-  out = stash_buf[stash_tail];
-  stash_tail = stash_next(stash_tail);
-  return true;
-}
-
-static void stash_clear() {
-  noInterrupts();
-  stash_tail = stash_head;
-  interrupts();
-}
-
 static inline uint16_t rb_capacity_bytes() {
   // 링버퍼는 (head+1==tail)로 full을 판정하므로, 실사용 용량은 size-1이다.
   return static_cast<uint16_t>(kRxBufferSize - 1);
@@ -953,17 +2655,1439 @@ static bool rb_pop(uint8_t& out) {
   return true;
 }
 
-static void rb_clear() {
-  noInterrupts();
-  rx_tail = rx_head;
-  interrupts();
+// -----------------------------
+// Job queue (multi-session)
+// -----------------------------
+// Flush Text 세션을 job으로 줄 세운다. 현재 job이 타이핑되는 동안 다음 job을 업로드할 수 있다.
+// - RX 링버퍼에는 job들의 바이트가 순서대로 이어 붙어 있고, job마다 남은 바이트 수(queued)를 센다.
+// - job은 Job char의 OPEN으로 등록하며, 자기 타이밍 설정을 가질 수 있다(타이핑 시작 시 적용).
+// - 데이터는 마지막(tail) job만 받는다(웹은 job을 순서대로 업로드한다).
+// - 취소된 job은 업로드 중이면 이후 패킷을 응답만 하고 버리고, 차례가 오면 남은 바이트를 한 번에 버린다.
+// - OPEN하지 않은 새 sessionId(seq==0)는 예전처럼 큐 전체를 버리고 새 작업으로 시작한다(opt-in abort).
+// - armed job(OPEN flags bit2)은 바이트를 쌓기만 하고, START를 받은 뒤 정한 시각에 타이핑을 시작한다.
+//   웹이 여러 장치(fleet)에 같은 job을 올려 두고 START를 한꺼번에 보내면 모든 Target이 같이 출발한다.
+// - job은 다음 job으로 넘어가거나, CLOSE(업로드 끝)를 받은 뒤 남은 바이트를 다 치면 끝난다.
+//   끝난 job은 journal에 clean 레코드를 남긴다(정상 완료 후 재개 제안이 뜨지 않게).
+// 생산자(BLE task)/소비자(HID task)가 함께 만지는 필드는 noInterrupts 구간에서만 바꾼다.
+// - 남은 타이핑 시간(status의 queueEtaMs)은 job마다 남은 키 수(eta_left)로 센다.
+//   적재할 때 그 바이트를 dry-run한 키 수를 더하고, 꺼낼 때 같은 순서로 dry-run해서 뺀다.
+//   두 dry-run은 같은 시작 상태에서 같은 바이트를 보므로 정확히 상쇄된다.
+static constexpr uint8_t kMaxJobs = 4;
+
+struct FlushJob {
+  uint16_t session_id;
+  uint16_t expected_seq;
+  uint16_t queued;  // RX 링버퍼에 남은 이 job의 바이트 수
+  bool cancelled;
+  bool has_timing;
+  uint16_t typing_delay_ms;
+  uint16_t mode_switch_delay_ms;
+  uint16_t key_press_delay_ms;
+  uint8_t toggle_key;
+  bool clip_paste;  // Windows: 비싼 구간은 클립보드 붙여넣기로 보낼 수 있다
+  bool device_timing;  // 타이밍을 싣지 않고 장치에 적용 중인 프로필을 쓴다
+  bool armed;          // START 전까지 타이핑하지 않는다(head가 되어도 기다린다)
+  bool start_scheduled;
+  uint32_t start_at_ms;  // start_scheduled일 때 타이핑을 시작할 millis()
+  bool closed;           // CLOSE: 더 올 바이트가 없다(다 치면 job이 끝난다)
+  bool line_sync;        // 줄이 명령이다: journal을 줄마다 Enter 전에 쓴다(아니면 몰아서 쓴다)
+  // has_timing일 때 같이 적용할 키 종류별 대기(OPEN에 표가 없으면 모두 typingDelay를 따른다)
+  uint16_t key_class_delay_ms[kKeyClassCount];
+  TypingState eta_push_state;  // 적재 쪽 dry-run 디코더(생산자만 만진다)
+  TypingState eta_pop_state;   // 꺼내는 쪽 dry-run 디코더(HID task)
+  TypingCost eta_left;         // 아직 치지 않은 바이트의 키 수
+};
+
+static FlushJob g_jobs[kMaxJobs];
+static volatile uint8_t g_job_head = 0;
+static volatile uint8_t g_job_count = 0;
+#if BF_FEATURE_CLIP_PASTE
+// Clipboard paste transport: 이미 "타이핑"으로 정한 구간에서 남은 바이트 수(0이면 다음 구간을 판단한다).
+static uint16_t g_clip_plain_left = 0;
+#endif
+
+static inline uint8_t job_slot(uint8_t i) {
+  return static_cast<uint8_t>((g_job_head + i) % kMaxJobs);
+}
+
+static inline uint8_t job_tail_slot() {
+  return job_slot(static_cast<uint8_t>(g_job_count - 1));
+}
+
+// job 경계와 같은 dry-run 시작 상태: UTF-8/CRLF/in-band는 비우고, 한/영 모드만 이어 간다.
+static void job_eta_begin(FlushJob& job, bool korean_mode) {
+  job.eta_push_state = TypingState{korean_mode, false, 0, 0, nullptr};
+  job.eta_pop_state = job.eta_push_state;
+  job.eta_left = {};
+}
+
+static void typing_cost_add(TypingCost& to, const TypingCost& d) {
+  to.keystrokes += d.keystrokes;
+  to.mode_switches += d.mode_switches;
+  to.wait_ms += d.wait_ms;
+  to.chord_keys += d.chord_keys;
+  for (uint8_t i = 0; i < kKeyClassCount; i++) {
+    to.class_keys[i] += d.class_keys[i];
+    to.settle_keys[i] += d.settle_keys[i];
+  }
+}
+
+static void typing_cost_sub(TypingCost& from, const TypingCost& d) {
+  from.keystrokes -= d.keystrokes;
+  from.mode_switches -= d.mode_switches;
+  from.wait_ms -= d.wait_ms;
+  from.chord_keys -= d.chord_keys;
+  for (uint8_t i = 0; i < kKeyClassCount; i++) {
+    from.class_keys[i] -= d.class_keys[i];
+    from.settle_keys[i] -= d.settle_keys[i];
+  }
+}
+
+// 키 수를 job의 타이밍(OPEN에 실린 값, 없으면 장치 설정)으로 ms로 바꾼다.
+static uint32_t typing_cost_ms(const TypingCost& c, const FlushJob& job) {
+  const bool own = job.has_timing;
+  const uint32_t typing = own ? job.typing_delay_ms : g_typing_delay_ms;
+  const uint32_t press = own ? job.key_press_delay_ms : g_key_press_delay_ms;
+  const uint32_t mode_switch = own ? job.mode_switch_delay_ms : g_mode_switch_delay_ms;
+  uint32_t class_ms[kKeyClassCount];
+  for (uint8_t i = 0; i < kKeyClassCount; i++) {
+    const uint16_t v = own ? job.key_class_delay_ms[i] : g_key_class_delay_ms[i];
+    class_ms[i] = v == kKeyClassDelayFollow ? typing : v;
+  }
+
+  uint32_t ms = c.wait_ms + (c.keystrokes + c.mode_switches) * 2u * press + c.mode_switches * mode_switch;
+  ms += c.chord_keys * typing;
+  for (uint8_t i = 0; i < kKeyClassCount; i++) {
+    const uint32_t settle = class_ms[i] > class_ms[kKeyClassAfterSwitch] ? class_ms[i] : class_ms[kKeyClassAfterSwitch];
+    ms += c.class_keys[i] * class_ms[i] + c.settle_keys[i] * settle;
+  }
+  return ms;
+}
+
+// (noInterrupts 구간에서 호출)
+static int job_find_locked(uint16_t session_id) {
+  for (uint8_t i = 0; i < g_job_count; i++) {
+    const uint8_t slot = job_slot(i);
+    if (g_jobs[slot].session_id == session_id) return slot;
+  }
+  return -1;
+}
+
+// 새 job을 tail에 붙인다. 실패하면(가득 참) false.
+static bool job_append(const FlushJob& job) {
+  bool ok = false;
+  noInterrupts();
+  if (job_find_locked(job.session_id) >= 0) {
+    ok = true;  // 재시도된 OPEN
+  } else if (g_job_count < kMaxJobs) {
+    FlushJob& added = g_jobs[job_slot(g_job_count)];
+    added = job;
+    // 앞 job이 끝난 뒤의 한/영 모드(예측)에서 시작한다.
+    job_eta_begin(added, g_job_count > 0 ? g_jobs[job_tail_slot()].eta_push_state.korean_mode : g_typing.korean_mode);
+    g_job_count++;
+    ok = true;
+  }
+  interrupts();
+  return ok;
+}
+
+// 큐 전체를 버리고 session_id 하나만 남긴다(OPEN하지 않은 새 세션 / abort).
+static void jobs_restart(uint16_t session_id) {
+  noInterrupts();
+  rx_tail = rx_head;
+  g_job_head = 0;
+  g_job_count = 0;
+#if BF_FEATURE_CLIP_PASTE
+  g_clip_plain_left = 0;
+#endif
+  if (session_id != 0) {
+    g_jobs[0] = {};
+    g_jobs[0].session_id = session_id;
+    g_jobs[0].line_sync = true;  // OPEN하지 않은 세션은 무엇을 치는지 모른다(파일 전송의 PowerShell 명령 등)
+    job_eta_begin(g_jobs[0], false);
+    g_job_count = 1;
+  }
+  interrupts();
+}
+
+static bool job_cancel(uint16_t session_id) {
+  noInterrupts();
+  const int slot = job_find_locked(session_id);
+  if (slot >= 0) g_jobs[slot].cancelled = true;
+  interrupts();
+  return slot >= 0;
+}
+
+static bool job_close(uint16_t session_id) {
+  noInterrupts();
+  const int slot = job_find_locked(session_id);
+  if (slot >= 0) g_jobs[slot].closed = true;
+  interrupts();
+  return slot >= 0;
+}
+
+// Duplicate: 이미 받은 seq(ACK 유실 후 재전송). 응답만 한다.
+// Refuse: 받을 수 없는 청크(tail이 아닌 job, 건너뛴 seq, 모르는 세션의 seq != 0). ATT 에러로 거절한다.
+// NewSession: OPEN하지 않은 세션의 seq 0(새 작업 시작).
+enum class JobPacket : uint8_t { Duplicate = 0, Accept = 1, Discard = 2, Refuse = 3, NewSession = 4 };
+
+// Flush 패킷을 받을지 판단한다(BLE task).
+static JobPacket job_classify_packet(uint16_t session_id, uint16_t seq) {
+  JobPacket r = JobPacket::Refuse;
+  noInterrupts();
+  const int slot = job_find_locked(session_id);
+  if (slot < 0) {
+    r = seq == 0 ? JobPacket::NewSession : JobPacket::Refuse;
+  } else {
+    FlushJob& job = g_jobs[slot];
+    // seq는 u16으로 돈다: expected_seq 바로 앞(반 바퀴 안)이면 이미 받은 청크다.
+    const uint16_t behind = static_cast<uint16_t>(job.expected_seq - seq);
+    if (behind != 0 && behind < 0x8000) {
+      r = JobPacket::Duplicate;
+    } else if (behind == 0 && slot == job_tail_slot()) {
+      if (job.cancelled) {
+        job.expected_seq++;
+        r = JobPacket::Discard;
+      } else {
+        r = JobPacket::Accept;
+      }
+    }
+  }
+  interrupts();
+  return r;
+}
+
+// tail job에 payload 전체를 적재한다. 자리가 없으면 false(부분 적재 없음).
+// tail이 바뀌었거나 취소됐으면 버리고 true.
+static bool job_commit_payload(uint16_t session_id, const uint8_t* data, uint16_t len) {
+  // ETA용 dry-run은 잠금 밖에서 한다(적재 쪽 디코더 상태는 생산자만 만진다).
+  TypingCost cost = {};
+  TypingState st = {false, false, 0, 0, nullptr};
+  noInterrupts();
+  const bool found = g_job_count > 0 && g_jobs[job_tail_slot()].session_id == session_id;
+  if (found) st = g_jobs[job_tail_slot()].eta_push_state;
+  interrupts();
+  if (found) {
+    st.cost = &cost;
+    for (uint16_t i = 0; i < len; i++) process_input_byte(st, data[i]);
+    st.cost = nullptr;
+  }
+
+  bool ok = true;
+  noInterrupts();
+  if (g_job_count > 0 && g_jobs[job_tail_slot()].session_id == session_id) {
+    FlushJob& job = g_jobs[job_tail_slot()];
+    if (job.cancelled) {
+      job.expected_seq++;
+    } else if (rb_free_bytes() < len) {
+      ok = false;
+    } else {
+      for (uint16_t i = 0; i < len; i++) rb_push(data[i]);
+      job.queued = static_cast<uint16_t>(job.queued + len);
+      job.expected_seq++;
+      job.eta_push_state = st;
+      typing_cost_add(job.eta_left, cost);
+    }
+  }
+  interrupts();
+  return ok;
+}
+
+static void job_apply_timing(const FlushJob& job) {
+  if (job.device_timing) {
+#if BF_FEATURE_PROFILES
+    profile_reapply();
+#endif
+    return;
+  }
+  if (!job.has_timing) return;
+  g_typing_delay_ms = job.typing_delay_ms;
+  g_mode_switch_delay_ms = job.mode_switch_delay_ms;
+  g_key_press_delay_ms = job.key_press_delay_ms;
+  g_toggle_key = job.toggle_key;
+  for (uint8_t i = 0; i < kKeyClassCount; i++) g_key_class_delay_ms[i] = job.key_class_delay_ms[i];
+}
+
+// job 경계에서는 UTF-8/CRLF 상태만 초기화한다.
+// 한/영 모드는 실제로 타이핑해서 만든 호스트 상태이므로 그대로 이어간다.
+static void job_reset_stream_state() {
+  g_typing.utf8_cp = 0;
+  g_typing.utf8_need = 0;
+  g_typing.prev_was_cr = false;
+  inband_reset(g_typing);
+#if BF_FEATURE_CLIP_PASTE
+  g_clip_plain_left = 0;
+#endif
+}
+
+// HID task: 취소된 head job의 바이트를 버리고, 끝난 head job을 다음 job으로 넘긴다.
+static void jobs_advance_in_loop() {
+  bool changed = false;
+  for (;;) {
+    bool dropped = false;
+    bool switched = false;
+    bool finished = false;
+    uint16_t done_session = 0;
+    noInterrupts();
+    if (g_job_count > 0) {
+      FlushJob& head = g_jobs[g_job_head];
+      if (head.cancelled && head.queued > 0) {
+        rx_tail = (rx_tail + head.queued) % kRxBufferSize;
+        head.queued = 0;
+        dropped = true;
+      }
+      if (head.queued == 0 && g_job_count > 1) {
+        done_session = head.session_id;
+        g_job_head = static_cast<uint8_t>((g_job_head + 1) % kMaxJobs);
+        g_job_count--;
+        switched = true;
+      } else if (head.queued == 0 && head.closed) {
+        // 마지막 job: 업로드가 끝났고 다 쳤다.
+        done_session = head.session_id;
+        g_job_count = 0;
+        finished = true;
+      }
+    }
+    const FlushJob next = g_jobs[g_job_head];
+    interrupts();
+
+    if (dropped) job_reset_stream_state();
+    if (done_session != 0) journal_discard_session(done_session);
+    if (finished) {
+      job_reset_stream_state();
+      changed = true;
+      break;
+    }
+    if (!switched) break;
+
+    job_apply_timing(next);
+    job_reset_stream_state();
+    changed = true;
+  }
+  if (changed) job_publish_state();
+}
+
+// START를 기다리는 armed job의 시작 시각을 정한다(BLE task). 이미 출발했으면 그대로 둔다.
+static bool job_schedule_start(uint16_t session_id, uint16_t delay_ms) {
+  const uint32_t start_at = millis() + delay_ms;
+  noInterrupts();
+  const int slot = job_find_locked(session_id);
+  if (slot >= 0 && g_jobs[slot].armed && !g_jobs[slot].start_scheduled) {
+    g_jobs[slot].start_at_ms = start_at;
+    g_jobs[slot].start_scheduled = true;
+  }
+  interrupts();
+  return slot >= 0;
+}
+
+// HID task: head job이 아직 START(또는 그 시각)를 기다리면 true. 시각이 되면 armed를 푼다.
+static bool job_head_held_in_loop() {
+  jobs_advance_in_loop();
+  const uint32_t now = millis();
+  bool held = false;
+  bool released = false;
+  noInterrupts();
+  if (g_job_count > 0) {
+    FlushJob& head = g_jobs[g_job_head];
+    if (head.armed && !head.cancelled) {
+      if (head.start_scheduled && static_cast<int32_t>(now - head.start_at_ms) >= 0) {
+        head.armed = false;
+        released = true;
+      } else {
+        held = true;
+      }
+    }
+  }
+  interrupts();
+  if (released) job_publish_state();
+  return held;
+}
+
+// idle_wait용: head job의 예약된 시작까지 남은 시간. 예약이 없으면 kIdleWaitMaxMs(START 콜백이 깨운다).
+static uint32_t job_start_wait_ms(uint32_t now) {
+  uint32_t wait_ms = kIdleWaitMaxMs;
+  noInterrupts();
+  if (g_job_count > 0) {
+    const FlushJob& head = g_jobs[g_job_head];
+    if (head.armed && !head.cancelled && head.start_scheduled) {
+      const int32_t left = static_cast<int32_t>(head.start_at_ms - now);
+      wait_ms = left > 0 ? static_cast<uint32_t>(left) : 0;
+    }
+  }
+  interrupts();
+  return wait_ms;
+}
+
+// session_id: 꺼낸 바이트가 속한 job(journal용). job이 없으면 0.
+static inline bool pop_next_byte(uint8_t& out, uint16_t& session_id) {
+  jobs_advance_in_loop();
+
+  bool ok = false;
+  session_id = 0;
+  noInterrupts();
+  if (rb_pop(out)) {
+    ok = true;
+    FlushJob& head = g_jobs[g_job_head];
+    if (g_job_count > 0) session_id = head.session_id;
+    if (g_job_count > 0 && head.queued > 0) {
+      head.queued--;
+      // 적재할 때 더한 이 바이트의 키 수를 뺀다(한 바이트 dry-run).
+      TypingCost cost = {};
+      head.eta_pop_state.cost = &cost;
+      process_input_byte(head.eta_pop_state, out);
+      head.eta_pop_state.cost = nullptr;
+      typing_cost_sub(head.eta_left, cost);
+    }
+  }
+  interrupts();
+  return ok;
+}
+
+// 남은 대기열의 예상 타이핑 시간: job마다 남은 키 수(eta_left)를 그 job의 타이밍으로 바꿔 더한다.
+// - 키 수는 실제 타이핑과 같은 코드(process_input_byte)의 dry-run이므로 규칙이 어긋나지 않는다.
+// - status는 이 값을 읽기만 한다(RX 버퍼를 다시 dry-run하지 않는다). 취소된 job은 0으로 친다.
+// - 매크로/Macro VM/캐시 재생 시간은 포함하지 않는다.
+static uint32_t queue_eta_ms() {
+  uint32_t total = 0;
+  noInterrupts();
+  for (uint8_t i = 0; i < g_job_count; i++) {
+    const FlushJob& job = g_jobs[job_slot(i)];
+    if (!job.cancelled) total += typing_cost_ms(job.eta_left, job);
+  }
+  interrupts();
+  return total;
+}
+
+#if BF_FEATURE_CLIP_PASTE
+// -----------------------------
+// Clipboard paste transport (Windows)
+// -----------------------------
+// 한글 음절은 2~6타 + 한/영 전환 대기가 들고, 한글/ASCII 밖의 문자는 '?'로 바뀐다.
+// job이 허용하면(OPEN flags bit0) 줄 시작마다 그 자리부터의 batch(큐에 있는 만큼, 최대 kClipBatchMaxBytes)를
+// 두 경로로 어림해 더 싼 쪽으로 보낸다.
+// - 타이핑: 디코더 dry-run 비용(queue_eta_ms와 같은 규칙). 더 싸면 첫 줄만 치고 다음 줄에서 다시 고른다.
+// - 붙여넣기: Win+R -> PowerShell 수신 명령 -> 콘솔에 base64 줄들 -> 빈 줄 -> 원래 창에 Ctrl+V
+//   수신 명령은 빈 줄까지 Read-Host로 base64를 모아 Set-Clipboard하고 끝난다(창이 닫히고 포커스가 돌아온다는 전제).
+//   실행 창(259자) 제한은 수신 명령에만 걸리므로, 고정 비용(Win+R, 명령, 창 대기)을 batch 전체가 나눠 낸다.
+// - 칠 수 없는 문자가 있는 batch는 비용과 상관없이 붙여넣는다(문자를 보존한다).
+// - 줄바꿈도 batch에 넣는다(붙여넣은 만큼 줄이 나뉜다). journal은 Ctrl+V를 보낸 뒤 batch 안의 마지막 줄 경계를
+//   checkpoint한다(타이핑 경로가 줄바꿈을 치기 직전에 하는 것과 같은 at-most-once).
+// - base64는 UTF-8 3바이트에 4타라 한글 음절(평균 3타 안팎)보다 싸지 않다. 이득은 칠 수 없는 문자 보존과
+//   한/영 전환이 잦은 구간에 있다.
+static const char kClipReceiverCommand[] =
+    "powershell -nop -c \"$b='';while($l=Read-Host){$b+=$l};"
+    "Set-Clipboard([Text.Encoding]::UTF8.GetString([Convert]::FromBase64String($b)))\"";
+static_assert(sizeof(kClipReceiverCommand) - 1 <= 259, "Run dialog accepts 259 characters");
+static constexpr uint16_t kClipBatchMaxBytes = kRxBufferSize < 2048 ? kRxBufferSize : 2048;
+static constexpr uint16_t kClipLineChars = 76;            // 콘솔에 치는 base64 한 줄
+static constexpr uint32_t kClipRunDialogDelayMs = 500;    // Win+R 후 실행 창이 포커스를 얻을 때까지
+static constexpr uint32_t kClipConsoleDelayMs = 2000;     // PowerShell 콘솔이 뜨고 Read-Host가 입력을 받을 때까지
+static constexpr uint32_t kClipSetClipboardDelayMs = 1000; // 클립보드를 채우고 콘솔이 닫힐 때까지
+static uint8_t g_clip_batch[kClipBatchMaxBytes];
+
+// 붙여넣기 경로의 비용(ms): Win+R/Enter/Ctrl+V + 명령/base64 타이핑 + 창 대기
+static uint32_t clip_paste_cost_ms(uint16_t len, bool korean_mode) {
+  // 명령/base64 문자열은 대부분 일반 키다(Shift 조합은 일반 키 값으로 어림한다).
+  const uint32_t per_key = key_class_delay_ms(kKeyClassPlain) + 2u * g_key_press_delay_ms;
+  const uint32_t b64_chars = static_cast<uint32_t>((len + 2u) / 3u) * 4u;
+  const uint32_t lines = (b64_chars + kClipLineChars - 1u) / kClipLineChars;
+  // Win+R, 명령 + Enter, base64 + 줄마다 Enter, 끝내는 빈 줄, Ctrl+V
+  const uint32_t keys = 1u + (sizeof(kClipReceiverCommand) - 1) + 1u + b64_chars + lines + 1u + 1u;
+  uint32_t ms = keys * per_key + kClipRunDialogDelayMs + kClipConsoleDelayMs + kClipSetClipboardDelayMs;
+  if (korean_mode) ms += 2u * g_key_press_delay_ms + g_mode_switch_delay_ms;
+  return ms;
+}
+
+// 붙여넣기 도중 Stop: 아무것도 붙여넣지 않고 실행 창(ESC)이나 수신 콘솔(Ctrl+C)을 닫는다.
+static bool clip_abort_if_requested(bool console_open) {
+  if (!g_abort_requested) return false;
+  if (console_open) {
+    hid_send_combo(KEYBOARD_MODIFIER_LEFTCTRL, HID_KEY_C);
+  } else {
+    hid_send_combo(0, HID_KEY_ESCAPE);
+  }
+  return true;
+}
+
+// base64로 바꾸면서 콘솔에 kClipLineChars자씩 줄로 친다. Stop이면 false.
+static bool clip_type_base64_lines(const uint8_t* data, uint16_t len) {
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  uint16_t column = 0;
+  for (uint16_t i = 0; i < len; i += 3) {
+    const uint32_t b0 = data[i];
+    const uint32_t b1 = (i + 1 < len) ? data[i + 1] : 0;
+    const uint32_t b2 = (i + 2 < len) ? data[i + 2] : 0;
+    const uint32_t v = (b0 << 16) | (b1 << 8) | b2;
+    const char quad[4] = {kAlphabet[(v >> 18) & 0x3F], kAlphabet[(v >> 12) & 0x3F],
+                          (i + 1 < len) ? kAlphabet[(v >> 6) & 0x3F] : '=', (i + 2 < len) ? kAlphabet[v & 0x3F] : '='};
+    for (char c : quad) {
+      if (clip_abort_if_requested(true)) return false;
+      type_ascii_char(g_typing, c);
+    }
+    column = static_cast<uint16_t>(column + 4);
+    if (column >= kClipLineChars) {
+      hid_send_combo(0, HID_KEY_ENTER);
+      column = 0;
+    }
+  }
+  if (column > 0) hid_send_combo(0, HID_KEY_ENTER);
+  return true;
+}
+
+// head job의 batch를 RX 버퍼에서 들여다본다(소비하지 않는다). in-band 시퀀스 전까지, UTF-8 문자 경계에서 자른다.
+// partial: 잘린 끝 문자가 아직 덜 온 것(큐의 끝까지 이어지는 올바른 앞부분)이면 true.
+static uint16_t clip_peek_batch(uint16_t queued, uint8_t* out, bool& partial) {
+  partial = false;
+  const uint16_t limit = queued < kClipBatchMaxBytes ? queued : kClipBatchMaxBytes;
+  uint16_t n = 0;
+  size_t at = rx_tail;
+  while (n < limit) {
+    const uint8_t b = rx_buf[at];
+    if (b == kInbandEscape) break;
+    out[n++] = b;
+    at = rb_next(at);
+  }
+  // 끝에 걸친 멀티바이트 문자는 다음 batch로 넘긴다.
+  uint16_t lead = n;
+  while (lead > 0 && n - lead < 3 && (out[lead - 1] & 0xC0) == 0x80) lead--;
+  if (lead == 0 || out[lead - 1] < 0xC0 || out[lead - 1] >= 0xF8) return n;
+  const uint8_t b = out[lead - 1];
+  const uint16_t need = (b & 0xE0) == 0xC0 ? 2 : ((b & 0xF0) == 0xE0 ? 3 : 4);
+  if (n - (lead - 1) >= need) return n;
+  partial = (n == queued);
+  return static_cast<uint16_t>(lead - 1);
+}
+
+enum class ClipStep : uint8_t { Type = 0, Pasted = 1, Wait = 2 };
+
+// Type: 타이핑 경로로 다음 바이트를 친다 / Pasted: batch를 붙여넣었다(바이트 소비) /
+// Wait: batch 첫 문자가 아직 덜 왔다(다음 패킷을 기다린다).
+static ClipStep clip_paste_step() {
+  if (g_clip_plain_left > 0 || g_typing.utf8_need != 0 || g_typing.ctl_state != 0) return ClipStep::Type;
+
+  jobs_advance_in_loop();
+  noInterrupts();
+  const bool eligible = g_job_count > 0 && g_jobs[g_job_head].clip_paste && !g_jobs[g_job_head].cancelled;
+  const uint16_t queued = g_job_count > 0 ? g_jobs[g_job_head].queued : 0;
+  const bool closed = g_job_count > 0 && g_jobs[g_job_head].closed;
+  interrupts();
+  if (!eligible || queued == 0) return ClipStep::Type;
+
+  // CRLF의 LF는 디코더가 버린다(붙여넣으면 줄이 하나 더 생긴다).
+  if (g_typing.prev_was_cr && rx_buf[rx_tail] == '\n') {
+    g_clip_plain_left = 1;
+    return ClipStep::Type;
+  }
+
+  bool partial = false;
+  const uint16_t len = clip_peek_batch(queued, g_clip_batch, partial);
+  if (len == 0) {
+    // 덜 온 첫 문자는 기다린다. in-band 시퀀스나 깨진 UTF-8은 타이핑 경로가 처리한다(디코더가 버린다).
+    if (partial && !closed) return ClipStep::Wait;
+    g_clip_plain_left = 1;
+    return ClipStep::Type;
+  }
+
+  TypingCost cost = {};
+  TypingState st = g_typing;
+  st.cost = &cost;
+  for (uint16_t i = 0; i < len; i++) process_input_byte(st, g_clip_batch[i]);
+  if (cost.replaced == 0 && typing_cost_total_ms(cost) <= clip_paste_cost_ms(len, g_typing.korean_mode)) {
+    // 첫 줄(줄바꿈 포함)만 치고 다음 줄에서 다시 고른다.
+    uint16_t line = 0;
+    while (line < len && g_clip_batch[line] != '\n' && g_clip_batch[line] != '\r') line++;
+    g_clip_plain_left = line < len ? static_cast<uint16_t>(line + 1) : len;
+    return ClipStep::Type;
+  }
+
+  // 여기서부터 batch를 소비한다(통계는 타이핑 경로와 똑같이 센다. journal은 붙여넣은 뒤에 센다).
+  uint16_t session_id = 0;
+  uint16_t popped = 0;
+  for (uint16_t i = 0; i < len; i++) {
+    uint8_t b = 0;
+    if (!pop_next_byte(b, session_id)) break;
+    popped++;
+#if BF_FEATURE_STATS
+    g_stats.text_bytes++;
+    g_stats.text_crc = crc32_update(g_stats.text_crc, &b, 1);
+#endif
+  }
+  // 다음 바이트가 LF면 이 batch의 CR과 한 줄바꿈이다.
+  g_typing.prev_was_cr = g_clip_batch[len - 1] == '\r';
+
+  switch_to_english(g_typing);
+  hid_send_combo(KEYBOARD_MODIFIER_LEFTGUI, HID_KEY_R);
+  hid_wait_ms(kClipRunDialogDelayMs);
+  for (const char* c = kClipReceiverCommand; *c != '\0'; c++) {
+    if (clip_abort_if_requested(false)) return ClipStep::Pasted;
+    type_ascii_char(g_typing, *c);
+  }
+  hid_send_combo(0, HID_KEY_ENTER);
+  hid_wait_ms(kClipConsoleDelayMs);
+  if (!clip_type_base64_lines(g_clip_batch, len)) return ClipStep::Pasted;
+  hid_send_combo(0, HID_KEY_ENTER);  // 빈 줄: 수신 끝
+  hid_wait_ms(kClipSetClipboardDelayMs);
+  hid_send_combo(KEYBOARD_MODIFIER_LEFTCTRL, HID_KEY_V);
+  journal_note_pasted_text(session_id, g_clip_batch, popped);
+  hid_wait_ms(g_typing_delay_ms);
+  return ClipStep::Pasted;
+}
+#endif
+
+#if BF_FEATURE_PROFILES
+// -----------------------------
+// Timing profiles (Flash persisted)
+// -----------------------------
+// 타이밍 설정(g_typing_delay_ms 등)은 RAM에만 있어서 부팅할 때마다 기본값으로 돌아간다.
+// 이름 붙인 프로필을 InternalFS(/bf_prof.bin)에 저장해 두고, 부팅 시 HID mount 전에 active 프로필을 적용한다.
+// 재연결 후 config를 다시 쓰지 않아도 첫 키 입력부터 맞춘 속도로 친다.
+// - auto-select를 켜면 USB 호스트 지문이 프로필에 묶인 값과 같을 때 그 프로필로 바꾼다.
+//   지문이 정해질 때까지(mount 후 kProfileFingerprintSettleMs) 타이핑을 미룬다.
+// - 지문: descriptor 콜백은 Adafruit core가 쥐고 있어서 enumeration 요청 자체는 볼 수 없다.
+//   HID 클래스에서 보이는 호스트 동작으로 만든다.
+//   bit15 valid / bit8~10 mount까지 걸린 시간 구간 / bit4~6 settle 동안 받은 LED output report 수(최대 7)
+//   / bit3 LED report 받음 / bit0~2 처음 받은 LED 상태(호스트가 복원하는 Num/Caps/Scroll Lock)
+// - config write는 지금처럼 RAM 값만 바꾼다. 파일은 Profile char의 SAVE/DELETE/ACTIVATE/AUTO 때만 쓴다.
+// - 프로필은 키 종류별 대기 표도 갖는다. 적용하면 앞서 config/job이 바꾼 표를 덮어쓴다.
+static const char* kProfileFilePath = "/bf_prof.bin";
+static const char* kProfileTmpPath = "/bf_prof.tmp";
+static constexpr uint32_t kProfileMagic = 0x32504642;    // "BFP2": 키 종류별 대기 표 추가
+static constexpr uint32_t kProfileMagicV1 = 0x31504642;  // "BFP1": 표가 없던 파일(읽을 때 바꾼다)
+static constexpr uint8_t kMaxProfiles = 8;
+static constexpr size_t kProfileNameMaxLen = 12;
+static constexpr uint8_t kProfileNone = 0xFF;
+static constexpr uint32_t kProfileFingerprintSettleMs = 1500;
+static constexpr uint32_t kProfileMountEdgesMs[] = {250, 500, 1000, 2000, 4000, 8000};
+
+// 지금 적용 중인 프로필이 어디서 왔는지
+static constexpr uint8_t kProfileSourceNone = 0;
+static constexpr uint8_t kProfileSourceBoot = 1;         // 저장된 active 프로필
+static constexpr uint8_t kProfileSourceFingerprint = 2;  // auto-select
+static constexpr uint8_t kProfileSourceActivate = 3;     // ACTIVATE 명령
+
+struct TimingProfile {
+  uint8_t used;
+  uint8_t toggle_key;
+  uint16_t typing_delay_ms;
+  uint16_t mode_switch_delay_ms;
+  uint16_t key_press_delay_ms;
+  uint16_t fingerprint;  // 0이면 호스트에 묶지 않음
+  char name[kProfileNameMaxLen + 1];
+  uint16_t key_class_delay_ms[kKeyClassCount];  // kKeyClassDelayFollow면 typingDelay를 따른다
+};
+
+struct ProfileStore {
+  uint32_t magic;
+  uint8_t active;     // 부팅 시 적용(kProfileNone이면 기본값)
+  uint8_t auto_select;
+  TimingProfile entries[kMaxProfiles];
+  uint32_t crc;  // 위 필드 전체의 CRC-32
+};
+
+// BFP1 파일 layout(TimingProfile에 표가 없던 때)
+struct TimingProfileV1 {
+  uint8_t used;
+  uint8_t toggle_key;
+  uint16_t typing_delay_ms;
+  uint16_t mode_switch_delay_ms;
+  uint16_t key_press_delay_ms;
+  uint16_t fingerprint;
+  char name[kProfileNameMaxLen + 1];
+};
+
+struct ProfileStoreV1 {
+  uint32_t magic;
+  uint8_t active;
+  uint8_t auto_select;
+  TimingProfileV1 entries[kMaxProfiles];
+  uint32_t crc;
+};
+
+static ProfileStore g_profiles = {};
+static uint8_t g_profile_applied = kProfileNone;
+static uint8_t g_profile_source = kProfileSourceNone;
+
+// 호스트 지문(HID task에서만 만진다)
+static uint16_t g_usb_fingerprint = 0;
+static bool g_fp_mounted = false;
+static uint32_t g_fp_attach_ms = 0;  // 부팅 또는 마지막 USB 분리 시각
+static uint32_t g_fp_mounted_ms = 0;
+
+static uint32_t profile_store_crc(const ProfileStore& store) {
+  return ~crc32_update(0xFFFFFFFF, reinterpret_cast<const uint8_t*>(&store), offsetof(ProfileStore, crc));
+}
+
+static void profile_store_reset() {
+  g_profiles = {};
+  g_profiles.magic = kProfileMagic;
+  g_profiles.active = kProfileNone;
+}
+
+// 쓰는 도중 전원이 끊겨도 이전 파일이 남도록 임시 파일에 쓰고 바꿔 끼운다.
+static bool profiles_save() {
+  if (!storage_try_begin()) return false;
+  g_profiles.magic = kProfileMagic;
+  g_profiles.crc = profile_store_crc(g_profiles);
+
+  InternalFS.remove(kProfileTmpPath);
+  File f(InternalFS.open(kProfileTmpPath, FILE_O_WRITE));
+  if (!f) return false;
+  const size_t n = f.write(reinterpret_cast<const uint8_t*>(&g_profiles), sizeof(g_profiles));
+  f.close();
+  if (n != sizeof(g_profiles)) {
+    InternalFS.remove(kProfileTmpPath);
+    return false;
+  }
+  InternalFS.remove(kProfileFilePath);
+  return InternalFS.rename(kProfileTmpPath, kProfileFilePath);
+}
+
+static bool profile_slot_used(uint8_t slot) {
+  return slot < kMaxProfiles && g_profiles.entries[slot].used != 0;
+}
+
+static void profile_apply(uint8_t slot, uint8_t source) {
+  if (!profile_slot_used(slot)) return;
+  const TimingProfile& p = g_profiles.entries[slot];
+  g_typing_delay_ms = p.typing_delay_ms;
+  g_mode_switch_delay_ms = p.mode_switch_delay_ms;
+  g_key_press_delay_ms = p.key_press_delay_ms;
+  g_toggle_key = p.toggle_key;
+  for (uint8_t i = 0; i < kKeyClassCount; i++) g_key_class_delay_ms[i] = p.key_class_delay_ms[i];
+  g_profile_applied = slot;
+  g_profile_source = source;
+}
+
+// "device timing" job의 타이핑이 시작될 때: 앞선 job이 바꾼 타이밍(키 종류별 대기 표 포함)을 프로필 값으로 되돌린다.
+static void profile_reapply() {
+  if (g_profile_applied != kProfileNone) profile_apply(g_profile_applied, g_profile_source);
+}
+
+// setup()에서 hid_begin() 전에 부른다.
+static void profiles_load() {
+  profile_store_reset();
+  if (!storage_try_begin()) return;
+
+  File f(InternalFS.open(kProfileFilePath, FILE_O_READ));
+  if (!f) return;
+  ProfileStore store;
+  const int n = f.read(&store, sizeof(store));
+  f.close();
+  if (n == static_cast<int>(sizeof(ProfileStoreV1)) && store.magic == kProfileMagicV1) {
+    // 표가 없던 파일: 모든 키가 typingDelay를 따르는 것으로 옮긴다(다음 SAVE 때 새 형식으로 쓴다).
+    ProfileStoreV1 old;
+    memcpy(&old, &store, sizeof(old));
+    if (old.crc != ~crc32_update(0xFFFFFFFF, reinterpret_cast<const uint8_t*>(&old), offsetof(ProfileStoreV1, crc))) return;
+    store = {};
+    store.magic = kProfileMagic;
+    store.active = old.active;
+    store.auto_select = old.auto_select;
+    for (uint8_t slot = 0; slot < kMaxProfiles; slot++) {
+      const TimingProfileV1& o = old.entries[slot];
+      TimingProfile& p = store.entries[slot];
+      p.used = o.used;
+      p.toggle_key = o.toggle_key;
+      p.typing_delay_ms = o.typing_delay_ms;
+      p.mode_switch_delay_ms = o.mode_switch_delay_ms;
+      p.key_press_delay_ms = o.key_press_delay_ms;
+      p.fingerprint = o.fingerprint;
+      memcpy(p.name, o.name, sizeof(p.name));
+      for (uint8_t i = 0; i < kKeyClassCount; i++) p.key_class_delay_ms[i] = kKeyClassDelayFollow;
+    }
+  } else {
+    if (n != static_cast<int>(sizeof(store)) || store.magic != kProfileMagic) return;
+    if (store.crc != profile_store_crc(store)) return;
+  }
+
+  g_profiles = store;
+  for (TimingProfile& p : g_profiles.entries) p.name[kProfileNameMaxLen] = 0;
+  profile_apply(g_profiles.active, kProfileSourceBoot);
+}
+
+static int profile_find_fingerprint(uint16_t fingerprint) {
+  if (fingerprint == 0) return -1;
+  for (uint8_t slot = 0; slot < kMaxProfiles; slot++) {
+    if (profile_slot_used(slot) && g_profiles.entries[slot].fingerprint == fingerprint) return slot;
+  }
+  return -1;
+}
+
+static uint16_t profile_compute_fingerprint(uint32_t mount_latency_ms) {
+  uint16_t bucket = 0;
+  for (const uint32_t edge : kProfileMountEdgesMs) {
+    if (mount_latency_ms >= edge) bucket++;
+  }
+  const uint8_t reports = g_led_report_count;
+  uint16_t fp = static_cast<uint16_t>(0x8000u | (bucket << 8) | (reports << 4));
+  if (reports > 0) fp = static_cast<uint16_t>(fp | 0x08u | (g_led_first_state & 0x07u));
+  return fp;
+}
+
+// auto-select 중이면 지문이 정해질 때까지 타이핑하지 않는다(첫 키부터 고른 프로필로 친다).
+static bool profile_ready_to_type() {
+  return !g_profiles.auto_select || !g_fp_mounted || g_usb_fingerprint != 0;
+}
+
+static uint32_t profile_fingerprint_wait_ms(uint32_t now_ms) {
+  if (!g_fp_mounted || g_usb_fingerprint != 0) return kIdleWaitMaxMs;
+  const uint32_t elapsed = now_ms - g_fp_mounted_ms;
+  return elapsed >= kProfileFingerprintSettleMs ? 0 : kProfileFingerprintSettleMs - elapsed;
+}
+
+// HID task: USB mount/분리를 따라가며 지문을 만들고, auto-select면 맞는 프로필을 적용한다.
+static void profile_fingerprint_in_loop() {
+  const bool mounted = TinyUSBDevice.mounted();
+  const uint32_t now_ms = millis();
+  if (mounted != g_fp_mounted) {
+    g_fp_mounted = mounted;
+    if (mounted) {
+      g_fp_mounted_ms = now_ms;
+    } else {
+      g_fp_attach_ms = now_ms;
+      g_usb_fingerprint = 0;
+      led_reset_host_state();
+      profile_publish_state();
+    }
+  }
+  if (!mounted || g_usb_fingerprint != 0 || (now_ms - g_fp_mounted_ms) < kProfileFingerprintSettleMs) return;
+
+  g_usb_fingerprint = profile_compute_fingerprint(g_fp_mounted_ms - g_fp_attach_ms);
+  if (g_profiles.auto_select) {
+    const int slot = profile_find_fingerprint(g_usb_fingerprint);
+    // 자기 타이밍을 가진 job이 이미 타이핑 중이면 그 job이 끝날 때까지 건드리지 않는다.
+    const bool job_owns_timing = g_job_count > 0 && g_jobs[g_job_head].has_timing && !g_jobs[g_job_head].device_timing;
+    if (slot >= 0 && !job_owns_timing) profile_apply(static_cast<uint8_t>(slot), kProfileSourceFingerprint);
+  }
+  profile_publish_state();
+}
+#endif
+
+#if BF_FEATURE_JOURNAL
+// -----------------------------
+// Power-loss journal (리셋 후 이어서 타이핑)
+// -----------------------------
+// 장치가 리셋되면(USB 케이블 분리, 전원 끊김) RAM의 큐/디코더 상태는 사라진다.
+// 진행 위치를 Flash에 checkpoint해 두고, 재부팅 후 웹이 요청하면 마지막 줄 경계부터 이어서 친다.
+// - checkpoint는 줄 경계(\n, \r)에서만 잡는다. 반쯤 친 줄은 재개 시 rollback(ESC 등)으로 지우고 줄 처음부터 다시 친다.
+// - 다시 치면 안 되는 줄(line sync)은 그 줄의 Enter를 치기 전에 바로 Flash에 쓴다(at-most-once). 리셋되어도
+//   이미 Enter를 친 줄은 다시 치지 않는다(명령이 두 번 실행되지 않는다). checkpoint와 Enter 사이에 리셋되면
+//   그 줄은 입력 줄에 남고, 재개 시 rollback이 지운다.
+//   line sync: 캐시 재생(파일 전송 PowerShell), OPEN하지 않은 세션, 재개한 job, OPEN flags bit3을 준 job.
+// - 나머지 줄은 몰아서 쓴다: 타이핑 중에는 kJournalMinIntervalMs에 한 번, 큐가 비거나 pause되면 바로 쓴다.
+//   리셋 직전 최대 그 시간만큼의 줄은 재개 후 다시 쳐진다(at-least-once).
+// - Text(Flush 세션): payload는 웹에 있다. 웹이 [0, offset)의 CRC-32로 같은 텍스트인지 확인한 뒤 offset부터 다시 보낸다.
+// - Cache(TYPE_CACHED 재생): payload가 Flash에 있으므로 장치가 offset부터 직접 재생한다.
+// - 작업이 끝나면(job 완료/CANCEL/Stop/캐시 재생 끝) clean 레코드를 써서 재개 제안을 지운다.
+// - wear leveling: kJournalSlots개 파일을 돌아가며 쓰고, 부팅 시 seq가 가장 큰 유효(CRC) 레코드를 쓴다.
+//   쓰는 도중 전원이 끊겨도 이전 슬롯의 레코드가 남는다.
+static const char* kJournalDir = "/bfj";
+static constexpr uint8_t kJournalSlots = 4;
+static constexpr uint32_t kJournalMagic = 0x314A4642;  // "BFJ1"
+static constexpr uint32_t kJournalMinIntervalMs = 1000;
+
+enum class JournalKind : uint8_t { None = 0, Text = 1, Cache = 2 };
+
+// Journal characteristic op / 결과 코드
+static constexpr uint8_t kJournalOpResume = 0x01;
+static constexpr uint8_t kJournalOpDismiss = 0x02;
+static constexpr uint8_t kJournalResultOk = 0;
+static constexpr uint8_t kJournalResultNoOffer = 1;
+static constexpr uint8_t kJournalResultNotReady = 2;  // USB(대상 PC) 미연결
+static constexpr uint8_t kJournalResultBusy = 3;      // 다른 작업이 진행 중
+static constexpr uint8_t kJournalResultMissing = 4;   // 캐시 항목이 사라짐
+static constexpr uint8_t kJournalResultBadRequest = 5;
+static uint8_t g_journal_op_count = 0;
+static uint8_t g_journal_last_op = 0;
+static uint8_t g_journal_last_result = 0;
+
+struct JournalRecord {
+  uint32_t magic;
+  uint32_t seq;
+  uint8_t kind;
+  uint8_t korean_mode;
+  uint8_t prev_was_cr;
+  uint8_t utf8_need;
+  uint32_t utf8_cp;
+  uint16_t session_id;     // Text
+  uint16_t line_delay_ms;  // Cache
+  uint32_t line_offset;    // 마지막으로 끝난 줄 다음 위치(재개 지점)
+  uint32_t line_crc;       // Text: [0, line_offset)의 CRC-32
+  uint8_t cache_hash[32];  // Cache
+  uint32_t crc;            // 위 필드 전체의 CRC-32
+};
+
+static uint32_t g_journal_seq = 0;
+static JournalKind g_journal_committed_kind = JournalKind::None;  // Flash 최신 레코드
+static uint32_t g_journal_last_commit_ms = 0;
+static JournalRecord g_journal_pending;  // 아직 쓰지 않은 최신 줄 경계(line sync가 아닌 줄)
+static bool g_journal_pending_dirty = false;
+
+// 지금 타이핑 중인 스트림
+static JournalKind g_journal_kind = JournalKind::None;
+static uint16_t g_journal_session = 0;
+static uint8_t g_journal_hash[32];
+static uint32_t g_journal_offset = 0;
+static uint32_t g_journal_crc_state = 0xFFFFFFFF;
+
+// 부팅 시 읽은 재개 제안과, RESUME 직후 스트림이 이어받을 기준값
+static JournalRecord g_journal_offer;
+static bool g_journal_offer_valid = false;
+static JournalRecord g_journal_base;
+static bool g_journal_base_valid = false;
+static bool g_journal_usb_mounted = false;
+
+// BLE 콜백 -> HID task 요청(Flash 쓰기/HID 출력은 HID task에서만 한다)
+static volatile uint8_t g_journal_request_op = 0;
+static volatile uint8_t g_journal_request_arg = 0;
+static volatile bool g_journal_discard_requested = false;
+static volatile uint16_t g_journal_discard_session = 0;  // 0이면 세션 무관
+
+static uint32_t journal_record_crc(const JournalRecord& rec) {
+  return ~crc32_update(0xFFFFFFFF, reinterpret_cast<const uint8_t*>(&rec), offsetof(JournalRecord, crc));
+}
+
+static void journal_slot_path(uint8_t slot, char* out, size_t out_size) {
+  snprintf(out, out_size, "%s/j%u.bin", kJournalDir, static_cast<unsigned>(slot));
+}
+
+static void journal_write(const JournalRecord& src) {
+  // 이 레코드가 미뤄 둔 줄 경계보다 최신이다(또는 clean 레코드).
+  g_journal_pending_dirty = false;
+  g_journal_last_commit_ms = millis();
+  if (!storage_try_begin()) return;
+  JournalRecord rec = src;
+  rec.magic = kJournalMagic;
+  rec.seq = ++g_journal_seq;
+  rec.crc = journal_record_crc(rec);
+
+  char path[24];
+  journal_slot_path(static_cast<uint8_t>(rec.seq % kJournalSlots), path, sizeof(path));
+  InternalFS.remove(path);
+  File f(InternalFS.open(path, FILE_O_WRITE));
+  if (!f) return;
+  f.write(reinterpret_cast<const uint8_t*>(&rec), sizeof(rec));
+  f.close();
+  g_journal_committed_kind = static_cast<JournalKind>(rec.kind);
+}
+
+// 부팅 시 가장 최근 레코드를 읽어 재개 제안으로 둔다.
+static void journal_load() {
+  if (!storage_try_begin()) return;
+  InternalFS.mkdir(kJournalDir);
+
+  bool found = false;
+  JournalRecord best = {};
+  for (uint8_t slot = 0; slot < kJournalSlots; slot++) {
+    char path[24];
+    journal_slot_path(slot, path, sizeof(path));
+    File f(InternalFS.open(path, FILE_O_READ));
+    if (!f) continue;
+    JournalRecord rec;
+    const int n = f.read(&rec, sizeof(rec));
+    f.close();
+    if (n != static_cast<int>(sizeof(rec)) || rec.magic != kJournalMagic) continue;
+    if (rec.crc != journal_record_crc(rec)) continue;
+    if (!found || static_cast<int32_t>(rec.seq - best.seq) > 0) {
+      best = rec;
+      found = true;
+    }
+  }
+  if (!found) return;
+
+  g_journal_seq = best.seq;
+  g_journal_committed_kind = static_cast<JournalKind>(best.kind);
+  if (best.kind == static_cast<uint8_t>(JournalKind::Text) || best.kind == static_cast<uint8_t>(JournalKind::Cache)) {
+    g_journal_offer = best;
+    g_journal_offer_valid = true;
+  }
+}
+
+// 지금 치는 줄이 다시 치면 안 되는 줄인지(at-most-once로 쓴다).
+static bool journal_line_sync() {
+  if (g_journal_kind == JournalKind::Cache) return true;
+  bool sync = false;
+  noInterrupts();
+  if (g_job_count > 0 && g_jobs[g_job_head].session_id == g_journal_session) sync = g_jobs[g_job_head].line_sync;
+  interrupts();
+  return sync;
+}
+
+// 지금 위치(g_journal_offset/crc)와 그 위치에서의 디코더 상태 st를 checkpoint한다.
+// line sync면 바로 쓰고, 아니면 kJournalMinIntervalMs가 지났을 때만 쓴다(남은 것은 journal_service_in_loop가 쓴다).
+static void journal_checkpoint(const TypingState& st) {
+  JournalRecord rec = {};
+  rec.kind = static_cast<uint8_t>(g_journal_kind);
+  rec.korean_mode = st.korean_mode ? 1 : 0;
+  rec.prev_was_cr = st.prev_was_cr ? 1 : 0;
+  rec.utf8_need = st.utf8_need;
+  rec.utf8_cp = st.utf8_cp;
+  rec.session_id = g_journal_session;
+  rec.line_offset = g_journal_offset;
+  if (g_journal_kind == JournalKind::Text) {
+    rec.line_crc = ~g_journal_crc_state;
+#if BF_FEATURE_CACHE
+  } else {
+    rec.line_delay_ms = g_cache_play_line_delay_ms;
+    memcpy(rec.cache_hash, g_journal_hash, sizeof(rec.cache_hash));
+#endif
+  }
+  if (journal_line_sync() || (millis() - g_journal_last_commit_ms) >= kJournalMinIntervalMs) {
+    journal_write(rec);
+  } else {
+    g_journal_pending = rec;
+    g_journal_pending_dirty = true;
+  }
+}
+
+// 줄 경계: 줄바꿈 바이트 b를 치기 전에, 그 바이트까지 친 뒤의 위치와 디코더 상태를 바로 checkpoint한다.
+// 디코더 상태는 g_typing 사본으로 b를 dry-run해서 얻는다. Enter가 나가지 않는 바이트(CRLF의 LF)는 건너뛴다.
+static void journal_checkpoint_line(uint8_t b) {
+  if (b != '\n' && b != '\r') return;
+  TypingCost cost = {};
+  TypingState st = g_typing;
+  st.cost = &cost;
+  process_input_byte(st, b);
+  if (cost.keystrokes == 0) return;
+  journal_checkpoint(st);
+}
+
+// 새 스트림이면 처음부터(또는 RESUME한 지점부터) 센다.
+static void journal_begin_stream(JournalKind kind, uint16_t session_id, const uint8_t* hash, uint32_t offset) {
+  g_journal_kind = kind;
+  g_journal_session = session_id;
+  if (hash) memcpy(g_journal_hash, hash, sizeof(g_journal_hash));
+  g_journal_offset = offset;
+  g_journal_crc_state = 0xFFFFFFFF;
+  if (g_journal_base_valid && g_journal_base.kind == static_cast<uint8_t>(kind)
+      && (kind == JournalKind::Text ? g_journal_base.session_id == session_id
+                                    : memcmp(g_journal_base.cache_hash, hash, 32) == 0)) {
+    g_journal_offset = g_journal_base.line_offset;
+    g_journal_crc_state = ~g_journal_base.line_crc;
+  }
+  g_journal_base_valid = false;
+}
+
+// HID task: Flush 세션 바이트를 하나 타이핑하기 전에 호출한다.
+static void journal_note_text_byte(uint16_t session_id, uint8_t b) {
+  if (session_id == 0) return;
+  if (g_journal_kind != JournalKind::Text || g_journal_session != session_id) {
+    journal_begin_stream(JournalKind::Text, session_id, nullptr, 0);
+  }
+  g_journal_offset++;
+  g_journal_crc_state = crc32_update(g_journal_crc_state, &b, 1);
+  journal_checkpoint_line(b);
+}
+
+#if BF_FEATURE_CLIP_PASTE
+// HID task: 클립보드로 붙여넣은 batch를 Ctrl+V를 보낸 뒤에 센다.
+// batch는 한 번에 들어가므로 그 안의 마지막 줄 경계 하나만 checkpoint한다. 붙여넣기 전에 checkpoint하면
+// 붙여넣는 도중 전원이 꺼졌을 때 재개가 들어가지 않은 줄을 건너뛴다.
+// 붙여넣기 경로는 영문 모드로 바꾸고 문자 경계에서 batch를 자르므로 디코더 상태는 g_typing에 prev_was_cr만 다르다.
+static void journal_note_pasted_text(uint16_t session_id, const uint8_t* data, uint16_t len) {
+  if (session_id == 0 || len == 0) return;
+  if (g_journal_kind != JournalKind::Text || g_journal_session != session_id) {
+    journal_begin_stream(JournalKind::Text, session_id, nullptr, 0);
+  }
+  uint16_t last_break = len;
+  for (uint16_t i = 0; i < len; i++) {
+    if (data[i] == '\n' || data[i] == '\r') last_break = i;
+  }
+  for (uint16_t i = 0; i < len; i++) {
+    g_journal_offset++;
+    g_journal_crc_state = crc32_update(g_journal_crc_state, &data[i], 1);
+    if (i == last_break) {
+      TypingState st = g_typing;
+      st.prev_was_cr = data[i] == '\r';
+      journal_checkpoint(st);
+    }
+  }
+}
+#endif
+
+#if BF_FEATURE_CACHE
+// HID task: 캐시 재생 바이트를 하나 타이핑하기 전에 호출한다(g_cache_play_offset은 이미 증가한 값).
+static void journal_note_cache_byte(uint8_t b) {
+  if (g_cache_play_entry < 0) return;
+  const uint8_t* hash = g_cache_entries[g_cache_play_entry].hash;
+  if (g_journal_kind != JournalKind::Cache || memcmp(g_journal_hash, hash, sizeof(g_journal_hash)) != 0) {
+    journal_begin_stream(JournalKind::Cache, 0, hash, 0);
+  }
+  g_journal_offset = g_cache_play_offset;
+  journal_checkpoint_line(b);
+}
+#endif
+
+// 취소/abort/재생 완료: 이어서 칠 것이 없다고 기록하도록 요청한다(BLE task에서도 호출).
+// 이미 다른 세션의 요청이 걸려 있으면 세션 무관(0)으로 넓힌다(둘 다 지운다).
+static void journal_request_discard(uint16_t session_id) {
+  noInterrupts();
+  if (g_journal_discard_requested && g_journal_discard_session != session_id) session_id = 0;
+  g_journal_discard_session = session_id;
+  g_journal_discard_requested = true;
+  interrupts();
+}
+
+// HID task: session_id(0이면 세션 무관)의 스트림이 끝났다고 바로 기록한다.
+static void journal_discard_session(uint16_t session_id) {
+  if (session_id != 0 && (g_journal_kind != JournalKind::Text || g_journal_session != session_id)) return;
+
+  g_journal_kind = JournalKind::None;
+  g_journal_base_valid = false;
+  g_journal_pending_dirty = false;
+  if (g_journal_committed_kind != JournalKind::None) {
+    const JournalRecord clean = {};
+    journal_write(clean);
+  }
+}
+
+static void journal_discard_in_loop() {
+  noInterrupts();
+  const bool requested = g_journal_discard_requested;
+  const uint16_t session_id = g_journal_discard_session;
+  g_journal_discard_requested = false;
+  interrupts();
+  if (requested) journal_discard_session(session_id);
+}
+
+static uint8_t journal_resume(uint8_t rollback);
+
+static void journal_service_in_loop() {
+  journal_discard_in_loop();
+
+  const uint8_t op = g_journal_request_op;
+  if (op != 0) {
+    const uint8_t arg = g_journal_request_arg;
+    g_journal_request_op = 0;
+    uint8_t result = kJournalResultBadRequest;
+    if (op == kJournalOpResume) {
+      result = journal_resume(arg);
+    } else if (op == kJournalOpDismiss) {
+      g_journal_offer_valid = false;
+      journal_discard_session(0);
+      result = kJournalResultOk;
+    }
+    g_journal_last_op = op;
+    g_journal_last_result = result;
+    g_journal_op_count++;
+    journal_publish_state();
+  }
+
+  // 재부팅 후 USB(대상 PC)가 잡히면 재개할 수 있다고 알린다.
+  const bool mounted = TinyUSBDevice.mounted();
+  if (mounted != g_journal_usb_mounted) {
+    g_journal_usb_mounted = mounted;
+    journal_publish_state();
+  }
+
+  // 미뤄 둔 줄 경계: 시간이 지났거나 멈춰 있으면(큐가 빔/pause) 쓴다.
+  if (!g_journal_pending_dirty) return;
+  if (!g_paused && !is_flush_idle() && (millis() - g_journal_last_commit_ms) < kJournalMinIntervalMs) return;
+  journal_write(g_journal_pending);
+}
+
+// 재개: 반쯤 친 줄을 지우고, 디코더 상태를 복원한 뒤 줄 경계부터 이어 간다.
+// rollback: 0=없음, 1=ESC(PowerShell/cmd 입력 줄 지우기), 2=Shift+Home 후 Backspace(편집기)
+static uint8_t journal_resume(uint8_t rollback) {
+  if (!g_journal_offer_valid) return kJournalResultNoOffer;
+  if (!hid_ready()) return kJournalResultNotReady;
+  if (!is_flush_idle()) return kJournalResultBusy;
+
+  const JournalRecord& rec = g_journal_offer;
+#if BF_FEATURE_CACHE
+  if (rec.kind == static_cast<uint8_t>(JournalKind::Cache) && payload_cache_find(rec.cache_hash) < 0) {
+#else
+  if (rec.kind == static_cast<uint8_t>(JournalKind::Cache)) {  // 캐시를 뺀 빌드는 재생할 수 없다.
+#endif
+    return kJournalResultMissing;
+  }
+
+  if (rollback == 1) {
+    hid_send_key(0, HID_KEY_ESCAPE);
+  } else if (rollback == 2) {
+    hid_send_combo(KEYBOARD_MODIFIER_LEFTSHIFT, HID_KEY_HOME);
+    hid_send_key(0, HID_KEY_BACKSPACE);
+  }
+  hid_wait_ms(g_typing_delay_ms);
+
+  g_typing.korean_mode = rec.korean_mode != 0;
+  g_typing.prev_was_cr = rec.prev_was_cr != 0;
+  g_typing.utf8_need = rec.utf8_need;
+  g_typing.utf8_cp = rec.utf8_cp;
+
+  g_journal_base = rec;
+  g_journal_base_valid = true;
+  g_journal_kind = JournalKind::None;
+
+  if (rec.kind == static_cast<uint8_t>(JournalKind::Text)) {
+    // 같은 sessionId의 job을 seq 0부터 다시 연다(웹은 offset 이후 바이트만 보낸다).
+    // 무엇을 치던 중이었는지 모르므로 줄마다 Enter 전에 쓴다.
+    FlushJob job = {};
+    job.session_id = rec.session_id;
+    job.line_sync = true;
+    if (!job_append(job)) return kJournalResultBusy;
+    job_publish_state();
+#if BF_FEATURE_CACHE
+  } else {
+    payload_cache_play_begin(rec.cache_hash, rec.line_delay_ms);
+    g_cache_play_offset = rec.line_offset;
+    payload_cache_publish_state();
+#endif
+  }
+
+  g_journal_offer_valid = false;
+  return kJournalResultOk;
+}
+#else
+// journal이 빠지면 타이핑/job 경로의 hook은 아무것도 하지 않는다.
+static inline void journal_note_text_byte(uint16_t /*session_id*/, uint8_t /*b*/) {}
+#if BF_FEATURE_CLIP_PASTE
+static inline void journal_note_pasted_text(uint16_t /*session_id*/, const uint8_t* /*data*/, uint16_t /*len*/) {}
+#endif
+#if BF_FEATURE_CACHE
+static inline void journal_note_cache_byte(uint8_t /*b*/) {}
+#endif
+static inline void journal_request_discard(uint16_t /*session_id*/) {}
+static inline void journal_discard_session(uint16_t /*session_id*/) {}
+#endif
+
+#if BF_FEATURE_DOCS
+// -----------------------------
+// Document snapshots (diff 재타이핑, Flash persisted)
+// -----------------------------
+// 설정 파일을 고쳐서 다시 flush할 때 전체를 지우고 다시 치지 않도록, 마지막으로 끝까지 친 문서를 이름별로 기억한다.
+// 원문 대신 줄마다 CRC-32만 저장한다(2,000줄 = 8KB; 원문은 InternalFS 용량에 들어가지 않는다).
+// 웹이 새 문서의 줄 hash와 비교해 바뀐 줄만 in-band CHORD(이동/선택 키)와 텍스트로 보낸다.
+// - kDocSlots개 파일(/bfd/dN.bin)에 [DocHeader][u32 hash x lineCount]로 저장한다.
+// - 같은 이름은 그 슬롯을 덮어쓰고, 새 이름은 빈 슬롯 -> 가장 오래 전에 저장한 슬롯 순으로 쓴다.
+//   총량이 kDocBudgetBytes를 넘으면 오래된 스냅샷부터 지운다.
+// - 저장은 tmp 파일에 모은 뒤 COMMIT에서 바꿔 끼운다(쓰는 도중 리셋되면 이전 스냅샷이 남는다).
+static const char* kDocDir = "/bfd";
+static const char* kDocTmpPath = "/bfd/tmp.bin";
+static constexpr uint8_t kDocSlots = 4;
+static constexpr uint16_t kDocMaxLines = 2048;
+static constexpr uint32_t kDocBudgetBytes = 10 * 1024;
+static constexpr uint32_t kDocMagic = 0x31444642;  // "BFD1"
+static constexpr size_t kDocNameMaxLen = 16;
+static constexpr uint8_t kDocNone = 0xFF;
+
+// Doc characteristic 결과 코드
+static constexpr uint8_t kDocResultOk = 0;
+static constexpr uint8_t kDocResultBadRequest = 1;
+static constexpr uint8_t kDocResultNotFound = 2;
+static constexpr uint8_t kDocResultTooLarge = 3;  // kDocMaxLines 초과(웹은 전체 flush만 한다)
+static constexpr uint8_t kDocResultIoError = 4;
+static constexpr uint8_t kDocResultBusy = 5;      // 앞선 요청을 아직 처리 중
+
+struct DocHeader {
+  uint32_t magic;
+  uint32_t seq;         // 저장 순서(클수록 최근)
+  uint16_t line_count;
+  uint16_t reserved;
+  uint32_t doc_crc;     // 문서 전체의 CRC-32(웹이 보낸 값, 같은 문서인지 확인용)
+  uint32_t hash_crc;    // hash 배열의 CRC-32
+  char name[kDocNameMaxLen + 1];
+  uint8_t pad[3];
+  uint32_t crc;         // 위 필드 전체의 CRC-32
+};
+
+static DocHeader g_doc_headers[kDocSlots];  // magic이 0이면 빈 슬롯
+static bool g_doc_loaded = false;
+static uint32_t g_doc_seq = 0;
+
+// 진행 중인 저장(BEGIN -> DATA* -> COMMIT)
+static bool g_doc_store_active = false;
+static DocHeader g_doc_store;
+static uint16_t g_doc_store_received = 0;
+static uint32_t g_doc_store_crc_state = 0xFFFFFFFF;
+
+static uint32_t doc_header_crc(const DocHeader& h) {
+  return ~crc32_update(0xFFFFFFFF, reinterpret_cast<const uint8_t*>(&h), offsetof(DocHeader, crc));
+}
+
+static void doc_slot_path(uint8_t slot, char* out, size_t out_size) {
+  snprintf(out, out_size, "%s/d%u.bin", kDocDir, static_cast<unsigned>(slot));
+}
+
+static uint32_t doc_file_bytes(const DocHeader& h) {
+  return sizeof(DocHeader) + static_cast<uint32_t>(h.line_count) * 4u;
 }
 
-static inline bool pop_next_byte(uint8_t& out) {
-  // Preserve order: bytes moved to stash are always older.
-  if (stash_pop(out)) return true;
-  return rb_pop(out);
+// 슬롯 헤더만 RAM에 둔다. hash는 READ 때 파일에서 페이지 단위로 읽는다.
+static bool doc_store_ready() {
+  if (!storage_try_begin()) return false;
+  if (g_doc_loaded) return true;
+  g_doc_loaded = true;
+
+  InternalFS.mkdir(kDocDir);
+  InternalFS.remove(kDocTmpPath);
+  for (uint8_t slot = 0; slot < kDocSlots; slot++) {
+    DocHeader& h = g_doc_headers[slot];
+    h = {};
+    char path[24];
+    doc_slot_path(slot, path, sizeof(path));
+    File f(InternalFS.open(path, FILE_O_READ));
+    if (!f) continue;
+    DocHeader rec;
+    const int n = f.read(&rec, sizeof(rec));
+    const uint32_t size = f.size();
+    f.close();
+    if (n != static_cast<int>(sizeof(rec)) || rec.magic != kDocMagic || rec.crc != doc_header_crc(rec) ||
+        rec.line_count > kDocMaxLines || size != doc_file_bytes(rec)) {
+      InternalFS.remove(path);
+      continue;
+    }
+    rec.name[kDocNameMaxLen] = 0;
+    h = rec;
+    if (h.seq > g_doc_seq) g_doc_seq = h.seq;
+  }
+  return true;
+}
+
+static uint8_t doc_find(const char* name) {
+  if (!doc_store_ready() || !name[0]) return kDocNone;
+  for (uint8_t slot = 0; slot < kDocSlots; slot++) {
+    if (g_doc_headers[slot].magic == kDocMagic && strcmp(g_doc_headers[slot].name, name) == 0) return slot;
+  }
+  return kDocNone;
+}
+
+static void doc_remove_slot(uint8_t slot) {
+  char path[24];
+  doc_slot_path(slot, path, sizeof(path));
+  InternalFS.remove(path);
+  g_doc_headers[slot] = {};
+}
+
+// [first, first+count) 줄의 hash를 읽는다. 읽은 개수를 돌려준다.
+static uint16_t doc_read_hashes(uint8_t slot, uint16_t first, uint16_t count, uint8_t* out) {
+  const DocHeader& h = g_doc_headers[slot];
+  if (first >= h.line_count) return 0;
+  if (count > h.line_count - first) count = static_cast<uint16_t>(h.line_count - first);
+  char path[24];
+  doc_slot_path(slot, path, sizeof(path));
+  File f(InternalFS.open(path, FILE_O_READ));
+  if (!f) return 0;
+  f.seek(sizeof(DocHeader) + static_cast<uint32_t>(first) * 4u);
+  const int n = f.read(out, static_cast<uint16_t>(count * 4u));
+  f.close();
+  return n > 0 ? static_cast<uint16_t>(n / 4) : 0;
+}
+
+static uint8_t doc_save_begin(const char* name, uint16_t line_count, uint32_t doc_crc) {
+  g_doc_store_active = false;
+  if (!doc_store_ready()) return kDocResultIoError;
+  if (!name[0] || line_count == 0) return kDocResultBadRequest;
+  if (line_count > kDocMaxLines) return kDocResultTooLarge;
+
+  InternalFS.remove(kDocTmpPath);
+  g_doc_store = {};
+  g_doc_store.magic = kDocMagic;
+  g_doc_store.line_count = line_count;
+  g_doc_store.doc_crc = doc_crc;
+  memcpy(g_doc_store.name, name, strnlen(name, kDocNameMaxLen));
+  // 헤더 자리는 COMMIT에서 채운다(hash_crc/seq가 그때 정해진다).
+  File f(InternalFS.open(kDocTmpPath, FILE_O_WRITE));
+  if (!f) return kDocResultIoError;
+  const size_t n = f.write(reinterpret_cast<const uint8_t*>(&g_doc_store), sizeof(g_doc_store));
+  f.close();
+  if (n != sizeof(g_doc_store)) {
+    InternalFS.remove(kDocTmpPath);
+    return kDocResultIoError;
+  }
+  g_doc_store_received = 0;
+  g_doc_store_crc_state = 0xFFFFFFFF;
+  g_doc_store_active = true;
+  return kDocResultOk;
+}
+
+// DATA는 줄 순서대로 온다(index가 지금까지 받은 줄 수와 같아야 한다).
+static uint8_t doc_save_append(uint16_t index, const uint8_t* hashes, uint16_t count) {
+  if (!g_doc_store_active || index != g_doc_store_received ||
+      count > g_doc_store.line_count - g_doc_store_received) {
+    g_doc_store_active = false;
+    InternalFS.remove(kDocTmpPath);
+    return kDocResultBadRequest;
+  }
+  File f(InternalFS.open(kDocTmpPath, FILE_O_WRITE));
+  if (!f) {
+    g_doc_store_active = false;
+    return kDocResultIoError;
+  }
+  const size_t bytes = static_cast<size_t>(count) * 4u;
+  const size_t written = f.write(hashes, bytes);
+  f.close();
+  if (written != bytes) {
+    g_doc_store_active = false;
+    InternalFS.remove(kDocTmpPath);
+    return kDocResultIoError;
+  }
+  g_doc_store_crc_state = crc32_update(g_doc_store_crc_state, hashes, bytes);
+  g_doc_store_received = static_cast<uint16_t>(g_doc_store_received + count);
+  return kDocResultOk;
+}
+
+static uint8_t doc_save_commit() {
+  if (!g_doc_store_active) return kDocResultBadRequest;
+  g_doc_store_active = false;
+  if (g_doc_store_received != g_doc_store.line_count) {
+    InternalFS.remove(kDocTmpPath);
+    return kDocResultBadRequest;
+  }
+
+  // 같은 이름이면 그 슬롯, 아니면 빈 슬롯 -> 가장 오래된 슬롯
+  uint8_t slot = doc_find(g_doc_store.name);
+  if (slot == kDocNone) {
+    for (uint8_t i = 0; i < kDocSlots; i++) {
+      if (g_doc_headers[i].magic != kDocMagic) {
+        slot = i;
+        break;
+      }
+      if (slot == kDocNone || g_doc_headers[i].seq < g_doc_headers[slot].seq) slot = i;
+    }
+  }
+  // 총량 상한: 다른 슬롯을 오래된 것부터 지운다.
+  for (;;) {
+    uint32_t used = doc_file_bytes(g_doc_store);
+    uint8_t oldest = kDocNone;
+    for (uint8_t i = 0; i < kDocSlots; i++) {
+      if (i == slot || g_doc_headers[i].magic != kDocMagic) continue;
+      used += doc_file_bytes(g_doc_headers[i]);
+      if (oldest == kDocNone || g_doc_headers[i].seq < g_doc_headers[oldest].seq) oldest = i;
+    }
+    if (used <= kDocBudgetBytes || oldest == kDocNone) break;
+    doc_remove_slot(oldest);
+  }
+
+  g_doc_store.seq = ++g_doc_seq;
+  g_doc_store.hash_crc = ~g_doc_store_crc_state;
+  g_doc_store.crc = doc_header_crc(g_doc_store);
+  {
+    File f(InternalFS.open(kDocTmpPath, FILE_O_WRITE));
+    if (!f) {
+      InternalFS.remove(kDocTmpPath);
+      return kDocResultIoError;
+    }
+    f.seek(0);
+    const size_t n = f.write(reinterpret_cast<const uint8_t*>(&g_doc_store), sizeof(g_doc_store));
+    f.close();
+    if (n != sizeof(g_doc_store)) {
+      InternalFS.remove(kDocTmpPath);
+      return kDocResultIoError;
+    }
+  }
+
+  char path[24];
+  doc_slot_path(slot, path, sizeof(path));
+  InternalFS.remove(path);
+  g_doc_headers[slot] = {};
+  if (!InternalFS.rename(kDocTmpPath, path)) {
+    InternalFS.remove(kDocTmpPath);
+    return kDocResultIoError;
+  }
+  g_doc_headers[slot] = g_doc_store;
+  return kDocResultOk;
 }
+#endif
 
 // -----------------------------
 // BLE GATT
@@ -971,13 +4095,43 @@ static inline bool pop_next_byte(uint8_t& out) {
 BLEService flusher_service(kFlusherServiceUuid);
 BLECharacteristic flush_text_char(kFlushTextCharUuid);
 BLECharacteristic config_char(kConfigCharUuid);
-BLECharacteristic nickname_char(kNicknameCharUuid);
 BLECharacteristic status_char(kStatusCharUuid);
-BLECharacteristic macro_char(kMacroCharUuid);
 BLECharacteristic bootloader_char(kBootloaderCharUuid);
+BLECharacteristic job_char(kJobCharUuid);
+#if BF_FEATURE_NICKNAME
+BLECharacteristic nickname_char(kNicknameCharUuid);
+#endif
+#if BF_FEATURE_MACRO
+BLECharacteristic macro_char(kMacroCharUuid);
+#endif
+#if BF_FEATURE_MOUSE
 BLECharacteristic scroll_char(kScrollCharUuid);
+#endif
+#if BF_FEATURE_CACHE
+BLECharacteristic cache_char(kCacheCharUuid);
+#endif
+#if BF_FEATURE_ESTIMATE
+BLECharacteristic estimate_char(kEstimateCharUuid);
+#endif
+#if BF_FEATURE_JOURNAL
+BLECharacteristic journal_char(kJournalCharUuid);
+#endif
+#if BF_FEATURE_STATS
+BLECharacteristic stats_char(kStatsCharUuid);
+#endif
+#if BF_FEATURE_TARGET
+BLECharacteristic target_char(kTargetCharUuid);
+#endif
+#if BF_FEATURE_PROFILES
+BLECharacteristic profile_char(kProfileCharUuid);
+#endif
+#if BF_FEATURE_DOCS
+BLECharacteristic doc_char(kDocCharUuid);
+#endif
 
-static void nickname_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+#if BF_FEATURE_NICKNAME
+static void nickname_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
   // Payload: UTF-8(권장 ASCII). 빈 값(또는 0x00 1바이트)이면 닉네임을 제거한다.
   if (!data) return;
 
@@ -1008,20 +4162,843 @@ static void nickname_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/,
   // Update GAP name for next advertising (현재 연결 중에는 광고를 중지하므로 여기서 재광고는 하지 않는다).
   Bluefruit.setName(build_ble_device_name());
 }
+#endif
+
+#if BF_FEATURE_CACHE
+// Cache characteristic Read 값
+// [magic(0xCA)][lastOp(u8)][lastResult(u8)][playing(u8)][entryCount(u8)][opCount(u8)][usedBytes(u16)][budgetBytes(u16)]
+// - write 응답은 콜백보다 먼저 나갈 수 있으므로, 웹은 opCount가 증가할 때까지 다시 읽는다.
+static constexpr uint8_t kCacheStateMagic = 0xCA;
+
+static void payload_cache_publish_state() {
+  uint8_t payload[10];
+  const uint32_t used = payload_cache_used_bytes();
+  payload[0] = kCacheStateMagic;
+  payload[1] = g_cache_last_op;
+  payload[2] = g_cache_last_result;
+  payload[3] = g_cache_play_entry >= 0 ? 1 : 0;
+  payload[4] = g_cache_entry_count;
+  payload[5] = g_cache_op_count;
+  payload[6] = used & 0xff;
+  payload[7] = (used >> 8) & 0xff;
+  payload[8] = kPayloadCacheBudgetBytes & 0xff;
+  payload[9] = (kPayloadCacheBudgetBytes >> 8) & 0xff;
+  cache_char.write(payload, sizeof(payload));
+}
+
+// Cache characteristic
+// Write: [op(u8)][...]  (HID task에서 실행, Flash 읽기/쓰기)
+// - 0x01 QUERY  [sha256(32)]           -> lastResult: Ok(hit) / Miss
+// - 0x02 BEGIN  [sha256(32)][size(u32)] 저장 시작(필요 시 LRU evict)
+// - 0x03 DATA   [bytes...]              순서대로 append
+// - 0x04 COMMIT                         SHA-256 검증 후 등록
+// - 0x05 CLEAR                          전체 삭제
+// 재생은 macro cmd 0x09(TYPE_CACHED)로 한다(텍스트/매크로 순서 유지).
+// 웹은 opCount가 바뀐 것을 보고 다음 요청을 보낸다. 처리 전에 또 쓰면 Busy로 거절한다.
+static constexpr uint16_t kCacheRequestMax = 244;
+static uint8_t g_cache_request[kCacheRequestMax];
+static volatile uint8_t g_cache_request_len = 0;
+
+static uint8_t cache_run_request(const uint8_t* data, uint16_t len) {
+  switch (data[0]) {
+    case 0x01:
+      if (len >= 33) return payload_cache_find(&data[1]) >= 0 ? kCacheResultOk : kCacheResultMiss;
+      break;
+    case 0x02:
+      if (len >= 37) return payload_cache_store_begin(&data[1], le32(&data[33]));
+      break;
+    case 0x03:
+      return payload_cache_store_append(&data[1], static_cast<uint16_t>(len - 1));
+    case 0x04:
+      return payload_cache_store_commit();
+    case 0x05:
+      return payload_cache_clear();
+    default:
+      break;
+  }
+  return kCacheResultBadRequest;
+}
+
+static void cache_service_in_loop() {
+  const uint8_t len = g_cache_request_len;
+  if (len == 0) return;
+  g_cache_last_op = g_cache_request[0];
+  g_cache_last_result = cache_run_request(g_cache_request, len);
+  g_cache_request_len = 0;
+  g_cache_op_count++;
+  payload_cache_publish_state();
+}
+
+static void cache_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
+  if (!data || len == 0 || len > sizeof(g_cache_request) || g_cache_request_len != 0) {
+    g_cache_last_op = (data && len > 0) ? data[0] : 0;
+    g_cache_last_result = (g_cache_request_len != 0) ? kCacheResultBusy : kCacheResultBadRequest;
+    g_cache_op_count++;
+    payload_cache_publish_state();
+    return;
+  }
+  memcpy(g_cache_request, data, len);
+  g_cache_request_len = static_cast<uint8_t>(len);
+  hid_task_wake();
+}
+#endif
+
+static void put_le16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+}
+
+static void put_le32(uint8_t* p, uint32_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+#if BF_FEATURE_ESTIMATE
+// Estimate characteristic
+// - 텍스트를 실제 디코더로 dry-run(HID 출력/대기 없음)해서 키 입력 수/전환 수/지연 시간을 센다.
+// - 새 세션(flush text seq 0)과 같은 초기 상태(영문, CR/UTF-8 없음)에서 시작한다.
+// Read: [magic(0xE5)][opCount(u8)][bytes(u32)][keystrokes(u32)][modeSwitches(u32)]
+//       [typingMs(u32)][keyPressMs(u32)][modeSwitchMs(u32)][waitMs(u32)] (LE)
+//       waitMs: in-band WAIT/WAIT_IDLE 합계(1.2.16+)
+static constexpr uint8_t kEstimateStateMagic = 0xE5;
+static TypingCost g_estimate_cost = {};
+static TypingState g_estimate_state = {false, false, 0, 0, &g_estimate_cost};
+static uint8_t g_estimate_op_count = 0;
+
+static void estimate_publish_state() {
+  uint8_t payload[30];
+  payload[0] = kEstimateStateMagic;
+  payload[1] = g_estimate_op_count;
+  put_le32(&payload[2], g_estimate_cost.bytes);
+  put_le32(&payload[6], g_estimate_cost.keystrokes);
+  put_le32(&payload[10], g_estimate_cost.mode_switches);
+  put_le32(&payload[14], g_estimate_cost.typing_ms);
+  put_le32(&payload[18], g_estimate_cost.key_press_ms);
+  put_le32(&payload[22], g_estimate_cost.mode_switch_ms);
+  put_le32(&payload[26], g_estimate_cost.wait_ms);
+  estimate_char.write(payload, sizeof(payload));
+}
+
+static void estimate_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
+  // Format: [op(u8)][...]
+  // - 0x01 RESET          카운터/디코더 상태 초기화
+  // - 0x02 DATA [bytes]   이어서 dry-run(청크 경계에서 UTF-8이 잘려도 된다)
+  if (!data || len == 0) return;
+
+  switch (data[0]) {
+    case 0x01:
+      g_estimate_cost = {};
+      g_estimate_state = {false, false, 0, 0, &g_estimate_cost};
+      break;
+    case 0x02:
+      for (uint16_t i = 1; i < len; i++) {
+        process_input_byte(g_estimate_state, data[i]);
+      }
+      break;
+    default:
+      return;
+  }
+
+  g_estimate_op_count++;
+  estimate_publish_state();
+}
+#endif
+
+// Job characteristic
+// Write: [op(u8)][sessionId(u16)][...]
+// - 0x01 OPEN   [sessionId] (+ [typingDelayMs(u16)][modeSwitchDelayMs(u16)][keyPressDelayMs(u16)][toggleKey(u8)]
+//               (+ [flags(u8)]))
+//               tail에 job을 등록한다. 타이밍을 주면 그 job의 타이핑이 시작될 때 적용한다.
+//               flags: bit0 clipboard paste 허용(Windows, "Clipboard paste transport" 참고)
+//                      bit1 device timing: 실은 타이밍 대신 장치에 적용 중인 프로필을 쓴다("Timing profiles" 참고)
+//                      bit2 armed: 바이트는 받되 START 전까지 타이핑하지 않는다(fleet 동시 시작)
+//                      bit3 line sync: 줄이 명령이다. journal을 줄마다 Enter 전에 쓴다("Power-loss journal" 참고)
+//               (+ [키 종류별 대기 u16 * 6]: config와 같은 표. 없으면 타이밍을 줄 때 모두 typingDelay를 따른다)
+// - 0x02 CANCEL [sessionId]  job 하나만 취소한다(타이핑 중이면 즉시 멈춘다).
+// - 0x03 START  [sessionId][delayMs(u16, 선택)]  armed job을 delayMs 뒤에 출발시킨다(최대 kJobStartMaxDelayMs).
+//               웹은 장치마다 보내는 시각 차이만큼 delayMs를 줄여서 모든 장치가 같은 순간에 시작하게 한다.
+// - 0x04 CLOSE  [sessionId]  업로드가 끝났다. 남은 바이트를 다 치면 job을 큐에서 빼고 journal을 비운다.
+// Read: [0xB0][opCount][lastOp][lastResult][jobCount]
+//       + job마다 [sessionId(u16)][queuedBytes(u16)][flags(u8)] (head부터, 최대 kMaxJobs)
+//       flags: bit0 typing(head), bit1 cancelled, bit2 has timing, bit3 clipboard paste, bit4 device timing,
+//              bit5 armed(START 대기 또는 예약됨), bit6 closed
+static constexpr uint8_t kJobStateMagic = 0xB0;
+static constexpr uint8_t kJobFlagClipPaste = 0x01;
+static constexpr uint8_t kJobFlagDeviceTiming = 0x02;
+static constexpr uint8_t kJobFlagArmed = 0x04;
+static constexpr uint8_t kJobFlagLineSync = 0x08;
+static constexpr uint8_t kJobOpOpen = 0x01;
+static constexpr uint8_t kJobOpCancel = 0x02;
+static constexpr uint8_t kJobOpStart = 0x03;
+static constexpr uint8_t kJobOpClose = 0x04;
+static constexpr uint16_t kJobStartMaxDelayMs = 5000;
+static constexpr uint8_t kJobResultOk = 0;
+static constexpr uint8_t kJobResultFull = 1;
+static constexpr uint8_t kJobResultUnknown = 2;
+static constexpr uint8_t kJobResultBadRequest = 3;
+static uint8_t g_job_op_count = 0;
+static uint8_t g_job_last_op = 0;
+static uint8_t g_job_last_result = 0;
+
+static void job_publish_state() {
+  uint8_t payload[5 + kMaxJobs * 5] = {0};
+  payload[0] = kJobStateMagic;
+  payload[1] = g_job_op_count;
+  payload[2] = g_job_last_op;
+  payload[3] = g_job_last_result;
+
+  noInterrupts();
+  const uint8_t count = g_job_count;
+  FlushJob jobs[kMaxJobs];
+  for (uint8_t i = 0; i < count; i++) jobs[i] = g_jobs[job_slot(i)];
+  interrupts();
+
+  payload[4] = count;
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t* p = &payload[5 + i * 5];
+    put_le16(&p[0], jobs[i].session_id);
+    put_le16(&p[2], jobs[i].queued);
+    p[4] = static_cast<uint8_t>((i == 0 ? 0x01 : 0) | (jobs[i].cancelled ? 0x02 : 0) | (jobs[i].has_timing ? 0x04 : 0) |
+                                    (jobs[i].clip_paste ? 0x08 : 0) | (jobs[i].device_timing ? 0x10 : 0) |
+                                    (jobs[i].armed ? 0x20 : 0) | (jobs[i].closed ? 0x40 : 0));
+  }
+  job_char.write(payload, static_cast<uint16_t>(5 + count * 5));
+}
+
+// BLE task에서 바로 실행한다(ada callback 큐를 거치면 뒤따르는 Flush write보다 늦게 처리될 수 있다).
+static void job_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
+  if (!data || len < 3) {
+    g_job_last_op = (data && len > 0) ? data[0] : 0;
+    g_job_last_result = kJobResultBadRequest;
+    g_job_op_count++;
+    job_publish_state();
+    return;
+  }
+
+  const uint8_t op = data[0];
+  const uint16_t session_id = le16(&data[1]);
+  uint8_t result = kJobResultBadRequest;
+
+  if (op == kJobOpOpen && session_id != 0) {
+    FlushJob job = {};
+    job.session_id = session_id;
+    for (uint8_t i = 0; i < kKeyClassCount; i++) job.key_class_delay_ms[i] = kKeyClassDelayFollow;
+    if (len >= 10) {
+      job.has_timing = true;
+      job.typing_delay_ms = clamp_u16(le16(&data[3]), 0, 1000);
+      job.mode_switch_delay_ms = clamp_u16(le16(&data[5]), 0, 3000);
+      job.key_press_delay_ms = clamp_u16(le16(&data[7]), 0, 300);
+      job.toggle_key = static_cast<uint8_t>(data[9] <= 6 ? data[9] : 0);
+    }
+    if (len >= 11) {
+      job.clip_paste = (data[10] & kJobFlagClipPaste) != 0;
+      job.device_timing = (data[10] & kJobFlagDeviceTiming) != 0;
+      job.armed = (data[10] & kJobFlagArmed) != 0;
+      job.line_sync = (data[10] & kJobFlagLineSync) != 0;
+      if (job.device_timing) job.has_timing = false;
+    }
+    if (len >= 11 + 2 * kKeyClassCount) {
+      for (uint8_t i = 0; i < kKeyClassCount; i++) job.key_class_delay_ms[i] = key_class_delay_from_le(&data[11 + 2 * i]);
+    }
+    const bool was_empty = (g_job_count == 0);
+    if (job_append(job)) {
+      // 앞선 job이 없으면 바로 이 job의 차례다.
+      if (was_empty) job_apply_timing(job);
+      result = kJobResultOk;
+    } else {
+      result = kJobResultFull;
+    }
+  } else if (op == kJobOpCancel) {
+    result = job_cancel(session_id) ? kJobResultOk : kJobResultUnknown;
+    if (result == kJobResultOk) journal_request_discard(session_id);
+  } else if (op == kJobOpStart) {
+    const uint16_t delay_ms = len >= 5 ? clamp_u16(le16(&data[3]), 0, kJobStartMaxDelayMs) : 0;
+    result = job_schedule_start(session_id, delay_ms) ? kJobResultOk : kJobResultUnknown;
+  } else if (op == kJobOpClose) {
+    result = job_close(session_id) ? kJobResultOk : kJobResultUnknown;
+  }
+
+  g_job_last_op = op;
+  g_job_last_result = result;
+  g_job_op_count++;
+  job_publish_state();
+  hid_task_wake();
+}
+
+#if BF_FEATURE_JOURNAL
+// Journal characteristic (power-loss resume)
+// Write: [op(u8)][...]
+// - 0x01 RESUME  [rollback(u8)]  마지막 checkpoint부터 이어서 친다(USB 연결 + 유휴 상태에서만).
+//                rollback: 0=없음, 1=ESC, 2=Shift+Home 후 Backspace
+//                Text는 같은 sessionId의 job을 seq 0부터 다시 열고, 웹이 lineOffset 이후 바이트를 보낸다.
+//                Cache는 장치가 lineOffset부터 바로 재생한다.
+// - 0x02 DISMISS                재개 제안을 버린다.
+// Read: [0xB1][opCount][lastOp][lastResult][offerKind(0 none,1 text,2 cache)][usbMounted]
+//       [sessionId(u16)][lineOffset(u32)][lineCrc32(u32)][koreanMode(u8)][lineDelayMs(u16)][cacheSha256(32)]
+static constexpr uint8_t kJournalStateMagic = 0xB1;
+static constexpr uint16_t kJournalStateLen = 51;
+
+static void journal_publish_state() {
+  uint8_t payload[kJournalStateLen] = {0};
+  payload[0] = kJournalStateMagic;
+  payload[1] = g_journal_op_count;
+  payload[2] = g_journal_last_op;
+  payload[3] = g_journal_last_result;
+  payload[5] = g_journal_usb_mounted ? 1 : 0;
+  if (g_journal_offer_valid) {
+    const JournalRecord& rec = g_journal_offer;
+    payload[4] = rec.kind;
+    put_le16(&payload[6], rec.session_id);
+    put_le32(&payload[8], rec.line_offset);
+    put_le32(&payload[12], rec.line_crc);
+    payload[16] = rec.korean_mode;
+    put_le16(&payload[17], rec.line_delay_ms);
+    memcpy(&payload[19], rec.cache_hash, sizeof(rec.cache_hash));
+  }
+  journal_char.write(payload, sizeof(payload));
+}
+
+// 실행은 HID task에서 한다(Flash 쓰기, rollback 키 입력).
+static void journal_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
+  if (!data || len == 0 || (data[0] != kJournalOpResume && data[0] != kJournalOpDismiss)) {
+    g_journal_last_op = (data && len > 0) ? data[0] : 0;
+    g_journal_last_result = kJournalResultBadRequest;
+    g_journal_op_count++;
+    journal_publish_state();
+    return;
+  }
+  g_journal_request_arg = len >= 2 ? data[1] : 0;
+  g_journal_request_op = data[0];
+  hid_task_wake();
+}
+#endif
+
+#if BF_FEATURE_STATS
+// Stats characteristic (fault-injection benchmark)
+// Write: [op(u8)][...]  (HID task에서 실행)
+// - 0x01 SNAPSHOT         현재 카운터를 Read 값으로 낸다.
+// - 0x02 RESET            카운터를 0으로 되돌린다(시나리오 시작).
+// - 0x03 MUTE [on(u8)]    1이면 키보드 report를 보내지 않고 세기만 한다.
+// - 0x04 MICROBENCH       디코더/적재 핫패스를 장치 CPU에서 잰다(Flush가 비어 있을 때만, 아래 참고).
+// Read: [0xB2][opCount][flags(bit0 muted, bit1 microbench 거절: Flush 중)][0]
+//       [packetsAccepted][packetsIgnored][packetsDeferred][busyRejects][stallMs]
+//       [textBytes][textCrc32][keyReports][keyCrc32][elapsedMs]  (모두 u32 LE)
+//       [benchRuns(u8)][benchCases(u8)][0][0] + case마다 [ns(u32)]  (1.2.18+)
+static constexpr uint8_t kStatsStateMagic = 0xB2;
+static constexpr uint8_t kStatsOpSnapshot = 0x01;
+static constexpr uint8_t kStatsOpReset = 0x02;
+static constexpr uint8_t kStatsOpMute = 0x03;
+static constexpr uint8_t kStatsOpMicroBench = 0x04;
+static uint8_t g_stats_op_count = 0;
+// BLE 콜백 -> HID task 요청(연달아 와도 하나도 잃지 않도록 op마다 따로 둔다)
+static volatile uint8_t g_stats_requests = 0;  // bit: 1 << op
+static volatile bool g_stats_mute_target = false;
+
+// Microbenchmark
+// 입력 핫패스의 단위 비용을 ns로 잰다. 웹(web/bench.js)이 저장해 둔 기준값과 비교해 회귀를 잡는다.
+// - 실제 펌웨어 빌드/CPU에서 재야 의미가 있으므로 장치에서 돌린다. 같은 case의 호스트 빌드(bench/native/microbench.cpp)는
+//   보드 없이 도는 회귀 게이트용이다(scripts/check_microbench.py --native).
+// - decode: dry-run 디코더(HID 출력/대기 없음)에 말뭉치를 넣는다(ns/byte).
+// - ingest: Flush Text 패킷 한 개의 헤더 해석 + job 분류 + 링버퍼 적재/소비(ns/packet).
+// - ring: 링버퍼 push+pop 한 쌍(ns/byte), ascii: ascii_to_hid 한 번(ns/lookup).
+// case마다 kMicroBenchMinUs 이상 반복한다(micros() 해상도 보정). HID task를 잠시 붙잡으므로
+// Flush가 비어 있을 때만 돌리고, case 사이에는 다른 task에 양보한다.
+enum MicroBenchCase : uint8_t {
+  kMicroBenchDecodeAscii = 0,
+  kMicroBenchDecodeKorean = 1,
+  kMicroBenchDecodeMalformed = 2,
+  kMicroBenchIngest20 = 3,
+  kMicroBenchIngest100 = 4,
+  kMicroBenchIngest240 = 5,
+  kMicroBenchRing = 6,
+  kMicroBenchAsciiToHid = 7,
+  kMicroBenchCaseCount = 8,
+};
+static constexpr uint32_t kMicroBenchMinUs = 20000;
+static constexpr uint16_t kStatsStateLen = 48 + 4 * kMicroBenchCaseCount;
+static uint32_t g_microbench_ns[kMicroBenchCaseCount] = {0};
+static uint8_t g_microbench_runs = 0;
+static bool g_microbench_refused = false;
+// 컴파일러가 결과를 안 쓰는 반복을 지우지 않도록 여기에 모은다.
+static volatile uint32_t g_microbench_sink = 0;
+
+static void stats_publish_state() {
+  uint8_t payload[kStatsStateLen] = {0};
+  payload[0] = kStatsStateMagic;
+  payload[1] = g_stats_op_count;
+  payload[2] = g_hid_muted ? 0x01 : 0;
+  const FlushStats st = g_stats;
+  put_le32(&payload[4], st.packets_accepted);
+  put_le32(&payload[8], st.packets_ignored);
+  put_le32(&payload[12], st.packets_deferred);
+  put_le32(&payload[16], st.busy_rejects);
+  put_le32(&payload[20], st.stall_ms);
+  put_le32(&payload[24], st.text_bytes);
+  put_le32(&payload[28], ~st.text_crc);
+  put_le32(&payload[32], st.key_reports);
+  put_le32(&payload[36], ~st.key_crc);
+  put_le32(&payload[40], millis() - g_stats_started_ms);
+  payload[2] = static_cast<uint8_t>(payload[2] | (g_microbench_refused ? 0x02 : 0));
+  payload[44] = g_microbench_runs;
+  payload[45] = kMicroBenchCaseCount;
+  for (uint8_t i = 0; i < kMicroBenchCaseCount; i++) put_le32(&payload[48 + 4 * i], g_microbench_ns[i]);
+  stats_char.write(payload, sizeof(payload));
+}
+
+static const char kMicroBenchAscii[] =
+    "Get-ChildItem -Path C:\\Temp -Recurse | Where-Object { $_.Length -gt 1024 } | Sort-Object Name\n";
+static const char kMicroBenchKorean[] =
+    "Write-Host '안녕하세요, 한글 입력 테스트입니다' # 값=42 ㄱㅏ 끝\n";
+// 떨어진 continuation, 잘린 2/3/4바이트 문자, 잘못된 시작 바이트(0xFF는 in-band 시작이라 뺀다)
+static const char kMicroBenchMalformed[] =
+    "a\x80\xBF\xC3(\xE2\x82\xF0\x9F\x98z\xFE\xC0\xAF\xED\xA0\x80\xE2\x28\xA1\xF8\x88\x80\x80\x80" "b\n";
+
+// 한 case의 비용(ns/unit). body 한 번이 units개를 처리한다.
+template <typename Body>
+static uint32_t microbench_measure(uint32_t units, Body body) {
+  uint32_t total_units = 0;
+  const uint32_t start = micros();
+  uint32_t elapsed = 0;
+  do {
+    body();
+    total_units += units;
+    elapsed = micros() - start;
+  } while (elapsed < kMicroBenchMinUs);
+  return static_cast<uint32_t>((static_cast<uint64_t>(elapsed) * 1000u) / total_units);
+}
+
+static uint32_t microbench_decode(const char* text, size_t len) {
+  TypingCost cost = {};
+  TypingState st = {false, false, 0, 0, &cost};
+  const uint32_t ns = microbench_measure(static_cast<uint32_t>(len), [&]() {
+    for (size_t i = 0; i < len; i++) process_input_byte(st, static_cast<uint8_t>(text[i]));
+  });
+  g_microbench_sink = g_microbench_sink + cost.keystrokes;
+  return ns;
+}
+
+// flush_text_write_authorize_cb가 패킷마다 하는 일(헤더/분류/적재)에 HID task의 소비(pop)까지.
+// 링버퍼는 실제 것을 쓰되 한 패킷을 임계 구역 안에서 넣고 바로 빼므로, 끼어든 BLE write와 섞이지 않는다.
+static uint32_t microbench_ingest(uint16_t payload_len) {
+  static uint8_t packet[kFlushHeaderSize + 240];
+  for (uint16_t i = 0; i < sizeof(packet); i++) packet[i] = static_cast<uint8_t>('a' + i % 26);
+  // 쓰이지 않는 sessionId: 분류는 job 표를 끝까지 훑는다.
+  put_le16(&packet[0], 0);
+  put_le16(&packet[2], 1);
+  return microbench_measure(1, [&]() {
+    const uint16_t session_id = le16(&packet[0]);
+    const uint16_t seq = le16(&packet[2]);
+    const JobPacket kind = job_classify_packet(session_id, seq);
+    uint32_t sum = static_cast<uint32_t>(kind);
+    noInterrupts();
+    if (rb_free_bytes() >= payload_len) {
+      for (uint16_t i = 0; i < payload_len; i++) rb_push(packet[kFlushHeaderSize + i]);
+      uint8_t b = 0;
+      for (uint16_t i = 0; i < payload_len && rb_pop(b); i++) sum += b;
+    }
+    interrupts();
+    g_microbench_sink = g_microbench_sink + sum;
+  });
+}
+
+static void microbench_run() {
+  // Flush 중이면 타이핑 간격을 흔들지 않도록 거절한다(웹은 flags bit1로 안다).
+  g_microbench_refused = !is_flush_idle();
+  if (g_microbench_refused) return;
+
+  g_microbench_ns[kMicroBenchDecodeAscii] = microbench_decode(kMicroBenchAscii, sizeof(kMicroBenchAscii) - 1);
+  delay(1);
+  g_microbench_ns[kMicroBenchDecodeKorean] = microbench_decode(kMicroBenchKorean, sizeof(kMicroBenchKorean) - 1);
+  delay(1);
+  g_microbench_ns[kMicroBenchDecodeMalformed] =
+      microbench_decode(kMicroBenchMalformed, sizeof(kMicroBenchMalformed) - 1);
+  delay(1);
+  g_microbench_ns[kMicroBenchIngest20] = microbench_ingest(20);
+  delay(1);
+  g_microbench_ns[kMicroBenchIngest100] = microbench_ingest(100);
+  delay(1);
+  g_microbench_ns[kMicroBenchIngest240] = microbench_ingest(240);
+  delay(1);
+
+  g_microbench_ns[kMicroBenchRing] = microbench_measure(64, []() {
+    uint32_t sum = 0;
+    noInterrupts();
+    if (rb_free_bytes() >= 64) {
+      uint8_t b = 0;
+      for (uint8_t i = 0; i < 64; i++) {
+        rb_push(i);
+        rb_pop(b);
+        sum += b;
+      }
+    }
+    interrupts();
+    g_microbench_sink = g_microbench_sink + sum;
+  });
+  delay(1);
+
+  g_microbench_ns[kMicroBenchAsciiToHid] = microbench_measure(95, []() {
+    uint32_t sum = 0;
+    for (char c = ' '; c <= '~'; c++) {
+      uint8_t modifier = 0;
+      uint8_t keycode = 0;
+      if (ascii_to_hid(c, modifier, keycode)) sum += static_cast<uint32_t>(modifier) + keycode;
+    }
+    g_microbench_sink = g_microbench_sink + sum;
+  });
+
+  g_microbench_runs++;
+}
+
+static void stats_service_in_loop() {
+  noInterrupts();
+  const uint8_t requests = g_stats_requests;
+  g_stats_requests = 0;
+  interrupts();
+  if (requests == 0) return;
+
+  if (requests & (1u << kStatsOpReset)) {
+    g_stats = {0, 0, 0, 0, 0, 0, 0xFFFFFFFF, 0, 0xFFFFFFFF};
+    g_stats_started_ms = millis();
+  }
+  if (requests & (1u << kStatsOpMute)) g_hid_muted = g_stats_mute_target;
+  if (requests & (1u << kStatsOpMicroBench)) microbench_run();
+  g_stats_op_count++;
+  stats_publish_state();
+}
+
+static void stats_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
+  if (!data || len == 0) return;
+  const uint8_t op = data[0];
+  if (op != kStatsOpSnapshot && op != kStatsOpReset && op != kStatsOpMute && op != kStatsOpMicroBench) return;
+  if (op == kStatsOpMute) g_stats_mute_target = len >= 2 && data[1] != 0;
+  g_stats_requests = static_cast<uint8_t>(g_stats_requests | (1u << op));
+  hid_task_wake();
+}
+#endif
+
+#if BF_FEATURE_TARGET
+// Target characteristic (Lock LED back-channel)
+// Read/Notify: [0xB3][kind(1=ACK,0=NACK)][chunkSeq(u8)][ledState(u8)]
+//              [frameCount(u16)][ackCount(u16)][nackCount(u16)]
+// 프레임을 하나 복원할 때마다 notify한다. frameCount로 놓친 notify를 알 수 있다.
+static constexpr uint8_t kTargetStateMagic = 0xB3;
+static constexpr uint16_t kTargetStateLen = 10;
+static uint16_t g_target_frame_count = 0;
+static uint16_t g_target_ack_count = 0;
+static uint16_t g_target_nack_count = 0;
+
+static void target_publish_state(const LedFrame* frame) {
+  uint8_t payload[kTargetStateLen] = {0};
+  payload[0] = kTargetStateMagic;
+  if (frame) {
+    payload[1] = frame->kind;
+    payload[2] = frame->seq;
+  }
+  payload[3] = g_led_state;
+  put_le16(&payload[4], g_target_frame_count);
+  put_le16(&payload[6], g_target_ack_count);
+  put_le16(&payload[8], g_target_nack_count);
+  target_char.write(payload, sizeof(payload));
+  // chunk ACK/NACK는 파일을 보내는 writer만 쓴다.
+  const uint16_t writer = g_control_conn_handle;
+  if (frame && writer != BLE_CONN_HANDLE_INVALID) target_char.notify(writer, payload, sizeof(payload));
+}
+
+static void target_service_in_loop() {
+  LedFrame frame;
+  while (led_pop_frame(&frame)) {
+    g_target_frame_count++;
+    if (frame.kind) {
+      g_target_ack_count++;
+    } else {
+      g_target_nack_count++;
+    }
+    target_publish_state(&frame);
+  }
+}
+#endif
+
+#if BF_FEATURE_PROFILES
+// Profile characteristic (persisted timing profiles)
+// Write: [op(u8)][...]  (HID task에서 실행, Flash 쓰기)
+// - 0x01 SAVE     [slot][typingDelayMs(u16)][modeSwitchDelayMs(u16)][keyPressDelayMs(u16)][toggleKey(u8)]
+//                 [fingerprint(u16), 0=묶지 않음][name(ASCII, 최대 12)]
+//                 또는 [name(12, 0 padding)][키 종류별 대기 u16 * 6]: config와 같은 표. 없으면 모두 typingDelay를 따른다
+// - 0x02 DELETE   [slot]
+// - 0x03 ACTIVATE [slot]  부팅 시 적용할 프로필로 저장하고 지금 적용한다(0xFF: 기본값으로 부팅)
+// - 0x04 AUTO     [on(u8)] USB 호스트 지문으로 프로필 자동 선택
+// Read: [0xB4][opCount][lastOp][lastResult][active][flags(bit0 auto, bit1 USB mounted)]
+//       [appliedSlot][appliedSource(0 none,1 boot,2 fingerprint,3 activate)][fingerprint(u16), 0=아직 없음]
+//       + 슬롯마다 [used][toggleKey][typingDelayMs(u16)][modeSwitchDelayMs(u16)][keyPressDelayMs(u16)]
+//                  [fingerprint(u16)][name(12, 0 padding)]
+//       + 슬롯마다 [키 종류별 대기 u16 * 6] (1.2.36+, 앞 부분은 예전과 같다)
+static constexpr uint8_t kProfileStateMagic = 0xB4;
+static constexpr uint16_t kProfileEntryLen = 22;
+static constexpr uint16_t kProfileTableLen = 2 * kKeyClassCount;
+static constexpr uint16_t kProfileStateLen = 10 + kMaxProfiles * (kProfileEntryLen + kProfileTableLen);
+static constexpr uint8_t kProfileSaveTableLen = 11 + kProfileNameMaxLen + kProfileTableLen;  // 표가 있는 SAVE
+static constexpr uint8_t kProfileOpSave = 0x01;
+static constexpr uint8_t kProfileOpDelete = 0x02;
+static constexpr uint8_t kProfileOpActivate = 0x03;
+static constexpr uint8_t kProfileOpAuto = 0x04;
+static constexpr uint8_t kProfileResultOk = 0;
+static constexpr uint8_t kProfileResultBadRequest = 1;
+static constexpr uint8_t kProfileResultEmpty = 2;
+static constexpr uint8_t kProfileResultIoError = 3;
+static constexpr uint8_t kProfileResultBusy = 4;  // 앞선 요청을 아직 처리 중
+static uint8_t g_profile_op_count = 0;
+static uint8_t g_profile_last_op = 0;
+static uint8_t g_profile_last_result = 0;
+// BLE 콜백 -> HID task 요청(하나씩, 웹은 opCount가 바뀐 뒤 다음 요청을 보낸다)
+static uint8_t g_profile_request[kProfileSaveTableLen];
+static volatile uint8_t g_profile_request_len = 0;
+
+static void profile_publish_state() {
+  uint8_t payload[kProfileStateLen] = {0};
+  payload[0] = kProfileStateMagic;
+  payload[1] = g_profile_op_count;
+  payload[2] = g_profile_last_op;
+  payload[3] = g_profile_last_result;
+  payload[4] = g_profiles.active;
+  payload[5] = static_cast<uint8_t>((g_profiles.auto_select ? 0x01 : 0) | (g_fp_mounted ? 0x02 : 0));
+  payload[6] = g_profile_applied;
+  payload[7] = g_profile_source;
+  put_le16(&payload[8], g_usb_fingerprint);
+  for (uint8_t slot = 0; slot < kMaxProfiles; slot++) {
+    const TimingProfile& p = g_profiles.entries[slot];
+    uint8_t* e = &payload[10 + slot * kProfileEntryLen];
+    if (!p.used) continue;
+    e[0] = 1;
+    e[1] = p.toggle_key;
+    put_le16(&e[2], p.typing_delay_ms);
+    put_le16(&e[4], p.mode_switch_delay_ms);
+    put_le16(&e[6], p.key_press_delay_ms);
+    put_le16(&e[8], p.fingerprint);
+    memcpy(&e[10], p.name, strnlen(p.name, kProfileNameMaxLen));
+    uint8_t* table = &payload[10 + kMaxProfiles * kProfileEntryLen + slot * kProfileTableLen];
+    for (uint8_t i = 0; i < kKeyClassCount; i++) put_le16(&table[2 * i], p.key_class_delay_ms[i]);
+  }
+  profile_char.write(payload, sizeof(payload));
+}
+
+static uint8_t profile_run_request(const uint8_t* data, uint8_t len) {
+  const uint8_t op = data[0];
+  const uint8_t slot = len >= 2 ? data[1] : kProfileNone;
+
+  if (op == kProfileOpSave) {
+    const bool has_table = len == kProfileSaveTableLen;
+    if (len < 11 || (len > 11 + kProfileNameMaxLen && !has_table) || slot >= kMaxProfiles) return kProfileResultBadRequest;
+    TimingProfile p = {};
+    p.used = 1;
+    p.typing_delay_ms = clamp_u16(le16(&data[2]), 0, 1000);
+    p.mode_switch_delay_ms = clamp_u16(le16(&data[4]), 0, 3000);
+    p.key_press_delay_ms = clamp_u16(le16(&data[6]), 0, 300);
+    p.toggle_key = static_cast<uint8_t>(data[8] <= 6 ? data[8] : 0);
+    p.fingerprint = le16(&data[9]);
+    char name[kProfileNameMaxLen + 1] = {0};
+    memcpy(name, &data[11], has_table ? kProfileNameMaxLen : len - 11u);
+    sanitize_nickname_to(p.name, sizeof(p.name), name);
+    for (uint8_t i = 0; i < kKeyClassCount; i++) {
+      p.key_class_delay_ms[i] = has_table ? key_class_delay_from_le(&data[11 + kProfileNameMaxLen + 2 * i]) : kKeyClassDelayFollow;
+    }
+    g_profiles.entries[slot] = p;
+    // 적용 중인 프로필을 고쳐 썼으면 바로 반영한다.
+    if (g_profile_applied == slot) profile_apply(slot, g_profile_source);
+  } else if (op == kProfileOpDelete) {
+    if (!profile_slot_used(slot)) return kProfileResultEmpty;
+    g_profiles.entries[slot] = {};
+    if (g_profiles.active == slot) g_profiles.active = kProfileNone;
+    if (g_profile_applied == slot) {
+      g_profile_applied = kProfileNone;
+      g_profile_source = kProfileSourceNone;
+    }
+  } else if (op == kProfileOpActivate) {
+    if (slot != kProfileNone && !profile_slot_used(slot)) return kProfileResultEmpty;
+    g_profiles.active = slot;
+    profile_apply(slot, kProfileSourceActivate);
+  } else if (op == kProfileOpAuto) {
+    if (len < 2) return kProfileResultBadRequest;
+    g_profiles.auto_select = data[1] != 0 ? 1 : 0;
+  } else {
+    return kProfileResultBadRequest;
+  }
+  return profiles_save() ? kProfileResultOk : kProfileResultIoError;
+}
+
+static void profile_service_in_loop() {
+  profile_fingerprint_in_loop();
+
+  const uint8_t len = g_profile_request_len;
+  if (len == 0) return;
+  g_profile_last_op = g_profile_request[0];
+  g_profile_last_result = profile_run_request(g_profile_request, len);
+  g_profile_request_len = 0;
+  g_profile_op_count++;
+  profile_publish_state();
+}
+
+static void profile_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
+  if (!data || len == 0 || len > sizeof(g_profile_request) || g_profile_request_len != 0) {
+    g_profile_last_op = (data && len > 0) ? data[0] : 0;
+    g_profile_last_result = (g_profile_request_len != 0) ? kProfileResultBusy : kProfileResultBadRequest;
+    g_profile_op_count++;
+    profile_publish_state();
+    return;
+  }
+  memcpy(g_profile_request, data, len);
+  g_profile_request_len = static_cast<uint8_t>(len);
+  hid_task_wake();
+}
+#endif
+
+#if BF_FEATURE_DOCS
+// Doc characteristic (diff 재타이핑용 문서 스냅샷)
+// Write: [op(u8)][...]  (HID task에서 실행, Flash 읽기/쓰기)
+// - 0x01 READ        [first(u16)][name(ASCII, 최대 16)]  first 줄부터 한 페이지의 hash를 Read 값에 싣는다
+// - 0x02 SAVE_BEGIN  [lineCount(u16)][docCrc(u32)][name]
+// - 0x03 SAVE_DATA   [index(u16)][hash(u32) x 최대 60]  줄 순서대로
+// - 0x04 SAVE_COMMIT
+// - 0x05 DELETE      [name]
+// Read: [0xB5][opCount][lastOp][lastResult][lineCount(u16)][docCrc(u32)][hashCrc(u32)]
+//       [first(u16)][count(u8)][slotsUsed(u8)][maxLines(u16)] + hash(u32) x count
+//       (lineCount 이후는 마지막 READ 결과. 없으면 0)
+static constexpr uint8_t kDocStateMagic = 0xB5;
+static constexpr uint16_t kDocStateHeaderLen = 20;
+static constexpr uint16_t kDocPageLines = 56;
+static constexpr uint16_t kDocStateLen = kDocStateHeaderLen + kDocPageLines * 4;
+static constexpr uint16_t kDocDataMaxHashes = 60;
+static constexpr uint8_t kDocOpRead = 0x01;
+static constexpr uint8_t kDocOpSaveBegin = 0x02;
+static constexpr uint8_t kDocOpSaveData = 0x03;
+static constexpr uint8_t kDocOpSaveCommit = 0x04;
+static constexpr uint8_t kDocOpDelete = 0x05;
+static uint8_t g_doc_op_count = 0;
+static uint8_t g_doc_last_op = 0;
+static uint8_t g_doc_last_result = 0;
+// 마지막 READ 결과
+static DocHeader g_doc_view = {};
+static uint16_t g_doc_page_first = 0;
+static uint8_t g_doc_page_count = 0;
+static uint8_t g_doc_page[kDocPageLines * 4];
+// BLE 콜백 -> HID task 요청(하나씩, 웹은 opCount가 바뀐 뒤 다음 요청을 보낸다)
+static uint8_t g_doc_request[3 + kDocDataMaxHashes * 4];
+static volatile uint8_t g_doc_request_len = 0;
+
+static void doc_publish_state() {
+  uint8_t payload[kDocStateLen] = {0};
+  payload[0] = kDocStateMagic;
+  payload[1] = g_doc_op_count;
+  payload[2] = g_doc_last_op;
+  payload[3] = g_doc_last_result;
+  put_le16(&payload[4], g_doc_view.line_count);
+  put_le32(&payload[6], g_doc_view.doc_crc);
+  put_le32(&payload[10], g_doc_view.hash_crc);
+  put_le16(&payload[14], g_doc_page_first);
+  payload[16] = g_doc_page_count;
+  uint8_t used = 0;
+  for (const DocHeader& h : g_doc_headers) {
+    if (h.magic == kDocMagic) used++;
+  }
+  payload[17] = used;
+  put_le16(&payload[18], kDocMaxLines);
+  memcpy(&payload[kDocStateHeaderLen], g_doc_page, g_doc_page_count * 4u);
+  doc_char.write(payload, static_cast<uint16_t>(kDocStateHeaderLen + g_doc_page_count * 4u));
+}
+
+static void doc_name_from(const uint8_t* data, uint8_t len, char* out) {
+  char name[kDocNameMaxLen + 1] = {0};
+  memcpy(name, data, len < kDocNameMaxLen ? len : kDocNameMaxLen);
+  sanitize_nickname_to(out, kDocNameMaxLen + 1, name);
+}
+
+static uint8_t doc_run_request(const uint8_t* data, uint8_t len) {
+  const uint8_t op = data[0];
+  char name[kDocNameMaxLen + 1] = {0};
+
+  if (op == kDocOpRead) {
+    g_doc_view = {};
+    g_doc_page_first = 0;
+    g_doc_page_count = 0;
+    if (len < 4) return kDocResultBadRequest;
+    doc_name_from(&data[3], static_cast<uint8_t>(len - 3), name);
+    const uint8_t slot = doc_find(name);
+    if (slot == kDocNone) return g_storage_ready ? kDocResultNotFound : kDocResultIoError;
+    g_doc_view = g_doc_headers[slot];
+    g_doc_page_first = le16(&data[1]);
+    g_doc_page_count = static_cast<uint8_t>(doc_read_hashes(slot, g_doc_page_first, kDocPageLines, g_doc_page));
+    return kDocResultOk;
+  }
+  if (op == kDocOpSaveBegin) {
+    if (len < 8) return kDocResultBadRequest;
+    doc_name_from(&data[7], static_cast<uint8_t>(len - 7), name);
+    return doc_save_begin(name, le16(&data[1]), le32(&data[3]));
+  }
+  if (op == kDocOpSaveData) {
+    if (len < 3 || ((len - 3) % 4) != 0) return kDocResultBadRequest;
+    return doc_save_append(le16(&data[1]), &data[3], static_cast<uint16_t>((len - 3) / 4));
+  }
+  if (op == kDocOpSaveCommit) return doc_save_commit();
+  if (op == kDocOpDelete) {
+    if (len < 2) return kDocResultBadRequest;
+    doc_name_from(&data[1], static_cast<uint8_t>(len - 1), name);
+    const uint8_t slot = doc_find(name);
+    if (slot == kDocNone) return kDocResultNotFound;
+    doc_remove_slot(slot);
+    return kDocResultOk;
+  }
+  return kDocResultBadRequest;
+}
+
+static void doc_service_in_loop() {
+  const uint8_t len = g_doc_request_len;
+  if (len == 0) return;
+  g_doc_last_op = g_doc_request[0];
+  g_doc_last_result = doc_run_request(g_doc_request, len);
+  g_doc_request_len = 0;
+  g_doc_op_count++;
+  doc_publish_state();
+}
+
+static void doc_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
+  if (!data || len == 0 || len > sizeof(g_doc_request) || g_doc_request_len != 0) {
+    g_doc_last_op = (data && len > 0) ? data[0] : 0;
+    g_doc_last_result = (g_doc_request_len != 0) ? kDocResultBusy : kDocResultBadRequest;
+    g_doc_op_count++;
+    doc_publish_state();
+    return;
+  }
+  memcpy(g_doc_request, data, len);
+  g_doc_request_len = static_cast<uint8_t>(len);
+  hid_task_wake();
+}
+#endif
 
-static void bootloader_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+static void bootloader_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
   if (!data || len == 0) return;
 
   // Any non-zero byte triggers a bootloader reboot.
   for (uint16_t i = 0; i < len; i++) {
     if (data[i] != 0) {
       g_bootloader_request_pending = true;
+      hid_task_wake();
       return;
     }
   }
 }
 
-static void scroll_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+#if BF_FEATURE_MOUSE
+static void scroll_write_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
+  if (!ble_write_allowed(conn_hdl)) return;
   // Format: [command(u8)][interval_ms(u16 LE)]
   // command: 0x00=stop, 0x01=start
   if (len < 1) return;
@@ -1035,186 +5012,485 @@ static void scroll_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, u
   } else {
     g_scroll_active = false;
   }
+  hid_task_wake();
 }
+#endif
 
 static void enter_bootloader_if_requested_in_loop() {
   if (!g_bootloader_request_pending) return;
   g_bootloader_request_pending = false;
 
   // Best-effort: release any pressed keys before reboot.
-  if (TinyUSBDevice.mounted() && usb_hid.ready()) {
-    usb_hid.keyboardRelease(kReportIdKeyboard);
+  if (TinyUSBDevice.mounted()) {
+    hid_report_keyboard_release();
     delay(5);
   }
 
-  // Stop BLE advertising to reduce race with reboot.
-  Bluefruit.Advertising.stop();
-  delay(20);
+  // Stop BLE advertising to reduce race with reboot.
+  Bluefruit.Advertising.stop();
+  delay(20);
+
+  // Reboot into Serial DFU bootloader (COM/DFU mode for uploads).
+  enterSerialDfu();
+}
+
+// -----------------------------
+// BLE 연결(writer / observer)
+// -----------------------------
+// observer는 진행 상황만 본다(모니터링 대시보드, 다른 자리의 브라우저).
+// - status notify는 연결마다 따로 throttle한다: writer는 예전 그대로(120ms), observer는 더 드물게.
+// - write 없이 남은 연결에는 긴 interval을 요청한다. 라디오 시간은 연결끼리 나눠 쓰므로
+//   observer의 연결 이벤트가 writer 링크의 처리량을 깎지 않게 한다.
+// - 일반 write 콜백 char는 observer가 write해도 값이 먼저 바뀐다. 콜백은 무시하고 HID task가 값을 다시 쓴다.
+static constexpr uint32_t kObserverStatusIntervalMs = 500;
+static constexpr uint32_t kObserverRelaxAfterMs = 5000;
+static constexpr ble_gap_conn_params_t kConnParamsObserver = {160, 240, 0, 600};  // 200~300ms, 6s
+
+struct BleLink {
+  uint16_t conn;  // BLE_CONN_HANDLE_INVALID = 빈 칸
+  uint32_t connected_ms;
+  uint32_t last_status_ms;
+  uint16_t last_status_free;
+  bool status_dirty;  // throttle 때문에 못 보낸 status가 있다
+  bool relaxed;       // observer 파라미터를 요청했다
+};
+
+static BleLink g_links[kBleMaxConnections];
+static volatile bool g_ble_republish_pending = false;
+static volatile bool g_ble_role_changed = false;
+
+static void ble_links_init() {
+  for (BleLink& l : g_links) l = BleLink{BLE_CONN_HANDLE_INVALID, 0, 0, 0, false, false};
+}
+
+static uint8_t ble_link_count() {
+  uint8_t n = 0;
+  for (const BleLink& l : g_links) {
+    if (l.conn != BLE_CONN_HANDLE_INVALID) n++;
+  }
+  return n;
+}
+
+static bool ble_link_add(uint16_t conn) {
+  for (BleLink& l : g_links) {
+    if (l.conn != BLE_CONN_HANDLE_INVALID) continue;
+    l = BleLink{conn, millis(), 0, 0, true, false};
+    return true;
+  }
+  return false;
+}
+
+static bool ble_link_remove(uint16_t conn) {
+  for (BleLink& l : g_links) {
+    if (l.conn != conn) continue;
+    l.conn = BLE_CONN_HANDLE_INVALID;
+    return true;
+  }
+  return false;
+}
+
+static void ble_links_mark_status_dirty() {
+  for (BleLink& l : g_links) l.status_dirty = true;
+}
+
+// BLE 콜백에서 호출: writer가 없으면 이 연결이 writer가 된다.
+static bool ble_writer_claim(uint16_t conn_hdl) {
+  bool claimed = false;
+  noInterrupts();
+  if (g_control_conn_handle == BLE_CONN_HANDLE_INVALID) {
+    g_control_conn_handle = conn_hdl;
+    claimed = true;
+  }
+  const bool is_writer = g_control_conn_handle == conn_hdl;
+  interrupts();
+
+  if (claimed) {
+    // 연결 파라미터는 writer 기준으로 다시 잡는다(conn_params_update_in_loop).
+    g_conn_profile = ConnProfile::None;
+    g_conn_last_busy_ms = millis();
+    g_ble_role_changed = true;
+    log_line("BLE writer 지정");
+    hid_task_wake();
+  }
+  return is_writer;
+}
+
+// write 콜백용: observer의 write는 무시한다.
+// write request는 write authorize에서 이미 ATT 에러로 거절되므로(writer_only_write_authorize_cb)
+// 여기까지 오는 observer write는 응답이 없는 write command뿐이다. 바뀐 char 값은 되돌린다.
+static bool ble_write_allowed(uint16_t conn_hdl) {
+  if (ble_writer_claim(conn_hdl)) return true;
+  g_ble_republish_pending = true;
+  hid_task_wake();
+  return false;
+}
+
+// status payload (kStatusLen)
+// [capacityBytes(u16)][freeBytes(u16)][queueEtaMs(u32)][connInterval(u16)][slaveLatency(u16)][supervisionTimeout(u16)]
+// [usbState(u8)][link(u8): bit0 이 연결이 writer, bit1 writer 있음, bit4..7 연결 수]
+static constexpr uint16_t kStatusLen = 16;
+
+static void status_build_payload(uint8_t* payload, uint16_t free_bytes, uint16_t conn) {
+  const uint16_t cap = rb_capacity_bytes();
+  payload[0] = cap & 0xff;
+  payload[1] = (cap >> 8) & 0xff;
+  payload[2] = free_bytes & 0xff;
+  payload[3] = (free_bytes >> 8) & 0xff;
+  // 남은 대기열의 예상 타이핑 시간(장치 디코더 dry-run)
+  put_le32(&payload[4], queue_eta_ms());
+  // 협상된 연결 파라미터(writer): [interval(1.25ms)][slaveLatency][supervisionTimeout(10ms)]
+  put_le16(&payload[8], g_conn_interval);
+  put_le16(&payload[10], g_conn_latency);
+  put_le16(&payload[12], g_conn_timeout);
+  // Target PC USB 상태: bit0 suspended, bit1 remote wakeup 후 재개 대기, bit2 호스트가 remote wakeup 불허
+  payload[14] = usb_state_flags();
+  const uint16_t writer = g_control_conn_handle;
+  uint8_t link = static_cast<uint8_t>(ble_link_count() << 4);
+  if (writer != BLE_CONN_HANDLE_INVALID) link |= 0x02;
+  if (writer != BLE_CONN_HANDLE_INVALID && writer == conn) link |= 0x01;
+  payload[15] = link;
+}
+
+// Read도 연결마다 자기 역할이 보이도록 authorize로 답한다(값은 read 시점에 만든다).
+static void status_read_authorize_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, ble_gatts_evt_read_t* req) {
+  uint8_t payload[kStatusLen];
+  status_build_payload(payload, rb_free_bytes(), conn_hdl);
+  const uint16_t offset = req->offset < kStatusLen ? req->offset : kStatusLen;
+  ble_gatts_rw_authorize_reply_params_t reply = {};
+  reply.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+  reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+  reply.params.read.update = 1;
+  reply.params.read.offset = offset;
+  reply.params.read.len = static_cast<uint16_t>(kStatusLen - offset);
+  reply.params.read.p_data = &payload[offset];
+  sd_ble_gatts_rw_authorize_reply(conn_hdl, &reply);
+}
+
+static uint32_t g_last_status_notify_ms = 0;
+static uint16_t g_last_status_free = 0;
+
+static void notify_status_if_needed(bool force) {
+  const uint16_t free_bytes = rb_free_bytes();
+  const uint32_t now_ms = millis();
+  const uint16_t writer = g_control_conn_handle;
+  uint8_t payload[kStatusLen];
+
+  // 너무 자주 notify하면 오히려 BLE에 부담이 되므로 throttle한다.
+  const bool time_ok = (now_ms - g_last_status_notify_ms) >= 120;
+  const bool delta_ok = (free_bytes != g_last_status_free);
+  if (force || (time_ok && delta_ok)) {
+    // 구독자가 없으면 notify는 내부적으로 실패(또는 무시)한다.
+    if (writer != BLE_CONN_HANDLE_INVALID) {
+      status_build_payload(payload, free_bytes, writer);
+      status_char.notify(writer, payload, sizeof(payload));
+    }
+    g_last_status_notify_ms = now_ms;
+    g_last_status_free = free_bytes;
+  }
+
+  // observer: 연결마다 따로, kObserverStatusIntervalMs에 한 번까지만 보낸다.
+  for (BleLink& l : g_links) {
+    if (l.conn == BLE_CONN_HANDLE_INVALID || l.conn == writer) continue;
+    if (force || free_bytes != l.last_status_free) l.status_dirty = true;
+    if (!l.status_dirty || (now_ms - l.last_status_ms) < kObserverStatusIntervalMs) continue;
+    l.status_dirty = false;
+    l.last_status_ms = now_ms;
+    l.last_status_free = free_bytes;
+    // 구독하지 않은 observer는 read로 본다.
+    if (!status_char.notifyEnabled(l.conn)) continue;
+    status_build_payload(payload, free_bytes, l.conn);
+    status_char.notify(l.conn, payload, sizeof(payload));
+  }
+}
+
+// -----------------------------
+// Deferred write response (flush/macro backpressure)
+// -----------------------------
+// flush/macro characteristic은 write authorization으로 받고, ATT 응답을 직접 보낸다.
+// - 패킷 전체가 큐에 들어가면 콜백에서 바로 적재하고 응답한다.
+// - 자리가 없으면 패킷을 g_deferred_write에 세워두고(park) 응답하지 않는다.
+//   웹은 응답을 받기 전에는 다음 write를 보낼 수 없으므로 자연스러운 백프레셔가 된다.
+// - HID task가 소비해서 자리가 생기면 적재한 뒤 응답한다(deferred_write_service).
+// - BLE 콜백은 절대 기다리지 않으므로 pause/abort(config write)는 백프레셔 중에도 즉시 처리된다.
+// ATT 요청은 연결당 한 번에 하나만 진행되므로 슬롯 하나면 충분하다.
+// 부분 적재는 하지 않는다: 거절된 패킷을 웹이 같은 seq로 재전송해도 중복 입력되지 않는다.
+enum class WriteTarget : uint8_t { Text = 0, Macro = 1 };
+
+// MTU 247 기준 한 번의 ATT write에 실을 수 있는 최대 길이(long write는 지원하지 않는다).
+static constexpr uint16_t kDeferredWriteMax = 244;
+// ATT 트랜잭션 타임아웃(30초)이 지나면 연결이 끊기므로, 그 전에 거절 응답을 보낸다.
+static constexpr uint32_t kDeferredWriteTimeoutMs = 25000;
+// 앱 정의 ATT 에러(0x80~): 장치가 바쁨(큐가 오래 비지 않음). 웹은 같은 seq로 재시도한다.
+static constexpr uint16_t kGattStatusDeviceBusy = BLE_GATT_STATUS_ATTERR_APP_BEGIN;
+// 청크를 받을 수 없음(뒤에 다른 job이 열렸거나 seq가 건너뜀). 재시도해도 받지 않는다.
+static constexpr uint16_t kGattStatusChunkRefused = BLE_GATT_STATUS_ATTERR_APP_BEGIN + 1;
+
+struct DeferredWrite {
+  volatile bool active;
+  uint16_t conn_hdl;
+  WriteTarget target;
+  uint16_t session_id;  // Text: 적재할 job
+  bool restart;         // Text: OPEN하지 않은 새 세션의 첫 패킷. HID task가 큐/입력 상태를 리셋한 뒤 적재한다
+  uint16_t len;
+  uint32_t parked_ms;
+  uint8_t data[kDeferredWriteMax];
+};
+
+static DeferredWrite g_deferred_write = {};
+
+static void write_authorize_reply(uint16_t conn_hdl, uint16_t gatt_status) {
+  ble_gatts_rw_authorize_reply_params_t reply = {};
+  reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+  reply.params.write.gatt_status = gatt_status;
+  // 값은 저장하지 않는다(macro_char Read는 Macro VM 버전으로 유지된다).
+  reply.params.write.update = 0;
+  sd_ble_gatts_rw_authorize_reply(conn_hdl, &reply);
+}
+
+// 패킷 전체가 들어갈 자리가 있을 때만 적재한다.
+static bool deferred_write_try_commit(WriteTarget target, uint16_t session_id, const uint8_t* data, uint16_t len) {
+#if BF_FEATURE_MACRO
+  if (target == WriteTarget::Macro) {
+    if (macro_free_bytes() < len) return false;
+    for (uint16_t i = 0; i < len; i++) macro_push(data[i]);
+    return true;
+  }
+#else
+  (void)target;
+#endif
+  return job_commit_payload(session_id, data, len);
+}
 
-  // Reboot into Serial DFU bootloader (COM/DFU mode for uploads).
-  enterSerialDfu();
+static void deferred_write_finish(uint16_t conn_hdl, uint16_t gatt_status) {
+#if BF_FEATURE_STATS
+  g_stats.stall_ms += millis() - g_deferred_write.parked_ms;
+  if (gatt_status == kGattStatusDeviceBusy) g_stats.busy_rejects++;
+#endif
+  // 응답을 보내는 순간 다음 write가 들어올 수 있으므로, 슬롯을 먼저 비운다.
+  g_deferred_write.active = false;
+  write_authorize_reply(conn_hdl, gatt_status);
 }
 
-static uint32_t g_last_status_notify_ms = 0;
-static uint16_t g_last_status_free = 0;
+static void deferred_write_park(uint16_t conn_hdl, WriteTarget target, uint16_t session_id, const uint8_t* data, uint16_t len,
+                                bool restart) {
+  g_deferred_write.conn_hdl = conn_hdl;
+  g_deferred_write.target = target;
+  g_deferred_write.session_id = session_id;
+  g_deferred_write.restart = restart;
+  g_deferred_write.len = len;
+  g_deferred_write.parked_ms = millis();
+  memcpy(g_deferred_write.data, data, len);
+  g_deferred_write.active = true;
+  hid_task_wake();
+}
 
-static void notify_status_if_needed(bool force) {
-  const uint16_t free_bytes = rb_free_bytes();
-  const uint32_t now_ms = millis();
+static void deferred_write_accept(uint16_t conn_hdl, WriteTarget target, uint16_t session_id, const uint8_t* data, uint16_t len) {
+  // 실제 연결 파라미터 요청은 HID task(conn_params_update_in_loop)에서 한다.
+  g_conn_job_started = true;
 
-  // 너무 자주 notify하면 오히려 BLE에 부담이 되므로 throttle한다.
-  const bool time_ok = (now_ms - g_last_status_notify_ms) >= 120;
-  const bool delta_ok = (free_bytes != g_last_status_free);
-  if (!force && !(time_ok && delta_ok)) {
+  if (deferred_write_try_commit(target, session_id, data, len)) {
+    write_authorize_reply(conn_hdl, BLE_GATT_STATUS_SUCCESS);
+    hid_task_wake();
     return;
   }
 
-  uint8_t payload[4];
-  const uint16_t cap = rb_capacity_bytes();
-  payload[0] = cap & 0xff;
-  payload[1] = (cap >> 8) & 0xff;
-  payload[2] = free_bytes & 0xff;
-  payload[3] = (free_bytes >> 8) & 0xff;
+#if BF_FEATURE_STATS
+  g_stats.packets_deferred++;
+#endif
+  deferred_write_park(conn_hdl, target, session_id, data, len, false);
+}
 
-  // 구독자가 없으면 notify는 내부적으로 실패(또는 무시)한다.
-  status_char.notify(payload, sizeof(payload));
-  g_last_status_notify_ms = now_ms;
-  g_last_status_free = free_bytes;
+// 새 세션: 대기 중인 job과 잔여 RX 데이터를 모두 버리고 UTF-8/CRLF/한영모드 내부 상태를 초기화한다
+// (추가 키 입력은 하지 않는다). HID task에서 타이핑 사이에 한다.
+static void deferred_write_restart_session() {
+  const uint16_t session_id = g_deferred_write.session_id;
+  g_deferred_write.restart = false;
+  jobs_restart(session_id);
+  reset_input_state_no_keystroke();
+  job_publish_state();
+  notify_status_if_needed(true);
 }
 
-static void macro_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
-  if (len == 0) return;
+// HID task(소비자)에서 호출: 자리가 생겼으면 세워둔 패킷을 적재하고 응답한다.
+static void deferred_write_service() {
+  if (!g_deferred_write.active) return;
+  if (g_deferred_write.restart) deferred_write_restart_session();
 
-  // Backpressure with write(with response): block until the macro queue has room.
-  for (uint16_t i = 0; i < len; i++) {
-    while (!macro_push(data[i])) {
-      delay(1);
-    }
+  if (deferred_write_try_commit(g_deferred_write.target, g_deferred_write.session_id, g_deferred_write.data, g_deferred_write.len)) {
+    deferred_write_finish(g_deferred_write.conn_hdl, BLE_GATT_STATUS_SUCCESS);
+    notify_status_if_needed(false);
+    return;
+  }
+
+  if ((millis() - g_deferred_write.parked_ms) >= kDeferredWriteTimeoutMs) {
+    deferred_write_finish(g_deferred_write.conn_hdl, kGattStatusDeviceBusy);
   }
 }
-static volatile uint16_t g_session_id = 0;
-static volatile uint16_t g_expected_seq = 0;
 
-static void reset_session(uint16_t session_id) {
-  g_session_id = session_id;
-  g_expected_seq = 0;
+static void deferred_write_discard() {
+  if (!g_deferred_write.active) return;
+  deferred_write_finish(g_deferred_write.conn_hdl, BLE_GATT_STATUS_SUCCESS);
 }
 
-static bool drain_one_byte() {
-  if (!hid_ready()) {
+// long write(Prepare/Execute Write)는 받지 않는다: 웹은 MTU 안에 들어가는 패킷만 보낸다.
+// observer의 write는 값을 바꾸지 않고 "write not permitted"로 거절한다.
+static bool write_request_is_plain(uint16_t conn_hdl, const ble_gatts_evt_write_t* req) {
+  if (req->op != BLE_GATTS_OP_WRITE_REQ || req->len > kDeferredWriteMax) {
+    write_authorize_reply(conn_hdl, BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED);
     return false;
   }
-  if (g_paused) {
+  if (!ble_writer_claim(conn_hdl)) {
+    write_authorize_reply(conn_hdl, BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED);
     return false;
   }
-  uint8_t out = 0;
-  if (!pop_next_byte(out)) {
-    return false;
+  return true;
+}
+
+// 일반 write char(config/job/cache/...)도 write authorize로 받는다.
+// - observer의 write request는 "write not permitted"로 거절한다(웹의 writeValue가 에러로 끝난다).
+// - writer면 값을 저장하도록 승인한 뒤 원래의 write 콜백을 부른다.
+// write command(write without response)는 authorize를 거치지 않고 write 콜백으로 바로 온다.
+static constexpr uint8_t kWriterOnlyCharMax = 12;
+
+struct WriterOnlyChar {
+  BLECharacteristic* chr;
+  BLECharacteristic::write_cb_t cb;
+};
+
+static WriterOnlyChar g_writer_only_chars[kWriterOnlyCharMax];
+static uint8_t g_writer_only_count = 0;
+
+static void writer_only_write_authorize_cb(uint16_t conn_hdl, BLECharacteristic* chr, ble_gatts_evt_write_t* req) {
+  if (!write_request_is_plain(conn_hdl, req)) return;
+
+  ble_gatts_rw_authorize_reply_params_t reply = {};
+  reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+  reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+  reply.params.write.update = 1;
+  reply.params.write.offset = req->offset;
+  reply.params.write.len = req->len;
+  reply.params.write.p_data = req->data;
+  // 콜백이 char 값을 다시 쓸 수 있으므로(상태 publish) 값을 먼저 저장한다.
+  sd_ble_gatts_rw_authorize_reply(conn_hdl, &reply);
+
+  for (uint8_t i = 0; i < g_writer_only_count; i++) {
+    if (g_writer_only_chars[i].chr != chr) continue;
+    g_writer_only_chars[i].cb(conn_hdl, chr, req->data, req->len);
+    return;
   }
+}
 
-  process_input_byte(out);
-  return true;
+// setWriteCallback 대신 쓴다. use_ada_callback은 setWriteCallback과 같다(false면 BLE task에서 바로 부른다).
+static void ble_set_writer_only(BLECharacteristic& chr, BLECharacteristic::write_cb_t cb, bool use_ada_callback = true) {
+  chr.setWriteCallback(cb, use_ada_callback);
+  if (g_writer_only_count >= kWriterOnlyCharMax) return;
+  g_writer_only_chars[g_writer_only_count++] = WriterOnlyChar{&chr, cb};
+  chr.setWriteAuthorizeCallback(writer_only_write_authorize_cb, use_ada_callback);
+}
+
+#if BF_FEATURE_MACRO
+static void macro_write_authorize_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, ble_gatts_evt_write_t* req) {
+  if (!write_request_is_plain(conn_hdl, req)) return;
+  if (req->len == 0) {
+    write_authorize_reply(conn_hdl, BLE_GATT_STATUS_SUCCESS);
+    return;
+  }
+  deferred_write_accept(conn_hdl, WriteTarget::Macro, 0, req->data, req->len);
 }
+#endif
+
+static void flush_text_write_authorize_cb(uint16_t conn_hdl, BLECharacteristic* /*chr*/, ble_gatts_evt_write_t* req) {
+  if (!write_request_is_plain(conn_hdl, req)) return;
+
+  const uint8_t* data = req->data;
+  const uint16_t len = req->len;
 
-static void flush_text_write_cb(uint16_t /*conn_hdl*/, BLECharacteristic* /*chr*/, uint8_t* data, uint16_t len) {
   // 최소 헤더가 없으면 무시
   if (len < kFlushHeaderSize) {
+    write_authorize_reply(conn_hdl, BLE_GATT_STATUS_SUCCESS);
     return;
   }
 
   const uint16_t session_id = le16(&data[0]);
   const uint16_t seq = le16(&data[2]);
   const uint16_t payload_len = static_cast<uint16_t>(len - kFlushHeaderSize);
-  uint8_t* payload = &data[kFlushHeaderSize];
-
-  // 다른 sessionId가 들어오면 seq==0일 때만 새 작업으로 인정한다.
-  if (g_session_id != session_id) {
-    if (seq != 0) {
-      return;
-    }
-    // 새 작업 시작: 정확성 우선
-    // - 이전 작업의 잔여 RX 데이터를 버리고
-    // - UTF-8/CRLF/한영모드 내부 상태를 초기화한다(추가 키 입력은 하지 않는다).
-    rb_clear();
-    stash_clear();
-    reset_input_state_no_keystroke();
-    reset_session(session_id);
-    notify_status_if_needed(true);
-  }
 
-  // 재시도/중복 청크는 무시
-  if (seq < g_expected_seq) {
+  // OPEN하지 않은 sessionId는 seq==0일 때만 새 작업으로 인정한다.
+  const JobPacket kind = job_classify_packet(session_id, seq);
+  if (kind == JobPacket::NewSession) {
+    // 새 작업 시작(opt-in abort): 정확성 우선
+    // - 큐/디코더 리셋은 HID task가 한다(이 task에서 하면 타이핑 중인 UTF-8/한영 상태를 그 밑에서 바꾼다).
+    // - 패킷은 세워두고, 리셋한 뒤 적재하고 응답한다(deferred_write_service).
+#if BF_FEATURE_STATS
+    g_stats.packets_accepted++;
+#endif
+    g_conn_job_started = true;
+    deferred_write_park(conn_hdl, WriteTarget::Text, session_id, &data[kFlushHeaderSize], payload_len, true);
     return;
   }
 
-  // 순서가 앞선 청크만 처리한다(브라우저는 순차 전송)
-  if (seq > g_expected_seq) {
+  // 재시도/중복 청크는 적재하지 않고 응답만 한다. 취소된 job의 청크는 seq만 올리고 버린다.
+  // 받을 수 없는 청크(마지막 job이 아닌 job, 건너뛴 seq)는 ATT 에러로 거절한다: 조용히 버리면 웹은 보낸 줄 안다.
+  if (kind != JobPacket::Accept) {
+#if BF_FEATURE_STATS
+    g_stats.packets_ignored++;
+#endif
+    write_authorize_reply(conn_hdl, kind == JobPacket::Refuse ? kGattStatusChunkRefused : BLE_GATT_STATUS_SUCCESS);
     return;
   }
+#if BF_FEATURE_STATS
+  g_stats.packets_accepted++;
+#endif
 
-  // payload를 RX 버퍼에 안전하게 적재한다.
-  // 버퍼가 꽉 찼으면 여기서 1바이트씩 타이핑해서 공간을 만든다.
-  // => write(with response) 기반으로 자연스러운 백프레셔가 걸린다.
-  for (uint16_t i = 0; i < payload_len; i++) {
-    while (!rb_push(payload[i])) {
-      // Pause 상태에서는 타이핑으로 공간을 만들지 않는다.
-      // 정확성 우선: 응답이 돌아가지 않게 하여 웹이 더 보내지 못하게 만든다.
-      if (g_paused) {
-        // 하지만 여기서 무한 대기하면 resume config write도 처리되지 않을 수 있다.
-        // 데이터를 버리지 않기 위해, RX의 오래된 바이트를 stash로 옮겨 공간을 만든다.
-        uint8_t moved = 0;
-        if (rb_pop(moved) && stash_push(moved)) {
-          continue;
-        }
-
-        // stash가 꽉 찼거나 RX가 비어있는(이론상) 경우에는 짧게 대기한다.
-        delay(2);
-        continue;
-      }
-
-      // (이론상 버퍼가 full이면 empty일 수 없다)
-      if (!drain_one_byte()) {
-        delay(1);
-      }
-    }
-  }
-
-  g_expected_seq++;
+  // 자리가 있으면 바로 적재/응답하고, 없으면 응답을 미룬다(pause 중에도 데이터는 버리지 않는다).
+  deferred_write_accept(conn_hdl, WriteTarget::Text, session_id, &data[kFlushHeaderSize], payload_len);
 }
 
-static void ble_connect_cb(uint16_t /*conn_handle*/) {
-  const uint16_t conn_handle = Bluefruit.connHandle();
-
-  // 이미 Control PC가 연결된 상태라면, 새 연결은 거부한다.
-  if (g_control_conn_handle != BLE_CONN_HANDLE_INVALID && g_control_conn_handle != conn_handle) {
+static void ble_connect_cb(uint16_t conn_handle) {
+  // 자리가 없으면(광고를 멈추기 전에 들어온 연결) 거부한다.
+  if (!ble_link_add(conn_handle)) {
     log_line("BLE 추가 연결 시도 거부");
     Bluefruit.disconnect(conn_handle);
     return;
   }
 
-  g_control_conn_handle = conn_handle;
-
-  // 연결 중에는 다른 PC가 연결하지 못하도록 광고를 중지한다.
-  Bluefruit.Advertising.stop();
+  // 역할은 첫 write에서 정해진다(ble_writer_claim). 그전까지는 observer로 status를 받는다.
+  // 자리가 남으면 다음 observer를 위해 광고를 이어 간다.
+  if (ble_link_count() < kBleMaxConnections) {
+    start_advertising();
+  } else {
+    Bluefruit.Advertising.stop();
+  }
 
   log_line("BLE 연결됨");
   notify_status_if_needed(true);
 }
 
-static void ble_disconnect_cb(uint16_t /*conn_handle*/, uint8_t /*reason*/) {
-  const uint16_t conn_handle = Bluefruit.connHandle();
+static void ble_disconnect_cb(uint16_t conn_handle, uint8_t /*reason*/) {
+  if (!ble_link_remove(conn_handle)) {
+    // 거부한(추가) 연결의 disconnect 이벤트일 수 있다.
+    log_line("BLE 연결 해제됨(추가 연결)");
+    return;
+  }
 
-  // 주 연결이 끊긴 경우에만 상태를 해제하고 광고를 재시작한다.
+  // writer가 끊기면 writer 자리를 비운다. 다음에 write하는 연결이 writer가 된다.
   if (g_control_conn_handle == conn_handle) {
     g_control_conn_handle = BLE_CONN_HANDLE_INVALID;
+#if BF_FEATURE_MOUSE
     g_scroll_active = false;
+#endif
+    g_conn_interval = 0;
+    g_conn_latency = 0;
+    g_conn_timeout = 0;
+    // 끊긴 연결에는 응답할 수 없다. 세워둔 패킷은 버린다(웹은 재연결 후 seq부터 다시 보낸다).
+    g_deferred_write.active = false;
+    g_ble_role_changed = true;
+    hid_task_wake();
     log_line("BLE 연결 해제됨");
-    start_advertising();
-    return;
+  } else {
+    log_line("BLE 연결 해제됨(observer)");
   }
-
-  // 거부한(추가) 연결의 disconnect 이벤트일 수 있다.
-  log_line("BLE 연결 해제됨(추가 연결)");
+  start_advertising();
 }
 
 static void start_advertising() {
@@ -1255,19 +5531,50 @@ void setup() {
   log_kv("Char UUID", kFlushTextCharUuid);
   log_kv("Config UUID", kConfigCharUuid);
   log_kv("Status UUID", kStatusCharUuid);
+#if BF_FEATURE_MACRO
   log_kv("Macro UUID", kMacroCharUuid);
+#endif
   log_kv("Boot UUID", kBootloaderCharUuid);
+#if BF_FEATURE_MOUSE
   log_kv("Scroll UUID", kScrollCharUuid);
+#endif
+#if BF_FEATURE_CACHE
+  log_kv("Cache UUID", kCacheCharUuid);
+#endif
+#if BF_FEATURE_ESTIMATE
+  log_kv("Estimate UUID", kEstimateCharUuid);
+#endif
+  log_kv("Job UUID", kJobCharUuid);
+#if BF_FEATURE_JOURNAL
+  log_kv("Journal UUID", kJournalCharUuid);
+#endif
+#if BF_FEATURE_STATS
+  log_kv("Stats UUID", kStatsCharUuid);
+#endif
+#if BF_FEATURE_PROFILES
+  log_kv("Profile UUID", kProfileCharUuid);
+#endif
+#if BF_FEATURE_DOCS
+  log_kv("Doc UUID", kDocCharUuid);
+#endif
+
+  // 저장된 타이밍 프로필을 HID mount 전에 적용한다(첫 키 입력부터 그 속도로 친다).
+#if BF_FEATURE_PROFILES
+  profiles_load();
+#endif
 
   // Target PC에 HID 키보드로 인식되도록 USB 초기화
   hid_begin();
 
   // Load persisted nickname early so GAP advertising name reflects it.
+#if BF_FEATURE_NICKNAME
   try_load_device_nickname_from_flash();
+#endif
 
   // Control PC(브라우저)와 통신하기 위한 BLE 초기화
-  // Peripheral(=Flusher)로서 동시 연결은 1개로 고정한다.
-  Bluefruit.begin(1, 0);
+  // Peripheral(=Flusher)로서 writer 1개 + observer kBleObserverMax개까지 연결한다.
+  ble_links_init();
+  Bluefruit.begin(kBleMaxConnections, 0);
   Bluefruit.setTxPower(4);
   const char* const ble_name = build_ble_device_name();
   Bluefruit.setName(ble_name);
@@ -1283,50 +5590,154 @@ void setup() {
   flush_text_char.setProperties(CHR_PROPS_WRITE);
   // 사용성 우선: OS 사전 페어링 없이도 브라우저(Web Bluetooth)만으로 연결 가능
   flush_text_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-  flush_text_char.setWriteCallback(flush_text_write_cb);
+  // 큐가 꽉 차면 ATT 응답을 미뤄 백프레셔를 건다(콜백은 BLE task에서 바로 처리, 블록하지 않음).
+  flush_text_char.setMaxLen(kDeferredWriteMax);
+  flush_text_char.setWriteAuthorizeCallback(flush_text_write_authorize_cb, false);
   flush_text_char.begin();
 
   // 런타임 입력 타이밍 설정
-  config_char.setProperties(CHR_PROPS_WRITE);
+  // write without response도 허용: flush/macro 응답이 미뤄진 동안에도 pause/abort가 바로 도착한다.
+  config_char.setProperties(CHR_PROPS_WRITE | CHR_PROPS_WRITE_WO_RESP);
   config_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-  config_char.setWriteCallback(config_write_cb);
+  ble_set_writer_only(config_char, config_write_cb);
   config_char.begin();
 
   // Device nickname (optional, persisted)
+#if BF_FEATURE_NICKNAME
   nickname_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
   nickname_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-  nickname_char.setWriteCallback(nickname_write_cb);
+  ble_set_writer_only(nickname_char, nickname_write_cb);
   nickname_char.begin();
   nickname_char.write(reinterpret_cast<const uint8_t*>(g_device_nickname), strlen(g_device_nickname));
+#endif
 
   // Macro / special keys (Windows automation)
-  macro_char.setProperties(CHR_PROPS_WRITE);
+  // Read: [macroVmVersion(u8)][inbandVersion(u8)] (구버전 펌웨어는 Read 미지원 -> 웹은 기존 매크로로 폴백)
+  // inbandVersion: flush 스트림 in-band 제어 시퀀스 지원(0/없음이면 미지원)
+#if BF_FEATURE_MACRO
+  macro_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
   macro_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-  macro_char.setWriteCallback(macro_write_cb);
+  macro_char.setMaxLen(kDeferredWriteMax);
+  macro_char.setWriteAuthorizeCallback(macro_write_authorize_cb, false);
   macro_char.begin();
+  const uint8_t macro_info[2] = {kMacroVmVersion, kInbandVersion};
+  macro_char.write(macro_info, sizeof(macro_info));
+#endif
 
   // Bootloader entry (button-less firmware upload)
   bootloader_char.setProperties(CHR_PROPS_WRITE);
   bootloader_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-  bootloader_char.setWriteCallback(bootloader_write_cb);
+  ble_set_writer_only(bootloader_char, bootloader_write_cb);
   bootloader_char.begin();
 
   // Auto Scroll (BLE 제어)
+#if BF_FEATURE_MOUSE
   scroll_char.setProperties(CHR_PROPS_WRITE);
   scroll_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-  scroll_char.setWriteCallback(scroll_write_cb);
+  ble_set_writer_only(scroll_char, scroll_write_cb);
   scroll_char.begin();
+#endif
+
+  // Payload cache (content-addressed, persisted)
+#if BF_FEATURE_CACHE
+  cache_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
+  cache_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  cache_char.setMaxLen(kCacheRequestMax);
+  ble_set_writer_only(cache_char, cache_write_cb);
+  cache_char.begin();
+  payload_cache_ready();
+  payload_cache_publish_state();
+#endif
+
+  // Keystroke cost dry-run (estimate)
+#if BF_FEATURE_ESTIMATE
+  estimate_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
+  estimate_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  estimate_char.setMaxLen(244);
+  ble_set_writer_only(estimate_char, estimate_write_cb);
+  estimate_char.begin();
+  estimate_publish_state();
+#endif
+
+  // Job queue (multi-session)
+  // write without response도 허용: 응답이 미뤄진 Flush write 뒤에서도 CANCEL이 바로 도착한다.
+  job_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE | CHR_PROPS_WRITE_WO_RESP);
+  job_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  job_char.setMaxLen(5 + kMaxJobs * 5);
+  ble_set_writer_only(job_char, job_write_cb, false);
+  job_char.begin();
+  job_publish_state();
+
+  // Power-loss journal (리셋 후 이어서 타이핑)
+#if BF_FEATURE_JOURNAL
+  journal_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
+  journal_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  journal_char.setMaxLen(kJournalStateLen);
+  ble_set_writer_only(journal_char, journal_write_cb);
+  journal_char.begin();
+  journal_load();
+  journal_publish_state();
+#endif
+
+  // Flush statistics (fault-injection benchmark)
+#if BF_FEATURE_STATS
+  stats_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
+  stats_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  stats_char.setMaxLen(kStatsStateLen);
+  ble_set_writer_only(stats_char, stats_write_cb);
+  stats_char.begin();
+  stats_publish_state();
+#endif
+
+  // Target back-channel (Lock LED ACK/NACK)
+#if BF_FEATURE_TARGET
+  target_char.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
+  target_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  target_char.setFixedLen(kTargetStateLen);
+  target_char.begin();
+  target_publish_state(nullptr);
+#endif
+
+  // Timing profiles (persisted, USB host auto-select)
+#if BF_FEATURE_PROFILES
+  profile_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
+  profile_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  profile_char.setMaxLen(kProfileStateLen);
+  ble_set_writer_only(profile_char, profile_write_cb);
+  profile_char.begin();
+  profile_publish_state();
+#endif
+
+  // Document snapshots (diff retyping)
+#if BF_FEATURE_DOCS
+  doc_char.setProperties(CHR_PROPS_READ | CHR_PROPS_WRITE);
+  doc_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+  doc_char.setMaxLen(kDocStateLen);
+  ble_set_writer_only(doc_char, doc_write_cb);
+  doc_char.begin();
+  doc_publish_state();
+#endif
 
   // 장치 상태(Flow Control)
-  // payload: [capacityBytes(u16 LE)][freeBytes(u16 LE)]
+  // payload: [capacityBytes(u16 LE)][freeBytes(u16 LE)][queueEtaMs(u32 LE)]
+  //          [connInterval(u16 LE, 1.25ms)][slaveLatency(u16 LE)][supervisionTimeout(u16 LE, 10ms)]
+  //          [usbState(u8): bit0 suspended, bit1 wakeup pending, bit2 wakeup refused]
+  //          [link(u8): bit0 이 연결이 writer, bit1 writer 있음, bit4..7 연결 수]
+  // link가 연결마다 다르므로 read는 authorize로 그때그때 만든다.
   status_char.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
   status_char.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-  status_char.setFixedLen(4);
+  status_char.setFixedLen(kStatusLen);
+  status_char.setReadAuthorizeCallback(status_read_authorize_cb, false);
   status_char.begin();
 
   // 부팅 직후 상태 1회 전송(구독자는 연결 후 설정될 수 있으므로 실패해도 무방)
   notify_status_if_needed(true);
 
+  if (xTaskCreate(hid_task, "hid", kHidTaskStackWords, nullptr, kHidTaskPriority, &g_hid_task) != pdPASS) {
+    g_hid_task = nullptr;
+    log_line("HID task create failed; typing runs in loop()");
+  }
+
   start_advertising();
 }
 
@@ -1334,11 +5745,17 @@ void setup() {
 // Mouse Jiggler
 // -----------------------------
 static bool is_flush_idle() {
-  return rb_used_bytes() == 0
-      && stash_head == stash_tail
-      && macro_used_bytes() == 0;
+  if (rb_used_bytes() != 0 || g_deferred_write.active) return false;
+#if BF_FEATURE_MACRO
+  if (macro_used_bytes() != 0 || g_macro_vm.active) return false;
+#endif
+#if BF_FEATURE_CACHE
+  if (g_cache_play_entry >= 0) return false;
+#endif
+  return true;
 }
 
+#if BF_FEATURE_MOUSE
 static void try_jiggle_mouse() {
   if (!hid_ready()) return;
 
@@ -1358,31 +5775,312 @@ static void try_jiggle_mouse() {
 
   // 마우스 1px 이동 (좌↔우 반복)
   const int8_t dx = g_jiggler_direction ? -kJigglerPixels : kJigglerPixels;
-  usb_hid.mouseReport(kReportIdMouse, 0, dx, 0, 0, 0);
+  hid_queue_mouse_move(dx);
   g_jiggler_direction = !g_jiggler_direction;
   g_jiggler_last_move_ms = now;
 }
 
+// 타이핑 중에도 돈다: report arbiter가 키보드 report 사이에 스크롤을 끼워 넣는다(hid_wait_ms).
 static void try_auto_scroll() {
-  if (!g_scroll_active || !hid_ready()) return;
-
-  // Flush 동작 중에는 스크롤 정지
-  if (!is_flush_idle()) return;
+  if (!g_scroll_active || !TinyUSBDevice.mounted()) return;
 
   const uint32_t now = millis();
   if (now - g_scroll_last_ms < g_scroll_interval_ms) return;
 
-  usb_hid.mouseScroll(kReportIdMouse, -1, 0);
+  hid_queue_mouse_scroll(-1);
   g_scroll_last_ms = now;
 }
+#endif
 
-void loop() {
+// suspend 진입/재개를 추적하고, 칠 것이 있으면 호스트를 깨운다(HID task에서 매 반복).
+static void usb_suspend_service_in_loop() {
+  const uint32_t now = millis();
+  if (!usb_bus_suspended()) {
+    if (!g_usb_suspend.suspended) return;
+    const bool release = g_usb_suspend.report_failed;
+    g_usb_suspend = {false, false, false, false, 0, 0};
+    log_line("USB resumed");
+    // suspend 중에 뗌 report가 빠졌을 수 있다: 키가 눌린 채 남지 않도록 먼저 모두 뗀다.
+    if (release && hid_wait_endpoint()) hid_report_keyboard_release();
+    notify_status_if_needed(true);
+    return;
+  }
+
+  if (!g_usb_suspend.suspended) {
+    g_usb_suspend.suspended = true;
+    g_usb_suspend.since_ms = now;
+    g_usb_suspend.wakeup_ms = now - kUsbWakeupRetryMs;
+    log_line("USB suspended");
+    notify_status_if_needed(true);
+  }
+
+  // 칠 것이 없으면 호스트를 깨우지 않는다(사용자가 재운 PC를 괜히 켜지 않는다).
+  if (g_paused || is_flush_idle()) return;
+
+  if (g_usb_suspend.wakeup_pending) {
+    if ((now - g_usb_suspend.wakeup_ms) < kUsbResumeTimeoutMs) return;
+    // 제한 시간 안에 재개되지 않았다: 큐는 그대로 두고 나중에 다시 깨운다.
+    g_usb_suspend.wakeup_pending = false;
+    notify_status_if_needed(true);
+  }
+  if ((now - g_usb_suspend.wakeup_ms) >= kUsbWakeupRetryMs) usb_request_wakeup(now);
+}
+
+// -----------------------------
+// Idle wait
+// -----------------------------
+static inline uint32_t ms_until(uint32_t last_ms, uint32_t interval_ms, uint32_t now_ms) {
+  const uint32_t elapsed = now_ms - last_ms;
+  return elapsed >= interval_ms ? 0 : interval_ms - elapsed;
+}
+
+// suspend 중 칠 것이 있으면: 재개 제한 시간이 끝날 시각 또는 다음 remote wakeup 시각
+static uint32_t usb_suspend_wait_ms(uint32_t now_ms) {
+  if (!g_usb_suspend.suspended || g_paused || is_flush_idle()) return kIdleWaitMaxMs;
+  if (g_usb_suspend.wakeup_pending) return ms_until(g_usb_suspend.wakeup_ms, kUsbResumeTimeoutMs, now_ms);
+  return ms_until(g_usb_suspend.wakeup_ms, kUsbWakeupRetryMs, now_ms);
+}
+
+// 밀린 observer status를 보낼 시각, observer 파라미터를 요청할 시각 중 가까운 쪽
+static uint32_t ble_links_wait_ms(uint32_t now_ms) {
+  uint32_t wait_ms = UINT32_MAX;
+  const uint16_t writer = g_control_conn_handle;
+  for (const BleLink& l : g_links) {
+    if (l.conn == BLE_CONN_HANDLE_INVALID || l.conn == writer) continue;
+    if (l.status_dirty) {
+      const uint32_t status = ms_until(l.last_status_ms, kObserverStatusIntervalMs, now_ms);
+      if (status < wait_ms) wait_ms = status;
+    }
+    if (!l.relaxed) {
+      const uint32_t relax = ms_until(l.connected_ms, kObserverRelaxAfterMs, now_ms);
+      if (relax < wait_ms) wait_ms = relax;
+    }
+  }
+  return wait_ms;
+}
+
+// -----------------------------
+// BLE 연결 파라미터 갱신
+// -----------------------------
+static void conn_params_publish_if_changed(uint16_t conn) {
+  BLEConnection* c = Bluefruit.Connection(conn);
+  if (!c) return;
+  const uint16_t interval = c->getConnectionInterval();
+  const uint16_t latency = c->getSlaveLatency();
+  const uint16_t timeout = c->getSupervisionTimeout();
+  if (interval == g_conn_interval && latency == g_conn_latency && timeout == g_conn_timeout) return;
+
+  g_conn_interval = interval;
+  g_conn_latency = latency;
+  g_conn_timeout = timeout;
+  notify_status_if_needed(true);
+}
+
+static void conn_params_update_in_loop() {
+  const uint16_t conn = g_control_conn_handle;
+  if (conn == BLE_CONN_HANDLE_INVALID) return;
+
+  const uint32_t now = millis();
+  ConnProfile want = g_conn_profile;
+  if (g_conn_job_started || !is_flush_idle()) {
+    g_conn_job_started = false;
+    g_conn_last_busy_ms = now;
+    want = ConnProfile::Fast;
+  } else if ((now - g_conn_last_busy_ms) >= kConnRelaxAfterMs) {
+    want = ConnProfile::Relaxed;
+  }
+
+  if (want != g_conn_profile && (now - g_conn_last_request_ms) >= kConnRequestRetryMs) {
+    g_conn_last_request_ms = now;
+    const ble_gap_conn_params_t& params = (want == ConnProfile::Fast) ? kConnParamsFast : kConnParamsRelaxed;
+    // 이미 갱신 절차가 진행 중이면 NRF_ERROR_BUSY -> 다음 기회에 다시 요청한다.
+    if (sd_ble_gap_conn_param_update(conn, &params) == NRF_SUCCESS) {
+      g_conn_profile = want;
+    }
+  }
+
+  // 갱신 결과(BLE_GAP_EVT_CONN_PARAM_UPDATE)는 Bluefruit이 연결 객체에 반영한다.
+  conn_params_publish_if_changed(conn);
+}
+
+// observer write로 바뀐 char 값을 현재 상태로 되돌린다.
+static void ble_republish_char_values() {
+#if BF_FEATURE_NICKNAME
+  nickname_char.write(reinterpret_cast<const uint8_t*>(g_device_nickname), strlen(g_device_nickname));
+#endif
+#if BF_FEATURE_CACHE
+  payload_cache_publish_state();
+#endif
+#if BF_FEATURE_ESTIMATE
+  estimate_publish_state();
+#endif
+  job_publish_state();
+#if BF_FEATURE_JOURNAL
+  journal_publish_state();
+#endif
+#if BF_FEATURE_STATS
+  stats_publish_state();
+#endif
+#if BF_FEATURE_PROFILES
+  profile_publish_state();
+#endif
+#if BF_FEATURE_DOCS
+  doc_publish_state();
+#endif
+}
+
+static void ble_links_service_in_loop() {
+  if (g_ble_republish_pending) {
+    g_ble_republish_pending = false;
+    ble_republish_char_values();
+  }
+
+  // writer가 바뀌면 모든 연결에 새 역할을 알린다.
+  if (g_ble_role_changed) {
+    g_ble_role_changed = false;
+    ble_links_mark_status_dirty();
+    notify_status_if_needed(true);
+  }
+
+  // write 없이 kObserverRelaxAfterMs가 지난 연결은 observer 파라미터로 내린다.
+  const uint32_t now = millis();
+  const uint16_t writer = g_control_conn_handle;
+  for (BleLink& l : g_links) {
+    if (l.conn == BLE_CONN_HANDLE_INVALID || l.conn == writer || l.relaxed) continue;
+    if ((now - l.connected_ms) < kObserverRelaxAfterMs) continue;
+    // 이미 갱신 절차가 진행 중이면 NRF_ERROR_BUSY -> 다음 기회에 다시 요청한다.
+    if (sd_ble_gap_conn_param_update(l.conn, &kConnParamsObserver) == NRF_SUCCESS) l.relaxed = true;
+  }
+}
+
+// 다음 주기 작업(지글러/스크롤/밀린 status notify)까지 남은 시간
+static uint32_t idle_wait_budget_ms() {
+  const uint32_t now = millis();
+  uint32_t wait_ms = kIdleWaitMaxMs;
+
+#if BF_FEATURE_MOUSE
+  // 지글러/스크롤은 HID가 준비됐을 때만 돈다(suspend 중에는 재개/mount 콜백이 깨운다).
+  const bool hid_up = hid_ready();
+#endif
+  if (is_flush_idle()) {
+#if BF_FEATURE_MOUSE
+    if (hid_up) {
+      const uint32_t cooldown = ms_until(g_last_flush_activity_ms, kJigglerCooldownMs, now);
+      const uint32_t interval = ms_until(g_jiggler_last_move_ms, kJigglerIntervalMs, now);
+      const uint32_t jiggle = cooldown > interval ? cooldown : interval;
+      if (jiggle < wait_ms) wait_ms = jiggle;
+    }
+#endif
+
+    if (g_conn_profile == ConnProfile::Fast && g_control_conn_handle != BLE_CONN_HANDLE_INVALID) {
+      const uint32_t relax = ms_until(g_conn_last_busy_ms, kConnRelaxAfterMs, now);
+      if (relax < wait_ms) wait_ms = relax;
+    }
+
+#if BF_FEATURE_MOUSE
+    if (hid_up && g_scroll_active) {
+      const uint32_t scroll = ms_until(g_scroll_last_ms, g_scroll_interval_ms, now);
+      if (scroll < wait_ms) wait_ms = scroll;
+    }
+#endif
+  }
+
+  // armed job의 예약된 시작 시각
+  const uint32_t start = job_start_wait_ms(now);
+  if (start < wait_ms) wait_ms = start;
+
+  // in-band WAIT/WAIT_IDLE이 끝날 시각
+  const uint32_t inband = inband_wait_ms(now);
+  if (inband < wait_ms) wait_ms = inband;
+
+#if BF_FEATURE_MACRO
+  // Macro VM SLEEP, 캐시 재생 줄 간격이 끝날 시각
+  const uint32_t macro = macro_wait_ms(now);
+  if (macro < wait_ms) wait_ms = macro;
+#endif
+
+  // suspend된 호스트를 다시 깨울 시각
+  const uint32_t usb = usb_suspend_wait_ms(now);
+  if (usb < wait_ms) wait_ms = usb;
+
+#if BF_FEATURE_PROFILES
+  // USB 호스트 지문이 정해질 시각
+  const uint32_t fingerprint = profile_fingerprint_wait_ms(now);
+  if (fingerprint < wait_ms) wait_ms = fingerprint;
+#endif
+
+  // throttle 때문에 못 보낸 status(free 변화)가 있으면 그때 깨어난다.
+  if (rb_free_bytes() != g_last_status_free) {
+    const uint32_t status = ms_until(g_last_status_notify_ms, 120, now);
+    if (status < wait_ms) wait_ms = status;
+  }
+
+  // observer별 밀린 status, observer 파라미터 요청
+  const uint32_t links = ble_links_wait_ms(now);
+  if (links < wait_ms) wait_ms = links;
+  return wait_ms;
+}
+
+static void idle_wait() {
+  const uint32_t wait_ms = idle_wait_budget_ms();
+  if (wait_ms == 0) return;
+  if (!g_hid_task) {
+    delay(1);
+    return;
+  }
+  // 콜백이 먼저 깨웠으면(notification pending) 바로 반환된다.
+  ulTaskNotifyTake(pdTRUE, ms2tick(wait_ms));
+}
+
+static void hid_task_iteration() {
   // Apply pause/resume/abort even while paused.
   apply_pending_controls_in_loop();
 
+  // 큐에 자리가 생겼으면 응답을 미뤄둔 flush/macro write를 적재하고 응답한다.
+  deferred_write_service();
+
+  // 작업 시작/유휴에 맞춰 BLE 연결 파라미터를 바꾼다.
+  conn_params_update_in_loop();
+
+  // observer 연결: 값 되돌리기, 역할 변경 알림, observer 파라미터
+  ble_links_service_in_loop();
+
+  // 재개/폐기 요청 처리, USB 연결 변화 알림
+#if BF_FEATURE_JOURNAL
+  journal_service_in_loop();
+#endif
+
+  // 벤치마크 카운터 스냅샷/리셋/mute
+#if BF_FEATURE_STATS
+  stats_service_in_loop();
+#endif
+
+  // Target PC가 Lock LED로 보낸 chunk ACK/NACK를 웹에 알린다.
+#if BF_FEATURE_TARGET
+  target_service_in_loop();
+#endif
+
+  // payload cache 조회/저장/삭제(Flash)
+#if BF_FEATURE_CACHE
+  cache_service_in_loop();
+#endif
+
+  // 타이밍 프로필 저장/적용, USB 호스트 지문과 auto-select
+#if BF_FEATURE_PROFILES
+  profile_service_in_loop();
+#endif
+
+  // 문서 스냅샷(줄 hash) 읽기/저장
+#if BF_FEATURE_DOCS
+  doc_service_in_loop();
+#endif
+
   // Enter bootloader (Serial DFU) when requested by Control PC.
   enter_bootloader_if_requested_in_loop();
 
+  // Target PC가 잠들어 USB가 suspend되면 알리고, 칠 것이 있으면 remote wakeup으로 깨운다.
+  usb_suspend_service_in_loop();
+
   // Serial monitor can attach after boot (especially when there is no reset button).
   // Some monitors don't assert DTR, so avoid relying on `if (Serial)`.
   // Print FW periodically for a limited window so users can confirm version reliably.
@@ -1404,33 +6102,106 @@ void loop() {
 
   // USB HID가 준비되지 않은 상태에서 입력을 소비하면(버퍼 pop) 타이핑이 누락될 수 있다.
   // 따라서 HID가 준비될 때까지는 RX 버퍼를 유지하며 대기한다.
+  // - 분리/suspend: mount/resume 콜백(또는 다음 remote wakeup 시각)까지 잠든다.
+  // - endpoint 전송 중: poll 간격만큼만 쉰다.
   if (!hid_ready()) {
-    delay(5);
+    notify_status_if_needed(false);
+    if (TinyUSBDevice.mounted() && !TinyUSBDevice.suspended()) {
+      hid_task_sleep_ms(kHidEndpointPollMs);
+    } else {
+      idle_wait();
+    }
+    return;
+  }
+
+#if BF_FEATURE_PROFILES
+  // auto-select: 호스트 지문으로 프로필을 고를 때까지(mount 후 잠깐) 기다린다.
+  if (!profile_ready_to_type()) {
+    notify_status_if_needed(false);
+    idle_wait();
     return;
   }
+#endif
 
   // Mouse Jiggler: Flush가 아닌 유휴 상태에서만 마우스를 움직인다.
+#if BF_FEATURE_MOUSE
   try_jiggle_mouse();
   try_auto_scroll();
+#endif
 
-  // Pause: 장치 내부 큐를 소비(타이핑)하지 않는다.
+  // Pause: 장치 내부 큐를 소비(타이핑)하지 않는다(resume은 config 콜백이 깨운다).
   if (g_paused) {
-    delay(5);
+    // 응답을 미뤘던 패킷이 들어가며 free가 바뀔 수 있다(throttle된 status가 남으면 idle_wait가 잠들지 못한다).
+    notify_status_if_needed(false);
+    idle_wait();
     return;
   }
 
+#if BF_FEATURE_MACRO
   // Macro actions first (e.g., Win+R) to avoid interleaving with text bytes.
   if (macro_try_process_one()) {
     notify_status_if_needed(false);
+    // VM SLEEP/캐시 줄 간격/캐시 안의 WAIT: 끝날 시각까지 잠든다.
+    if (macro_waiting()) idle_wait();
+    return;
+  }
+#endif
+
+  // Fleet: armed job은 START로 정한 시각까지 쌓아 두기만 한다.
+  if (job_head_held_in_loop()) {
+    notify_status_if_needed(false);
+    idle_wait();
+    return;
+  }
+
+  // In-band WAIT/WAIT_IDLE: 시간이 될 때까지 다음 바이트를 치지 않는다.
+  if (inband_wait_in_loop()) {
+    notify_status_if_needed(false);
+    idle_wait();
     return;
   }
 
+#if BF_FEATURE_CLIP_PASTE
+  // Windows job이면 줄 구간마다 타이핑/클립보드 붙여넣기 중 싼 쪽을 고른다.
+  const ClipStep clip = clip_paste_step();
+  if (clip != ClipStep::Type) {
+    notify_status_if_needed(false);
+    if (clip == ClipStep::Wait) idle_wait();
+    return;
+  }
+#endif
+
   uint8_t b = 0;
-  if (pop_next_byte(b)) {
+  uint16_t session_id = 0;
+  if (pop_next_byte(b, session_id)) {
+#if BF_FEATURE_CLIP_PASTE
+    if (g_clip_plain_left > 0) g_clip_plain_left--;
+#endif
+    journal_note_text_byte(session_id, b);
     process_input_byte(b);
+#if BF_FEATURE_STATS
+    g_stats.text_bytes++;
+    g_stats.text_crc = crc32_update(g_stats.text_crc, &b, 1);
+#endif
     notify_status_if_needed(false);
   } else {
     notify_status_if_needed(false);
-    delay(1);
+    idle_wait();
+  }
+}
+
+static void hid_task(void* /*arg*/) {
+  for (;;) {
+    hid_task_iteration();
+  }
+}
+
+void loop() {
+  // 모든 작업은 HID task에서 한다. loop task는 할 일이 없으므로 멈춰 둔다.
+  if (g_hid_task) {
+    vTaskSuspend(nullptr);
+    return;
   }
+  // task 생성에 실패한 경우에만 예전처럼 loop에서 처리한다.
+  hid_task_iteration();
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+// Host stub: LittleFS File (backed by an in-memory map in fake_board.h).
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+#define FILE_O_READ 0
+#define FILE_O_WRITE 1
+
+namespace Adafruit_LittleFS_Namespace {
+class File {
+ public:
+  File();
+  template <class T>
+  File(T) {}
+  explicit operator bool() const;
+  int read(void* buf, uint16_t len);
+  int read();
+  size_t write(const uint8_t* buf, size_t len);
+  bool seek(uint32_t pos);
+  uint32_t position();
+  uint32_t size();
+  void close();
+  void flush();
+  bool isDirectory();
+  File openNextFile(uint8_t mode = FILE_O_READ);
+  const char* name();
+  void rewindDirectory();
+
+  std::string path_;
+  uint32_t pos_ = 0;
+  bool ok_ = false;
+};
+}  // namespace Adafruit_LittleFS_Namespace
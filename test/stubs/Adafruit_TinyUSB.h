@@ -0,0 +1,57 @@
+// Host stub: the TinyUSB HID/device API that src/main.cpp uses.
+#pragma once
+#include <Arduino.h>
+
+enum {
+  HID_KEY_A = 0x04, HID_KEY_C = 0x06, HID_KEY_R = 0x15, HID_KEY_V = 0x19,
+  HID_KEY_1 = 0x1e, HID_KEY_2, HID_KEY_3, HID_KEY_4, HID_KEY_5, HID_KEY_6, HID_KEY_7, HID_KEY_8, HID_KEY_9,
+  HID_KEY_0 = 0x27, HID_KEY_ENTER = 0x28, HID_KEY_ESCAPE = 0x29, HID_KEY_BACKSPACE = 0x2a, HID_KEY_TAB = 0x2b,
+  HID_KEY_SPACE = 0x2c, HID_KEY_MINUS = 0x2d, HID_KEY_EQUAL = 0x2e, HID_KEY_BRACKET_LEFT = 0x2f,
+  HID_KEY_BRACKET_RIGHT = 0x30, HID_KEY_BACKSLASH = 0x31, HID_KEY_SEMICOLON = 0x33, HID_KEY_APOSTROPHE = 0x34,
+  HID_KEY_GRAVE = 0x35, HID_KEY_COMMA = 0x36, HID_KEY_PERIOD = 0x37, HID_KEY_SLASH = 0x38,
+  HID_KEY_CAPS_LOCK = 0x39, HID_KEY_F1 = 0x3a, HID_KEY_INSERT = 0x49, HID_KEY_HOME = 0x4a, HID_KEY_PAGE_UP = 0x4b,
+  HID_KEY_DELETE = 0x4c, HID_KEY_END = 0x4d, HID_KEY_PAGE_DOWN = 0x4e, HID_KEY_ARROW_RIGHT = 0x4f,
+  HID_KEY_ARROW_LEFT = 0x50, HID_KEY_ARROW_DOWN = 0x51, HID_KEY_ARROW_UP = 0x52,
+};
+enum {
+  KEYBOARD_MODIFIER_LEFTCTRL = 1, KEYBOARD_MODIFIER_LEFTSHIFT = 2, KEYBOARD_MODIFIER_LEFTALT = 4,
+  KEYBOARD_MODIFIER_LEFTGUI = 8, KEYBOARD_MODIFIER_RIGHTCTRL = 16, KEYBOARD_MODIFIER_RIGHTSHIFT = 32,
+  KEYBOARD_MODIFIER_RIGHTALT = 64, KEYBOARD_MODIFIER_RIGHTGUI = 128,
+};
+enum { KEYBOARD_LED_NUMLOCK = 1, KEYBOARD_LED_CAPSLOCK = 2, KEYBOARD_LED_SCROLLLOCK = 4 };
+typedef enum {
+  HID_REPORT_TYPE_INVALID = 0,
+  HID_REPORT_TYPE_INPUT,
+  HID_REPORT_TYPE_OUTPUT,
+  HID_REPORT_TYPE_FEATURE,
+} hid_report_type_t;
+
+#define HID_REPORT_ID(x) 0x85, x,
+#define TUD_HID_REPORT_DESC_KEYBOARD(...) 0x05, 0x01, __VA_ARGS__ 0xc0
+#define TUD_HID_REPORT_DESC_MOUSE(...) 0x05, 0x01, __VA_ARGS__ 0xc0
+
+struct Adafruit_USBD_HID {
+  typedef uint16_t (*get_report_callback_t)(uint8_t, hid_report_type_t, uint8_t*, uint16_t);
+  typedef void (*set_report_callback_t)(uint8_t, hid_report_type_t, uint8_t const*, uint16_t);
+  void setPollInterval(uint8_t ms);
+  void setReportDescriptor(const uint8_t* desc, size_t len);
+  void setReportCallback(get_report_callback_t get_cb, set_report_callback_t set_cb);
+  bool begin();
+  bool ready();
+  bool keyboardReport(uint8_t report_id, uint8_t modifier, uint8_t* keycodes);
+  bool keyboardRelease(uint8_t report_id);
+  bool mouseReport(uint8_t report_id, uint8_t buttons, int8_t x, int8_t y, int8_t vertical, int8_t horizontal);
+  bool mouseScroll(uint8_t report_id, int8_t vertical, int8_t horizontal);
+  bool sendReport(uint8_t report_id, const void* report, uint8_t len);
+};
+
+struct Adafruit_USBD_Device {
+  bool mounted();
+  bool suspended();
+  bool remoteWakeup();
+};
+extern Adafruit_USBD_Device TinyUSBDevice;
+
+bool tud_suspended();
+bool tud_remote_wakeup();
+bool tud_mounted();
@@ -0,0 +1,59 @@
+// Host stub: Arduino core + FreeRTOS API that src/main.cpp uses (declarations only).
+// The definitions live in fake_board.h, which a test includes after src/main.cpp.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void delay(uint32_t ms);
+uint32_t millis();
+uint32_t micros();
+void noInterrupts();
+void interrupts();
+void yield();
+
+struct SerialT {
+  void begin(int baud);
+  explicit operator bool() const;
+  void println(const char* s);
+  void print(const char* s);
+  void println(unsigned long v);
+};
+extern SerialT Serial;
+#define CFG_TUD_CDC 1
+
+struct NRF_FICR_T {
+  uint32_t DEVICEID[2];
+};
+extern NRF_FICR_T* NRF_FICR;
+
+// FreeRTOS
+typedef void* SemaphoreHandle_t;
+typedef void* TaskHandle_t;
+typedef void* TimerHandle_t;
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffu
+#define TASK_PRIO_LOW 1
+#define TASK_PRIO_NORMAL 2
+#define TASK_PRIO_HIGH 3
+#define configMINIMAL_STACK_SIZE 128
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken);
+TickType_t ms2tick(uint32_t ms);
+BaseType_t xTaskCreate(void (*fn)(void*), const char* name, uint32_t stack, void* arg, UBaseType_t prio, TaskHandle_t* out);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t ticks);
+void vTaskSuspend(TaskHandle_t task);
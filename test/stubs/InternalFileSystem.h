@@ -0,0 +1,14 @@
+// Host stub: InternalFS (backed by an in-memory map in fake_board.h).
+#pragma once
+#include <Adafruit_LittleFS.h>
+
+struct InternalFSClass {
+  bool begin();
+  Adafruit_LittleFS_Namespace::File open(const char* path, uint8_t mode);
+  bool remove(const char* path);
+  bool exists(const char* path);
+  bool mkdir(const char* path);
+  bool rename(const char* from, const char* to);
+  bool rmdir_r(const char* path);
+};
+extern InternalFSClass InternalFS;
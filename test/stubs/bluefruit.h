@@ -0,0 +1,142 @@
+// Host stub: the Bluefruit / SoftDevice API that src/main.cpp uses.
+#pragma once
+#include <Arduino.h>
+
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE 6
+#define BLE_GAP_CP_MIN_CONN_INTVL_MIN 6
+#define BLE_GATT_STATUS_SUCCESS 0
+#define BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED 0x0103
+#define BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED 0x0106
+#define BLE_GATT_STATUS_ATTERR_INSUF_RESOURCES 0x0111
+#define BLE_GATT_STATUS_ATTERR_APP_BEGIN 0x0180
+#define BLE_GATTS_AUTHORIZE_TYPE_READ 1
+#define BLE_GATTS_AUTHORIZE_TYPE_WRITE 2
+#define BLE_GATTS_OP_WRITE_REQ 1
+#define NRF_SUCCESS 0
+#define BANDWIDTH_MAX 3
+
+enum { CHR_PROPS_READ = 2, CHR_PROPS_WRITE_WO_RESP = 4, CHR_PROPS_WRITE = 8, CHR_PROPS_NOTIFY = 16 };
+
+struct SecureMode_t {};
+extern SecureMode_t SECMODE_OPEN;
+extern SecureMode_t SECMODE_NO_ACCESS;
+
+struct ble_gatts_evt_write_t {
+  uint16_t handle;
+  uint8_t op;
+  uint8_t auth_required;
+  uint16_t offset;
+  uint16_t len;
+  uint8_t data[1];
+};
+struct ble_gatts_evt_read_t {
+  uint16_t handle;
+  uint16_t offset;
+};
+struct ble_gap_conn_params_t {
+  uint16_t min_conn_interval, max_conn_interval, slave_latency, conn_sup_timeout;
+};
+struct ble_gatts_authorize_params_t {
+  uint16_t gatt_status;
+  uint8_t update;
+  uint16_t offset;
+  uint16_t len;
+  const uint8_t* p_data;
+};
+struct ble_gatts_rw_authorize_reply_params_t {
+  uint8_t type;
+  union {
+    ble_gatts_authorize_params_t write;
+    ble_gatts_authorize_params_t read;
+  } params;
+};
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn, const ble_gatts_rw_authorize_reply_params_t* reply);
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn, const ble_gap_conn_params_t* params);
+
+class BLEService {
+ public:
+  BLEService(const char* uuid);
+  bool begin();
+};
+
+class BLECharacteristic {
+ public:
+  typedef void (*write_cb_t)(uint16_t, BLECharacteristic*, uint8_t*, uint16_t);
+  typedef void (*write_authorize_cb_t)(uint16_t, BLECharacteristic*, ble_gatts_evt_write_t*);
+  typedef void (*read_authorize_cb_t)(uint16_t, BLECharacteristic*, ble_gatts_evt_read_t*);
+  typedef void (*cccd_cb_t)(uint16_t, BLECharacteristic*, uint16_t);
+
+  BLECharacteristic(const char* uuid);
+  void setProperties(uint8_t props);
+  void setPermission(SecureMode_t read, SecureMode_t write);
+  void setWriteCallback(write_cb_t cb, bool useAdaCallback = true);
+  void setWriteAuthorizeCallback(write_authorize_cb_t cb, bool useAdaCallback = true);
+  void setReadAuthorizeCallback(read_authorize_cb_t cb, bool useAdaCallback = true);
+  void setCccdWriteCallback(cccd_cb_t cb, bool useAdaCallback = true);
+  void setFixedLen(uint16_t len);
+  void setMaxLen(uint16_t len);
+  bool begin();
+  uint16_t write(const void* data, uint16_t len);
+  bool notify(const void* data, uint16_t len);
+  bool notify(uint16_t conn, const void* data, uint16_t len);
+  bool notifyEnabled();
+  bool notifyEnabled(uint16_t conn);
+};
+
+class BLEConnection {
+ public:
+  uint16_t getConnectionInterval();
+  uint16_t getSlaveLatency();
+  uint16_t getSupervisionTimeout();
+  bool requestConnectionParameter(uint16_t interval, uint16_t latency = 0, uint16_t timeout = 0);
+  uint16_t getMtu();
+  bool requestPHY();
+  bool requestDataLengthUpdate();
+  bool requestMtuExchange(uint16_t mtu);
+  bool connected();
+};
+
+struct BLEAdvertisingData {
+  void clearData();
+  bool addFlags(uint8_t flags);
+  bool addService(BLEService& svc);
+  bool addTxPower();
+  bool addName();
+};
+
+struct BLEAdvertising : BLEAdvertisingData {
+  void restartOnDisconnect(bool on);
+  void setInterval(uint16_t fast, uint16_t slow);
+  void setFastTimeout(uint16_t sec);
+  bool start(uint16_t timeout);
+  bool stop();
+  bool isRunning();
+};
+
+struct BLEPeriph {
+  typedef void (*connect_cb)(uint16_t);
+  typedef void (*disconnect_cb)(uint16_t, uint8_t);
+  void setConnectCallback(connect_cb cb);
+  void setDisconnectCallback(disconnect_cb cb);
+  void setConnInterval(uint16_t min, uint16_t max);
+  void setConnSupervisionTimeout(uint16_t timeout);
+  void setConnSlaveLatency(uint16_t latency);
+};
+
+struct AdafruitBluefruit {
+  bool begin(uint8_t prph = 1, uint8_t central = 0);
+  void setTxPower(int8_t dbm);
+  void setName(const char* name);
+  uint16_t connHandle();
+  bool disconnect(uint16_t conn);
+  BLEConnection* Connection(uint16_t conn);
+  uint8_t connected();
+  void configPrphBandwidth(uint8_t bw);
+  void configPrphConn(uint16_t mtu, uint16_t event_len, uint8_t hvn_qsize, uint8_t wrcmd_qsize);
+
+  BLEAdvertising Advertising;
+  BLEAdvertisingData ScanResponse;
+  BLEPeriph Periph;
+};
+extern AdafruitBluefruit Bluefruit;
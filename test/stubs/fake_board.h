@@ -0,0 +1,296 @@
+// fake_board.h
+//
+// Host definitions for the stub headers in this directory. A test includes src/main.cpp first and this
+// file second (once per test binary, even when main.cpp is included into several namespaces).
+//
+// 보드 대신 기록만 한다:
+// - 시간: g_fake_ms. delay/vTaskDelay와 타임아웃이 있는 세마포어/notify 대기가 그만큼 시간을 진행시킨다.
+// - HID: g_hid_log ("K mm k0 k1 k2" = keyboard report, "R" = release, "M x v" = mouse, "S v" = scroll,
+//   "J" = /bfj/ 아래 파일 쓰기, 즉 journal 체크포인트가 HID 순서의 어디에서 일어났는지).
+// - USB: g_fake_mounted / g_fake_suspended / g_fake_wakeup_allowed. remoteWakeup()은 40ms 뒤 resume된다.
+// - Flash: g_fs (path -> bytes). 프로세스 안에서 재부팅을 흉내낼 때는 g_fs만 남기고 새 namespace를 쓴다.
+// - BLE: g_auth_replies (authorize 응답 status), g_conn_updates, g_notifies / g_notify_conns.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+uint32_t g_fake_ms = 0;
+std::vector<std::string> g_hid_log;
+
+bool g_fake_mounted = true;
+bool g_fake_suspended = false;
+bool g_fake_wakeup_allowed = true;
+uint32_t g_fake_wakeups = 0;
+uint32_t g_fake_resume_at = 0;
+
+std::map<std::string, std::string> g_fs;
+
+std::vector<uint16_t> g_auth_replies;
+std::vector<uint16_t> g_conn_updates;
+std::vector<std::vector<uint8_t>> g_notifies;
+std::vector<uint16_t> g_notify_conns;
+
+// 테스트 사이에 기록만 지운다 (시간과 flash는 테스트가 직접 정한다).
+static inline void fake_board_clear_logs() {
+  g_hid_log.clear();
+  g_auth_replies.clear();
+  g_conn_updates.clear();
+  g_notifies.clear();
+  g_notify_conns.clear();
+}
+
+// -----------------------------
+// Arduino core
+// -----------------------------
+void delay(uint32_t ms) { g_fake_ms += ms; }
+uint32_t millis() { return g_fake_ms; }
+uint32_t micros() {
+  // Microbenchmark만 쓴다: 실제 경과 시간이 필요하다.
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+void noInterrupts() {}
+void interrupts() {}
+void yield() {}
+
+SerialT Serial;
+void SerialT::begin(int) {}
+SerialT::operator bool() const { return false; }
+void SerialT::println(const char*) {}
+void SerialT::print(const char*) {}
+void SerialT::println(unsigned long) {}
+
+static NRF_FICR_T g_fake_ficr{{0x1234, 0x5678}};
+NRF_FICR_T* NRF_FICR = &g_fake_ficr;
+
+extern "C" void enterSerialDfu(void) {}
+
+// -----------------------------
+// FreeRTOS (single task: 대기는 타임아웃만큼 시간을 진행시키고 깨우는 쪽은 없다)
+// -----------------------------
+SemaphoreHandle_t xSemaphoreCreateBinary() { return (void*)1; }
+SemaphoreHandle_t xSemaphoreCreateMutex() { return (void*)1; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t ticks) {
+  if (ticks != portMAX_DELAY) g_fake_ms += ticks;
+  return pdFALSE;
+}
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t, BaseType_t*) { return pdTRUE; }
+TickType_t ms2tick(uint32_t ms) { return ms; }
+BaseType_t xTaskCreate(void (*)(void*), const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* out) {
+  if (out) *out = (void*)1;
+  return pdPASS;
+}
+BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t ticks) {
+  if (ticks != portMAX_DELAY) g_fake_ms += ticks;
+  return 0;
+}
+TaskHandle_t xTaskGetCurrentTaskHandle() { return (void*)1; }
+void vTaskDelay(TickType_t ticks) { g_fake_ms += ticks; }
+void vTaskSuspend(TaskHandle_t) {}
+
+// -----------------------------
+// TinyUSB
+// -----------------------------
+Adafruit_USBD_Device TinyUSBDevice;
+
+bool Adafruit_USBD_Device::mounted() { return g_fake_mounted; }
+bool Adafruit_USBD_Device::suspended() {
+  if (g_fake_suspended && g_fake_resume_at && g_fake_ms >= g_fake_resume_at) {
+    g_fake_suspended = false;
+    g_fake_resume_at = 0;
+  }
+  return g_fake_suspended;
+}
+bool Adafruit_USBD_Device::remoteWakeup() {
+  if (!g_fake_wakeup_allowed) return false;
+  g_fake_wakeups++;
+  g_fake_resume_at = g_fake_ms + 40;
+  return true;
+}
+bool tud_suspended() { return g_fake_suspended; }
+bool tud_remote_wakeup() { return true; }
+bool tud_mounted() { return g_fake_mounted; }
+
+void Adafruit_USBD_HID::setPollInterval(uint8_t) {}
+void Adafruit_USBD_HID::setReportDescriptor(const uint8_t*, size_t) {}
+void Adafruit_USBD_HID::setReportCallback(get_report_callback_t, set_report_callback_t) {}
+bool Adafruit_USBD_HID::begin() { return true; }
+bool Adafruit_USBD_HID::ready() { return !TinyUSBDevice.suspended(); }
+bool Adafruit_USBD_HID::keyboardReport(uint8_t, uint8_t modifier, uint8_t* keycodes) {
+  char line[64];
+  snprintf(line, sizeof line, "K %02x %02x %02x %02x", modifier, keycodes[0], keycodes[1], keycodes[2]);
+  g_hid_log.push_back(line);
+  return true;
+}
+bool Adafruit_USBD_HID::keyboardRelease(uint8_t) {
+  g_hid_log.push_back("R");
+  return true;
+}
+bool Adafruit_USBD_HID::mouseReport(uint8_t, uint8_t, int8_t x, int8_t, int8_t vertical, int8_t) {
+  char line[32];
+  snprintf(line, sizeof line, "M %d %d", x, vertical);
+  g_hid_log.push_back(line);
+  return true;
+}
+bool Adafruit_USBD_HID::mouseScroll(uint8_t, int8_t vertical, int8_t) {
+  char line[32];
+  snprintf(line, sizeof line, "S %d", vertical);
+  g_hid_log.push_back(line);
+  return true;
+}
+bool Adafruit_USBD_HID::sendReport(uint8_t, const void*, uint8_t) { return true; }
+
+// -----------------------------
+// LittleFS (g_fs)
+// -----------------------------
+namespace Adafruit_LittleFS_Namespace {
+File::File() {}
+File::operator bool() const { return ok_; }
+int File::read(void* buf, uint16_t len) {
+  const std::string& data = g_fs[path_];
+  if (pos_ >= data.size()) return 0;
+  uint32_t n = std::min<uint32_t>(len, data.size() - pos_);
+  memcpy(buf, data.data() + pos_, n);
+  pos_ += n;
+  return (int)n;
+}
+int File::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+size_t File::write(const uint8_t* buf, size_t len) {
+  if (path_.rfind("/bfj/", 0) == 0) g_hid_log.push_back("J");
+  std::string& data = g_fs[path_];
+  if (data.size() < pos_ + len) data.resize(pos_ + len);
+  memcpy(&data[pos_], buf, len);
+  pos_ += len;
+  return len;
+}
+bool File::seek(uint32_t pos) {
+  pos_ = pos;
+  return true;
+}
+uint32_t File::position() { return pos_; }
+uint32_t File::size() { return g_fs[path_].size(); }
+void File::close() {}
+void File::flush() {}
+bool File::isDirectory() { return false; }
+File File::openNextFile(uint8_t) { return File(); }
+const char* File::name() { return path_.c_str(); }
+void File::rewindDirectory() {}
+}  // namespace Adafruit_LittleFS_Namespace
+
+InternalFSClass InternalFS;
+
+bool InternalFSClass::begin() { return true; }
+Adafruit_LittleFS_Namespace::File InternalFSClass::open(const char* path, uint8_t mode) {
+  Adafruit_LittleFS_Namespace::File f;
+  f.path_ = path;
+  if (mode == FILE_O_WRITE) {
+    // LittleFS FILE_O_WRITE는 append 위치에서 연다.
+    f.ok_ = true;
+    f.pos_ = g_fs[path].size();
+  } else {
+    f.ok_ = g_fs.count(path) > 0;
+  }
+  return f;
+}
+bool InternalFSClass::remove(const char* path) { return g_fs.erase(path) > 0; }
+bool InternalFSClass::exists(const char* path) { return g_fs.count(path) > 0; }
+bool InternalFSClass::mkdir(const char*) { return true; }
+bool InternalFSClass::rename(const char* from, const char* to) {
+  if (!g_fs.count(from)) return false;
+  g_fs[to] = g_fs[from];
+  g_fs.erase(from);
+  return true;
+}
+bool InternalFSClass::rmdir_r(const char*) { return true; }
+
+// -----------------------------
+// Bluefruit / SoftDevice
+// -----------------------------
+SecureMode_t SECMODE_OPEN;
+SecureMode_t SECMODE_NO_ACCESS;
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t, const ble_gatts_rw_authorize_reply_params_t* reply) {
+  g_auth_replies.push_back(reply->params.write.gatt_status);
+  return NRF_SUCCESS;
+}
+uint32_t sd_ble_gap_conn_param_update(uint16_t, const ble_gap_conn_params_t* params) {
+  g_conn_updates.push_back(params->min_conn_interval);
+  return NRF_SUCCESS;
+}
+
+BLEService::BLEService(const char*) {}
+bool BLEService::begin() { return true; }
+
+BLECharacteristic::BLECharacteristic(const char*) {}
+void BLECharacteristic::setProperties(uint8_t) {}
+void BLECharacteristic::setPermission(SecureMode_t, SecureMode_t) {}
+void BLECharacteristic::setWriteCallback(write_cb_t, bool) {}
+void BLECharacteristic::setWriteAuthorizeCallback(write_authorize_cb_t, bool) {}
+void BLECharacteristic::setReadAuthorizeCallback(read_authorize_cb_t, bool) {}
+void BLECharacteristic::setCccdWriteCallback(cccd_cb_t, bool) {}
+void BLECharacteristic::setFixedLen(uint16_t) {}
+void BLECharacteristic::setMaxLen(uint16_t) {}
+bool BLECharacteristic::begin() { return true; }
+uint16_t BLECharacteristic::write(const void*, uint16_t len) { return len; }
+bool BLECharacteristic::notify(const void* data, uint16_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  g_notifies.emplace_back(p, p + len);
+  return true;
+}
+bool BLECharacteristic::notify(uint16_t conn, const void* data, uint16_t len) {
+  g_notify_conns.push_back(conn);
+  return notify(data, len);
+}
+bool BLECharacteristic::notifyEnabled() { return true; }
+bool BLECharacteristic::notifyEnabled(uint16_t) { return true; }
+
+static BLEConnection g_fake_conn;
+uint16_t BLEConnection::getConnectionInterval() { return 6; }
+uint16_t BLEConnection::getSlaveLatency() { return 0; }
+uint16_t BLEConnection::getSupervisionTimeout() { return 400; }
+bool BLEConnection::requestConnectionParameter(uint16_t, uint16_t, uint16_t) { return true; }
+uint16_t BLEConnection::getMtu() { return 247; }
+bool BLEConnection::requestPHY() { return true; }
+bool BLEConnection::requestDataLengthUpdate() { return true; }
+bool BLEConnection::requestMtuExchange(uint16_t) { return true; }
+bool BLEConnection::connected() { return true; }
+
+void BLEAdvertisingData::clearData() {}
+bool BLEAdvertisingData::addFlags(uint8_t) { return true; }
+bool BLEAdvertisingData::addService(BLEService&) { return true; }
+bool BLEAdvertisingData::addTxPower() { return true; }
+bool BLEAdvertisingData::addName() { return true; }
+
+void BLEAdvertising::restartOnDisconnect(bool) {}
+void BLEAdvertising::setInterval(uint16_t, uint16_t) {}
+void BLEAdvertising::setFastTimeout(uint16_t) {}
+bool BLEAdvertising::start(uint16_t) { return true; }
+bool BLEAdvertising::stop() { return true; }
+bool BLEAdvertising::isRunning() { return false; }
+
+void BLEPeriph::setConnectCallback(connect_cb) {}
+void BLEPeriph::setDisconnectCallback(disconnect_cb) {}
+void BLEPeriph::setConnInterval(uint16_t, uint16_t) {}
+void BLEPeriph::setConnSupervisionTimeout(uint16_t) {}
+void BLEPeriph::setConnSlaveLatency(uint16_t) {}
+
+AdafruitBluefruit Bluefruit;
+bool AdafruitBluefruit::begin(uint8_t, uint8_t) { return true; }
+void AdafruitBluefruit::setTxPower(int8_t) {}
+void AdafruitBluefruit::setName(const char*) {}
+uint16_t AdafruitBluefruit::connHandle() { return 0; }
+bool AdafruitBluefruit::disconnect(uint16_t) { return true; }
+BLEConnection* AdafruitBluefruit::Connection(uint16_t) { return &g_fake_conn; }
+uint8_t AdafruitBluefruit::connected() { return 1; }
+void AdafruitBluefruit::configPrphBandwidth(uint8_t) {}
+void AdafruitBluefruit::configPrphConn(uint16_t, uint16_t, uint8_t, uint8_t) {}
@@ -0,0 +1,33 @@
+// firmware_instance.h
+//
+// Includes src/main.cpp into namespace BF_INSTANCE, so one test binary can hold several devices
+// (fleet) or a device before and after a reboot (journal). Include once per instance, then fake_board.h once:
+//
+//   #define BF_INSTANCE dev0
+//   #include "firmware_instance.h"
+//   #undef BF_INSTANCE
+//
+// 모든 instance가 fake_board의 시간/HID log/g_fs를 같이 쓴다. extern "C" 콜백만 instance마다 이름을 바꾼다.
+// (no #pragma once: 여러 번 include한다)
+#include <Arduino.h>
+#include <Adafruit_TinyUSB.h>
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+#include <bluefruit.h>
+
+#define BF_INSTANCE_CAT2(a, b) a##_##b
+#define BF_INSTANCE_CAT(a, b) BF_INSTANCE_CAT2(a, b)
+
+#define tud_mount_cb BF_INSTANCE_CAT(BF_INSTANCE, tud_mount_cb)
+#define tud_umount_cb BF_INSTANCE_CAT(BF_INSTANCE, tud_umount_cb)
+#define tud_suspend_cb BF_INSTANCE_CAT(BF_INSTANCE, tud_suspend_cb)
+#define tud_resume_cb BF_INSTANCE_CAT(BF_INSTANCE, tud_resume_cb)
+
+namespace BF_INSTANCE {
+#include "../../src/main.cpp"
+}  // namespace BF_INSTANCE
+
+#undef tud_mount_cb
+#undef tud_umount_cb
+#undef tud_suspend_cb
+#undef tud_resume_cb
@@ -0,0 +1,164 @@
+// Clipboard paste transport: 키보드로 칠 수 없는 문자가 있는 job은 base64로 보내 PowerShell이 클립보드에 붙인다.
+// 잘린 UTF-8 바이트에서 멈추지 않는지도 본다.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+#include <string>
+
+static void flush_text(uint16_t session, uint16_t seq, const std::string& text) {
+  const size_t n = text.size();
+  auto* req = (ble_gatts_evt_write_t*)calloc(1, sizeof(ble_gatts_evt_write_t) + 4 + n);
+  req->op = BLE_GATTS_OP_WRITE_REQ;
+  req->len = 4 + n;
+  put_le16(&req->data[0], session);
+  put_le16(&req->data[2], seq);
+  memcpy(&req->data[4], text.data(), n);
+  flush_text_write_authorize_cb(0, nullptr, req);
+  free(req);
+}
+
+// OPEN: typing 30ms, flags=clipboard paste 허용
+static void open_job(uint16_t session) {
+  uint8_t data[11] = {kJobOpOpen, uint8_t(session), 0, 30, 0, 100, 0, 10, 0, 0, kJobFlagClipPaste};
+  job_write_cb(0, nullptr, data, sizeof data);
+}
+
+static void close_job(uint16_t session) {
+  uint8_t data[3] = {kJobOpClose, uint8_t(session), 0};
+  job_write_cb(0, nullptr, data, sizeof data);
+}
+
+static void run(int n = 3000) {
+  for (int i = 0; i < n; i++) hid_task_iteration();
+}
+
+// 키보드 report를 ASCII로 되돌린다(ascii_to_hid의 역).
+static std::string typed() {
+  std::string out;
+  for (auto& e : g_hid_log) {
+    unsigned mod, k0, k1, k2;
+    if (sscanf(e.c_str(), "K %x %x %x %x", &mod, &k0, &k1, &k2) != 4 || k0 == 0) continue;
+    for (int c = 9; c < 127; c++) {
+      uint8_t m = 0, k = 0;
+      if (ascii_to_hid((char)c, m, k) && m == mod && k == k0) {
+        out += (char)c;
+        break;
+      }
+    }
+  }
+  g_hid_log.clear();
+  return out;
+}
+
+static std::string base64_decode(const std::string& s) {
+  static const std::string kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  uint32_t v = 0;
+  int bits = 0;
+  for (char c : s) {
+    if (c == '=') break;
+    const size_t p = kAlphabet.find(c);
+    if (p == std::string::npos) continue;
+    v = (v << 6) | p;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out += char((v >> bits) & 0xFF);
+    }
+  }
+  return out;
+}
+
+void setUp(void) { fake_board_clear_logs(); }
+
+void tearDown(void) {}
+
+static void test_unsupported_chars_are_pasted_whole(void) {
+  const std::string text = "hello\n\xe2\x9c\x93 ok \xf0\x9f\x98\x80\nabc";
+  open_job(7);
+  flush_text(7, 0, text);
+  close_job(7);
+  run();
+
+  // ...FromBase64String($b)))"<Enter><base64><Enter>
+  const std::string out = typed();
+  const std::string marker = "FromBase64String($b)))\"";
+  const size_t at = out.find(marker);
+  TEST_ASSERT_TRUE(at != std::string::npos);
+  const size_t b64_start = out.find('\n', at) + 1;
+  const size_t b64_end = out.find('\n', b64_start);
+  TEST_ASSERT_TRUE(b64_end != std::string::npos);
+  TEST_ASSERT_TRUE(base64_decode(out.substr(b64_start, b64_end - b64_start)) == text);
+  TEST_ASSERT_EQUAL(0, g_job_count);
+}
+
+static void test_lone_lead_byte_does_not_stall(void) {
+  open_job(8);
+  flush_text(8, 0, "ab\xe0");
+  close_job(8);
+  run();
+
+  TEST_ASSERT_EQUAL_STRING("ab", typed().c_str());
+  TEST_ASSERT_EQUAL(0, g_job_count);
+  TEST_ASSERT_EQUAL(0, rb_used_bytes());
+}
+
+static void test_split_char_waits_for_rest(void) {
+  open_job(9);
+  flush_text(9, 0, "\xe2\x9c");
+  run(50);
+  TEST_ASSERT_EQUAL_STRING("", typed().c_str());
+  TEST_ASSERT_EQUAL(2, rb_used_bytes());
+
+  flush_text(9, 1, "\x93!\n");
+  close_job(9);
+  run();
+  TEST_ASSERT_TRUE(typed().find("Read-Host") != std::string::npos);
+  TEST_ASSERT_EQUAL(0, g_job_count);
+}
+
+// journal은 Ctrl+V를 보낸 뒤, batch 안의 마지막 줄 경계 하나만 checkpoint한다.
+static void test_batch_checkpoint_follows_paste(void) {
+  open_job(11);
+  flush_text(11, 0, "\xe2\x9c\x93 a\n\xe2\x9c\x93 b\nc");
+  run(50);
+
+  char ctrl_v[32];
+  snprintf(ctrl_v, sizeof ctrl_v, "K %02x %02x 00 00", KEYBOARD_MODIFIER_LEFTCTRL, HID_KEY_V);
+  const auto paste = std::find(g_hid_log.begin(), g_hid_log.end(), std::string(ctrl_v));
+  TEST_ASSERT_TRUE(paste != g_hid_log.end());
+  TEST_ASSERT_TRUE(std::find(g_hid_log.begin(), paste, std::string("J")) == paste);
+  TEST_ASSERT_EQUAL(1, std::count(paste, g_hid_log.end(), std::string("J")));
+  // 마지막 레코드는 "✓ a\n✓ b\n"까지다(끝의 "c"는 아직 줄 경계가 아니다).
+  char path[24];
+  journal_slot_path(static_cast<uint8_t>(g_journal_seq % kJournalSlots), path, sizeof path);
+  JournalRecord rec = {};
+  memcpy(&rec, g_fs[path].data(), sizeof rec);
+  TEST_ASSERT_EQUAL(12, rec.line_offset);
+  TEST_ASSERT_EQUAL(0, rec.korean_mode);
+
+  close_job(11);
+  run();
+  g_hid_log.clear();
+}
+
+static void test_plain_ascii_is_typed(void) {
+  open_job(10);
+  flush_text(10, 0, "plain text\nmore\n");
+  close_job(10);
+  run();
+  TEST_ASSERT_EQUAL_STRING("plain text\nmore\n", typed().c_str());
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_unsupported_chars_are_pasted_whole);
+  RUN_TEST(test_lone_lead_byte_does_not_stall);
+  RUN_TEST(test_split_char_waits_for_rest);
+  RUN_TEST(test_batch_checkpoint_follows_paste);
+  RUN_TEST(test_plain_ascii_is_typed);
+  return UNITY_END();
+}
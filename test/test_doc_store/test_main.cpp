@@ -0,0 +1,125 @@
+// Document snapshots (diff 재타이핑): 줄 hash 저장/읽기, 크기 제한, 예산 초과 시 오래된 스냅샷 삭제, Flash 재로드.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static uint8_t request(const std::vector<uint8_t>& req) {
+  std::vector<uint8_t> data = req;
+  doc_write_cb(0, nullptr, data.data(), data.size());
+  hid_task_iteration();
+  return g_doc_last_result;
+}
+
+// [op][prefix...][name]
+static std::vector<uint8_t> named(uint8_t op, const char* name, std::vector<uint8_t> prefix = {}) {
+  std::vector<uint8_t> v{op};
+  v.insert(v.end(), prefix.begin(), prefix.end());
+  v.insert(v.end(), name, name + strlen(name));
+  return v;
+}
+
+static uint8_t read_doc(const char* name, uint16_t first) {
+  return request(named(kDocOpRead, name, {uint8_t(first), uint8_t(first >> 8)}));
+}
+
+static uint8_t save_begin(const char* name, uint16_t lines) {
+  return request(named(kDocOpSaveBegin, name, {uint8_t(lines), uint8_t(lines >> 8), 1, 2, 3, 4}));
+}
+
+// 줄 i의 hash = seed + i
+static bool save(const char* name, uint16_t lines, uint32_t seed) {
+  if (save_begin(name, lines) != kDocResultOk) return false;
+  for (uint16_t i = 0; i < lines;) {
+    const uint16_t n = std::min<uint16_t>(kDocDataMaxHashes, lines - i);
+    std::vector<uint8_t> v{kDocOpSaveData, uint8_t(i), uint8_t(i >> 8)};
+    for (uint16_t k = 0; k < n; k++) {
+      const uint32_t h = seed + i + k;
+      for (int b = 0; b < 4; b++) v.push_back(uint8_t(h >> (8 * b)));
+    }
+    if (request(v) != kDocResultOk) return false;
+    i += n;
+  }
+  return request({kDocOpSaveCommit}) == kDocResultOk;
+}
+
+static std::vector<std::string> stored_names() {
+  std::vector<std::string> out;
+  for (const DocHeader& h : g_doc_headers)
+    if (h.magic == kDocMagic) out.push_back(h.name);
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_save_and_read_pages(void) {
+  TEST_ASSERT_EQUAL(kDocResultNotFound, read_doc("cfg", 0));
+  TEST_ASSERT_TRUE(save("cfg", 100, 1000));
+
+  TEST_ASSERT_EQUAL(kDocResultOk, read_doc("cfg", 56));
+  TEST_ASSERT_EQUAL(100, g_doc_view.line_count);
+  TEST_ASSERT_EQUAL(56, g_doc_page_first);
+  TEST_ASSERT_EQUAL(44, g_doc_page_count);
+  TEST_ASSERT_EQUAL(1056, le32(g_doc_page));
+}
+
+static void test_too_large_is_rejected(void) {
+  TEST_ASSERT_EQUAL(kDocResultTooLarge, save_begin("huge", kDocMaxLines + 1));
+}
+
+static void test_budget_evicts_oldest(void) {
+  TEST_ASSERT_TRUE(save("big", 2048, 0));
+  TEST_ASSERT_TRUE(save("c", 300, 7));
+  TEST_ASSERT_EQUAL(3, stored_names().size());  // cfg + big + c는 예산 안이다
+
+  // big(8KB) + c + d는 예산을 넘는다: 가장 오래된 cfg, 그 다음 big을 지운다.
+  TEST_ASSERT_TRUE(save("d", 300, 9));
+  const std::vector<std::string> names = stored_names();
+  TEST_ASSERT_EQUAL(2, names.size());
+  TEST_ASSERT_EQUAL_STRING("c", names[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("d", names[1].c_str());
+}
+
+static void test_reload_from_flash(void) {
+  g_doc_loaded = false;
+  memset(g_doc_headers, 0, sizeof(g_doc_headers));
+
+  TEST_ASSERT_EQUAL(kDocResultOk, read_doc("c", 256));
+  TEST_ASSERT_EQUAL(300, g_doc_view.line_count);
+  TEST_ASSERT_EQUAL(44, g_doc_page_count);
+  TEST_ASSERT_EQUAL(7 + 256, le32(g_doc_page));
+  TEST_ASSERT_EQUAL(2, stored_names().size());
+}
+
+static void test_bad_sequences(void) {
+  TEST_ASSERT_EQUAL(kDocResultOk, save_begin("x", 2));
+  TEST_ASSERT_EQUAL(kDocResultBadRequest, request({kDocOpSaveData, 1, 0, 1, 2, 3, 4}));  // 순서 밖 DATA
+  TEST_ASSERT_EQUAL(kDocResultBadRequest, request({kDocOpSaveCommit}));
+  TEST_ASSERT_EQUAL(kDocResultNotFound, read_doc("x", 0));  // 끝나지 않은 저장은 남지 않는다
+}
+
+static void test_delete(void) {
+  TEST_ASSERT_EQUAL(kDocResultOk, request(named(kDocOpDelete, "c")));
+  TEST_ASSERT_EQUAL(kDocResultNotFound, read_doc("c", 0));
+  TEST_ASSERT_EQUAL(kDocResultNotFound, request(named(kDocOpDelete, "c")));
+  TEST_ASSERT_EQUAL(kDocResultOk, read_doc("d", 0));
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_save_and_read_pages);
+  RUN_TEST(test_too_large_is_rejected);
+  RUN_TEST(test_budget_evicts_oldest);
+  RUN_TEST(test_reload_from_flash);
+  RUN_TEST(test_bad_sequences);
+  RUN_TEST(test_delete);
+  return UNITY_END();
+}
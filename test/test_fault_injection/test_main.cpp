@@ -0,0 +1,245 @@
+// Flush Text fault injection: 중복 패킷, 유실된 ACK(늦은 재전송), 패킷 도중 재연결, pause/resume 폭주,
+// backpressure로 세워둔 패킷이 있을 때의 abort. 웹처럼 ATT 응답을 받아야 다음 패킷을 보내고, 대상 PC에 친 글자
+// (g_hid_log)가 보낸 텍스트와 바이트 단위로 같은지 본다. 시나리오마다 goodput과 정체 시간을 출력한다.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+#include <cstdio>
+#include <string>
+
+static constexpr uint16_t kNoReply = 0xFFFF;
+static constexpr uint16_t kChunkMax = kDeferredWriteMax - kFlushHeaderSize;
+
+static uint16_t g_conn = 1;
+static uint32_t g_started_ms = 0;
+static uint32_t g_web_wait_ms = 0;  // 웹이 ATT 응답을 기다린 시간
+static uint32_t g_held_ms = 0;      // 시나리오가 일부러 pause로 붙잡아 둔 시간(goodput에서 뺀다)
+
+// a..z, 공백, Enter만 쓴다(레이아웃/한영 전환과 무관하게 키 하나 = 글자 하나).
+static std::string corpus(size_t n, uint32_t seed) {
+  std::string s;
+  for (size_t i = 0; i < n; i++) {
+    seed = seed * 1103515245u + 12345u;
+    const uint32_t r = (seed >> 8) % 32;
+    s += r < 26 ? char('a' + r) : (r < 30 ? ' ' : '\n');
+  }
+  return s;
+}
+
+static std::string typed() {
+  std::string s;
+  for (auto& e : g_hid_log) {
+    unsigned mod, key;
+    if (sscanf(e.c_str(), "K %x %x", &mod, &key) != 2 || mod != 0) continue;
+    if (key >= HID_KEY_A && key <= HID_KEY_A + 25) s += char('a' + key - HID_KEY_A);
+    if (key == HID_KEY_SPACE) s += ' ';
+    if (key == HID_KEY_ENTER) s += '\n';
+  }
+  return s;
+}
+
+static void run(int n) {
+  for (int i = 0; i < n; i++) hid_task_iteration();
+}
+
+// 응답을 기다리지 않고 쓴다. 돌아온 응답이 있으면 그 status, 세워뒀으면 kNoReply.
+static uint16_t write_packet(uint16_t session, uint16_t seq, const std::string& chunk) {
+  auto* req = (ble_gatts_evt_write_t*)calloc(1, sizeof(ble_gatts_evt_write_t) + kFlushHeaderSize + chunk.size());
+  req->op = BLE_GATTS_OP_WRITE_REQ;
+  req->len = kFlushHeaderSize + chunk.size();
+  put_le16(&req->data[0], session);
+  put_le16(&req->data[2], seq);
+  memcpy(&req->data[kFlushHeaderSize], chunk.data(), chunk.size());
+  const size_t before = g_auth_replies.size();
+  flush_text_write_authorize_cb(g_conn, nullptr, req);
+  free(req);
+  return g_auth_replies.size() > before ? g_auth_replies.back() : kNoReply;
+}
+
+// 웹처럼: 쓰고 응답이 올 때까지 기다린다(그동안 HID task가 돈다).
+static uint16_t send(uint16_t session, uint16_t seq, const std::string& chunk) {
+  const size_t before = g_auth_replies.size();
+  const uint32_t start = millis();
+  uint16_t status = write_packet(session, seq, chunk);
+  for (int i = 0; status == kNoReply && i < 100000; i++) {
+    hid_task_iteration();
+    if (g_auth_replies.size() > before) status = g_auth_replies.back();
+  }
+  g_web_wait_ms += millis() - start;
+  return status;
+}
+
+static void config(uint8_t flags) {
+  uint8_t data[8] = {1, 0, 0, 0, 1, 0, 0, flags};  // typing 1ms, press 1ms
+  config_write_cb(g_conn, nullptr, data, sizeof data);
+}
+
+static void drain() {
+  for (int i = 0; !is_flush_idle() && i < 100000; i++) hid_task_iteration();
+  run(5);
+}
+
+static void report(const char* scenario, size_t bytes) {
+  const uint32_t elapsed = millis() - g_started_ms - g_held_ms;
+  printf("fault %-12s %5u bytes in %6u ms: goodput %7.1f B/s, device stall %5u ms, web wait %6u ms\n", scenario,
+         (unsigned)bytes, (unsigned)elapsed, elapsed ? bytes * 1000.0 / elapsed : 0.0, (unsigned)g_stats.stall_ms,
+         (unsigned)g_web_wait_ms);
+}
+
+void setUp(void) {
+  ble_connect_cb(g_conn);
+  config(0);
+  uint8_t reset = kStatsOpReset;
+  stats_write_cb(g_conn, nullptr, &reset, 1);
+  run(2);
+  fake_board_clear_logs();
+  g_started_ms = millis();
+  g_web_wait_ms = 0;
+  g_held_ms = 0;
+}
+
+void tearDown(void) {
+  config(0x02);  // abort: 남은 것을 다음 시나리오로 넘기지 않는다
+  run(2);
+  ble_disconnect_cb(g_conn, 0);
+}
+
+static void test_duplicate_packets(void) {
+  const std::string text = corpus(1500, 1);
+  uint16_t seq = 0;
+  for (size_t at = 0; at < text.size(); at += 40, seq++) {
+    const std::string chunk = text.substr(at, 40);
+    TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(21, seq, chunk));
+    if (seq % 3 == 0) TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(21, seq, chunk));
+  }
+  drain();
+
+  TEST_ASSERT_TRUE(typed() == text);
+  TEST_ASSERT_EQUAL(13, g_stats.packets_ignored);  // seq 0, 3, ..., 36
+  report("duplicates", text.size());
+}
+
+// ACK가 유실되면 웹은 같은 seq를 다시 보내고, 늦게 도착한 예전 재전송도 섞인다. 어느 것도 다시 치지 않는다.
+static void test_dropped_acks(void) {
+  const std::string text = corpus(1500, 2);
+  uint16_t seq = 0;
+  for (size_t at = 0; at < text.size(); at += 60, seq++) {
+    TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(22, seq, text.substr(at, 60)));
+    if (seq % 4 == 1) TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(22, seq, text.substr(at, 60)));
+    if (seq >= 2 && seq % 5 == 0) {
+      const uint16_t late = seq - 2;
+      TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(22, late, text.substr(late * 60, 60)));
+    }
+  }
+  drain();
+
+  TEST_ASSERT_TRUE(typed() == text);
+  report("dropped-acks", text.size());
+}
+
+// backpressure로 세워둔 패킷은 연결이 끊기면 응답 없이 버려진다. 웹은 다시 연결해 그 seq부터 보낸다.
+static void test_reconnect_mid_packet(void) {
+  const std::string text = corpus(2000, 3);
+  uint16_t seq = 0;
+  int reconnects = 0;
+  for (size_t at = 0; at < text.size(); at += kChunkMax, seq++) {
+    const std::string chunk = text.substr(at, kChunkMax);
+    if (write_packet(23, seq, chunk) == kNoReply && seq > 0 && reconnects < 3) {
+      TEST_ASSERT_TRUE(g_deferred_write.active);
+      ble_disconnect_cb(g_conn, 0x08);
+      TEST_ASSERT_FALSE(g_deferred_write.active);
+      run(3);
+      g_conn++;
+      ble_connect_cb(g_conn);
+      reconnects++;
+    }
+    TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(23, seq, chunk));
+  }
+  drain();
+
+  TEST_ASSERT_EQUAL(3, reconnects);
+  TEST_ASSERT_TRUE(typed() == text);
+  report("reconnect", text.size());
+}
+
+// 패킷마다 pause/resume을 몇 번씩 오간다. pause 중에는 한 글자도 치지 않고, 데이터는 버리지 않는다.
+static void test_pause_resume_storm(void) {
+  const std::string text = corpus(1500, 4);
+  uint16_t seq = 0;
+  for (size_t at = 0; at < text.size(); at += 50, seq++) {
+    for (int i = 0; i < 3; i++) {
+      const uint32_t start = millis();
+      config(0x01);
+      run(1);
+      const size_t keys = g_hid_log.size();
+      run(2);
+      TEST_ASSERT_EQUAL(keys, g_hid_log.size());
+      config(0x00);
+      g_held_ms += millis() - start;
+      run(1);
+    }
+    config(seq % 2 ? 0x01 : 0x00);  // 홀수 seq는 pause한 채로 보낸다(응답은 자리가 있는 한 바로 온다)
+    const uint16_t status = write_packet(24, seq, text.substr(at, 50));
+    if (status == kNoReply) {
+      const uint32_t start = millis();
+      config(0x00);
+      for (int i = 0; g_deferred_write.active && i < 100000; i++) hid_task_iteration();
+      g_web_wait_ms += millis() - start;
+    } else {
+      TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, status);
+    }
+    config(0x00);
+  }
+  drain();
+
+  TEST_ASSERT_TRUE(typed() == text);
+  report("pause-storm", text.size());
+}
+
+// pause로 큐를 채워 패킷이 세워진 상태에서 abort: 세워둔 패킷에는 응답하고 버리며, 아무것도 치지 않는다.
+// 다음 session은 이전 것의 바이트 없이 그대로 친다.
+static void test_abort_under_backpressure(void) {
+  config(0x01);
+  run(1);
+  const std::string text = corpus(1200, 5);
+  TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(25, 0, text.substr(0, kChunkMax)));
+  uint16_t seq = 1;
+  uint16_t status = BLE_GATT_STATUS_SUCCESS;
+  for (size_t at = kChunkMax; status != kNoReply && at < text.size(); at += kChunkMax, seq++) {
+    status = write_packet(25, seq, text.substr(at, kChunkMax));
+  }
+  TEST_ASSERT_EQUAL(kNoReply, status);
+  TEST_ASSERT_TRUE(g_deferred_write.active);
+  const size_t replies = g_auth_replies.size();
+
+  config(0x02);
+  run(5);
+  TEST_ASSERT_FALSE(g_deferred_write.active);
+  TEST_ASSERT_EQUAL(replies + 1, g_auth_replies.size());
+  TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, g_auth_replies.back());
+  TEST_ASSERT_EQUAL(0, rb_used_bytes());
+  TEST_ASSERT_TRUE(typed().empty());
+  TEST_ASSERT_EQUAL(kGattStatusChunkRefused, send(25, seq, "late"));  // abort 뒤의 늦은 청크: job이 없다
+
+  const std::string next = corpus(300, 6);
+  g_started_ms = millis();
+  g_web_wait_ms = 0;
+  TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(26, 0, next.substr(0, 150)));
+  TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, send(26, 1, next.substr(150)));
+  drain();
+  TEST_ASSERT_TRUE(typed() == next);
+  report("abort", next.size());
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_duplicate_packets);
+  RUN_TEST(test_dropped_acks);
+  RUN_TEST(test_reconnect_mid_packet);
+  RUN_TEST(test_pause_resume_storm);
+  RUN_TEST(test_abort_under_backpressure);
+  return UNITY_END();
+}
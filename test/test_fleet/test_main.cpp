@@ -0,0 +1,161 @@
+// Fleet fan-out: 세 장치가 같은 armed job을 받고, 웹이 보낸 시각 차이만큼 줄인 START delay로 같은 순간에 치기 시작한다.
+#define BF_INSTANCE dev0
+#include "firmware_instance.h"
+#undef BF_INSTANCE
+#define BF_INSTANCE dev1
+#include "firmware_instance.h"
+#undef BF_INSTANCE
+#define BF_INSTANCE dev2
+#include "firmware_instance.h"
+#undef BF_INSTANCE
+#include "fake_board.h"
+
+#include <unity.h>
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// 장치마다 HID log를 따로 모은다(fake_board의 g_hid_log와 바꿔 끼운다).
+static std::vector<std::string> g_logs[3];
+static uint32_t g_first_key_ms[3];
+
+template <class F>
+static void on_device(int i, F f) {
+  std::swap(g_hid_log, g_logs[i]);
+  f();
+  std::swap(g_hid_log, g_logs[i]);
+}
+
+#define DEVICE_HELPERS(ns, i)                                                                 \
+  static void flush_##i(uint16_t session, uint16_t seq, const char* text) {                   \
+    const size_t n = strlen(text);                                                            \
+    auto* req = (ble_gatts_evt_write_t*)calloc(1, sizeof(ble_gatts_evt_write_t) + 4 + n);     \
+    req->op = BLE_GATTS_OP_WRITE_REQ;                                                         \
+    req->len = 4 + n;                                                                         \
+    ns::put_le16(&req->data[0], session);                                                     \
+    ns::put_le16(&req->data[2], seq);                                                         \
+    memcpy(&req->data[4], text, n);                                                           \
+    on_device(i, [&] { ns::flush_text_write_authorize_cb(0, nullptr, req); });                \
+    free(req);                                                                                \
+  }                                                                                           \
+  static uint8_t job_##i(std::initializer_list<uint8_t> bytes) {                              \
+    std::vector<uint8_t> data(bytes);                                                         \
+    on_device(i, [&] { ns::job_write_cb(0, nullptr, data.data(), data.size()); });            \
+    return ns::g_job_last_result;                                                             \
+  }                                                                                           \
+  static void step_##i() {                                                                    \
+    on_device(i, [&] {                                                                        \
+      const uint32_t t = g_fake_ms;                                                           \
+      ns::hid_task_iteration();                                                               \
+      if (!g_hid_log.empty() && g_first_key_ms[i] == 0) g_first_key_ms[i] = t;                \
+    });                                                                                       \
+  }
+DEVICE_HELPERS(dev0, 0)
+DEVICE_HELPERS(dev1, 1)
+DEVICE_HELPERS(dev2, 2)
+
+static void step_all(int n, uint32_t tick_ms = 0) {
+  for (int k = 0; k < n; k++) {
+    step_0();
+    step_1();
+    step_2();
+    g_fake_ms += tick_ms;
+  }
+}
+
+// a..z만 글자로 바꾼다.
+static std::string typed(int i) {
+  std::string s;
+  for (auto& e : g_logs[i]) {
+    unsigned mod, key;
+    if (sscanf(e.c_str(), "K %x %x", &mod, &key) == 2 && key >= HID_KEY_A && key <= HID_KEY_A + 25) {
+      s += char('a' + key - HID_KEY_A);
+    }
+  }
+  return s;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_synchronized_start(void) {
+  const uint16_t sid = 0x4242;
+  // OPEN: typing 10ms, flags=armed
+  TEST_ASSERT_EQUAL(0, job_0({1, 0x42, 0x42, 10, 0, 0, 0, 2, 0, 0, 0x04}));
+  TEST_ASSERT_EQUAL(0, job_1({1, 0x42, 0x42, 10, 0, 0, 0, 2, 0, 0, 0x04}));
+  TEST_ASSERT_EQUAL(0, job_2({1, 0x42, 0x42, 10, 0, 0, 0, 2, 0, 0, 0x04}));
+  flush_0(sid, 0, "hello");
+  flush_1(sid, 0, "hello");
+  flush_2(sid, 0, "hello");
+  step_all(50);
+
+  // armed: 받기만 하고 치지 않는다.
+  TEST_ASSERT_EQUAL_STRING("", typed(0).c_str());
+  TEST_ASSERT_EQUAL_STRING("", typed(1).c_str());
+  TEST_ASSERT_EQUAL_STRING("", typed(2).c_str());
+  TEST_ASSERT_TRUE(dev0::g_jobs[dev0::g_job_head].armed);
+  TEST_ASSERT_EQUAL(5, dev0::rb_used_bytes());
+
+  // 웹은 START를 몇 ms 간격으로 보내고, 그만큼 delay를 줄인다.
+  const uint32_t t0 = g_fake_ms;
+  job_0({3, 0x42, 0x42, 200, 0});
+  g_fake_ms += 7;
+  job_1({3, 0x42, 0x42, 193, 0});
+  g_fake_ms += 5;
+  job_2({3, 0x42, 0x42, 188, 0});
+  TEST_ASSERT_EQUAL(0, job_2({3, 0x42, 0x42, 50, 0}));  // 재전송된 START는 시작 시각을 바꾸지 않는다
+  TEST_ASSERT_EQUAL(200, dev0::g_jobs[dev0::g_job_head].start_at_ms - t0);
+  TEST_ASSERT_EQUAL(200, dev1::g_jobs[dev1::g_job_head].start_at_ms - t0);
+  TEST_ASSERT_EQUAL(200, dev2::g_jobs[dev2::g_job_head].start_at_ms - t0);
+  TEST_ASSERT_EQUAL(2, job_1({3, 0x99, 0x99, 0, 0}));  // 모르는 session
+
+  step_all(400, 1);
+  flush_0(sid, 1, " fleet");
+  flush_1(sid, 1, " fleet");
+  flush_2(sid, 1, " fleet");
+  step_all(2000);
+
+  // 세 장치가 fake 시계 하나를 같이 쓰므로(한 장치의 대기가 모두의 시간을 진행시킨다) 첫 키 시각은
+  // ms 단위로 비교하지 않는다. 같은 start_at보다 먼저 치지 않는 것만 본다.
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(200, g_first_key_ms[i] - t0);
+    TEST_ASSERT_EQUAL_STRING("hellofleet", typed(i).c_str());
+  }
+  TEST_ASSERT_FALSE(dev0::g_jobs[dev0::g_job_head].armed);
+}
+
+static void test_idle_budget_honours_scheduled_start(void) {
+  job_0({1, 0x10, 0x00, 0, 0, 0, 0, 0, 0, 0, 0x04});
+  flush_0(0x10, 0, "x");
+  job_0({3, 0x10, 0x00, 0x2c, 0x01});  // 300ms 뒤
+  dev0::jobs_advance_in_loop();
+  dev0::g_last_status_free = dev0::rb_free_bytes();
+
+  TEST_ASSERT_EQUAL_HEX16(0x0010, dev0::g_jobs[dev0::g_job_head].session_id);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(300, dev0::idle_wait_budget_ms());
+}
+
+static void test_cancel_armed_job_drops_bytes(void) {
+  g_logs[1].clear();
+  job_1({1, 0x11, 0x00, 0, 0, 0, 0, 0, 0, 0, 0x04});
+  flush_1(0x11, 0, "zz");
+  TEST_ASSERT_EQUAL(0, job_1({2, 0x11, 0x00}));
+  for (int k = 0; k < 20; k++) step_1();
+
+  TEST_ASSERT_EQUAL(0, dev1::rb_used_bytes());
+  TEST_ASSERT_EQUAL_STRING("", typed(1).c_str());
+}
+
+int main(int, char**) {
+  dev0::setup();
+  dev1::setup();
+  dev2::setup();
+  g_fake_ms = 1000;
+  UNITY_BEGIN();
+  RUN_TEST(test_synchronized_start);
+  RUN_TEST(test_idle_budget_honours_scheduled_start);
+  RUN_TEST(test_cancel_armed_job_drops_bytes);
+  return UNITY_END();
+}
@@ -0,0 +1,77 @@
+// Idle: HID task는 할 일이 없으면 폴링하지 않고 task notification에서 잔다.
+// fake_board의 대기는 타임아웃만큼 시간을 진행시키므로, 일정 시간 동안의 loop 횟수가 곧 깨어난 횟수다.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+static int iterations_for(uint32_t ms) {
+  const uint32_t start = g_fake_ms;
+  int n = 0;
+  while (g_fake_ms - start < ms) {
+    hid_task_iteration();
+    n++;
+  }
+  return n;
+}
+
+void setUp(void) {
+  g_fake_mounted = true;
+  g_fake_suspended = false;
+  fake_board_clear_logs();
+}
+
+void tearDown(void) {}
+
+static void test_idle_wakes_about_once_per_second(void) {
+  // 1ms 폴링이면 60000번이다.
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(70, (uint32_t)iterations_for(60000));
+}
+
+static void test_auto_scroll_wakes_per_interval(void) {
+  g_scroll_active = true;
+  g_scroll_interval_ms = 100;
+  g_scroll_last_ms = g_fake_ms;
+  const int n = iterations_for(1000);
+  g_scroll_active = false;
+
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(9, (uint32_t)n);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(12, (uint32_t)n);
+}
+
+static void test_macro_sleep_does_not_poll(void) {
+  // SLEEP 1000; END
+  const uint8_t prog[] = {0x05, 0xe8, 0x03, 0x00};
+  macro_push(0x08);
+  macro_push(sizeof prog);
+  for (uint8_t b : prog) macro_push(b);
+
+  const uint32_t t0 = g_fake_ms;
+  int n = 0;
+  while (n < 5000 && (g_macro_vm.active || macro_used_bytes())) {
+    hid_task_iteration();
+    n++;
+  }
+  TEST_ASSERT_FALSE(g_macro_vm.active);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1000, g_fake_ms - t0);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(10, (uint32_t)n);
+}
+
+static void test_unmounted_does_not_poll(void) {
+  g_fake_mounted = false;
+  rb_push('a');
+  const int n = iterations_for(60000);
+  g_fake_mounted = true;
+
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(70, (uint32_t)n);
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_wakes_about_once_per_second);
+  RUN_TEST(test_auto_scroll_wakes_per_interval);
+  RUN_TEST(test_macro_sleep_does_not_poll);
+  RUN_TEST(test_unmounted_does_not_poll);
+  return UNITY_END();
+}
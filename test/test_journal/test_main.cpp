@@ -0,0 +1,163 @@
+// Power-loss journal: 줄의 Enter 전에 checkpoint를 쓰고, 재부팅 후 그 줄 경계부터 이어서 치며, job이 끝나면 비운다.
+// 재부팅은 Flash(g_fs)만 같이 쓰는 두 번째 firmware instance로 흉내낸다.
+#define BF_INSTANCE before_reset
+#include "firmware_instance.h"
+#undef BF_INSTANCE
+#define BF_INSTANCE after_reset
+#include "firmware_instance.h"
+#undef BF_INSTANCE
+#include "fake_board.h"
+
+#include <unity.h>
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#define DEVICE_HELPERS(ns)                                                                \
+  static void ns##_flush(uint16_t session, uint16_t seq, const char* text) {              \
+    const size_t n = strlen(text);                                                        \
+    auto* req = (ble_gatts_evt_write_t*)calloc(1, sizeof(ble_gatts_evt_write_t) + 4 + n); \
+    req->op = BLE_GATTS_OP_WRITE_REQ;                                                     \
+    req->len = 4 + n;                                                                     \
+    ns::put_le16(&req->data[0], session);                                                 \
+    ns::put_le16(&req->data[2], seq);                                                     \
+    memcpy(&req->data[4], text, n);                                                       \
+    ns::flush_text_write_authorize_cb(0, nullptr, req);                                   \
+    free(req);                                                                            \
+  }                                                                                       \
+  static void ns##_run(int n) {                                                           \
+    for (int i = 0; i < n; i++) ns::hid_task_iteration();                                 \
+  }
+DEVICE_HELPERS(before_reset)
+DEVICE_HELPERS(after_reset)
+
+// a..z, Enter(|), journal 쓰기(J)만 남긴다.
+static std::string typed() {
+  std::string s;
+  for (auto& e : g_hid_log) {
+    if (e == "J") {
+      s += 'J';
+      continue;
+    }
+    unsigned mod, key;
+    if (sscanf(e.c_str(), "K %x %x", &mod, &key) != 2 || mod != 0) continue;
+    if (key >= HID_KEY_A && key <= HID_KEY_A + 25) s += char('a' + key - HID_KEY_A);
+    if (key == HID_KEY_ENTER) s += '|';
+  }
+  return s;
+}
+
+static uint8_t job(uint8_t op, uint16_t session) {
+  uint8_t data[3] = {op, uint8_t(session), uint8_t(session >> 8)};
+  after_reset::job_write_cb(0, nullptr, data, 3);
+  return after_reset::g_job_last_result;
+}
+
+static uint8_t journal_op(uint8_t op) {
+  uint8_t data[2] = {op, 1};
+  after_reset::journal_write_cb(0, nullptr, data, op == after_reset::kJournalOpResume ? 2 : 1);
+  after_reset_run(1);
+  return after_reset::g_journal_last_result;
+}
+
+void setUp(void) { fake_board_clear_logs(); }
+
+void tearDown(void) {}
+
+static void test_checkpoint_is_written_before_enter(void) {
+  before_reset::setup();
+  before_reset::jobs_restart(0);
+  before_reset_flush(7, 0, "abc\r\ndef\nghi\njk");
+  fake_board_clear_logs();
+  before_reset_run(10);
+
+  // 줄마다 checkpoint(J)가 그 줄의 Enter보다 먼저 Flash에 쓰인다. 여기서 전원이 끊긴다.
+  TEST_ASSERT_EQUAL_STRING("abcJ|defJ|g", typed().c_str());
+}
+
+static void test_resume_after_reset(void) {
+  g_fake_mounted = false;
+  after_reset::setup();
+
+  const auto& offer = after_reset::g_journal_offer;
+  TEST_ASSERT_TRUE(after_reset::g_journal_offer_valid);
+  TEST_ASSERT_EQUAL(7, offer.session_id);
+  TEST_ASSERT_EQUAL(9, offer.line_offset);  // "abc\r\ndef\n" 다음
+  TEST_ASSERT_EQUAL_HEX32(~after_reset::crc32_update(0xFFFFFFFF, (const uint8_t*)"abc\r\ndef\n", 9), offer.line_crc);
+
+  TEST_ASSERT_EQUAL(after_reset::kJournalResultNotReady, journal_op(after_reset::kJournalOpResume));
+  g_fake_mounted = true;
+  TEST_ASSERT_EQUAL(after_reset::kJournalResultOk, journal_op(after_reset::kJournalOpResume));
+  TEST_ASSERT_EQUAL(1, after_reset::g_job_count);
+  TEST_ASSERT_EQUAL(7, after_reset::g_jobs[after_reset::g_job_head].session_id);
+
+  // 웹은 offset부터 다시 보낸다. 반쯤 친 "g"는 rollback으로 지우고 줄 처음부터 친다.
+  after_reset_flush(7, 0, "ghi\nx");
+  fake_board_clear_logs();
+  after_reset_run(30);
+  TEST_ASSERT_EQUAL_STRING("ghiJ|x", typed().c_str());
+  TEST_ASSERT_EQUAL(14, after_reset::g_journal_offset);
+
+  TEST_ASSERT_EQUAL(after_reset::kJournalResultOk, journal_op(after_reset::kJournalOpDismiss));
+  TEST_ASSERT_TRUE(after_reset::g_journal_committed_kind == after_reset::JournalKind::None);
+}
+
+static void test_completed_job_clears_journal(void) {
+  job(after_reset::kJobOpOpen, 9);
+  after_reset_flush(9, 0, "ab\ncd");
+  job(after_reset::kJobOpClose, 9);
+  after_reset_run(10);
+  TEST_ASSERT_EQUAL(0, after_reset::g_job_count);
+  TEST_ASSERT_TRUE(after_reset::g_journal_committed_kind == after_reset::JournalKind::None);
+
+  // 다음 job으로 넘어갈 때도 앞 job의 레코드를 비운다.
+  job(after_reset::kJobOpOpen, 10);
+  job(after_reset::kJobOpOpen, 11);
+  after_reset_flush(10, 0, "x\ny");
+  after_reset_flush(11, 0, "z");
+  after_reset_run(4);
+  TEST_ASSERT_EQUAL(11, after_reset::g_jobs[after_reset::g_job_head].session_id);
+  TEST_ASSERT_TRUE(after_reset::g_journal_committed_kind == after_reset::JournalKind::None);
+}
+
+// OPEN [typing 5ms][mode 0][press 5ms][toggle 0][flags]
+static void open_with_flags(uint16_t session, uint8_t flags) {
+  uint8_t data[11] = {after_reset::kJobOpOpen, uint8_t(session), uint8_t(session >> 8), 5, 0, 0, 0, 5, 0, 0, flags};
+  after_reset::job_write_cb(0, nullptr, data, sizeof data);
+}
+
+static void test_plain_lines_are_batched(void) {
+  open_with_flags(12, 0);
+  after_reset_flush(12, 0, "a\nb\nc\nd");
+  g_fake_ms += 2000;  // 앞 레코드는 오래 전에 썼다
+  fake_board_clear_logs();
+  after_reset_run(12);
+
+  // 첫 줄만 바로 쓰고, 1초 안의 다음 줄들은 미뤘다가 큐가 비면 한 번에 쓴다.
+  TEST_ASSERT_EQUAL_STRING("aJ|b|c|dJ", typed().c_str());
+  TEST_ASSERT_EQUAL(6, after_reset::g_journal_pending.line_offset);
+  TEST_ASSERT_FALSE(after_reset::g_journal_pending_dirty);
+  job(after_reset::kJobOpCancel, 12);
+  after_reset_run(2);
+}
+
+static void test_line_sync_job_writes_every_line(void) {
+  open_with_flags(13, after_reset::kJobFlagLineSync);
+  after_reset_flush(13, 0, "a\nb\nc");
+  fake_board_clear_logs();
+  after_reset_run(10);
+  TEST_ASSERT_EQUAL_STRING("aJ|bJ|c", typed().c_str());
+  job(after_reset::kJobOpCancel, 13);
+  after_reset_run(2);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_checkpoint_is_written_before_enter);
+  RUN_TEST(test_resume_after_reset);
+  RUN_TEST(test_completed_job_clears_journal);
+  RUN_TEST(test_plain_lines_are_batched);
+  RUN_TEST(test_line_sync_job_writes_every_line);
+  return UNITY_END();
+}
@@ -0,0 +1,81 @@
+// Lock LED back-channel: Target PC의 bf_led(web/files.js)가 Scroll Lock(=1)/Num Lock(=0) 토글로 보낸
+// 16-bit 프레임 [1011][kind][seq(8)][check(3)]을 LED output report에서 복원한다.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+static uint8_t g_host_leds = 0;
+
+static void host_toggle(uint8_t bit) {
+  g_host_leds ^= bit;
+  g_fake_ms += 30;
+  hid_set_report_cb(kReportIdKeyboard, HID_REPORT_TYPE_OUTPUT, &g_host_leds, 1);
+}
+
+// web/files.js의 bf_led와 같은 인코딩. flip_bit >= 0이면 그 비트를 뒤집어 보낸다(전송 오류).
+static void bf_led(int kind, int seq, int flip_bit = -1) {
+  const int v = (kind << 8) | (seq & 255);
+  const int check = ((v & 7) + ((v >> 3) & 7) + ((v >> 6) & 7)) & 7;
+  const int frame = (11 << 12) | (v << 3) | check;
+  int scroll = 0, num = 0;
+  for (int b = 15; b >= 0; b--) {
+    int bit = (frame >> b) & 1;
+    if (b == flip_bit) bit ^= 1;
+    if (bit) {
+      host_toggle(KEYBOARD_LED_SCROLLLOCK);
+      scroll ^= 1;
+    } else {
+      host_toggle(KEYBOARD_LED_NUMLOCK);
+      num ^= 1;
+    }
+  }
+  // 원래 Lock 상태로 되돌린다.
+  if (scroll) host_toggle(KEYBOARD_LED_SCROLLLOCK);
+  if (num) host_toggle(KEYBOARD_LED_NUMLOCK);
+}
+
+void setUp(void) {
+  LedFrame f;
+  while (led_pop_frame(&f)) {
+  }
+  g_fake_ms += 5000;
+}
+
+void tearDown(void) {}
+
+static void test_frames_survive_noise_and_errors(void) {
+  hid_set_report_cb(kReportIdKeyboard, HID_REPORT_TYPE_OUTPUT, &g_host_leds, 1);  // 첫 상태
+  host_toggle(KEYBOARD_LED_CAPSLOCK);  // Caps Lock은 무시한다
+  host_toggle(KEYBOARD_LED_NUMLOCK);   // 사용자가 누른 Lock 키
+  host_toggle(KEYBOARD_LED_SCROLLLOCK);
+  bf_led(1, 0);
+  bf_led(0, 1);
+  bf_led(1, 300);    // seq는 8비트
+  bf_led(1, 5, 7);   // check가 맞지 않는 프레임은 버린다
+  bf_led(1, 6);
+
+  const LedFrame expected[] = {{1, 0}, {0, 1}, {1, 44}, {1, 6}};
+  LedFrame f;
+  for (const LedFrame& e : expected) {
+    TEST_ASSERT_TRUE(led_pop_frame(&f));
+    TEST_ASSERT_EQUAL(e.kind, f.kind);
+    TEST_ASSERT_EQUAL(e.seq, f.seq);
+  }
+  TEST_ASSERT_FALSE(led_pop_frame(&f));
+}
+
+static void test_report_id_prefixed_buffer(void) {
+  // 일부 스택은 report id를 버퍼 앞에 남긴 채 report_id=0으로 넘긴다.
+  g_host_leds ^= KEYBOARD_LED_NUMLOCK;
+  const uint8_t buf[2] = {kReportIdKeyboard, g_host_leds};
+  hid_set_report_cb(0, HID_REPORT_TYPE_OUTPUT, buf, 2);
+  TEST_ASSERT_EQUAL(g_host_leds, g_led_state);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_survive_noise_and_errors);
+  RUN_TEST(test_report_id_prefixed_buffer);
+  return UNITY_END();
+}
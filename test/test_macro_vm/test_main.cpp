@@ -0,0 +1,99 @@
+// Macro VM (Macro cmd 0x08 RUN_PROGRAM): 루프/chord/반복과 로드 시 검증.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+static void run_program(const std::vector<uint8_t>& prog) {
+  macro_push(0x08);
+  macro_push((uint8_t)prog.size());
+  for (uint8_t b : prog) macro_push(b);
+}
+
+static int run_until_idle(int max_iterations = 5000) {
+  int n = 0;
+  while (n < max_iterations && (g_macro_vm.active || macro_used_bytes())) {
+    hid_task_iteration();
+    n++;
+  }
+  return n;
+}
+
+// 키 입력만 본다 (지글러 같은 마우스 리포트는 뺀다).
+static std::vector<std::string> keys() {
+  std::vector<std::string> out;
+  for (auto& e : g_hid_log)
+    if (e[0] == 'K' || e[0] == 'R') out.push_back(e);
+  return out;
+}
+
+void setUp(void) { fake_board_clear_logs(); }
+
+void tearDown(void) {}
+
+static void test_loop_tap_type_sleep(void) {
+  // SET r0=3; L: TAP DOWN; DJNZ r0 L; TYPE "ab"; SLEEP 1000; END
+  const std::vector<uint8_t> prog = {0x07, 0, 3, 0, 0x01, 0, HID_KEY_ARROW_DOWN, 0x09, 0, 4,
+                                     0x04, 2, 'a', 'b', 0x05, 0xe8, 0x03, 0x00};
+  const uint32_t t0 = g_fake_ms;
+  run_program(prog);
+  run_until_idle();
+
+  TEST_ASSERT_FALSE(g_macro_vm.active);
+  const std::vector<std::string> k = keys();
+  TEST_ASSERT_EQUAL(10, k.size());
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL_STRING("K 00 51 00 00", k[i * 2].c_str());
+    TEST_ASSERT_EQUAL_STRING("R", k[i * 2 + 1].c_str());
+  }
+  TEST_ASSERT_EQUAL_STRING("K 00 04 00 00", k[6].c_str());
+  TEST_ASSERT_EQUAL_STRING("K 00 05 00 00", k[8].c_str());
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1000, g_fake_ms - t0);
+}
+
+static void test_chord_down_up(void) {
+  // DOWN Ctrl; TAPN c x2; UP all; END
+  const std::vector<uint8_t> prog = {0x02, KEYBOARD_MODIFIER_LEFTCTRL, 0, 0x08, 0, HID_KEY_C, 2, 0x03, 0, 0, 0x00};
+  run_program(prog);
+  run_until_idle();
+
+  TEST_ASSERT_FALSE(g_macro_vm.active);
+  const std::vector<std::string> k = keys();
+  TEST_ASSERT_TRUE(k.size() >= 4);
+  int chords = 0;
+  for (auto& e : k)
+    if (e == "K 01 06 00 00") chords++;
+  TEST_ASSERT_EQUAL(2, chords);
+  TEST_ASSERT_EQUAL_STRING("R", k.back().c_str());
+}
+
+static void test_invalid_program_does_not_run(void) {
+  // JMP past the end: 로드 시 검증에서 거절된다.
+  run_program({0x01, 0, HID_KEY_A, 0x0A, 200, 0x00});
+  run_until_idle();
+
+  TEST_ASSERT_FALSE(g_macro_vm.active);
+  TEST_ASSERT_EQUAL(0, keys().size());
+}
+
+static void test_infinite_loop_is_bounded(void) {
+  // L: JMP L — 스텝 상한에서 끝난다.
+  run_program({0x0A, 0});
+  const int n = run_until_idle(kMacroVmMaxSteps + 1000);
+
+  TEST_ASSERT_FALSE(g_macro_vm.active);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(kMacroVmMaxSteps + 10, (uint32_t)n);
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_loop_tap_type_sleep);
+  RUN_TEST(test_chord_down_up);
+  RUN_TEST(test_invalid_program_does_not_run);
+  RUN_TEST(test_infinite_loop_is_bounded);
+  return UNITY_END();
+}
@@ -0,0 +1,97 @@
+// Timing profiles: 프로필은 키 종류별 대기 표를 같이 저장하고, 적용하면(ACTIVATE / device timing job) 표도 되돌린다.
+// 표가 없던 BFP1 파일은 모두 typingDelay를 따르는 표로 읽는다.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+static void run(int n) {
+  for (int i = 0; i < n; i++) hid_task_iteration();
+}
+
+static void profile_request(const uint8_t* data, uint16_t len) {
+  profile_write_cb(0, nullptr, const_cast<uint8_t*>(data), len);
+  run(1);
+}
+
+// SAVE [slot][typing 20][mode 100][press 10][toggle 0][fingerprint 0][name 12][table]
+static void save_with_table(uint8_t slot, const char* name, const uint16_t (&table)[kKeyClassCount]) {
+  uint8_t data[kProfileSaveTableLen] = {kProfileOpSave, slot, 20, 0, 100, 0, 10, 0, 0, 0, 0};
+  memcpy(&data[11], name, strlen(name));
+  for (uint8_t i = 0; i < kKeyClassCount; i++) put_le16(&data[11 + kProfileNameMaxLen + 2 * i], table[i]);
+  profile_request(data, sizeof data);
+}
+
+// Config: typing 5, mode 0, press 5, toggle 0, flags 0 + 표
+static void config_with_table(const uint16_t (&table)[kKeyClassCount]) {
+  uint8_t data[8 + 2 * kKeyClassCount] = {5, 0, 0, 0, 5, 0, 0, 0};
+  for (uint8_t i = 0; i < kKeyClassCount; i++) put_le16(&data[8 + 2 * i], table[i]);
+  config_write_cb(0, nullptr, data, sizeof data);
+  run(1);
+}
+
+static void assert_table(const uint16_t (&expected)[kKeyClassCount]) {
+  for (uint8_t i = 0; i < kKeyClassCount; i++) TEST_ASSERT_EQUAL(expected[i], g_key_class_delay_ms[i]);
+}
+
+void setUp(void) { fake_board_clear_logs(); }
+
+void tearDown(void) {}
+
+static void test_activate_applies_the_table(void) {
+  const uint16_t table[kKeyClassCount] = {kKeyClassDelayFollow, 40, 300, 50, kKeyClassDelayFollow, 200};
+  save_with_table(0, "shell", table);
+  TEST_ASSERT_EQUAL(kProfileResultOk, g_profile_last_result);
+
+  const uint8_t activate[2] = {kProfileOpActivate, 0};
+  profile_request(activate, sizeof activate);
+  TEST_ASSERT_EQUAL(kProfileResultOk, g_profile_last_result);
+  assert_table(table);
+  TEST_ASSERT_EQUAL(20, g_typing_delay_ms);
+}
+
+static void test_device_timing_job_restores_the_table(void) {
+  const uint16_t profile_table[kKeyClassCount] = {kKeyClassDelayFollow, 40, 300, 50, kKeyClassDelayFollow, 200};
+  const uint16_t config_table[kKeyClassCount] = {1, 2, 3, 4, 5, 6};
+  config_with_table(config_table);
+  assert_table(config_table);
+
+  // OPEN [flags bit1 device timing]: 타이핑이 시작될 때 장치 프로필(표 포함)로 되돌린다.
+  uint8_t open[11] = {kJobOpOpen, 21, 0, 0, 0, 0, 0, 0, 0, 0, kJobFlagDeviceTiming};
+  job_write_cb(0, nullptr, open, sizeof open);
+  run(1);
+  assert_table(profile_table);
+  TEST_ASSERT_EQUAL(20, g_typing_delay_ms);
+
+  uint8_t cancel[3] = {kJobOpCancel, 21, 0};
+  job_write_cb(0, nullptr, cancel, sizeof cancel);
+  run(2);
+}
+
+static void test_v1_store_is_migrated(void) {
+  ProfileStoreV1 old = {};
+  old.magic = kProfileMagicV1;
+  old.active = 1;
+  old.entries[1].used = 1;
+  old.entries[1].typing_delay_ms = 33;
+  memcpy(old.entries[1].name, "legacy", 6);
+  old.crc = ~crc32_update(0xFFFFFFFF, reinterpret_cast<const uint8_t*>(&old), offsetof(ProfileStoreV1, crc));
+  g_fs[kProfileFilePath] = std::string(reinterpret_cast<const char*>(&old), sizeof old);
+
+  profiles_load();
+  TEST_ASSERT_EQUAL(1, g_profile_applied);
+  TEST_ASSERT_EQUAL(33, g_typing_delay_ms);
+  TEST_ASSERT_EQUAL_STRING("legacy", g_profiles.entries[1].name);
+  const uint16_t follow[kKeyClassCount] = {kKeyClassDelayFollow, kKeyClassDelayFollow, kKeyClassDelayFollow,
+                                           kKeyClassDelayFollow, kKeyClassDelayFollow, kKeyClassDelayFollow};
+  assert_table(follow);
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_activate_applies_the_table);
+  RUN_TEST(test_device_timing_job_restores_the_table);
+  RUN_TEST(test_v1_store_is_migrated);
+  return UNITY_END();
+}
@@ -0,0 +1,117 @@
+// Flush 통계 (fault-injection 벤치마크): 중복/재전송 패킷은 세기만 하고, 타이핑한 바이트의 CRC는 보낸 텍스트와 같다.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+static void flush_text(uint16_t session, uint16_t seq, const char* text) {
+  const size_t n = strlen(text);
+  auto* req = (ble_gatts_evt_write_t*)calloc(1, sizeof(ble_gatts_evt_write_t) + 4 + n);
+  req->op = BLE_GATTS_OP_WRITE_REQ;
+  req->len = 4 + n;
+  put_le16(&req->data[0], session);
+  put_le16(&req->data[2], seq);
+  memcpy(&req->data[4], text, n);
+  flush_text_write_authorize_cb(0, nullptr, req);
+  free(req);
+  // 웹은 응답을 받은 뒤에 다음 패킷을 보낸다(세워둔 패킷은 HID task가 적재하고 응답한다).
+  while (g_deferred_write.active) hid_task_iteration();
+}
+
+static void stats_op(uint8_t op, uint8_t arg) {
+  uint8_t data[2] = {op, arg};
+  stats_write_cb(0, nullptr, data, op == kStatsOpMute ? 2 : 1);
+}
+
+static void run(int n) {
+  for (int i = 0; i < n; i++) hid_task_iteration();
+}
+
+static int key_reports_sent() {
+  int n = 0;
+  for (auto& e : g_hid_log)
+    if (e[0] == 'K' || e[0] == 'R') n++;
+  return n;
+}
+
+void setUp(void) {
+  stats_op(kStatsOpReset, 0);
+  run(2);
+  fake_board_clear_logs();
+}
+
+void tearDown(void) {
+  stats_op(kStatsOpMute, 0);
+  run(2);
+}
+
+static void test_duplicates_are_counted_not_typed(void) {
+  stats_op(kStatsOpMute, 1);
+  run(2);
+  TEST_ASSERT_TRUE(g_hid_muted);
+
+  flush_text(9, 0, "ab");
+  flush_text(9, 0, "ab");  // ACK 유실 후 재전송
+  flush_text(9, 1, "C\n");
+  flush_text(9, 1, "C\n");
+  run(10);
+
+  TEST_ASSERT_EQUAL(2, g_stats.packets_accepted);
+  TEST_ASSERT_EQUAL(2, g_stats.packets_ignored);
+  TEST_ASSERT_EQUAL(4, g_stats.text_bytes);
+  TEST_ASSERT_EQUAL_HEX32(crc32_update(0xFFFFFFFF, (const uint8_t*)"abC\n", 4), g_stats.text_crc);
+  TEST_ASSERT_EQUAL(8, g_stats.key_reports);  // 4글자 x (press + release)
+  TEST_ASSERT_EQUAL(0, key_reports_sent());   // mute: 대상 PC에는 아무것도 치지 않는다
+}
+
+static void job_open(uint16_t session) {
+  uint8_t data[3] = {kJobOpOpen, 0, 0};
+  put_le16(&data[1], session);
+  job_write_cb(0, nullptr, data, sizeof(data));
+}
+
+static void test_non_tail_chunks_are_refused(void) {
+  stats_op(kStatsOpMute, 1);
+  run(2);
+
+  flush_text(11, 0, "a");
+  job_open(12);  // 뒤에 다른 job이 열렸다: 11은 더 이상 청크를 받지 않는다
+  g_auth_replies.clear();
+
+  flush_text(11, 0, "a");   // 이미 받은 seq: 조용히 성공
+  flush_text(11, 1, "b");   // 새 seq지만 tail이 아니다: 거절
+  flush_text(12, 1, "c");   // seq를 건너뛰었다: 거절
+  flush_text(13, 5, "d");   // 모르는 세션의 seq != 0: 거절
+  flush_text(12, 0, "e");
+  run(10);
+
+  TEST_ASSERT_EQUAL(5, g_auth_replies.size());
+  TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, g_auth_replies[0]);
+  TEST_ASSERT_EQUAL(kGattStatusChunkRefused, g_auth_replies[1]);
+  TEST_ASSERT_EQUAL(kGattStatusChunkRefused, g_auth_replies[2]);
+  TEST_ASSERT_EQUAL(kGattStatusChunkRefused, g_auth_replies[3]);
+  TEST_ASSERT_EQUAL(BLE_GATT_STATUS_SUCCESS, g_auth_replies[4]);
+  TEST_ASSERT_EQUAL(2, g_stats.packets_accepted);
+  TEST_ASSERT_EQUAL(4, g_stats.packets_ignored);
+  TEST_ASSERT_EQUAL_HEX32(crc32_update(0xFFFFFFFF, (const uint8_t*)"ae", 2), g_stats.text_crc);
+}
+
+static void test_reset_clears_counters(void) {
+  TEST_ASSERT_EQUAL(0, g_stats.packets_accepted);
+  TEST_ASSERT_EQUAL(0, g_stats.text_bytes);
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, g_stats.text_crc);
+
+  flush_text(10, 0, "x");
+  run(5);
+  TEST_ASSERT_EQUAL(1, g_stats.text_bytes);
+  TEST_ASSERT_EQUAL(2, key_reports_sent());  // mute가 아니면 그대로 친다
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_duplicates_are_counted_not_typed);
+  RUN_TEST(test_non_tail_chunks_are_refused);
+  RUN_TEST(test_reset_clears_counters);
+  return UNITY_END();
+}
@@ -0,0 +1,119 @@
+// USB suspend: 큐는 그대로 두고, 칠 것이 있을 때만 remote wakeup으로 호스트를 깨운다.
+#include "../../src/main.cpp"
+#include "fake_board.h"
+
+#include <unity.h>
+
+#include <string>
+
+static void flush_text(uint16_t session, uint16_t seq, const char* text) {
+  const size_t n = strlen(text);
+  auto* req = (ble_gatts_evt_write_t*)calloc(1, sizeof(ble_gatts_evt_write_t) + 4 + n);
+  req->op = BLE_GATTS_OP_WRITE_REQ;
+  req->len = 4 + n;
+  put_le16(&req->data[0], session);
+  put_le16(&req->data[2], seq);
+  memcpy(&req->data[4], text, n);
+  flush_text_write_authorize_cb(0, nullptr, req);
+  free(req);
+}
+
+static void run(int n) {
+  for (int i = 0; i < n; i++) hid_task_iteration();
+}
+
+// 마지막 status notify의 usbState(byte 14). notify가 없으면 -1.
+static int notified_usb_state() {
+  if (g_notifies.empty() || g_notifies.back().size() <= 14) return -1;
+  return g_notifies.back()[14];
+}
+
+static int key_reports() {
+  int n = 0;
+  for (auto& e : g_hid_log)
+    if (e[0] == 'K') n++;
+  return n;
+}
+
+static int iterations_for(uint32_t ms) {
+  const uint32_t start = g_fake_ms;
+  int n = 0;
+  while (g_fake_ms - start < ms) {
+    hid_task_iteration();
+    n++;
+  }
+  return n;
+}
+
+void setUp(void) {
+  g_fake_mounted = true;
+  g_fake_suspended = false;
+  g_fake_wakeup_allowed = true;
+  g_fake_wakeups = 0;
+  g_fake_resume_at = 0;
+  run(5);
+  fake_board_clear_logs();
+}
+
+void tearDown(void) {}
+
+static void test_idle_suspend_does_not_wake_host(void) {
+  g_fake_suspended = true;
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(70, (uint32_t)iterations_for(60000));
+  TEST_ASSERT_EQUAL(0, g_fake_wakeups);
+  TEST_ASSERT_EQUAL(0, key_reports());
+}
+
+static void test_queued_text_wakes_host_and_types(void) {
+  g_fake_suspended = true;
+  run(5);
+  flush_text(7, 0, "abc");
+  hid_task_iteration();
+  TEST_ASSERT_EQUAL(1, g_fake_wakeups);
+  TEST_ASSERT_EQUAL(kUsbStateSuspended | kUsbStateWakeupPending, notified_usb_state());
+  TEST_ASSERT_EQUAL(3, rb_used_bytes());
+
+  run(30);
+  TEST_ASSERT_FALSE(g_fake_suspended);
+  TEST_ASSERT_EQUAL(0, notified_usb_state());
+  TEST_ASSERT_EQUAL(0, rb_used_bytes());
+  TEST_ASSERT_EQUAL(3, key_reports());
+}
+
+static void test_refused_wakeup_holds_queue_until_resume(void) {
+  g_fake_wakeup_allowed = false;
+  g_fake_suspended = true;
+  flush_text(8, 0, "xyz");
+  run(20);
+  TEST_ASSERT_EQUAL(kUsbStateSuspended | kUsbStateWakeupRefused, notified_usb_state());
+  TEST_ASSERT_EQUAL(3, rb_used_bytes());
+  TEST_ASSERT_EQUAL(0, key_reports());
+
+  // 대기 중에도 폴링하지 않는다.
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(70, (uint32_t)iterations_for(60000));
+
+  g_fake_suspended = false;
+  run(30);
+  TEST_ASSERT_EQUAL(0, notified_usb_state());
+  TEST_ASSERT_EQUAL(0, rb_used_bytes());
+  TEST_ASSERT_EQUAL_STRING("K 00 1b 00 00", g_hid_log[0].c_str());  // x
+  TEST_ASSERT_EQUAL(3, key_reports());
+}
+
+static void test_suspend_between_press_and_release_wakes_host(void) {
+  g_fake_suspended = true;
+  TEST_ASSERT_TRUE(hid_report_keyboard_release());
+  TEST_ASSERT_EQUAL(1, g_fake_wakeups);
+  TEST_ASSERT_FALSE(g_fake_suspended);
+  TEST_ASSERT_EQUAL_STRING("R", g_hid_log.back().c_str());
+}
+
+int main(int, char**) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_suspend_does_not_wake_host);
+  RUN_TEST(test_queued_text_wakes_host_and_types);
+  RUN_TEST(test_refused_wakeup_holds_queue_until_resume);
+  RUN_TEST(test_suspend_between_press_and_release_wakes_host);
+  return UNITY_END();
+}
@@ -0,0 +1,203 @@
+// web/diff.js: the keystroke stream from buildDiffStream, applied to a line-buffer editor, turns the old
+// document into the new one exactly.
+//
+//     node --test test/web/
+//
+// The editor follows the model in the header of web/diff.js and throws on anything the stream must not rely on
+// (Down/Up away from column 0, Down past the last line, Right with a selection), so a stream that only works in
+// some editors fails here too.
+
+import assert from 'node:assert/strict';
+import { test } from 'node:test';
+
+import { KEY, buildDiffStream, hashLines, splitLines } from '../../web/diff.js';
+
+const MOD_CTRL = 0x01;
+const MOD_SHIFT = 0x02;
+const KEY_DEL = KEY.del;
+const INBAND_ESCAPE = 0xff;
+const INBAND_CHORD = 0x82;
+
+class Editor {
+  constructor(text) {
+    this.lines = splitLines(text);
+    this.row = 0;
+    this.col = 0;
+    this.anchor = null;
+  }
+
+  get text() {
+    return this.lines.join('\n');
+  }
+
+  hasSelection() {
+    return this.anchor != null && (this.anchor.row !== this.row || this.anchor.col !== this.col);
+  }
+
+  deleteSelection() {
+    const a = this.anchor;
+    this.anchor = null;
+    if (!a) return;
+    const [s, e] = a.row < this.row || (a.row === this.row && a.col <= this.col)
+      ? [a, { row: this.row, col: this.col }]
+      : [{ row: this.row, col: this.col }, a];
+    const head = this.lines[s.row].slice(0, s.col);
+    const tail = this.lines[e.row].slice(e.col);
+    this.lines.splice(s.row, e.row - s.row + 1, head + tail);
+    this.row = s.row;
+    this.col = s.col;
+  }
+
+  select(move) {
+    if (!this.anchor) this.anchor = { row: this.row, col: this.col };
+    move();
+  }
+
+  move(move) {
+    this.anchor = null;
+    move();
+  }
+
+  key(modifier, keycode) {
+    const last = this.lines.length - 1;
+    const ctrl = (modifier & MOD_CTRL) !== 0;
+    const shift = (modifier & MOD_SHIFT) !== 0;
+    const go = (fn) => (shift ? this.select(fn) : this.move(fn));
+    if (keycode === KEY.home && ctrl) {
+      go(() => { this.row = 0; this.col = 0; });
+    } else if (keycode === KEY.end && ctrl) {
+      go(() => { this.row = last; this.col = this.lines[last].length; });
+    } else if (keycode === KEY.home) {
+      go(() => { this.col = 0; });
+    } else if (keycode === KEY.end) {
+      go(() => { this.col = this.lines[this.row].length; });
+    } else if (keycode === KEY.down || keycode === KEY.up) {
+      assert.equal(this.col, 0, 'Down/Up from a column other than 0');
+      const to = this.row + (keycode === KEY.down ? 1 : -1);
+      assert.ok(to >= 0 && to <= last, 'Down/Up past the document');
+      go(() => { this.row = to; });
+    } else if (keycode === KEY.right && !shift) {
+      assert.ok(!this.hasSelection(), 'Right with a selection');
+      this.move(() => {
+        if (this.col < this.lines[this.row].length) this.col += 1;
+        else if (this.row < last) { this.row += 1; this.col = 0; }
+      });
+    } else if (keycode === KEY_DEL && !ctrl && !shift) {
+      if (this.hasSelection()) {
+        this.deleteSelection();
+      } else {
+        this.anchor = null;
+        const line = this.lines[this.row];
+        if (this.col < line.length) this.lines[this.row] = line.slice(0, this.col) + line.slice(this.col + 1);
+        else if (this.row < last) this.lines.splice(this.row, 2, line + this.lines[this.row + 1]);
+      }
+    } else {
+      assert.fail(`unexpected chord ${modifier}/${keycode}`);
+    }
+  }
+
+  type(text) {
+    if (this.hasSelection()) this.deleteSelection();
+    this.anchor = null;
+    for (const ch of text) {
+      const line = this.lines[this.row];
+      if (ch === '\n') {
+        this.lines.splice(this.row, 1, line.slice(0, this.col), line.slice(this.col));
+        this.row += 1;
+        this.col = 0;
+      } else {
+        this.lines[this.row] = line.slice(0, this.col) + ch + line.slice(this.col);
+        this.col += ch.length;
+      }
+    }
+  }
+
+  // Device stream: UTF-8 text and in-band CHORD sequences [0xFF][0x82][mod lo][mod hi][key lo][key hi].
+  play(bytes) {
+    const dec = new TextDecoder();
+    let text = [];
+    const flushText = () => {
+      if (text.length) this.type(dec.decode(Uint8Array.from(text)));
+      text = [];
+    };
+    for (let i = 0; i < bytes.length; i += 1) {
+      if (bytes[i] !== INBAND_ESCAPE) {
+        text.push(bytes[i]);
+        continue;
+      }
+      flushText();
+      assert.equal(bytes[i + 1], INBAND_CHORD);
+      const value = (at) => (bytes[at] & 0x7f) | ((bytes[at + 1] & 0x7f) << 7);
+      this.key(value(i + 2), value(i + 4));
+      i += 5;
+    }
+    flushText();
+  }
+}
+
+function retype(oldText, newText) {
+  const newLines = splitLines(newText);
+  const stream = buildDiffStream(hashLines(splitLines(oldText)), newLines);
+  const editor = new Editor(oldText);
+  // The cursor may start anywhere: the stream begins with Ctrl+Home.
+  editor.row = editor.lines.length - 1;
+  editor.col = editor.lines[editor.row].length;
+  editor.play(stream.bytes);
+  assert.equal(editor.text, newLines.join('\n'), `${JSON.stringify(oldText)} -> ${JSON.stringify(newText)}`);
+  return stream;
+}
+
+test('insert at the end of the document', () => {
+  retype('a\nb', 'a\nb\nc');
+  retype('a\nb\n', 'a\nb\nc\n');
+  retype('a', 'a\n\n');
+});
+
+test('delete the last line', () => {
+  retype('a\nb\nc', 'a\nb');
+  retype('a\nb\nc\n', 'a\nb\n');
+  retype('a\nb', 'a');
+  retype('a\n', 'a');
+});
+
+test('empty documents', () => {
+  retype('', 'x\ny');
+  retype('x\ny', '');
+  retype('', '');
+  retype('\n', '');
+});
+
+test('CRLF input', () => {
+  retype('one\r\ntwo\r\nthree\r\n', 'one\r\n2\r\nthree\r\nfour\r\n');
+  retype('one\ntwo\n', 'one\r\ntwo\r\nthree');
+  assert.equal(retype('a\r\nb', 'a\nb').bytes.length, 6); // same lines: only the Ctrl+Home chord
+});
+
+test('trailing newline added and removed', () => {
+  retype('a\nb', 'a\nb\n');
+  retype('a\nb\n', 'a\nb');
+  retype('a\nb\n\n', 'a\nb\n');
+  retype('x\na\nb\n', 'a\nb\n');
+});
+
+test('changes in the middle', () => {
+  retype('a\nb\nc\nd\ne', 'a\nB\nc\nd2\nd3\ne');
+  retype('a\nb\nc\nd\ne', 'a\ne');
+  retype('a\nb\nc', 'z\na\nb\nc');
+  retype('한글\n줄\n', '한글\n바뀐 줄\n');
+});
+
+// Small alphabets make many equal lines, so the LCS pairs them in every order.
+test('random edits', () => {
+  let seed = 12345;
+  const rand = (n) => {
+    seed = (Math.imul(seed, 1103515245) + 12345) >>> 0;
+    return (seed >>> 8) % n;
+  };
+  const doc = () => {
+    const lines = [];
+    for (let i = rand(7); i > 0; i -= 1) lines.push(['', 'a', 'b', 'cc'][rand(4)]);
+    return lines.join(['\n', '\r\n'][rand(2)]) + (rand(2) ? '\n' : '');
+  };
+  for (let i = 0; i < 2000; i += 1) retype(doc(), doc());
+});
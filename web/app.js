@@ -185,4 +185,15 @@ export async function main() {
   window.addEventListener('hashchange', async () => {
     await switchRoute(getRoute());
   });
+
+  // Developer tool: ?bench exposes the fault-injection benchmark and the firmware microbenchmarks on the console.
+  if (new URLSearchParams(location.search).has('bench')) {
+    const bench = await import('./bench.js');
+    window.byteFlusherBench = {
+      run: bench.runFaultBench,
+      scenarios: bench.BENCH_SCENARIOS,
+      micro: bench.runMicroBench,
+      saveMicroBaseline: bench.saveMicroBenchBaseline,
+    };
+  }
 }
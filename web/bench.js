@@ -0,0 +1,344 @@
+// ByteFlusher fault-injection goodput benchmark (developer tool)
+// Drives the real device over BLE with scripted transport faults and checks the outcome with the
+// firmware Stats characteristic (see src/main.cpp "Flush 통계"):
+//   - textCrc/textBytes: the bytes the device actually typed must equal the text that was sent
+//   - keyCrc: the keyboard report stream must equal the fault-free run
+// Open the app with ?bench and run `await byteFlusherBench.run()` in the DevTools console.
+// By default the device counts keyboard reports without sending them (mute), so nothing is typed
+// on the Target PC. The device still has to be plugged into USB (typing waits for the HID mount).
+//
+// `await byteFlusherBench.micro()` runs the firmware microbenchmarks (Stats op MICROBENCH: decoder,
+// packet ingest, ring buffer and ascii_to_hid, timed on the device CPU) and compares them with a stored
+// baseline. `byteFlusherBench.saveMicroBaseline(rows)` stores a run as the baseline (localStorage) and
+// returns it as JSON, so a baseline per board/firmware can also be kept and passed in as `baseline`.
+// The repo keeps one baseline per PlatformIO env in bench/microbench-baseline.json; save the rows
+// (`copy(rows)`) and gate them with scripts/check_microbench.py (exits 1 past the threshold).
+
+import * as ble from './ble.js';
+
+const FLUSH_HEADER_SIZE = 4;
+const DONE_TIMEOUT_MS = 60000;
+const MICRO_BASELINE_KEY = 'byteflusher.bench.microBaseline';
+// A case fails when its median is this much slower than the baseline (0.15 = 15%).
+const MICRO_DEFAULT_THRESHOLD = 0.15;
+
+export const BENCH_SCENARIOS = Object.freeze([
+  'clean',              // baseline: in-order packets, no faults
+  'duplicate',          // every packet is written twice
+  'lostAck',            // some packets are written again later (as if their ACK was lost)
+  'reconnect',          // drop the connection while a write is in flight, then retry the same seq
+  'pauseStorm',         // rapid pause/resume config writes between packets
+  'abortBackpressure',  // abort while a write is held by backpressure, then send the text again
+]);
+
+// Small deterministic PRNG so a run can be repeated with the same fault placement.
+function makeRandom(seed) {
+  let a = seed >>> 0;
+  return () => {
+    a = (a + 0x6d2b79f5) >>> 0;
+    let t = a;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+function sleep(ms) {
+  return new Promise((r) => setTimeout(r, ms));
+}
+
+function defaultBenchText() {
+  const lines = [];
+  for (let i = 1; i <= 60; i += 1) {
+    lines.push(`Write-Host 'line ${i}: The quick brown fox' # 한글 테스트 ${i}\tend`);
+  }
+  return lines.join('\n') + '\n';
+}
+
+function buildPacket(sessionId, seq, payload) {
+  const packet = new Uint8Array(FLUSH_HEADER_SIZE + payload.length);
+  packet[0] = sessionId & 0xff;
+  packet[1] = (sessionId >> 8) & 0xff;
+  packet[2] = seq & 0xff;
+  packet[3] = (seq >> 8) & 0xff;
+  packet.set(payload, FLUSH_HEADER_SIZE);
+  return packet;
+}
+
+// [typingDelayMs][modeSwitchDelayMs][keyPressDelayMs][toggleKey][flags(bit0 pause, bit1 abort)]
+function buildConfig(timing, flags) {
+  const buf = new Uint8Array(8);
+  const put16 = (at, v) => {
+    buf[at] = v & 0xff;
+    buf[at + 1] = (v >> 8) & 0xff;
+  };
+  put16(0, timing.typingDelayMs);
+  put16(2, timing.modeSwitchDelayMs);
+  put16(4, timing.keyPressDelayMs);
+  buf[6] = 0;
+  buf[7] = flags;
+  return buf;
+}
+
+async function bounceConnection() {
+  ble.disconnect();
+  for (let i = 0; i < 40 && ble.isConnected(); i += 1) await sleep(50);
+  for (let attempt = 0; ; attempt += 1) {
+    try {
+      await ble.reconnect();
+      return;
+    } catch (err) {
+      if (attempt >= 10) throw err;
+      await sleep(300);
+    }
+  }
+}
+
+// Writes one packet; on failure reconnects and retries the same packet (same rule as text.js).
+async function writeReliable(packet, counters) {
+  for (;;) {
+    const startedAt = performance.now();
+    try {
+      await ble.getChar(ble.FLUSH_TEXT_CHAR_UUID).writeValue(packet);
+      const took = performance.now() - startedAt;
+      if (took > 50) counters.webStallMs += took;
+      return;
+    } catch {
+      counters.retries += 1;
+      if (!ble.isConnected()) await bounceConnection();
+      await sleep(50);
+    }
+  }
+}
+
+async function waitTyped(totalBytes) {
+  const startedAt = performance.now();
+  for (;;) {
+    const s = await ble.statsCommand(ble.STATS_OP.snapshot);
+    if (s && s.textBytes >= totalBytes) return s;
+    if (performance.now() - startedAt > DONE_TIMEOUT_MS) return s;
+    await sleep(100);
+  }
+}
+
+async function sendWithFaults(bytes, scenario, { chunkSize, timing, rand }) {
+  const counters = { webStallMs: 0, retries: 0, injected: 0 };
+  const sessionId = 1 + Math.floor(rand() * 0xfffe);
+  let prevPacket = null;
+  let seq = 0;
+
+  for (let offset = 0; offset < bytes.length; ) {
+    const chunk = bytes.subarray(offset, offset + chunkSize);
+    const packet = buildPacket(sessionId, seq, chunk);
+
+    if (scenario === 'reconnect' && seq > 0 && rand() < 0.1) {
+      // The write may or may not reach the device before the link drops; the retry must not duplicate it.
+      counters.injected += 1;
+      ble.getChar(ble.FLUSH_TEXT_CHAR_UUID).writeValue(packet).catch(() => {});
+      await bounceConnection();
+    }
+
+    await writeReliable(packet, counters);
+
+    if (scenario === 'duplicate') {
+      counters.injected += 1;
+      await writeReliable(packet, counters);
+    } else if (scenario === 'lostAck' && prevPacket && rand() < 0.3) {
+      counters.injected += 1;
+      await writeReliable(prevPacket, counters);
+    } else if (scenario === 'pauseStorm' && rand() < 0.3) {
+      counters.injected += 1;
+      const toggles = 1 + Math.floor(rand() * 4);
+      for (let i = 0; i < toggles; i += 1) {
+        await ble.writeConfig(buildConfig(timing, 0x01));
+        await sleep(Math.floor(rand() * 20));
+        await ble.writeConfig(buildConfig(timing, 0x00));
+      }
+    }
+
+    prevPacket = packet;
+    offset += chunk.length;
+    seq += 1;
+  }
+  return counters;
+}
+
+// Fill the paused device queue until a write is held by backpressure, then abort.
+// The held write must complete and nothing from the aborted session may be typed.
+async function abortUnderBackpressure(bytes, { chunkSize, timing, rand }) {
+  const sessionId = 1 + Math.floor(rand() * 0xfffe);
+  await ble.writeConfig(buildConfig(timing, 0x01));
+  let seq = 0;
+  let held = null;
+  for (let guard = 0; guard < 2000 && !held; guard += 1) {
+    const chunk = bytes.subarray(0, chunkSize);
+    const write = ble.getChar(ble.FLUSH_TEXT_CHAR_UUID).writeValue(buildPacket(sessionId, seq, chunk));
+    const result = await Promise.race([write.then(() => 'done'), sleep(300).then(() => 'held')]);
+    if (result === 'held') held = write;
+    seq += 1;
+  }
+  await ble.writeConfig(buildConfig(timing, 0x02));
+  let heldCompleted = held != null;
+  try {
+    await Promise.race([held, sleep(3000).then(() => Promise.reject(new Error('held write did not complete')))]);
+  } catch {
+    heldCompleted = false;
+  }
+  await sleep(200);
+  const after = await ble.statsCommand(ble.STATS_OP.snapshot);
+  return { heldCompleted, typedWhilePaused: after ? after.textBytes : -1 };
+}
+
+/**
+ * Run the fault-injection benchmark against the connected device.
+ * @param {{text?:string, chunkSize?:number, scenarios?:string[], mute?:boolean, seed?:number}} [options]
+ * @returns {Promise<Array<object>>} one row per scenario (also printed with console.table)
+ */
+export async function runFaultBench(options = {}) {
+  if (!ble.isConnected() || !ble.getChar(ble.STATS_CHAR_UUID) || !ble.getChar(ble.CONFIG_CHAR_UUID)) {
+    throw new Error('bench: connect a device with the Stats characteristic first');
+  }
+
+  const text = options.text ?? defaultBenchText();
+  const bytes = new TextEncoder().encode(text);
+  const chunkSize = Math.max(1, Math.min(200, options.chunkSize ?? 100));
+  const scenarios = options.scenarios ?? BENCH_SCENARIOS;
+  const mute = options.mute ?? true;
+  const rand = makeRandom(options.seed ?? 1);
+  // Muted runs measure the transport, so typing delays are zero; unmuted runs keep safe defaults.
+  const timing = mute
+    ? { typingDelayMs: 0, modeSwitchDelayMs: 0, keyPressDelayMs: 0 }
+    : { typingDelayMs: 30, modeSwitchDelayMs: 100, keyPressDelayMs: 10 };
+  const expectedCrc = ble.crc32(bytes);
+  const ctx = { chunkSize, timing, rand };
+
+  await ble.statsCommand(ble.STATS_OP.mute, mute ? 1 : 0);
+  const rows = [];
+  let baselineKeyCrc = null;
+
+  try {
+    for (const scenario of scenarios) {
+      if (!BENCH_SCENARIOS.includes(scenario)) throw new Error(`bench: unknown scenario '${scenario}'`);
+      await ble.writeConfig(buildConfig(timing, 0x00));
+
+      let abortInfo = null;
+      if (scenario === 'abortBackpressure') {
+        await ble.statsCommand(ble.STATS_OP.reset);
+        abortInfo = await abortUnderBackpressure(bytes, ctx);
+        await ble.writeConfig(buildConfig(timing, 0x00));
+      }
+
+      await ble.statsCommand(ble.STATS_OP.reset);
+      const startedAt = performance.now();
+      const counters = await sendWithFaults(bytes, abortInfo ? 'clean' : scenario, ctx);
+      const s = await waitTyped(bytes.length);
+      const elapsedMs = performance.now() - startedAt;
+      // Late duplicates must not type anything extra.
+      await sleep(300);
+      const settled = (await ble.statsCommand(ble.STATS_OP.snapshot)) ?? s;
+
+      if (scenario === 'clean') baselineKeyCrc = settled.keyCrc;
+      const textOk = settled.textBytes === bytes.length && settled.textCrc === expectedCrc;
+      const keyOk = baselineKeyCrc == null || settled.keyCrc === baselineKeyCrc;
+      const abortOk = !abortInfo || (abortInfo.heldCompleted && abortInfo.typedWhilePaused === 0);
+      rows.push({
+        scenario,
+        ok: textOk && keyOk && abortOk,
+        textOk,
+        keyOk,
+        abortOk,
+        bytes: settled.textBytes,
+        elapsedMs: Math.round(elapsedMs),
+        goodputBps: Math.round((bytes.length * 1000) / Math.max(1, elapsedMs)),
+        deviceStallMs: settled.stallMs,
+        webStallMs: Math.round(counters.webStallMs),
+        faults: counters.injected,
+        retries: counters.retries,
+        accepted: settled.packetsAccepted,
+        ignored: settled.packetsIgnored,
+        deferred: settled.packetsDeferred,
+        busy: settled.busyRejects,
+        keyReports: settled.keyReports,
+      });
+    }
+  } finally {
+    await ble.statsCommand(ble.STATS_OP.mute, 0);
+    await ble.writeConfig(buildConfig({ typingDelayMs: 30, modeSwitchDelayMs: 100, keyPressDelayMs: 10 }, 0x00));
+  }
+
+  console.table(rows);
+  return rows;
+}
+
+function median(values) {
+  const sorted = [...values].sort((a, b) => a - b);
+  return sorted[Math.floor(sorted.length / 2)];
+}
+
+/** Baseline saved with saveMicroBenchBaseline(), or null. */
+export function loadMicroBenchBaseline() {
+  try {
+    const raw = localStorage.getItem(MICRO_BASELINE_KEY);
+    return raw ? JSON.parse(raw) : null;
+  } catch {
+    return null;
+  }
+}
+
+/**
+ * Store a microbenchmark run (the rows returned by runMicroBench) as the baseline.
+ * @returns {string} the baseline as JSON
+ */
+export function saveMicroBenchBaseline(rows) {
+  const baseline = {};
+  for (const r of rows) baseline[r.case] = r.ns;
+  const json = JSON.stringify(baseline);
+  localStorage.setItem(MICRO_BASELINE_KEY, json);
+  return json;
+}
+
+/**
+ * Run the firmware microbenchmarks and gate them against a baseline.
+ * Each case is measured `runs` times on the device and the median is compared.
+ * @param {{runs?:number, baseline?:Record<string,number>|null, threshold?:number, throwOnRegression?:boolean}} [options]
+ * @returns {Promise<Array<object>>} one row per case (also printed with console.table)
+ */
+export async function runMicroBench(options = {}) {
+  if (!ble.isConnected() || !ble.getChar(ble.STATS_CHAR_UUID)) {
+    throw new Error('bench: connect a device with the Stats characteristic first');
+  }
+  const runs = Math.max(1, Math.min(15, options.runs ?? 5));
+  const threshold = options.threshold ?? MICRO_DEFAULT_THRESHOLD;
+  const baseline = options.baseline === undefined ? loadMicroBenchBaseline() : options.baseline;
+
+  const samples = {};
+  for (let i = 0; i < runs; i += 1) {
+    const s = await ble.statsCommand(ble.STATS_OP.microbench);
+    if (!s || !s.microbench) throw new Error('bench: firmware has no microbenchmarks (1.2.18+)');
+    if (s.microbenchRefused) throw new Error('bench: device is flushing; run the microbenchmarks while idle');
+    for (const [name, ns] of Object.entries(s.microbench)) (samples[name] ??= []).push(ns);
+  }
+
+  const rows = Object.entries(samples).map(([name, values]) => {
+    const ns = median(values);
+    const base = baseline?.[name];
+    const ratio = Number.isFinite(base) && base > 0 ? ns / base : null;
+    return {
+      case: name,
+      ns,
+      min: Math.min(...values),
+      max: Math.max(...values),
+      baseline: base ?? null,
+      change: ratio == null ? null : `${ratio >= 1 ? '+' : ''}${Math.round((ratio - 1) * 1000) / 10}%`,
+      ok: ratio == null || ratio <= 1 + threshold,
+    };
+  });
+
+  console.table(rows);
+  if (!baseline) console.info('bench: no baseline yet; store this run with byteFlusherBench.saveMicroBaseline(rows)');
+  const regressed = rows.filter((r) => !r.ok);
+  if (regressed.length > 0 && (options.throwOnRegression ?? true)) {
+    throw new Error(`bench: regression over ${Math.round(threshold * 100)}%: ${regressed.map((r) => `${r.case} ${r.change}`).join(', ')}`);
+  }
+  return rows;
+}
@@ -16,6 +16,14 @@ export const MACRO_CHAR_UUID       = 'f3641404-00b0-4240-ba50-05ca45bf8abc';
 export const BOOTLOADER_CHAR_UUID  = 'f3641405-00b0-4240-ba50-05ca45bf8abc';
 export const NICKNAME_CHAR_UUID    = 'f3641406-00b0-4240-ba50-05ca45bf8abc';
 export const SCROLL_CHAR_UUID      = 'f3641407-00b0-4240-ba50-05ca45bf8abc';
+export const CACHE_CHAR_UUID       = 'f3641408-00b0-4240-ba50-05ca45bf8abc';
+export const ESTIMATE_CHAR_UUID    = 'f3641409-00b0-4240-ba50-05ca45bf8abc';
+export const JOB_CHAR_UUID         = 'f364140a-00b0-4240-ba50-05ca45bf8abc';
+export const JOURNAL_CHAR_UUID     = 'f364140b-00b0-4240-ba50-05ca45bf8abc';
+export const STATS_CHAR_UUID       = 'f364140c-00b0-4240-ba50-05ca45bf8abc';
+export const TARGET_CHAR_UUID      = 'f364140d-00b0-4240-ba50-05ca45bf8abc';
+export const PROFILE_CHAR_UUID     = 'f364140e-00b0-4240-ba50-05ca45bf8abc';
+export const DOC_CHAR_UUID         = 'f364140f-00b0-4240-ba50-05ca45bf8abc';
 
 // ---------------------------------------------------------------------------
 // Internal state
@@ -30,13 +38,25 @@ const chars = {};
 let deviceBufCapacity = null;
 let deviceBufFree     = null;
 let deviceBufUpdatedAt = 0;
+// Remaining typing time of the device queue (firmware dry-run), null on legacy firmware
+let deviceQueueEtaMs  = null;
+// Negotiated BLE connection parameters reported in status, null on older firmware
+let deviceConnParams  = null;
+let deviceUsbState    = null;
+let deviceLink        = null;
 let statusWaiters = [];
 
+// Macro VM version reported by the macro characteristic (0 = legacy firmware, no VM)
+let macroVmVersion = 0;
+// In-band flush control version (second macro characteristic byte, 0 = unsupported)
+let inbandVersion = 0;
+
 // Simple array-based event system
 const listeners = {
   connect:    [],
   disconnect: [],
   status:     [],
+  target:     [],
 };
 
 // ---------------------------------------------------------------------------
@@ -90,6 +110,23 @@ export function getChar(uuid) {
   return chars[uuid] ?? null;
 }
 
+/**
+ * Macro VM bytecode version supported by the device (0 if unsupported).
+ * @returns {number}
+ */
+export function getMacroVmVersion() {
+  return macroVmVersion;
+}
+
+/**
+ * In-band flush control version supported by the device (0 if unsupported).
+ * Only send inband*() sequences when this is >= 1: older firmware would type their bytes.
+ * @returns {number}
+ */
+export function getInbandVersion() {
+  return inbandVersion;
+}
+
 // ---------------------------------------------------------------------------
 // Buffer State (Flow Control)
 // ---------------------------------------------------------------------------
@@ -106,6 +143,52 @@ export function getDeviceBufUpdatedAt() {
   return deviceBufUpdatedAt;
 }
 
+export function getDeviceQueueEtaMs() {
+  return deviceQueueEtaMs;
+}
+
+/**
+ * Connection parameters negotiated by the device (status bytes 8..13).
+ * The firmware requests a fast interval during jobs and a relaxed one when idle.
+ * @returns {{intervalMs:number, slaveLatency:number, supervisionTimeoutMs:number}|null}
+ */
+export function getDeviceConnParams() {
+  return deviceConnParams;
+}
+
+/**
+ * Target PC USB state from status byte 14 (firmware 1.2.20+), or null on older firmware.
+ * suspended: the Target PC is asleep, the device keeps the queue and does not type;
+ * wakeupPending: a remote wakeup was sent and the device waits for the resume;
+ * wakeupRefused: the host did not enable remote wakeup (wake the Target PC by hand).
+ * @returns {{suspended:boolean, wakeupPending:boolean, wakeupRefused:boolean}|null}
+ */
+export function getDeviceUsbState() {
+  return deviceUsbState;
+}
+
+/**
+ * This connection's role from status byte 15 (firmware 1.2.22+), or null on older firmware.
+ * The first connection that writes becomes the writer; the others are read-only observers
+ * (status/telemetry only) until the writer disconnects. Their write requests fail with
+ * "write not permitted" (firmware 1.2.26+); write-without-response is refused here because the
+ * device cannot answer it.
+ * @returns {{writer:boolean, writerPresent:boolean, connections:number}|null}
+ */
+export function getDeviceLink() {
+  return deviceLink;
+}
+
+/** True when another connection holds write access (this one is an observer). */
+export function isReadOnlyObserver() {
+  return !!deviceLink && deviceLink.writerPresent && !deviceLink.writer;
+}
+
+// Write-without-response gets no ATT error, so an observer's write would be dropped silently.
+function assertWriter() {
+  if (isReadOnlyObserver()) throw new Error(t('error.observerReadOnly'));
+}
+
 export async function readStatusOnce() {
   const statusChar = chars[STATUS_CHAR_UUID];
   if (!statusChar) return;
@@ -141,15 +224,54 @@ function resolveStatusWaiters() {
   }
 }
 
+/**
+ * Decode a status characteristic value (also used by fleet.js for its own connections).
+ * @param {DataView} dataView
+ * @returns {{capacity:number, free:number, queueEtaMs:number|null, connParams:object|null, usb:object|null,
+ *            link:object|null}|null}
+ */
+export function parseStatusValue(dataView) {
+  if (!dataView || dataView.byteLength < 4) return null;
+  return {
+    capacity: dataView.getUint16(0, true),
+    free: dataView.getUint16(2, true),
+    queueEtaMs: dataView.byteLength >= 8 ? dataView.getUint32(4, true) : null,
+    connParams: dataView.byteLength >= 14 && dataView.getUint16(8, true) > 0
+      ? {
+        intervalMs: dataView.getUint16(8, true) * 1.25,
+        slaveLatency: dataView.getUint16(10, true),
+        supervisionTimeoutMs: dataView.getUint16(12, true) * 10,
+      }
+      : null,
+    usb: dataView.byteLength >= 15
+      ? {
+        suspended: (dataView.getUint8(14) & 0x01) !== 0,
+        wakeupPending: (dataView.getUint8(14) & 0x02) !== 0,
+        wakeupRefused: (dataView.getUint8(14) & 0x04) !== 0,
+      }
+      : null,
+    link: dataView.byteLength >= 16
+      ? {
+        writer: (dataView.getUint8(15) & 0x01) !== 0,
+        writerPresent: (dataView.getUint8(15) & 0x02) !== 0,
+        connections: dataView.getUint8(15) >> 4,
+      }
+      : null,
+  };
+}
+
 function handleStatusValue(dataView) {
-  if (!dataView || dataView.byteLength < 4) return;
-  const cap  = dataView.getUint16(0, true);
-  const free = dataView.getUint16(2, true);
-  if (Number.isFinite(cap)  && cap  > 0)  deviceBufCapacity = cap;
-  if (Number.isFinite(free) && free >= 0) deviceBufFree     = free;
+  const st = parseStatusValue(dataView);
+  if (!st) return;
+  if (Number.isFinite(st.capacity) && st.capacity > 0) deviceBufCapacity = st.capacity;
+  if (Number.isFinite(st.free) && st.free >= 0) deviceBufFree = st.free;
+  deviceQueueEtaMs = st.queueEtaMs;
+  deviceConnParams = st.connParams;
+  deviceUsbState = st.usb;
+  deviceLink = st.link;
   deviceBufUpdatedAt = performance.now();
   resolveStatusWaiters();
-  emit('status', { capacity: deviceBufCapacity, free: deviceBufFree });
+  emit('status', { capacity: deviceBufCapacity, free: deviceBufFree, connParams: deviceConnParams, usb: deviceUsbState, link: deviceLink });
 }
 
 function clearConnectionState() {
@@ -160,6 +282,12 @@ function clearConnectionState() {
   deviceBufCapacity  = null;
   deviceBufFree      = null;
   deviceBufUpdatedAt = 0;
+  deviceQueueEtaMs   = null;
+  deviceConnParams   = null;
+  deviceUsbState     = null;
+  deviceLink         = null;
+  macroVmVersion     = 0;
+  inbandVersion      = 0;
   resolveStatusWaiters();
 }
 
@@ -180,6 +308,13 @@ async function acquireCharacteristics(service) {
     BOOTLOADER_CHAR_UUID,
     NICKNAME_CHAR_UUID,
     SCROLL_CHAR_UUID,
+    CACHE_CHAR_UUID,
+    ESTIMATE_CHAR_UUID,
+    JOB_CHAR_UUID,
+    JOURNAL_CHAR_UUID,
+    STATS_CHAR_UUID,
+    PROFILE_CHAR_UUID,
+    DOC_CHAR_UUID,
   ];
   for (const uuid of optionalUuids) {
     try {
@@ -189,6 +324,19 @@ async function acquireCharacteristics(service) {
     }
   }
 
+  // Macro char is readable on firmware with the Macro VM: [macroVmVersion(u8)][inbandVersion(u8)]
+  macroVmVersion = 0;
+  inbandVersion = 0;
+  if (chars[MACRO_CHAR_UUID]) {
+    try {
+      const v = await chars[MACRO_CHAR_UUID].readValue();
+      if (v && v.byteLength >= 1) macroVmVersion = v.getUint8(0);
+      if (v && v.byteLength >= 2) inbandVersion = v.getUint8(1);
+    } catch {
+      // Legacy firmware: write-only macro characteristic
+    }
+  }
+
   // Status char: optional, but needs notifications
   try {
     const statusChar = await service.getCharacteristic(STATUS_CHAR_UUID);
@@ -201,6 +349,867 @@ async function acquireCharacteristics(service) {
   } catch {
     delete chars[STATUS_CHAR_UUID];
   }
+
+  // Target char: optional, Lock LED ACK/NACK frames arrive as notifications
+  try {
+    const targetChar = await service.getCharacteristic(TARGET_CHAR_UUID);
+    chars[TARGET_CHAR_UUID] = targetChar;
+    targetChar.addEventListener('characteristicvaluechanged', (ev) => {
+      const frame = parseTargetFrame(ev?.target?.value);
+      if (frame) emit('target', frame);
+    });
+    await targetChar.startNotifications();
+  } catch {
+    delete chars[TARGET_CHAR_UUID];
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Config (timing / pause / abort)
+// ---------------------------------------------------------------------------
+
+/**
+ * Write the config characteristic.
+ * Firmware that defers flush/macro write responses (backpressure) also accepts config as
+ * write-without-response, so pause/abort is not queued behind a pending flush write.
+ * @param {Uint8Array} payload
+ */
+export async function writeConfig(payload) {
+  const configChar = chars[CONFIG_CHAR_UUID];
+  if (!configChar) throw new Error(t('error.noConfigChar'));
+  if (configChar.properties?.writeWithoutResponse) {
+    assertWriter();
+    await configChar.writeValueWithoutResponse(payload);
+    return;
+  }
+  await configChar.writeValue(payload);
+}
+
+// ---------------------------------------------------------------------------
+// In-band flush controls (escaped sequences inside the flush text stream)
+// ---------------------------------------------------------------------------
+// [0xFF][op][args]: op and every argument byte have bit7 set, values are u14 as two 7-bit bytes (LE).
+// The device runs them in stream order with the text, so waits are timed on the device.
+
+export const INBAND_OP = Object.freeze({ wait: 0x81, chord: 0x82, mode: 0x83, waitIdle: 0x84 });
+export const INBAND_MODE = Object.freeze({ english: 0, korean: 1, assumeEnglish: 2, assumeKorean: 3 });
+const kInbandEscape = 0xff;
+const kInbandMaxValue = 0x3fff;
+
+function inbandSequence(op, values) {
+  const out = [kInbandEscape, op];
+  for (const raw of values) {
+    const v = Math.max(0, Math.min(kInbandMaxValue, Math.floor(Number(raw) || 0)));
+    out.push(0x80 | (v & 0x7f), 0x80 | (v >> 7));
+  }
+  return out;
+}
+
+/**
+ * Device-timed wait. Waits longer than one sequence allows (16383 ms) are split.
+ * @param {number} ms
+ * @returns {Uint8Array}
+ */
+export function inbandWait(ms) {
+  const out = [];
+  let left = Math.max(0, Math.floor(Number(ms) || 0));
+  while (left > 0) {
+    const step = Math.min(kInbandMaxValue, left);
+    out.push(...inbandSequence(INBAND_OP.wait, [step]));
+    left -= step;
+  }
+  return Uint8Array.from(out);
+}
+
+/**
+ * Wait until the host has picked up the last key report and the keyboard was quiet for `quietMs`.
+ * @param {number} quietMs
+ * @returns {Uint8Array}
+ */
+export function inbandWaitIdle(quietMs) {
+  return Uint8Array.from(inbandSequence(INBAND_OP.waitIdle, [quietMs]));
+}
+
+/**
+ * One key chord (HID modifier bits + usage id); the English/Korean mode is left as is.
+ * @param {number} modifier
+ * @param {number} keycode
+ * @returns {Uint8Array}
+ */
+export function inbandChord(modifier, keycode) {
+  return Uint8Array.from(inbandSequence(INBAND_OP.chord, [modifier & 0xff, keycode & 0xff]));
+}
+
+/**
+ * Force (or, with assume*, only re-sync without a keystroke) the English/Korean input mode.
+ * @param {number} mode one of INBAND_MODE
+ * @returns {Uint8Array}
+ */
+export function inbandMode(mode) {
+  return Uint8Array.from(inbandSequence(INBAND_OP.mode, [mode]));
+}
+
+// ---------------------------------------------------------------------------
+// Payload cache (content-addressed, stored on the device)
+// ---------------------------------------------------------------------------
+
+export const CACHE_OP = Object.freeze({ query: 0x01, begin: 0x02, data: 0x03, commit: 0x04, clear: 0x05, typeCached: 0x09 });
+export const CACHE_RESULT = Object.freeze({ ok: 0, miss: 1, noSpace: 2, hashMismatch: 3, ioError: 4, badRequest: 5, busy: 6 });
+const kCacheStateMagic = 0xca;
+const kCacheDataChunk = 200;
+
+function parseCacheState(v) {
+  if (!v || v.byteLength < 10 || v.getUint8(0) !== kCacheStateMagic) return null;
+  return {
+    lastOp: v.getUint8(1),
+    lastResult: v.getUint8(2),
+    playing: v.getUint8(3) !== 0,
+    entryCount: v.getUint8(4),
+    opCount: v.getUint8(5),
+    usedBytes: v.getUint16(6, true),
+    budgetBytes: v.getUint16(8, true),
+  };
+}
+
+/**
+ * Read the cache characteristic state, or null when unsupported.
+ * @returns {Promise<{lastOp:number,lastResult:number,playing:boolean,entryCount:number,opCount:number,usedBytes:number,budgetBytes:number}|null>}
+ */
+export async function readCacheState() {
+  const cacheChar = chars[CACHE_CHAR_UUID];
+  if (!cacheChar) return null;
+  return parseCacheState(await cacheChar.readValue());
+}
+
+// The write response can reach the browser before the device has handled the write,
+// so re-read until opCount moves past the value seen before the write.
+async function cacheCommand(bytes, timeoutMs = 3000) {
+  const cacheChar = chars[CACHE_CHAR_UUID];
+  if (!cacheChar) throw new Error(t('error.noCacheChar'));
+  const before = await readCacheState();
+  if (!before) throw new Error(t('error.noCacheChar'));
+  await cacheChar.writeValue(bytes);
+
+  const startedAt = performance.now();
+  for (;;) {
+    const s = await readCacheState();
+    if (s && s.opCount !== before.opCount) return s;
+    if (performance.now() - startedAt > timeoutMs) throw new Error(t('error.cacheTimeout'));
+    await new Promise((r) => setTimeout(r, 30));
+  }
+}
+
+/**
+ * @param {Uint8Array} hash SHA-256 (32 bytes)
+ * @returns {Promise<boolean>} true when the payload is already stored on the device.
+ */
+export async function cacheHas(hash) {
+  const s = await cacheCommand(Uint8Array.of(CACHE_OP.query, ...hash));
+  return s.lastResult === CACHE_RESULT.ok;
+}
+
+/**
+ * Store a payload under its SHA-256. The device verifies the hash before committing.
+ * @param {Uint8Array} hash
+ * @param {Uint8Array} bytes
+ * @returns {Promise<number>} CACHE_RESULT code (ok on success)
+ */
+export async function cacheStore(hash, bytes) {
+  const n = bytes.length;
+  const begin = new Uint8Array(37);
+  begin[0] = CACHE_OP.begin;
+  begin.set(hash, 1);
+  begin[33] = n & 0xff;
+  begin[34] = (n >> 8) & 0xff;
+  begin[35] = (n >> 16) & 0xff;
+  begin[36] = (n >>> 24) & 0xff;
+  let s = await cacheCommand(begin);
+  if (s.lastResult !== CACHE_RESULT.ok) return s.lastResult;
+
+  for (let off = 0; off < n; off += kCacheDataChunk) {
+    const part = bytes.subarray(off, off + kCacheDataChunk);
+    const pkt = new Uint8Array(1 + part.length);
+    pkt[0] = CACHE_OP.data;
+    pkt.set(part, 1);
+    s = await cacheCommand(pkt);
+    if (s.lastResult !== CACHE_RESULT.ok) return s.lastResult;
+  }
+
+  s = await cacheCommand(Uint8Array.of(CACHE_OP.commit));
+  return s.lastResult;
+}
+
+// ---------------------------------------------------------------------------
+// Job queue (multi-session: next job uploads while the current one types)
+// ---------------------------------------------------------------------------
+
+export const JOB_OP = Object.freeze({ open: 0x01, cancel: 0x02, start: 0x03, close: 0x04 });
+export const JOB_RESULT = Object.freeze({ ok: 0, full: 1, unknown: 2, badRequest: 3 });
+const kJobStateMagic = 0xb0;
+
+export function parseJobState(v) {
+  if (!v || v.byteLength < 5 || v.getUint8(0) !== kJobStateMagic) return null;
+  const count = v.getUint8(4);
+  const jobs = [];
+  for (let i = 0; i < count && 5 + i * 5 + 5 <= v.byteLength; i += 1) {
+    const o = 5 + i * 5;
+    const flags = v.getUint8(o + 4);
+    jobs.push({
+      sessionId: v.getUint16(o, true),
+      queuedBytes: v.getUint16(o + 2, true),
+      typing: (flags & 0x01) !== 0,
+      cancelled: (flags & 0x02) !== 0,
+      hasTiming: (flags & 0x04) !== 0,
+      clipboardPaste: (flags & 0x08) !== 0,
+      deviceTiming: (flags & 0x10) !== 0,
+      armed: (flags & 0x20) !== 0,
+      closed: (flags & 0x40) !== 0,
+    });
+  }
+  return { opCount: v.getUint8(1), lastOp: v.getUint8(2), lastResult: v.getUint8(3), jobs };
+}
+
+/**
+ * Read the device job queue, or null when unsupported (older firmware).
+ * @returns {Promise<{opCount:number,lastOp:number,lastResult:number,jobs:Array<{sessionId:number,queuedBytes:number,typing:boolean,cancelled:boolean,hasTiming:boolean,clipboardPaste:boolean,deviceTiming:boolean,armed:boolean,closed:boolean}>}|null>}
+ */
+export async function readJobState() {
+  const jobChar = chars[JOB_CHAR_UUID];
+  if (!jobChar) return null;
+  return parseJobState(await jobChar.readValue());
+}
+
+/**
+ * Whether the device still takes Flush chunks for sessionId: only the last (tail) job does.
+ * The device refuses other chunks with ATT 0x81; Web Bluetooth does not expose the code, so the
+ * sender calls this after a failed write to tell a refusal from a transient error.
+ * @param {number} sessionId
+ * @returns {Promise<boolean|null>} null when unknown (older firmware or read failed)
+ */
+export async function jobAcceptsChunks(sessionId) {
+  let state = null;
+  try {
+    state = await readJobState();
+  } catch {
+    return null;
+  }
+  if (!state) return null;
+  const tail = state.jobs[state.jobs.length - 1];
+  return tail != null && tail.sessionId === sessionId;
+}
+
+// Same read-back rule as the cache: wait until opCount moves past the value seen before the write.
+async function jobCommand(bytes, timeoutMs = 3000) {
+  const jobChar = chars[JOB_CHAR_UUID];
+  const before = await readJobState();
+  if (!jobChar || !before) return null;
+  await jobChar.writeValue(bytes);
+
+  const startedAt = performance.now();
+  for (;;) {
+    const s = await readJobState();
+    if (s && s.opCount !== before.opCount) return s;
+    if (performance.now() - startedAt > timeoutMs) return null;
+    await new Promise((r) => setTimeout(r, 30));
+  }
+}
+
+/**
+ * Job OPEN packet (see openJob). armed: the device buffers the job and waits for START before typing it.
+ * keyClassDelays: optional per-key-class delay table (u16 x6, 0xFFFF = typing delay), same as config.
+ * lineSync: the lines are commands; the device journals each line before its Enter (never re-run after a reset)
+ * instead of batching checkpoints (firmware 1.2.35+).
+ * @param {number} sessionId
+ * @param {{typingDelayMs:number,modeSwitchDelayMs:number,keyPressDelayMs:number,toggleKeyId:number,keyClassDelays?:number[],clipboardPaste?:boolean,deviceTiming?:boolean,armed?:boolean,lineSync?:boolean}|null} timing
+ * @returns {Uint8Array}
+ */
+export function buildOpenJobPacket(sessionId, timing) {
+  const classes = timing?.keyClassDelays ?? [];
+  const pkt = new Uint8Array(timing ? 11 + 2 * classes.length : 3);
+  pkt[0] = JOB_OP.open;
+  pkt[1] = sessionId & 0xff;
+  pkt[2] = (sessionId >> 8) & 0xff;
+  if (timing) {
+    const put16 = (at, v) => {
+      pkt[at] = v & 0xff;
+      pkt[at + 1] = (v >> 8) & 0xff;
+    };
+    put16(3, timing.typingDelayMs);
+    put16(5, timing.modeSwitchDelayMs);
+    put16(7, timing.keyPressDelayMs);
+    pkt[9] = timing.toggleKeyId & 0xff;
+    pkt[10] =
+      (timing.clipboardPaste ? 0x01 : 0) | (timing.deviceTiming ? 0x02 : 0) | (timing.armed ? 0x04 : 0) | (timing.lineSync ? 0x08 : 0);
+    classes.forEach((v, i) => put16(11 + 2 * i, v));
+  }
+  return pkt;
+}
+
+/**
+ * Job START packet: an armed job starts typing delayMs after the device receives it (max 5000).
+ * @param {number} sessionId
+ * @param {number} delayMs
+ * @returns {Uint8Array}
+ */
+export function buildStartJobPacket(sessionId, delayMs) {
+  const d = Math.max(0, Math.min(5000, Math.round(Number(delayMs) || 0)));
+  return Uint8Array.of(JOB_OP.start, sessionId & 0xff, (sessionId >> 8) & 0xff, d & 0xff, (d >> 8) & 0xff);
+}
+
+/**
+ * Job CLOSE packet: the upload is complete (see closeJob).
+ * @param {number} sessionId
+ * @returns {Uint8Array}
+ */
+export function buildCloseJobPacket(sessionId) {
+  return Uint8Array.of(JOB_OP.close, sessionId & 0xff, (sessionId >> 8) & 0xff);
+}
+
+/**
+ * Register a flush session as a queued job (appended without aborting the current one).
+ * @param {number} sessionId
+ * @param {{typingDelayMs:number,modeSwitchDelayMs:number,keyPressDelayMs:number,toggleKeyId:number,clipboardPaste?:boolean,deviceTiming?:boolean,armed?:boolean}|null} timing
+ *   applied by the device when this job starts typing. clipboardPaste lets the device paste
+ *   expensive text through the Windows clipboard in batches. deviceTiming makes the device keep its applied
+ *   timing profile instead (older firmware ignores the flags byte and uses the timing sent here).
+ *   armed holds the job until startJob (firmware 1.2.15+).
+ * @returns {Promise<number|null>} JOB_RESULT code, or null when the firmware has no job queue
+ */
+export async function openJob(sessionId, timing) {
+  const s = await jobCommand(buildOpenJobPacket(sessionId, timing));
+  return s ? s.lastResult : null;
+}
+
+/**
+ * Start an armed job after delayMs.
+ * @param {number} sessionId
+ * @param {number} [delayMs]
+ * @returns {Promise<number|null>} JOB_RESULT code, or null when the firmware has no job queue
+ */
+export async function startJob(sessionId, delayMs = 0) {
+  const s = await jobCommand(buildStartJobPacket(sessionId, delayMs));
+  return s ? s.lastResult : null;
+}
+
+/**
+ * Mark a job's upload as complete. Once its last byte is typed the device drops the job and clears
+ * the power-loss journal, so a finished run leaves no resume offer (firmware 1.2.29+).
+ * @param {number} sessionId
+ * @returns {Promise<number|null>} JOB_RESULT code, or null when the firmware has no job queue
+ */
+export async function closeJob(sessionId) {
+  const s = await jobCommand(buildCloseJobPacket(sessionId));
+  return s ? s.lastResult : null;
+}
+
+/**
+ * Cancel one job (its queued bytes are dropped; other jobs keep typing).
+ * Sent without response when possible so it is not queued behind a held flush write.
+ * @param {number} sessionId
+ */
+export async function cancelJob(sessionId) {
+  const jobChar = chars[JOB_CHAR_UUID];
+  if (!jobChar) return;
+  const pkt = Uint8Array.of(JOB_OP.cancel, sessionId & 0xff, (sessionId >> 8) & 0xff);
+  if (jobChar.properties?.writeWithoutResponse) {
+    assertWriter();
+    await jobChar.writeValueWithoutResponse(pkt);
+    return;
+  }
+  await jobChar.writeValue(pkt);
+}
+
+// ---------------------------------------------------------------------------
+// Power-loss journal (resume typing after a device reset)
+// ---------------------------------------------------------------------------
+
+export const JOURNAL_KIND = Object.freeze({ none: 0, text: 1, cache: 2 });
+export const JOURNAL_RESULT = Object.freeze({ ok: 0, noOffer: 1, notReady: 2, busy: 3, missing: 4, badRequest: 5 });
+// Line rollback before resuming: none / ESC (PowerShell, cmd) / Shift+Home then Backspace (editors)
+export const JOURNAL_ROLLBACK = Object.freeze({ none: 0, esc: 1, selectLine: 2 });
+const kJournalStateMagic = 0xb1;
+
+let crc32Table = null;
+
+/**
+ * CRC-32 (IEEE), same as the firmware journal checkpoint.
+ * @param {Uint8Array} bytes
+ * @returns {number} unsigned 32-bit CRC
+ */
+export function crc32(bytes) {
+  if (!crc32Table) {
+    crc32Table = new Uint32Array(256);
+    for (let i = 0; i < 256; i += 1) {
+      let c = i;
+      for (let k = 0; k < 8; k += 1) c = (c >>> 1) ^ (0xedb88320 & -(c & 1));
+      crc32Table[i] = c >>> 0;
+    }
+  }
+  let c = 0xffffffff;
+  for (let i = 0; i < bytes.length; i += 1) c = crc32Table[(c ^ bytes[i]) & 0xff] ^ (c >>> 8);
+  return (c ^ 0xffffffff) >>> 0;
+}
+
+function parseJournalState(v) {
+  if (!v || v.byteLength < 51 || v.getUint8(0) !== kJournalStateMagic) return null;
+  return {
+    opCount: v.getUint8(1),
+    lastOp: v.getUint8(2),
+    lastResult: v.getUint8(3),
+    kind: v.getUint8(4),
+    usbMounted: v.getUint8(5) !== 0,
+    sessionId: v.getUint16(6, true),
+    lineOffset: v.getUint32(8, true),
+    lineCrc: v.getUint32(12, true),
+    koreanMode: v.getUint8(16) !== 0,
+    lineDelayMs: v.getUint16(17, true),
+    cacheHash: new Uint8Array(v.buffer, v.byteOffset + 19, 32).slice(),
+  };
+}
+
+/**
+ * Read the resume offer left by a reset, or null when unsupported (older firmware).
+ * kind is JOURNAL_KIND.none when there is nothing to resume.
+ */
+export async function readResumeOffer() {
+  const journalChar = chars[JOURNAL_CHAR_UUID];
+  if (!journalChar) return null;
+  return parseJournalState(await journalChar.readValue());
+}
+
+async function journalCommand(bytes, timeoutMs = 5000) {
+  const journalChar = chars[JOURNAL_CHAR_UUID];
+  const before = await readResumeOffer();
+  if (!journalChar || !before) return null;
+  await journalChar.writeValue(bytes);
+
+  const startedAt = performance.now();
+  for (;;) {
+    const s = await readResumeOffer();
+    if (s && s.opCount !== before.opCount) return s;
+    if (performance.now() - startedAt > timeoutMs) return null;
+    await new Promise((r) => setTimeout(r, 30));
+  }
+}
+
+/**
+ * Resume from the last checkpoint. For a text offer the device reopens the job under the offered
+ * sessionId; send bytes from lineOffset with seq starting at 0.
+ * @param {number} rollback JOURNAL_ROLLBACK value
+ * @returns {Promise<number|null>} JOURNAL_RESULT code, or null when unsupported / timed out
+ */
+export async function resumeJob(rollback) {
+  const s = await journalCommand(Uint8Array.of(0x01, rollback & 0xff));
+  return s ? s.lastResult : null;
+}
+
+/** Drop the resume offer. */
+export async function dismissResume() {
+  const s = await journalCommand(Uint8Array.of(0x02));
+  return s ? s.lastResult : null;
+}
+
+// ---------------------------------------------------------------------------
+// Flush statistics (fault-injection benchmark)
+// ---------------------------------------------------------------------------
+
+const kStatsStateMagic = 0xb2;
+export const STATS_OP = Object.freeze({ snapshot: 0x01, reset: 0x02, mute: 0x03, microbench: 0x04 });
+// Order of the MICROBENCH results in the stats value (firmware MicroBenchCase, 1.2.18+).
+export const MICROBENCH_CASES = Object.freeze([
+  'decodeAscii',      // ns/byte
+  'decodeKorean',     // ns/byte
+  'decodeMalformed',  // ns/byte
+  'ingest20',         // ns/packet (20-byte payload)
+  'ingest100',        // ns/packet
+  'ingest240',        // ns/packet
+  'ringPushPop',      // ns/byte
+  'asciiToHid',       // ns/lookup
+]);
+
+function parseStatsState(v) {
+  if (!v || v.byteLength < 44 || v.getUint8(0) !== kStatsStateMagic) return null;
+  const u32 = (at) => v.getUint32(at, true);
+  return {
+    opCount: v.getUint8(1),
+    muted: (v.getUint8(2) & 0x01) !== 0,
+    packetsAccepted: u32(4),
+    packetsIgnored: u32(8),
+    packetsDeferred: u32(12),
+    busyRejects: u32(16),
+    stallMs: u32(20),
+    textBytes: u32(24),
+    textCrc: u32(28),
+    keyReports: u32(32),
+    keyCrc: u32(36),
+    elapsedMs: u32(40),
+    microbenchRefused: (v.getUint8(2) & 0x02) !== 0,
+    microbenchRuns: v.byteLength >= 48 ? v.getUint8(44) : 0,
+    microbench: parseMicroBench(v),
+  };
+}
+
+function parseMicroBench(v) {
+  if (v.byteLength < 48) return null;
+  const out = {};
+  const count = Math.min(v.getUint8(45), MICROBENCH_CASES.length, Math.floor((v.byteLength - 48) / 4));
+  for (let i = 0; i < count; i += 1) out[MICROBENCH_CASES[i]] = v.getUint32(48 + 4 * i, true);
+  return out;
+}
+
+/**
+ * Run a stats op (executed by the device HID task) and return the counters published after it.
+ * @param {number} op STATS_OP value
+ * @param {number} [arg] MUTE: 1 = count keyboard reports without sending them
+ * @returns {Promise<object|null>} null when unsupported (older firmware) or timed out
+ */
+export async function statsCommand(op, arg = 0) {
+  const statsChar = chars[STATS_CHAR_UUID];
+  if (!statsChar) return null;
+  const before = parseStatsState(await statsChar.readValue());
+  if (!before) return null;
+  await statsChar.writeValue(op === STATS_OP.mute ? Uint8Array.of(op, arg ? 1 : 0) : Uint8Array.of(op));
+
+  const startedAt = performance.now();
+  for (;;) {
+    const s = parseStatsState(await statsChar.readValue());
+    if (s && s.opCount !== before.opCount) return s;
+    if (performance.now() - startedAt > 3000) return null;
+    await new Promise((r) => setTimeout(r, 30));
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Target back-channel (Lock LED ACK/NACK frames decoded by the firmware)
+// ---------------------------------------------------------------------------
+
+const kTargetStateMagic = 0xb3;
+
+// [0xB3][kind(1=ACK,0=NACK)][chunkSeq(u8)][ledState(u8)][frameCount(u16)][ackCount(u16)][nackCount(u16)]
+function parseTargetFrame(v) {
+  if (!v || v.byteLength < 10 || v.getUint8(0) !== kTargetStateMagic) return null;
+  return {
+    ack: v.getUint8(1) === 1,
+    seq: v.getUint8(2),
+    ledState: v.getUint8(3),
+    frameCount: v.getUint16(4, true),
+    ackCount: v.getUint16(6, true),
+    nackCount: v.getUint16(8, true),
+  };
+}
+
+// ---------------------------------------------------------------------------
+// Timing profiles (stored on the device, applied at boot / by USB host fingerprint)
+// ---------------------------------------------------------------------------
+
+export const PROFILE_OP = Object.freeze({ save: 0x01, delete: 0x02, activate: 0x03, autoSelect: 0x04 });
+export const PROFILE_RESULT = Object.freeze({ ok: 0, badRequest: 1, empty: 2, ioError: 3, busy: 4 });
+export const PROFILE_SOURCE = Object.freeze({ none: 0, boot: 1, fingerprint: 2, activate: 3 });
+export const PROFILE_NONE = 0xff;
+export const PROFILE_SLOTS = 8;
+const kProfileStateMagic = 0xb4;
+const kProfileEntryLen = 22;
+const kProfileTableLen = 12; // key-class table per slot, after all entries (firmware 1.2.36+)
+
+function parseProfileState(v) {
+  if (!v || v.byteLength < 10 || v.getUint8(0) !== kProfileStateMagic) return null;
+  const profiles = [];
+  for (let slot = 0; slot < PROFILE_SLOTS && 10 + (slot + 1) * kProfileEntryLen <= v.byteLength; slot += 1) {
+    const o = 10 + slot * kProfileEntryLen;
+    if (v.getUint8(o) === 0) continue;
+    const tableAt = 10 + PROFILE_SLOTS * kProfileEntryLen + slot * kProfileTableLen;
+    const keyClassDelays =
+      tableAt + kProfileTableLen <= v.byteLength ? Array.from({ length: 6 }, (_, i) => v.getUint16(tableAt + 2 * i, true)) : null;
+    let name = '';
+    for (let i = 0; i < 12; i += 1) {
+      const c = v.getUint8(o + 10 + i);
+      if (c === 0) break;
+      name += String.fromCharCode(c);
+    }
+    profiles.push({
+      slot,
+      name,
+      toggleKeyId: v.getUint8(o + 1),
+      typingDelayMs: v.getUint16(o + 2, true),
+      modeSwitchDelayMs: v.getUint16(o + 4, true),
+      keyPressDelayMs: v.getUint16(o + 6, true),
+      fingerprint: v.getUint16(o + 8, true),
+      keyClassDelays,
+    });
+  }
+  return {
+    opCount: v.getUint8(1),
+    lastOp: v.getUint8(2),
+    lastResult: v.getUint8(3),
+    active: v.getUint8(4),
+    autoSelect: (v.getUint8(5) & 0x01) !== 0,
+    usbMounted: (v.getUint8(5) & 0x02) !== 0,
+    applied: v.getUint8(6),
+    appliedSource: v.getUint8(7),
+    fingerprint: v.getUint16(8, true),
+    keyClassTables: v.byteLength >= 10 + PROFILE_SLOTS * (kProfileEntryLen + kProfileTableLen),
+    profiles,
+  };
+}
+
+/**
+ * Read the device timing profiles, or null when unsupported (older firmware).
+ * `fingerprint` identifies the USB host the device is plugged into (0 until it is known).
+ * `keyClassTables` is true when profiles carry the key-class delay table (keyClassDelays, null on older firmware).
+ * @returns {Promise<{opCount:number,lastOp:number,lastResult:number,active:number,autoSelect:boolean,usbMounted:boolean,applied:number,appliedSource:number,fingerprint:number,keyClassTables:boolean,profiles:Array<{slot:number,name:string,toggleKeyId:number,typingDelayMs:number,modeSwitchDelayMs:number,keyPressDelayMs:number,fingerprint:number,keyClassDelays:number[]|null}>}|null>}
+ */
+export async function readProfileState() {
+  const profileChar = chars[PROFILE_CHAR_UUID];
+  if (!profileChar) return null;
+  return parseProfileState(await profileChar.readValue());
+}
+
+// The device writes flash in its HID task; wait until opCount moves past the value seen before the write.
+async function profileCommand(bytes) {
+  const profileChar = chars[PROFILE_CHAR_UUID];
+  const before = await readProfileState();
+  if (!profileChar || !before) return null;
+  await profileChar.writeValue(bytes);
+
+  const startedAt = performance.now();
+  for (;;) {
+    const s = await readProfileState();
+    if (s && s.opCount !== before.opCount) return s;
+    if (performance.now() - startedAt > 3000) return null;
+    await new Promise((r) => setTimeout(r, 30));
+  }
+}
+
+/**
+ * Store a timing profile in a device slot.
+ * @param {number} slot 0..PROFILE_SLOTS-1
+ * @param {{name:string,typingDelayMs:number,modeSwitchDelayMs:number,keyPressDelayMs:number,toggleKeyId:number,fingerprint?:number,keyClassDelays?:number[]}} profile
+ *   fingerprint binds the profile to a USB host for auto-select (0 = not bound).
+ *   keyClassDelays (u16 x6, 0xFFFF = typing delay) is stored with the profile when the firmware supports it.
+ * @returns {Promise<object|null>} state after the op (see readProfileState), null when unsupported or timed out
+ */
+export async function saveTimingProfile(slot, profile) {
+  const name = new TextEncoder().encode(sanitizeNickname(profile.name));
+  const classes = profile.keyClassDelays ?? [];
+  // With a table the name is padded to 12 bytes; older firmware rejects the longer packet.
+  const withTable = classes.length === 6 && Boolean((await readProfileState())?.keyClassTables);
+  const pkt = new Uint8Array(withTable ? 11 + 12 + 2 * classes.length : 11 + name.length);
+  const put16 = (at, v) => {
+    pkt[at] = v & 0xff;
+    pkt[at + 1] = (v >> 8) & 0xff;
+  };
+  pkt[0] = PROFILE_OP.save;
+  pkt[1] = slot;
+  put16(2, profile.typingDelayMs);
+  put16(4, profile.modeSwitchDelayMs);
+  put16(6, profile.keyPressDelayMs);
+  pkt[8] = profile.toggleKeyId & 0xff;
+  put16(9, profile.fingerprint ?? 0);
+  pkt.set(name.subarray(0, 12), 11);
+  if (withTable) classes.forEach((v, i) => put16(23 + 2 * i, v));
+  return profileCommand(pkt);
+}
+
+/**
+ * Run a one-argument profile op.
+ * @param {number} op PROFILE_OP.delete / activate (slot, PROFILE_NONE = boot with defaults) / autoSelect (1 = on)
+ * @param {number} arg
+ * @returns {Promise<object|null>} state after the op, null when unsupported or timed out
+ */
+export async function profileOp(op, arg) {
+  return profileCommand(Uint8Array.of(op, arg & 0xff));
+}
+
+// ---------------------------------------------------------------------------
+// Document snapshots (line hashes of the last flushed document, for diff retyping)
+// ---------------------------------------------------------------------------
+
+export const DOC_OP = Object.freeze({ read: 0x01, saveBegin: 0x02, saveData: 0x03, saveCommit: 0x04, delete: 0x05 });
+export const DOC_RESULT = Object.freeze({ ok: 0, badRequest: 1, notFound: 2, tooLarge: 3, ioError: 4, busy: 5 });
+const kDocStateMagic = 0xb5;
+const kDocStateHeaderLen = 20;
+const kDocDataMaxHashes = 60;
+
+function parseDocState(v) {
+  if (!v || v.byteLength < kDocStateHeaderLen || v.getUint8(0) !== kDocStateMagic) return null;
+  const count = Math.min(v.getUint8(16), Math.floor((v.byteLength - kDocStateHeaderLen) / 4));
+  const hashes = new Uint32Array(count);
+  for (let i = 0; i < count; i += 1) hashes[i] = v.getUint32(kDocStateHeaderLen + i * 4, true);
+  return {
+    opCount: v.getUint8(1),
+    lastOp: v.getUint8(2),
+    lastResult: v.getUint8(3),
+    lineCount: v.getUint16(4, true),
+    docCrc: v.getUint32(6, true),
+    hashCrc: v.getUint32(10, true),
+    first: v.getUint16(14, true),
+    slotsUsed: v.getUint8(17),
+    maxLines: v.getUint16(18, true),
+    hashes,
+  };
+}
+
+// Same read-back rule as profileCommand (flash work runs in the device HID task).
+async function docCommand(bytes) {
+  const docChar = chars[DOC_CHAR_UUID];
+  if (!docChar) return null;
+  const before = parseDocState(await docChar.readValue());
+  if (!before) return null;
+  await docChar.writeValue(bytes);
+
+  const startedAt = performance.now();
+  for (;;) {
+    const s = parseDocState(await docChar.readValue());
+    if (s && s.opCount !== before.opCount) return s;
+    if (performance.now() - startedAt > 3000) return null;
+    await new Promise((r) => setTimeout(r, 30));
+  }
+}
+
+/** Snapshot names use the nickname character set (A-Z a-z 0-9 _ -), up to 16 characters. */
+export function sanitizeDocName(raw) {
+  return String(raw ?? '').trim().replace(/[^A-Za-z0-9_-]/g, '').slice(0, 16);
+}
+
+function docNamed(op, prefix, name) {
+  const n = new TextEncoder().encode(sanitizeDocName(name));
+  const pkt = new Uint8Array(1 + prefix.length + n.length);
+  pkt[0] = op;
+  pkt.set(prefix, 1);
+  pkt.set(n, 1 + prefix.length);
+  return pkt;
+}
+
+function hashesToBytes(hashes) {
+  const bytes = new Uint8Array(hashes.length * 4);
+  const dv = new DataView(bytes.buffer);
+  for (let i = 0; i < hashes.length; i += 1) dv.setUint32(i * 4, hashes[i], true);
+  return bytes;
+}
+
+/**
+ * Read the stored line hashes of a document snapshot.
+ * @param {string} name
+ * @returns {Promise<{lineCount:number, docCrc:number, hashes:Uint32Array, maxLines:number}|null>}
+ *   null when unsupported, not stored, timed out or damaged (hash CRC mismatch)
+ */
+export async function readDocSnapshot(name) {
+  const hashes = [];
+  let info = null;
+  do {
+    const first = hashes.length;
+    const s = await docCommand(docNamed(DOC_OP.read, [first & 0xff, (first >> 8) & 0xff], name));
+    if (!s || s.lastResult !== DOC_RESULT.ok || s.first !== first) return null;
+    if (info && (s.lineCount !== info.lineCount || s.hashCrc !== info.hashCrc)) return null;
+    info = s;
+    if (s.hashes.length === 0) return null;
+    hashes.push(...s.hashes);
+  } while (hashes.length < info.lineCount);
+
+  const out = Uint32Array.from(hashes.slice(0, info.lineCount));
+  if (crc32(hashesToBytes(out)) !== info.hashCrc) return null;
+  return { lineCount: info.lineCount, docCrc: info.docCrc, hashes: out, maxLines: info.maxLines };
+}
+
+/**
+ * Store (or replace) the line hashes of a document snapshot.
+ * @param {string} name
+ * @param {Uint32Array} hashes one CRC-32 per line
+ * @param {number} docCrc CRC-32 of the whole document
+ * @returns {Promise<number|null>} DOC_RESULT of the failing step (ok when stored), null when unsupported/timed out
+ */
+export async function saveDocSnapshot(name, hashes, docCrc) {
+  const head = [hashes.length & 0xff, (hashes.length >> 8) & 0xff,
+    docCrc & 0xff, (docCrc >>> 8) & 0xff, (docCrc >>> 16) & 0xff, (docCrc >>> 24) & 0xff];
+  let s = await docCommand(docNamed(DOC_OP.saveBegin, head, name));
+  if (!s || s.lastResult !== DOC_RESULT.ok) return s ? s.lastResult : null;
+  const bytes = hashesToBytes(hashes);
+  for (let i = 0; i < hashes.length; i += kDocDataMaxHashes) {
+    const n = Math.min(kDocDataMaxHashes, hashes.length - i);
+    const pkt = new Uint8Array(3 + n * 4);
+    pkt[0] = DOC_OP.saveData;
+    pkt[1] = i & 0xff;
+    pkt[2] = (i >> 8) & 0xff;
+    pkt.set(bytes.subarray(i * 4, (i + n) * 4), 3);
+    s = await docCommand(pkt);
+    if (!s || s.lastResult !== DOC_RESULT.ok) return s ? s.lastResult : null;
+  }
+  s = await docCommand(Uint8Array.of(DOC_OP.saveCommit));
+  return s ? s.lastResult : null;
+}
+
+/**
+ * Forget a document snapshot (the next flush of that name types the whole document).
+ * @param {string} name
+ * @returns {Promise<number|null>} DOC_RESULT (notFound is fine), null when unsupported/timed out
+ */
+export async function deleteDocSnapshot(name) {
+  const s = await docCommand(docNamed(DOC_OP.delete, [], name));
+  return s ? s.lastResult : null;
+}
+
+// ---------------------------------------------------------------------------
+// Keystroke cost dry-run (firmware decoder, no HID output)
+// ---------------------------------------------------------------------------
+
+const kEstimateStateMagic = 0xe5;
+const kEstimateDataChunk = 200;
+
+function parseEstimateState(v) {
+  if (!v || v.byteLength < 26 || v.getUint8(0) !== kEstimateStateMagic) return null;
+  const typingMs = v.getUint32(14, true);
+  const keyPressMs = v.getUint32(18, true);
+  const modeSwitchMs = v.getUint32(22, true);
+  // In-band WAIT/WAIT_IDLE total (firmware 1.2.16+)
+  const waitMs = v.byteLength >= 30 ? v.getUint32(26, true) : 0;
+  return {
+    opCount: v.getUint8(1),
+    bytes: v.getUint32(2, true),
+    keystrokes: v.getUint32(6, true),
+    modeSwitches: v.getUint32(10, true),
+    typingMs,
+    keyPressMs,
+    modeSwitchMs,
+    waitMs,
+    totalMs: typingMs + keyPressMs + modeSwitchMs + waitMs,
+  };
+}
+
+async function readEstimateState() {
+  const estimateChar = chars[ESTIMATE_CHAR_UUID];
+  if (!estimateChar) return null;
+  return parseEstimateState(await estimateChar.readValue());
+}
+
+/**
+ * Count keystrokes / mode switches / delay time per class for `bytes` using the firmware's own
+ * decoder in dry-run mode (same rules as real typing, current device timing settings).
+ * Starts from the state of a new flush session (English mode).
+ * @param {Uint8Array} bytes UTF-8 text
+ * @returns {Promise<{bytes:number,keystrokes:number,modeSwitches:number,typingMs:number,keyPressMs:number,modeSwitchMs:number,waitMs:number,totalMs:number}|null>}
+ *   null when the firmware has no estimate characteristic.
+ */
+export async function estimateOnDevice(bytes) {
+  const estimateChar = chars[ESTIMATE_CHAR_UUID];
+  if (!estimateChar) return null;
+
+  await estimateChar.writeValue(Uint8Array.of(0x01));
+  for (let off = 0; off < bytes.length; off += kEstimateDataChunk) {
+    const part = bytes.subarray(off, off + kEstimateDataChunk);
+    const pkt = new Uint8Array(1 + part.length);
+    pkt[0] = 0x02;
+    pkt.set(part, 1);
+    await estimateChar.writeValue(pkt);
+  }
+
+  // The write response can precede the callback; wait until every byte has been counted.
+  const startedAt = performance.now();
+  for (;;) {
+    const s = await readEstimateState();
+    if (s && s.bytes === bytes.length) return s;
+    if (performance.now() - startedAt > 3000) return null;
+    await new Promise((r) => setTimeout(r, 30));
+  }
 }
 
 // ---------------------------------------------------------------------------
@@ -267,6 +1276,12 @@ export async function writeDeviceNickname(nickname) {
 // Connection / Disconnection
 // ---------------------------------------------------------------------------
 
+// Device picker filter (shared with fleet.js)
+export const DEVICE_REQUEST_OPTIONS = Object.freeze({
+  filters: [{ services: [SERVICE_UUID] }, { namePrefix: 'ByteFlusher' }],
+  optionalServices: [SERVICE_UUID],
+});
+
 /**
  * Open the browser BLE device picker and establish a connection.
  * @returns {Promise<{cancelled: boolean, device?: BluetoothDevice}>}
@@ -276,14 +1291,9 @@ export async function connect() {
     throw new Error(t('error.noWebBluetooth'));
   }
 
-  const requestOptions = {
-    filters: [{ services: [SERVICE_UUID] }, { namePrefix: 'ByteFlusher' }],
-    optionalServices: [SERVICE_UUID],
-  };
-
   let selectedDevice;
   try {
-    selectedDevice = await navigator.bluetooth.requestDevice(requestOptions);
+    selectedDevice = await navigator.bluetooth.requestDevice(DEVICE_REQUEST_OPTIONS);
   } catch (err) {
     const name = (err?.name ?? '').toString();
     if (name === 'NotFoundError') {
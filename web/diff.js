@@ -0,0 +1,242 @@
+// ByteFlusher diff retyping: turn "old document -> new document" into a keystroke stream
+// The device remembers only a CRC-32 per line of the last flushed document (Doc characteristic), so the
+// diff runs on line hashes. Changed lines are reached with navigation chords (in-band CHORD sequences)
+// and retyped; unchanged lines are never touched.
+//
+// Editor model (what the stream assumes about the Target PC editor):
+// - the editor holds exactly the old document; word wrap is off (Down/Up move one logical line)
+// - Ctrl+Home goes to (0,0); Down/Up from column 0 stay in column 0; Right at the end of a line goes to
+//   the start of the next line; End/Shift+End go to/select up to the end of the line
+// - Shift+Down from column 0 selects the whole line including its line break; typing replaces a selection
+// - Enter splits the line without adding indentation
+// Home is not used: editors with "smart home" (VS Code etc.) jump to the first non-blank character.
+
+import { crc32, inbandChord } from './ble.js';
+
+const MOD_CTRL = 0x01;
+const MOD_SHIFT = 0x02;
+export const KEY = Object.freeze({ right: 0x4f, end: 0x4d, del: 0x4c, down: 0x51, up: 0x52, home: 0x4a });
+
+// LCS table cells; a larger changed middle is replaced as one block.
+const kMaxLcsCells = 4_000_000;
+
+/** Split like the device types it: \r\n, \r and \n are one line break each. */
+export function splitLines(text) {
+  return String(text ?? '').split(/\r\n|\r|\n/);
+}
+
+/**
+ * CRC-32 of every line (UTF-8). Same values the device stores.
+ * @param {string[]} lines
+ * @returns {Uint32Array}
+ */
+export function hashLines(lines) {
+  const enc = new TextEncoder();
+  const out = new Uint32Array(lines.length);
+  for (let i = 0; i < lines.length; i += 1) out[i] = crc32(enc.encode(lines[i]));
+  return out;
+}
+
+/**
+ * Line hunks between two hash lists: { a, m, b, n } replaces old lines [a, a+m) with new lines [b, b+n).
+ * Common prefix/suffix are trimmed, the middle is matched with an LCS.
+ * @param {ArrayLike<number>} oldHashes
+ * @param {ArrayLike<number>} newHashes
+ */
+export function diffLines(oldHashes, newHashes) {
+  let start = 0;
+  let oldEnd = oldHashes.length;
+  let newEnd = newHashes.length;
+  while (start < oldEnd && start < newEnd && oldHashes[start] === newHashes[start]) start += 1;
+  while (oldEnd > start && newEnd > start && oldHashes[oldEnd - 1] === newHashes[newEnd - 1]) {
+    oldEnd -= 1;
+    newEnd -= 1;
+  }
+  const rows = oldEnd - start;
+  const cols = newEnd - start;
+  if (rows === 0 && cols === 0) return [];
+  if (rows === 0 || cols === 0 || (rows + 1) * (cols + 1) > kMaxLcsCells) {
+    return [{ a: start, m: rows, b: start, n: cols }];
+  }
+
+  // lcs[i][j] = LCS length of old[start+i..oldEnd) and new[start+j..newEnd)
+  const w = cols + 1;
+  const lcs = new Uint32Array((rows + 1) * w);
+  for (let i = rows - 1; i >= 0; i -= 1) {
+    for (let j = cols - 1; j >= 0; j -= 1) {
+      lcs[i * w + j] = oldHashes[start + i] === newHashes[start + j]
+        ? lcs[(i + 1) * w + j + 1] + 1
+        : Math.max(lcs[(i + 1) * w + j], lcs[i * w + j + 1]);
+    }
+  }
+
+  const hunks = [];
+  let i = 0;
+  let j = 0;
+  let hunk = null;
+  const flush = () => {
+    if (hunk) hunks.push(hunk);
+    hunk = null;
+  };
+  while (i < rows || j < cols) {
+    if (i < rows && j < cols && oldHashes[start + i] === newHashes[start + j]) {
+      flush();
+      i += 1;
+      j += 1;
+      continue;
+    }
+    if (!hunk) hunk = { a: start + i, m: 0, b: start + j, n: 0 };
+    if (j < cols && (i >= rows || lcs[i * w + j + 1] >= lcs[(i + 1) * w + j])) {
+      hunk.n += 1;
+      j += 1;
+    } else {
+      hunk.m += 1;
+      i += 1;
+    }
+  }
+  flush();
+  return hunks;
+}
+
+// Stream builder: text parts are UTF-8 encoded, keys become CHORD sequences.
+function createStream() {
+  const enc = new TextEncoder();
+  const parts = [];
+  let keys = 0;
+  let typed = '';
+  return {
+    key(modifier, keycode, times = 1) {
+      for (let k = 0; k < times; k += 1) parts.push(inbandChord(modifier, keycode));
+      keys += times;
+    },
+    text(s) {
+      if (!s) return;
+      parts.push(enc.encode(s));
+      typed += s;
+    },
+    finish() {
+      let len = 0;
+      for (const p of parts) len += p.length;
+      const bytes = new Uint8Array(len);
+      let o = 0;
+      for (const p of parts) {
+        bytes.set(p, o);
+        o += p.length;
+      }
+      return { bytes, navKeys: keys, textChars: typed.length, typedText: typed };
+    },
+  };
+}
+
+/**
+ * Keystrokes that turn the old document (given as line hashes) into `newLines` in the Target editor.
+ * The cursor may start anywhere: the stream begins with Ctrl+Home.
+ * @param {ArrayLike<number>} oldHashes
+ * @param {string[]} newLines
+ * @returns {{bytes:Uint8Array, hunks:number, changedLines:number, navKeys:number, textChars:number, typedText:string}}
+ */
+export function buildDiffStream(oldHashes, newLines) {
+  const hunks = diffLines(oldHashes, hashLines(newLines));
+  const out = createStream();
+  let lineCount = oldHashes.length;
+  // Cursor: row, and whether it sits in column 0 (otherwise at the end of the row).
+  let row = 0;
+  let atStart = true;
+  // Last line of the editor is empty (usual for a trailing newline) and no hunk has touched it yet.
+  let tailEmpty = false;
+  const emptyHash = crc32(new Uint8Array(0));
+  out.key(MOD_CTRL, KEY.home);
+
+  const goStart = (target) => {
+    if (!atStart && row + 1 < lineCount) {
+      // End of row -> start of the next row.
+      out.key(0, KEY.right);
+      row += 1;
+      atStart = true;
+    } else if (!atStart) {
+      out.key(MOD_CTRL, KEY.home);
+      row = 0;
+      atStart = true;
+    }
+    // Cheapest of: relative Down/Up, Ctrl+Home + Down, Ctrl+End + Up (only when the last line is
+    // empty, so Ctrl+End lands in column 0).
+    const relative = Math.abs(target - row);
+    const fromEnd = tailEmpty ? 1 + (lineCount - 1 - target) : Infinity;
+    if (fromEnd < relative && fromEnd < target + 1) {
+      out.key(MOD_CTRL, KEY.end);
+      out.key(0, KEY.up, lineCount - 1 - target);
+    } else if (target + 1 < relative) {
+      out.key(MOD_CTRL, KEY.home);
+      out.key(0, KEY.down, target);
+    } else if (target > row) {
+      out.key(0, KEY.down, target - row);
+    } else {
+      out.key(0, KEY.up, row - target);
+    }
+    row = target;
+  };
+  const goEnd = (target) => {
+    if (!atStart && row === target) return;
+    goStart(target);
+    out.key(0, KEY.end);
+    atStart = false;
+  };
+
+  let changedLines = 0;
+  for (const h of hunks) {
+    // Everything above the hunk is already the new text, so the hunk starts at new row h.b.
+    const top = h.b;
+    const paired = Math.min(h.m, h.n);
+    tailEmpty = h.a + h.m < oldHashes.length && oldHashes[oldHashes.length - 1] === emptyHash;
+    for (let k = 0; k < paired; k += 1) {
+      goStart(top + k);
+      out.key(MOD_SHIFT, KEY.end);
+      if (newLines[top + k]) out.text(newLines[top + k]);
+      else out.key(0, KEY.del);
+      atStart = newLines[top + k].length === 0;
+    }
+
+    if (h.n > h.m) {
+      const extra = newLines.slice(top + paired, top + h.n);
+      if (paired > 0) {
+        // After the retyped line: line break first, then the line.
+        goEnd(top + paired - 1);
+        out.text(extra.map((l) => `\n${l}`).join(''));
+        row = top + h.n - 1;
+        atStart = extra[extra.length - 1].length === 0;
+      } else if (top < lineCount) {
+        // In front of the old line at `top`, which moves down.
+        goStart(top);
+        out.text(extra.map((l) => `${l}\n`).join(''));
+        row = top + extra.length;
+        atStart = true;
+      } else {
+        goEnd(top - 1);
+        out.text(extra.map((l) => `\n${l}`).join(''));
+        row = top + extra.length - 1;
+        atStart = extra[extra.length - 1].length === 0;
+      }
+      lineCount += extra.length;
+    } else if (h.m > h.n) {
+      const count = h.m - h.n;
+      const first = top + paired;
+      if (first + count < lineCount) {
+        goStart(first);
+        out.key(MOD_SHIFT, KEY.down, count);
+        out.key(0, KEY.del);
+      } else if (first > 0) {
+        // Through the end of the document: also remove the line break before `first`.
+        goEnd(first - 1);
+        out.key(MOD_SHIFT | MOD_CTRL, KEY.end);
+        out.key(0, KEY.del);
+      } else {
+        goStart(0);
+        out.key(MOD_SHIFT | MOD_CTRL, KEY.end);
+        out.key(0, KEY.del);
+      }
+      lineCount -= count;
+    }
+    changedLines += Math.max(h.m, h.n);
+  }
+  return { ...out.finish(), hunks: hunks.length, changedLines };
+}
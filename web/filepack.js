@@ -0,0 +1,164 @@
+// ByteFlusher folder archive (File Flusher "packed" folder transfer)
+// Small files of a folder are sent as one framed archive instead of one prepare/reset/commit round per
+// file. The archive is typed through the same base64 chunk pipeline (filestream.js) and unpacked on the
+// Target PC by the bootstrap helper bf_unpack (files.js), which checks the archive SHA-256, every content
+// SHA-256, and then writes all entries.
+//
+// Layout (little-endian):
+//   'BFA1'  u32 blobCount  u32 entryCount
+//   blobCount  x { u32 size, 32-byte SHA-256 }
+//   entryCount x { u32 blobIndex, u16 pathLen, path (UTF-8, relative, '\' separators) }
+//   blob contents, concatenated in blob order
+// Identical contents are stored once (one blob, several entries).
+
+import { Sha256 } from './filestream.js';
+
+const kMagic = [0x42, 0x46, 0x41, 0x31]; // 'BFA1'
+// Larger files keep the per-file path: their data dwarfs the per-file command overhead.
+export const kPackMaxFileBytes = 1024 * 1024; // 1 MiB
+// bf_unpack decodes one archive in memory; keep each archive small.
+export const kPackMaxArchiveBytes = 8 * 1024 * 1024; // 8 MiB
+// crypto.subtle for small files (one read), streaming Sha256 above this.
+const kSubtleHashMaxBytes = 8 * 1024 * 1024;
+
+/** Relative archive path of a folder-picker File. */
+export function packEntryPath(file) {
+  return String(file?.webkitRelativePath || file?.name || '').replace(/\//g, '\\');
+}
+
+/** True when this file goes into an archive (folder transfers only). */
+export function isPackable(file) {
+  return (Number(file?.size) || 0) <= kPackMaxFileBytes;
+}
+
+function toHex(bytes) {
+  let s = '';
+  for (const b of bytes) s += b.toString(16).padStart(2, '0');
+  return s;
+}
+
+async function sha256OfBlob(blob) {
+  if (blob.size <= kSubtleHashMaxBytes && globalThis.crypto?.subtle) {
+    return new Uint8Array(await globalThis.crypto.subtle.digest('SHA-256', await blob.arrayBuffer()));
+  }
+  const h = new Sha256();
+  const reader = blob.stream().getReader();
+  for (;;) {
+    const { value, done } = await reader.read();
+    if (done) break;
+    h.update(value);
+  }
+  const hex = h.hex();
+  const out = new Uint8Array(32);
+  for (let i = 0; i < 32; i += 1) out[i] = Number.parseInt(hex.slice(i * 2, i * 2 + 2), 16);
+  return out;
+}
+
+function encodeHeader(blobs, entries) {
+  const enc = new TextEncoder();
+  const paths = entries.map((e) => enc.encode(e.path));
+  let len = 12 + blobs.length * 36;
+  paths.forEach((p, i) => {
+    if (p.length > 0xffff) throw new Error(`path too long: ${entries[i].path}`);
+    len += 6 + p.length;
+  });
+  const out = new Uint8Array(len);
+  const view = new DataView(out.buffer);
+  out.set(kMagic, 0);
+  view.setUint32(4, blobs.length, true);
+  view.setUint32(8, entries.length, true);
+  let o = 12;
+  for (const b of blobs) {
+    view.setUint32(o, b.size, true);
+    out.set(b.sha, o + 4);
+    o += 36;
+  }
+  entries.forEach((e, i) => {
+    view.setUint32(o, e.blob, true);
+    view.setUint16(o + 4, paths[i].length, true);
+    out.set(paths[i], o + 6);
+    o += 6 + paths[i].length;
+  });
+  return out;
+}
+
+/**
+ * Hash the packable files, merge identical contents and split them into archives of up to
+ * kPackMaxArchiveBytes (a file is never split; every entry lives in the archive of its content).
+ * @param {File[]} files packable files, in transfer order
+ * @param {{shouldStop?:() => boolean, onHashed?:(done:number, total:number) => void}} [opts]
+ * @returns {Promise<Array<{blob:Blob, entryCount:number, entryBytes:number, uniqueBytes:number}>|null>}
+ *   null when stopped while hashing
+ */
+export async function buildFolderArchives(files, opts = {}) {
+  const uniques = []; // { file, size, sha, entries: [path] }
+  const byHash = new Map();
+  for (let i = 0; i < files.length; i += 1) {
+    if (opts.shouldStop?.()) return null;
+    const f = files[i];
+    const sha = await sha256OfBlob(f);
+    const hex = toHex(sha);
+    let u = byHash.get(hex);
+    if (!u) {
+      u = { file: f, size: Number(f.size) || 0, sha, entries: [] };
+      byHash.set(hex, u);
+      uniques.push(u);
+    }
+    u.entries.push(packEntryPath(f));
+    opts.onHashed?.(i + 1, files.length);
+  }
+
+  const groups = [];
+  let cur = null;
+  for (const u of uniques) {
+    if (!cur || (cur.bytes > 0 && cur.bytes + u.size > kPackMaxArchiveBytes)) {
+      cur = { uniques: [], bytes: 0 };
+      groups.push(cur);
+    }
+    cur.uniques.push(u);
+    cur.bytes += u.size;
+  }
+
+  return groups.map((g) => {
+    const blobs = g.uniques.map((u) => ({ size: u.size, sha: u.sha }));
+    const entries = [];
+    let entryBytes = 0;
+    g.uniques.forEach((u, bi) => {
+      for (const path of u.entries) {
+        entries.push({ blob: bi, path });
+        entryBytes += u.size;
+      }
+    });
+    // Blob parts are read lazily by Blob.stream(); nothing is copied here.
+    const blob = new Blob([encodeHeader(blobs, entries), ...g.uniques.map((u) => u.file)]);
+    return { blob, entryCount: entries.length, entryBytes, uniqueBytes: g.bytes };
+  });
+}
+
+/**
+ * Size-only split used for the ETA before anything is hashed (duplicates are not known yet).
+ * @param {Array<{size:number}>} files
+ * @returns {{looseFiles:Array<{size:number}>, archiveCount:number, archiveBytes:number}}
+ */
+export function estimateFolderArchives(files) {
+  const looseFiles = [];
+  let archiveCount = 0;
+  let archiveBytes = 0;
+  let cur = -1;
+  for (const f of files) {
+    if (!isPackable(f)) {
+      looseFiles.push(f);
+      continue;
+    }
+    const size = Number(f?.size) || 0;
+    if (cur < 0 || (cur > 0 && cur + size > kPackMaxArchiveBytes)) {
+      archiveCount += 1;
+      cur = 0;
+    }
+    cur += size;
+    // blob record + entry record + a typical path
+    archiveBytes += size + 36 + 6 + packEntryPath(f).length;
+  }
+  archiveBytes += archiveCount * 12;
+  return { looseFiles, archiveCount, archiveBytes };
+}
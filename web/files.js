@@ -7,6 +7,9 @@
 import { t, getLocale, applyDom } from './i18n.js';
 import * as ble from './ble.js';
 import { setStatus as setAppStatus } from './app.js';
+import { assembleMacro } from './macro.js';
+import { gzipIfSmaller, openFileChunkStream } from './filestream.js';
+import { buildFolderArchives, estimateFolderArchives, isPackable } from './filepack.js';
 
 // Shared localStorage keys (same meaning as text flusher)
 const LS_TYPING_DELAY_MS = 'byteflusher.typingDelayMs';
@@ -63,6 +66,12 @@ const kDefaultFilesSettings = Object.freeze({
   psLaunchDelayMs: 9000,
   bootstrapDelayMs: 1200,
   diagLog: true,
+  // Per-chunk ACK/NACK from the Target PC over the keyboard Lock LEDs (firmware Target characteristic).
+  ledAck: false,
+  // Folder: small files travel as one verified archive (filepack.js) instead of a round trip per file.
+  packFolder: true,
+  // gzip each file/archive before base64 when it gets smaller (decompressed + verified on the Target PC).
+  compress: true,
 });
 
 // Temp artifacts live under targetDir\.tmp
@@ -72,11 +81,11 @@ const kTempSubdirName = '.tmp';
 const kTempB64Prefix = 'bf_payload_';
 
 // Size limits (browser-side safety)
-// - 단일 파일이 너무 크면 ArrayBuffer/Base64 변환이 브라우저 메모리/시간 한계로 실패할 수 있다.
+// - 파일은 filestream.js로 스트리밍(해시/Base64/청크를 조금씩)하므로 메모리는 파일 크기와 무관하다.
+//   단일 파일 한도는 Target PC의 bf_commit(임시 Base64 전체를 읽어 디코드)이 감당할 수 있는 선으로 둔다.
 // - 전체(합계)가 너무 크면 작업 시간이 길어져 포커스 이탈/팝업 등 환경 리스크가 누적된다.
-// 정확성 우선: 보수적으로 시작하고, 필요 시 상향한다.
-const kMaxSingleFileBytes = 50 * 1024 * 1024; // 50 MiB
-const kMaxTotalBytes = 200 * 1024 * 1024; // 200 MiB
+const kMaxSingleFileBytes = 512 * 1024 * 1024; // 512 MiB
+const kMaxTotalBytes = 1024 * 1024 * 1024; // 1 GiB
 
 function sleep(ms) {
   return new Promise((resolve) => setTimeout(resolve, ms));
@@ -92,14 +101,23 @@ function waitForStatusUpdate(timeoutMs) {
 async function waitForDeviceRoom({ requiredBytes, maxBacklogBytes }) {
   if (!ble.getChar(ble.STATUS_CHAR_UUID)) return;
   const startedAt = performance.now();
+  let asleepShown = '';
 
   while (!stopRequested) {
     if (paused) return;
     if (!ble.isConnected()) return;
 
+    // Target PC가 잠들어 USB가 suspend되면, 장치가 깨우거나 사용자가 깨울 때까지 보내지 않는다(큐는 장치에 남는다).
+    const usb = ble.getDeviceUsbState();
     const cap = ble.getDeviceBufCapacity();
     const free = ble.getDeviceBufFree();
-    if (Number.isFinite(cap) && Number.isFinite(free)) {
+    if (usb?.suspended) {
+      const detailKey = usb.wakeupRefused ? 'status.targetAsleepWakeManually' : 'status.targetAsleepWaking';
+      if (asleepShown !== detailKey) {
+        asleepShown = detailKey;
+        setStatus(t('status.targetAsleep'), t(detailKey));
+      }
+    } else if (Number.isFinite(cap) && Number.isFinite(free)) {
       const used = Math.max(0, cap - free);
       const enoughFree = free >= requiredBytes;
       const backlogOk = used <= maxBacklogBytes;
@@ -144,7 +162,8 @@ function toggleKeyStringToId(v) {
 }
 
 function buildDeviceConfigPayload({ typingDelayMs, modeSwitchDelayMs, keyPressDelayMs, toggleKeyId, flags }) {
-  const out = new Uint8Array(8);
+  // Trailing key-class table all 0xFFFF: every key follows typingDelayMs (clears a Text Flusher table).
+  const out = new Uint8Array(20).fill(0xff);
   const setU16 = (off, n) => {
     const v = Math.max(0, Math.min(65535, Number(n) || 0));
     out[off] = v & 0xff;
@@ -162,7 +181,7 @@ async function writeDeviceConfig({ typingDelayMs, modeSwitchDelayMs, keyPressDel
   if (!ble.getChar(ble.CONFIG_CHAR_UUID)) return;
   const flags = (pausedFlag ? 0x01 : 0) | (abortFlag ? 0x02 : 0);
   const payload = buildDeviceConfigPayload({ typingDelayMs, modeSwitchDelayMs, keyPressDelayMs, toggleKeyId, flags });
-  await ble.getChar(ble.CONFIG_CHAR_UUID).writeValue(payload);
+  await ble.writeConfig(payload);
 }
 
 function makeSessionId16() {
@@ -241,41 +260,40 @@ function bumpWorkLines(n = 1) {
   job.workDoneLines = cur + Math.max(0, Number(n) || 0);
 }
 
-async function psLine(tx, line, { commandDelayMs, guard = 'normal', trackWork = true } = {}) {
+// Exact text typed for one PowerShell line (guard prefix + line + Enter).
+function psLineText(line, guard = 'normal') {
   const s = String(line ?? '');
-  if (s.length === 0) {
-    await txSendTextUtf8(tx, `\n`);
-    if (commandDelayMs > 0) await sleep(commandDelayMs);
-    if (trackWork) bumpWorkLines(1);
-    return;
-  }
-
+  if (s.length === 0) return '\n';
   const prefix = guard === 'strong' ? kPsLineGuardPrefixStrong : guard === 'none' ? '' : kPsLineGuardPrefix;
-  await txSendTextUtf8(tx, `${prefix}${s}\n`);
-  if (commandDelayMs > 0) await sleep(commandDelayMs);
-  if (trackWork) bumpWorkLines(1);
+  return `${prefix}${s}\n`;
 }
 
-async function sha256Hex(buffer) {
-  const hash = await crypto.subtle.digest('SHA-256', buffer);
-  const u8 = new Uint8Array(hash);
-  let out = '';
-  for (const b of u8) out += b.toString(16).padStart(2, '0');
+function concatBytes(parts) {
+  const out = new Uint8Array(parts.reduce((n, p) => n + p.length, 0));
+  let at = 0;
+  for (const p of parts) {
+    out.set(p, at);
+    at += p.length;
+  }
   return out;
 }
 
-function arrayBufferToBase64(buffer) {
-  const bytes = new Uint8Array(buffer);
-  const chunkSize = 0x8000;
-  let binary = '';
-  for (let i = 0; i < bytes.length; i += chunkSize) {
-    const slice = bytes.subarray(i, i + chunkSize);
-    // Avoid Array.from(slice) to reduce memory churn on large payloads.
-    binary += String.fromCharCode.apply(null, slice);
-  }
-  return btoa(binary);
+// Line text followed by a device-timed wait (in-band WAIT, firmware with in-band controls only).
+function psLineBytes(line, guard, waitMs) {
+  return concatBytes([new TextEncoder().encode(psLineText(line, guard)), ble.inbandWait(waitMs)]);
 }
 
+async function psLine(tx, line, { commandDelayMs, guard = 'normal', trackWork = true } = {}) {
+  if (ble.getInbandVersion() >= 1) {
+    // The device waits right after this line's Enter, in stream order: no browser timer jitter, and the
+    // wait is measured from when the line was typed rather than when it was sent.
+    await txSendBytesWithFlowControl(tx, psLineBytes(line, guard, commandDelayMs));
+  } else {
+    await txSendTextUtf8(tx, psLineText(line, guard));
+    if (commandDelayMs > 0) await sleep(commandDelayMs);
+  }
+  if (trackWork) bumpWorkLines(1);
+}
 
 function splitStringIntoChunks(s, chunkLen) {
   const str = String(s ?? '');
@@ -339,6 +357,36 @@ async function macroForceEnglish() {
   await macroWrite(0x06);
 }
 
+async function macroRunProgram(program) {
+  await macroWrite(0x08, program);
+}
+
+const kPsRunCommand = 'powershell -NoProfile -ExecutionPolicy Bypass -NoExit';
+
+function getPsSettleDelayMs(cfg) {
+  return Math.max(600, Math.min(2500, Math.floor(Number(cfg?.psLaunchDelayMs) / 2) || 0));
+}
+
+function buildPsLaunchMacroSource(cfg) {
+  // Same sequence as the legacy per-command path, but timed on the device in one BLE write.
+  // Text sent afterwards stays queued on the device until the program finishes.
+  return [
+    'tap esc',
+    'sleep 40',
+    'tap esc',
+    'sleep 40',
+    'tap gui+r',
+    `sleep ${Math.max(0, Number(cfg.runDialogDelayMs) || 0)}`,
+    'english',
+    'sleep 50',
+    `type "${kPsRunCommand}"`,
+    'tap enter',
+    `sleep ${Math.max(0, Number(cfg.psLaunchDelayMs) || 0)}`,
+    `sleep ${getPsSettleDelayMs(cfg)}`,
+    'end',
+  ].join('\n');
+}
+
 function makeRunToken() {
   // ASCII-safe, no spaces, collision-resistant enough for our use.
   return `${Date.now().toString(36)}_${Math.random().toString(36).slice(2, 10)}`;
@@ -377,6 +425,9 @@ function getFilesSettingsFromUi() {
     psLaunchDelayMs: clampInt(els.psLaunchDelayMsFiles?.value, 1200, 20000, kDefaultFilesSettings.psLaunchDelayMs),
     bootstrapDelayMs: clampInt(els.bootstrapDelayMsFiles?.value, 200, 10000, kDefaultFilesSettings.bootstrapDelayMs),
     diagLog: Boolean(els.diagLogFiles?.checked),
+    ledAck: Boolean(els.ledAckFiles?.checked),
+    packFolder: Boolean(els.packFolderFiles?.checked),
+    compress: Boolean(els.compressFiles?.checked),
   };
 }
 
@@ -394,6 +445,9 @@ function applyFilesSettingsToUi(s) {
   if (els.psLaunchDelayMsFiles) els.psLaunchDelayMsFiles.value = String(s.psLaunchDelayMs);
   if (els.bootstrapDelayMsFiles) els.bootstrapDelayMsFiles.value = String(s.bootstrapDelayMs);
   if (els.diagLogFiles) els.diagLogFiles.checked = Boolean(s.diagLog);
+  if (els.ledAckFiles) els.ledAckFiles.checked = Boolean(s.ledAck);
+  if (els.packFolderFiles) els.packFolderFiles.checked = Boolean(s.packFolder);
+  if (els.compressFiles) els.compressFiles.checked = Boolean(s.compress);
 }
 
 function loadFilesSettings() {
@@ -425,6 +479,9 @@ function loadFilesSettings() {
       migrated.psLaunchDelayMs = clampInt(migrated.psLaunchDelayMs, 1200, 20000, kDefaultFilesSettings.psLaunchDelayMs);
       migrated.bootstrapDelayMs = clampInt(migrated.bootstrapDelayMs, 200, 10000, kDefaultFilesSettings.bootstrapDelayMs);
       migrated.diagLog = Boolean(migrated.diagLog);
+      migrated.ledAck = Boolean(migrated.ledAck);
+      migrated.packFolder = Boolean(migrated.packFolder);
+      migrated.compress = Boolean(migrated.compress);
 
       try {
         localStorage.setItem(kFilesSettingsStorageKey, JSON.stringify(migrated));
@@ -450,6 +507,9 @@ function loadFilesSettings() {
     s.psLaunchDelayMs = clampInt(s.psLaunchDelayMs, 1200, 8000, kDefaultFilesSettings.psLaunchDelayMs);
     s.bootstrapDelayMs = clampInt(s.bootstrapDelayMs, 200, 3000, kDefaultFilesSettings.bootstrapDelayMs);
     s.diagLog = Boolean(s.diagLog);
+    s.ledAck = Boolean(s.ledAck);
+    s.packFolder = Boolean(s.packFolder);
+    s.compress = Boolean(s.compress);
     return s;
   } catch {
     return { ...kDefaultFilesSettings };
@@ -775,19 +835,32 @@ function encodePowerShellEncodedCommandBase64(script) {
   return btoa(u8ToBinaryString(u8));
 }
 
-function buildBootstrapChunkLauncherLines({ runToken, targetDir }) {
-  // Define bf_boot_append / bf_boot_run using short lines to minimize keystroke drops.
+function buildBootstrapPreludeLines({ runToken, targetDir, tmpB64Path, overwritePolicy, diagLog }) {
+  // Run-specific values only. The launcher and bootstrap script read these globals, so their
+  // text is identical across runs and can be replayed from the device payload cache.
+  // targetDir is validated ASCII/no-space; single quotes are still escaped for safety.
   const rt = String(runToken || 'run').replace(/[^a-z0-9_\-]/gi, '_');
-  const td = String(targetDir || '').trim();
+  const td = psEscapeSingleQuoted(String(targetDir || '').trim());
+  const tmp = psEscapeSingleQuoted(String(tmpB64Path ?? ''));
+  const ow = psEscapeSingleQuoted(String(overwritePolicy ?? 'fail'));
+  const d = diagLog ? 1 : 0;
+  return [
+    `$global:bf_root='${td}';$global:bf_rt='${rt}'`,
+    `$global:bf_tmpPath='${tmp}';$global:bf_ow='${ow}';$global:bf_d=${d}`,
+  ];
+}
+
+function buildBootstrapChunkLauncherLines() {
+  // Define bf_boot_append / bf_boot_run using short lines to minimize keystroke drops.
+  // Requires the prelude globals (buildBootstrapPreludeLines).
   return [
     "$ErrorActionPreference='Stop'",
     '[Console]::InputEncoding=[Text.Encoding]::UTF8',
     '[Console]::OutputEncoding=[Text.Encoding]::UTF8',
     // Keep all work artifacts under targetDir.
-    `$global:bf_root='${td}'`,
     "$global:bf_work=(Join-Path $global:bf_root '.tmp')",
     'New-Item -ItemType Directory -Force -Path $global:bf_work | Out-Null',
-    `$global:bf_bootPath=(Join-Path $global:bf_work 'bf_boot_${rt}.b64')`,
+    "$global:bf_bootPath=(Join-Path $global:bf_work ('bf_boot_'+$global:bf_rt+'.b64'))",
     'Remove-Item -Force -ErrorAction SilentlyContinue $global:bf_bootPath',
     "[IO.File]::WriteAllText($global:bf_bootPath,'',[Text.Encoding]::ASCII)",
     'function bf_boot_append([string]$c) {',
@@ -802,24 +875,49 @@ function buildBootstrapChunkLauncherLines({ runToken, targetDir }) {
   ];
 }
 
-function buildBootstrapScript({ targetDir, tmpB64Path, overwritePolicy, diagLog }) {
-  // Executed via IEX from Base64(UTF-16LE). Can safely contain non-ASCII after decoding.
-  // Still, pass user-provided strings as Base64 to avoid quoting edge cases.
-  const tdB64 = encodePowerShellEncodedCommandBase64(String(targetDir ?? ''));
-  const tmpB64 = encodePowerShellEncodedCommandBase64(String(tmpB64Path ?? ''));
-  const opB64 = encodePowerShellEncodedCommandBase64(String(overwritePolicy ?? 'fail'));
-  const d = diagLog ? 1 : 0;
+// Per-chunk hash checked by bf_chunk on the Target PC (same arithmetic as the PowerShell helper).
+function chunkCheckHash(s) {
+  let x = 0;
+  for (let i = 0; i < s.length; i += 1) x = (x * 31 + s.charCodeAt(i)) % 65521;
+  return x;
+}
+
+// Lock LED back-channel helpers (firmware "Lock LED back-channel"):
+// - bf_led sends one 16-bit frame [1011][kind][seq(8)][check(3)] by toggling Scroll Lock (=1) / Num Lock (=0),
+//   then toggles again where needed so the user's Lock state is left unchanged.
+// - bf_chunk checks the chunk hash, appends chunks to tmp in index order (out-of-order chunks wait in
+//   $bf_pend, so only failed chunks need retyping) and answers ACK/NACK with the chunk index.
+function buildLedAckHelperLines() {
+  return [
+    "function global:bf_led([int]$k,[int]$i){$v=($k -shl 8) -bor ($i -band 255);$c=(($v -band 7)+(($v -shr 3) -band 7)+(($v -shr 6) -band 7)) -band 7;$f=(11 -shl 12) -bor ($v -shl 3) -bor $c;$w=New-Object -ComObject WScript.Shell;$sn=0;$nn=0;for($b=15;$b -ge 0;$b--){if(($f -shr $b) -band 1){$w.SendKeys('{SCROLLLOCK}');$sn=1-$sn}else{$w.SendKeys('{NUMLOCK}');$nn=1-$nn};Start-Sleep -Milliseconds 30};if($sn){$w.SendKeys('{SCROLLLOCK}')};if($nn){$w.SendKeys('{NUMLOCK}')}}",
+    "function global:bf_rx_reset(){bf_tmp_reset;$global:bf_next=0;$global:bf_pend=@{}}",
+    "function global:bf_chunk([int]$i,[string]$s,[int]$h){$x=0;foreach($ch in $s.ToCharArray()){$x=($x*31+[int]$ch)%65521};if($s.Length -eq 0 -or $x -ne $h){bf_led 0 $i;return};if($i -ge $global:bf_next){$global:bf_pend[$i]=$s};while($global:bf_pend.ContainsKey($global:bf_next)){[IO.File]::AppendAllText($global:tmp,$global:bf_pend[$global:bf_next],[Text.Encoding]::ASCII);$global:bf_pend.Remove($global:bf_next);$global:bf_next++};bf_led 1 $i}",
+  ];
+}
+
+// Folder archive helper (filepack.js layout):
+// - bf_unpack decodes (and with $z=1 gunzips) tmp, checks the archive SHA-256, parses the blob/entry tables, checks every content
+//   SHA-256, and only then writes each entry under $td (bf_ow_prep applies the overwrite policy per entry).
+function buildUnpackHelperLines() {
+  return [
+    "function global:bf_unpack([string]$expected,[int]$z=0){try{$b=[Convert]::FromBase64String((Get-Content -Raw -Encoding ASCII $global:tmp)-replace'\\s','');if($z){$i=New-Object IO.MemoryStream(,$b);$g=New-Object IO.Compression.GZipStream($i,[IO.Compression.CompressionMode]::Decompress);$m=New-Object IO.MemoryStream;$g.CopyTo($m);$g.Close();$b=$m.ToArray()};$h=[Security.Cryptography.SHA256]::Create();$hx={param($o,$n)([BitConverter]::ToString($h.ComputeHash($b,$o,$n))-replace'-','').ToLower()};if((& $hx 0 $b.Length) -ne $expected){throw('SHA256 mismatch: archive')};if($b.Length -lt 12 -or [Text.Encoding]::ASCII.GetString($b,0,4) -ne 'BFA1'){throw('Bad archive header')};$nb=[BitConverter]::ToUInt32($b,4);$ne=[BitConverter]::ToUInt32($b,8);$p=12;$bz=@();$bh=@();for($i=0;$i -lt $nb;$i++){$bz+=[int][BitConverter]::ToUInt32($b,$p);$bh+=([BitConverter]::ToString($b,$p+4,32)-replace'-','').ToLower();$p+=36};$ei=@();$ep=@();for($i=0;$i -lt $ne;$i++){$n=[BitConverter]::ToUInt16($b,$p+4);$ei+=[int][BitConverter]::ToUInt32($b,$p);$ep+=[Text.Encoding]::UTF8.GetString($b,$p+6,$n);$p+=6+$n};$bo=@();foreach($z in $bz){$bo+=$p;$p+=$z};if($p -ne $b.Length){throw('Bad archive length')};for($i=0;$i -lt $nb;$i++){if((& $hx $bo[$i] $bz[$i]) -ne $bh[$i]){throw('SHA256 mismatch: content '+$i)}};for($i=0;$i -lt $ne;$i++){$k=$ei[$i];if($k -ge $nb){throw('Bad archive entry '+$i)};bf_ow_prep (Join-Path $global:td $ep[$i]);$f=[IO.File]::Open($global:out,'Create');try{$f.Write($b,$bo[$k],$bz[$k])}finally{$f.Close()}};Remove-Item -Force -ErrorAction SilentlyContinue $global:tmp}catch{if($global:d){try{($_|Out-String)|Set-Content -Encoding UTF8 -LiteralPath $global:l}catch{}};throw}}",
+  ];
+}
 
+function buildBootstrapScript(cfg) {
+  // Executed via IEX from Base64(UTF-16LE). Can safely contain non-ASCII after decoding.
+  // Run-specific values come from the prelude globals, so the encoded script never changes
+  // between runs (cacheable on the device). The LED ACK helpers only add a second variant.
   return [
     "$ErrorActionPreference='Stop'",
     '[Console]::InputEncoding=[Text.Encoding]::UTF8',
     '[Console]::OutputEncoding=[Text.Encoding]::UTF8',
     // NOTE: This script is executed inside bf_boot_run() (a function). Use global: scope so
     // variables/functions persist after bf_boot_run returns.
-    `$global:td=[Text.Encoding]::Unicode.GetString([Convert]::FromBase64String('${tdB64}'))`,
-    `$global:tmp=[Text.Encoding]::Unicode.GetString([Convert]::FromBase64String('${tmpB64}'))`,
-    `$global:overwritePolicy=[Text.Encoding]::Unicode.GetString([Convert]::FromBase64String('${opB64}'))`,
-    `$global:d=${d}`,
+    '$global:td=$global:bf_root',
+    '$global:tmp=$global:bf_tmpPath',
+    '$global:overwritePolicy=$global:bf_ow',
+    '$global:d=$global:bf_d',
     "$global:t=(Join-Path $global:td '.tmp')",
     'New-Item -ItemType Directory -Force -Path $global:td | Out-Null',
     'New-Item -ItemType Directory -Force -Path $global:t | Out-Null',
@@ -827,10 +925,12 @@ function buildBootstrapScript({ targetDir, tmpB64Path, overwritePolicy, diagLog
     'if ($global:d) { Remove-Item -Force -ErrorAction SilentlyContinue $global:l }',
     // Output helpers: keep per-file commands short (fewer keystrokes => faster, more reliable).
     // IMPORTANT: persist $out across calls (bf_commit expects it).
-    "function global:bf_prepare_out_b64([string]$b64){$global:out=[Text.Encoding]::Unicode.GetString([Convert]::FromBase64String($b64));$outDir=Split-Path -Parent $global:out;if($outDir){New-Item -ItemType Directory -Force -Path $outDir|Out-Null};if(Test-Path -LiteralPath $global:out){if($global:overwritePolicy -eq 'fail'){throw('File exists: '+$global:out)}elseif($global:overwritePolicy -eq 'overwrite'){Remove-Item -Force -LiteralPath $global:out}elseif($global:overwritePolicy -eq 'backup'){$bak=($global:out+'.bak');while(Test-Path -LiteralPath $bak){$bak=($bak+'.bak')};Move-Item -Force -LiteralPath $global:out -Destination $bak}}}",
+    // bf_ow_prep: sets $out, creates its directory and applies the overwrite policy (also used by bf_unpack).
+    "function global:bf_ow_prep([string]$p){$global:out=$p;$outDir=Split-Path -Parent $global:out;if($outDir){New-Item -ItemType Directory -Force -Path $outDir|Out-Null};if(Test-Path -LiteralPath $global:out){if($global:overwritePolicy -eq 'fail'){throw('File exists: '+$global:out)}elseif($global:overwritePolicy -eq 'overwrite'){Remove-Item -Force -LiteralPath $global:out}elseif($global:overwritePolicy -eq 'backup'){$bak=($global:out+'.bak');while(Test-Path -LiteralPath $bak){$bak=($bak+'.bak')};Move-Item -Force -LiteralPath $global:out -Destination $bak}}}",
+    "function global:bf_prepare_out_b64([string]$b64){bf_ow_prep ([Text.Encoding]::Unicode.GetString([Convert]::FromBase64String($b64)))}",
 
-    // Commit helper: decodes tmp->out, verifies hash, cleans tmp. Logs on error if enabled.
-    "function global:bf_commit([string]$expected){try{if(!$global:out){throw('Missing out path (call bf_prepare_out_b64 first)')};$b=(Get-Content -Raw -Encoding ASCII $global:tmp)-replace'\\s','';[IO.File]::WriteAllBytes($global:out,[Convert]::FromBase64String($b));$a=(Get-FileHash -Algorithm SHA256 -LiteralPath $global:out).Hash.ToLower();if($a -ne $expected){throw('SHA256 mismatch: '+$global:out)};Remove-Item -Force -ErrorAction SilentlyContinue $global:tmp}catch{if($global:d){try{($_|Out-String)|Set-Content -Encoding UTF8 -LiteralPath $global:l}catch{}};throw}}",
+    // Commit helper: decodes tmp->out (gunzip when $z=1), verifies hash, cleans tmp. Logs on error if enabled.
+    "function global:bf_commit([string]$expected,[int]$z=0){try{if(!$global:out){throw('Missing out path (call bf_prepare_out_b64 first)')};$b=(Get-Content -Raw -Encoding ASCII $global:tmp)-replace'\\s','';if($z){$i=New-Object IO.MemoryStream(,[Convert]::FromBase64String($b));$g=New-Object IO.Compression.GZipStream($i,[IO.Compression.CompressionMode]::Decompress);$f=[IO.File]::Create($global:out);try{$g.CopyTo($f)}finally{$f.Close();$g.Close()}}else{[IO.File]::WriteAllBytes($global:out,[Convert]::FromBase64String($b))};$a=(Get-FileHash -Algorithm SHA256 -LiteralPath $global:out).Hash.ToLower();if($a -ne $expected){throw('SHA256 mismatch: '+$global:out)};Remove-Item -Force -ErrorAction SilentlyContinue $global:tmp}catch{if($global:d){try{($_|Out-String)|Set-Content -Encoding UTF8 -LiteralPath $global:l}catch{}};throw}}",
 
     // Temp helpers: keep per-chunk commands short (fewer keystrokes => faster, more reliable).
     "function global:bf_tmp_reset(){Remove-Item -Force -ErrorAction SilentlyContinue $global:tmp;[IO.File]::WriteAllText($global:tmp,'',[Text.Encoding]::ASCII)}",
@@ -838,9 +938,184 @@ function buildBootstrapScript({ targetDir, tmpB64Path, overwritePolicy, diagLog
 
     // Final cleanup on success/cancel: remove temp file + logs + work dir.
     "function global:bf_finalize(){try{Remove-Item -Force -ErrorAction SilentlyContinue $global:tmp;if(Test-Path -LiteralPath $global:l){Remove-Item -Force -ErrorAction SilentlyContinue $global:l};if(Test-Path -LiteralPath $global:t){Remove-Item -Force -Recurse -ErrorAction SilentlyContinue $global:t}}catch{}}",
+
+    ...(cfg?.ledAck ? buildLedAckHelperLines() : []),
+    ...(cfg?.packFolder ? buildUnpackHelperLines() : []),
   ].join(';');
 }
 
+// Launcher + bootstrap chunks + bf_boot_run, in typing order.
+// Each step: { line, guard, delayMs, afterMs } (afterMs = extra chunk delay).
+function buildBootstrapSteps(cfg) {
+  const steps = [];
+  for (const line of buildBootstrapChunkLauncherLines()) {
+    const trimmed = String(line || '').trim();
+    const delayMs = trimmed.startsWith('function ') || trimmed === '}' ? cfg.commandDelayMs : cfg.lineDelayMs;
+    steps.push({ line, guard: 'strong', delayMs, afterMs: 0 });
+  }
+
+  const bootstrapEncoded = encodePowerShellEncodedCommandBase64(buildBootstrapScript(cfg));
+  // Keep each PowerShell line short to reduce keystroke drops.
+  const bootChunks = splitStringIntoChunks(bootstrapEncoded, cfg.bootChunkChars);
+  for (const chunk of bootChunks) {
+    steps.push({ line: `bf_boot_append '${chunk}'`, guard: 'normal', delayMs: cfg.lineDelayMs, afterMs: cfg.chunkDelayMs });
+  }
+
+  steps.push({ line: 'bf_boot_run', guard: 'strong', delayMs: cfg.commandDelayMs, afterMs: 0 });
+  return steps;
+}
+
+// Lock LED back-channel: at most this many chunks are typed ahead of the oldest unconfirmed one.
+// The firmware reports 8-bit chunk seqs, so the window must stay well below 256.
+const kLedAckWindow = 4;
+// No frame for this long after the device typed everything: the line was lost or broken, retype it.
+const kLedAckTimeoutMs = 8000;
+const kLedAckMaxAttempts = 5;
+
+/**
+ * Type the chunks of `stream` (filestream.js) as `bf_chunk <index> '<chunk>' <hash>` lines and wait for the
+ * Target PC's ACK/NACK frames (Lock LEDs -> firmware -> Target characteristic). NACKed or silent chunks are
+ * retyped alone. Keeps up to kLedAckWindow chunks in flight, so typing is paced by what the Target PC consumed;
+ * only those in-flight chunks are kept in memory.
+ */
+async function sendChunksWithLedAck(tx, stream, cfg, onChunkSent) {
+  const total = stream.chunkCount;
+  const inflight = new Map(); // index -> { text, attempts, acked }
+  const inbox = [];
+  const onFrame = (frame) => inbox.push(frame);
+  let base = 0;
+  let next = 0;
+  let lastProgressAt = performance.now();
+
+  const typeChunk = async (i) => {
+    const entry = inflight.get(i);
+    entry.attempts += 1;
+    if (entry.attempts > kLedAckMaxAttempts) {
+      throw new Error(t('error.ledAckFailed', { index: i, attempts: kLedAckMaxAttempts }));
+    }
+    const c = entry.text;
+    await psLine(tx, `bf_chunk ${i} '${c}' ${chunkCheckHash(c)}`, { commandDelayMs: cfg.lineDelayMs });
+    if (cfg.chunkDelayMs > 0) await sleep(cfg.chunkDelayMs);
+    lastProgressAt = performance.now();
+  };
+
+  ble.on('target', onFrame);
+  try {
+    while (base < total) {
+      if (stopRequested) return;
+      while (paused && !stopRequested) await sleep(120);
+      if (stopRequested) return;
+      if (!ble.isConnected()) throw new Error(t('error.bleDisconnected'));
+
+      while (next < total && next - base < kLedAckWindow) {
+        const text = await stream.next();
+        if (text == null) throw new Error(t('error.fileReadShort'));
+        inflight.set(next, { text, attempts: 0, acked: false });
+        await typeChunk(next);
+        onChunkSent(next);
+        next += 1;
+      }
+
+      while (inbox.length > 0) {
+        const frame = inbox.shift();
+        // Map the 8-bit seq back into the in-flight window; late duplicates fall outside it.
+        let idx = -1;
+        for (let i = base; i < next; i += 1) {
+          if ((i & 0xff) === frame.seq) idx = i;
+        }
+        if (idx < 0 || inflight.get(idx).acked) continue;
+        if (frame.ack) {
+          inflight.get(idx).acked = true;
+          lastProgressAt = performance.now();
+        } else {
+          console.warn('[files] chunk NACK, retyping', idx);
+          await typeChunk(idx);
+        }
+      }
+      while (base < next && inflight.get(base).acked) {
+        inflight.delete(base);
+        base += 1;
+      }
+      if (base >= total) break;
+
+      // Silence only counts once the device has typed everything we sent.
+      const cap = ble.getDeviceBufCapacity();
+      const drained = !Number.isFinite(cap) || ble.getDeviceBufFree() >= cap;
+      if (!drained) {
+        lastProgressAt = performance.now();
+      } else if (performance.now() - lastProgressAt > kLedAckTimeoutMs) {
+        console.warn('[files] chunk ACK timeout, retyping', base);
+        await typeChunk(base);
+      }
+      await sleep(50);
+    }
+  } finally {
+    ble.off('target', onFrame);
+  }
+}
+
+async function waitForDeviceTextDrained() {
+  // Cached playback runs from the macro slot, which the device serves before queued text.
+  // Wait until every previously sent text byte has been typed.
+  for (;;) {
+    if (stopRequested) throw new Error(t('status.userStopped'));
+    if (!ble.isConnected()) throw new Error(t('error.bleDisconnected'));
+    const cap = ble.getDeviceBufCapacity();
+    await waitForDeviceRoom({ requiredBytes: Number.isFinite(cap) ? cap : 1, maxBacklogBytes: 0 });
+    if (!paused && Number.isFinite(cap) && ble.getDeviceBufFree() >= cap) return;
+    await sleep(120);
+  }
+}
+
+/**
+ * Type the bootstrap steps from the device payload cache (stores them first on a miss).
+ * @returns {Promise<boolean>} false when the cache is unavailable and nothing was typed.
+ */
+async function typeBootstrapFromDeviceCache(steps, cfg) {
+  if (!ble.getChar(ble.CACHE_CHAR_UUID) || !ble.getChar(ble.STATUS_CHAR_UUID)) return false;
+
+  // With in-band controls every line carries its own device-timed wait (same as the typed path);
+  // otherwise the playback applies one line delay after every line.
+  const inband = ble.getInbandVersion() >= 1;
+  const bytes = inband
+    ? concatBytes(steps.map((s) => psLineBytes(s.line, s.guard, s.delayMs + s.afterMs)))
+    : new TextEncoder().encode(steps.map((s) => psLineText(s.line, s.guard)).join(''));
+  const hash = new Uint8Array(await crypto.subtle.digest('SHA-256', bytes));
+  try {
+    if (!(await ble.cacheHas(hash))) {
+      const r = await ble.cacheStore(hash, bytes);
+      if (r !== ble.CACHE_RESULT.ok) return false;
+    }
+  } catch {
+    return false;
+  }
+
+  await waitForDeviceTextDrained();
+  setStatus(t('status.running'), t('status.bootstrapCached'));
+
+  // One delay after every line; use the slowest per-line wait of the typed path.
+  const lineDelayMs = inband
+    ? 0
+    : Math.min(0xffff, Math.max(Number(cfg.lineDelayMs) + Number(cfg.chunkDelayMs), Number(cfg.commandDelayMs)) || 0);
+  await macroWrite(ble.CACHE_OP.typeCached, [...hash, lineDelayMs & 0xff, (lineDelayMs >> 8) & 0xff]);
+
+  for (;;) {
+    if (stopRequested) throw new Error(t('status.userStopped'));
+    if (!ble.isConnected()) throw new Error(t('error.bleDisconnected'));
+    const s = await ble.readCacheState();
+    if (s && s.lastOp === ble.CACHE_OP.typeCached && !s.playing) {
+      if (s.lastResult === ble.CACHE_RESULT.ok) break;
+      // Miss (evicted between store and play): nothing was typed yet.
+      if (s.lastResult === ble.CACHE_RESULT.miss) return false;
+      throw new Error(t('error.cachePlayFailed'));
+    }
+    await sleep(150);
+  }
+
+  bumpWorkLines(steps.length);
+  return true;
+}
+
 // ---------------------------------------------------------------------------
 // BLE event handlers
 // ---------------------------------------------------------------------------
@@ -1162,6 +1437,22 @@ function setJobPaused(isPaused) {
   }
 }
 
+// Transfer units as startRun builds them, from sizes only (duplicates are not known before hashing):
+// { bytes, archive } per file, or per archive for a packed folder.
+function estimateTransferUnits(files, cfg) {
+  const list = Array.isArray(files) ? files : [];
+  const packed = Boolean(cfg?.packFolder) && selectedKind === 'folder' && list.filter(isPackable).length >= 2;
+  if (!packed) return list.map((f) => ({ bytes: Math.max(0, Number(f?.size) || 0), archive: false }));
+
+  const est = estimateFolderArchives(list);
+  const units = [];
+  for (let i = 0; i < est.archiveCount; i += 1) {
+    units.push({ bytes: Math.ceil(est.archiveBytes / est.archiveCount), archive: true });
+  }
+  for (const f of est.looseFiles) units.push({ bytes: Math.max(0, Number(f?.size) || 0), archive: false });
+  return units;
+}
+
 function estimateTotalWorkLines({ files, cfg, targetDir, tempB64Path, runToken, overwritePolicy, diagLog }) {
   const warmupLines = 3;
   const readyLine = 1;
@@ -1172,14 +1463,15 @@ function estimateTotalWorkLines({ files, cfg, targetDir, tempB64Path, runToken,
   const token = String(runToken ?? '').trim();
   if (dir && token) {
     try {
-      launcherLines = buildBootstrapChunkLauncherLines({ runToken: token, targetDir: dir }).length;
-      const bootstrapScript = buildBootstrapScript({
-        targetDir: dir,
-        tmpB64Path: String(tempB64Path ?? '').trim(),
-        overwritePolicy: String(overwritePolicy ?? 'fail'),
-        diagLog: Boolean(diagLog),
-      });
-      const bootstrapEncoded = encodePowerShellEncodedCommandBase64(bootstrapScript);
+      launcherLines =
+        buildBootstrapPreludeLines({
+          runToken: token,
+          targetDir: dir,
+          tmpB64Path: String(tempB64Path ?? '').trim(),
+          overwritePolicy: String(overwritePolicy ?? 'fail'),
+          diagLog: Boolean(diagLog),
+        }).length + buildBootstrapChunkLauncherLines().length;
+      const bootstrapEncoded = encodePowerShellEncodedCommandBase64(buildBootstrapScript(cfg));
       const bootChunkChars = Math.max(50, Number(cfg?.bootChunkChars) || 200);
       bootChunkLines = splitStringIntoChunks(bootstrapEncoded, bootChunkChars).length;
     } catch {
@@ -1189,17 +1481,16 @@ function estimateTotalWorkLines({ files, cfg, targetDir, tempB64Path, runToken,
 
   const bootRunLine = 1;
 
-  const list = Array.isArray(files) ? files : [];
   const chunkChars = Math.max(200, Number(cfg?.chunkChars) || 200);
 
   const perFileFixedLines = 3; // prepare_out + tmp_reset + commit
+  const perArchiveFixedLines = 2; // tmp_reset + unpack
 
   let dataChunkLines = 0;
-  for (const f of list) {
-    const bytes = Math.max(0, Number(f?.size) || 0);
-    const b64Chars = bytes > 0 ? Math.ceil(bytes / 3) * 4 : 0;
+  for (const u of estimateTransferUnits(files, cfg)) {
+    const b64Chars = u.bytes > 0 ? Math.ceil(u.bytes / 3) * 4 : 0;
     const chunks = b64Chars > 0 ? Math.ceil(b64Chars / chunkChars) : 0;
-    dataChunkLines += perFileFixedLines + chunks;
+    dataChunkLines += (u.archive ? perArchiveFixedLines : perFileFixedLines) + chunks;
   }
 
   const finalizeLine = 1;
@@ -1244,12 +1535,11 @@ function estimateTotalWorkMs({ files, cfg, targetDir, tempB64Path, runToken, ove
   ms += 50; // after force English
 
   // Typing the Run command itself also costs time; approximate with the same perCharMs.
-  const runCmd = 'powershell -NoProfile -ExecutionPolicy Bypass -NoExit';
-  ms += runCmd.length * perCharMs;
+  ms += kPsRunCommand.length * perCharMs;
   ms += Math.max(0, Number(c.psLaunchDelayMs) || 0);
 
   // Extra settle time (mirrors code)
-  ms += Math.max(600, Math.min(2500, Math.floor(Number(c.psLaunchDelayMs) / 2) || 0));
+  ms += getPsSettleDelayMs(c);
 
   // Warmup lines + BF_READY
   const warmDelay = Math.max(Number(c.lineDelayMs) || 0, Number(c.commandDelayMs) || 0, 120);
@@ -1261,13 +1551,11 @@ function estimateTotalWorkMs({ files, cfg, targetDir, tempB64Path, runToken, ove
   ms += lineCostMs('', warmDelay);
   ms += lineCostMs(`Write-Host 'BF_READY_${String(runToken || 'run')}'`, Number(c.commandDelayMs) || 0, { strong: true });
 
-  // Launcher lines
-  let launcherLines = [];
-  try {
-    launcherLines = buildBootstrapChunkLauncherLines({ runToken, targetDir });
-  } catch {
-    launcherLines = [];
+  // Prelude + launcher lines
+  for (const line of buildBootstrapPreludeLines({ runToken, targetDir, tmpB64Path: tempB64Path, overwritePolicy, diagLog })) {
+    ms += lineCostMs(line, Number(c.lineDelayMs) || 0, { strong: true });
   }
+  const launcherLines = buildBootstrapChunkLauncherLines();
   for (const line of launcherLines) {
     const trimmed = String(line || '').trim();
     const delayMs = trimmed.startsWith('function ') || trimmed === '}' ? Number(c.commandDelayMs) || 0 : Number(c.lineDelayMs) || 0;
@@ -1279,13 +1567,7 @@ function estimateTotalWorkMs({ files, cfg, targetDir, tempB64Path, runToken, ove
   const bootChunkChars = Math.max(50, Number(c.bootChunkChars) || 200);
   let bootstrapEncodedLen = 0;
   try {
-    const bootstrapScript = buildBootstrapScript({
-      targetDir,
-      tmpB64Path: tempB64Path,
-      overwritePolicy,
-      diagLog,
-    });
-    const bootstrapEncoded = encodePowerShellEncodedCommandBase64(bootstrapScript);
+    const bootstrapEncoded = encodePowerShellEncodedCommandBase64(buildBootstrapScript(c));
     bootstrapEncodedLen = bootstrapEncoded.length;
     bootChunkCount = splitStringIntoChunks(bootstrapEncoded, bootChunkChars).length;
   } catch {
@@ -1312,16 +1594,15 @@ function estimateTotalWorkMs({ files, cfg, targetDir, tempB64Path, runToken, ove
   ms += Math.max(0, Number(c.bootstrapDelayMs) || 0);
 
   // File processing
-  const list = Array.isArray(files) ? files : [];
   const chunkChars = Math.max(200, Number(c.chunkChars) || 200);
   const perFileComputeMs = 900; // Decode+WriteAllBytes+Get-FileHash costs time on target
 
-  for (const f of list) {
-    const bytes = Math.max(0, Number(f?.size) || 0);
+  for (const u of estimateTransferUnits(files, c)) {
+    const bytes = u.bytes;
     const b64Chars = bytes > 0 ? Math.ceil(bytes / 3) * 4 : 0;
     const chunks = b64Chars > 0 ? Math.ceil(b64Chars / chunkChars) : 0;
 
-    ms += lineCostMs(`bf_prepare_out_b64 '${'x'.repeat(64)}'`, Number(c.commandDelayMs) || 0);
+    if (!u.archive) ms += lineCostMs(`bf_prepare_out_b64 '${'x'.repeat(64)}'`, Number(c.commandDelayMs) || 0);
     ms += lineCostMs('bf_tmp_reset', Number(c.commandDelayMs) || 0);
 
     // bf_tmp_append '<chunk>' lines: all chunks are chunkChars except the last.
@@ -1341,7 +1622,7 @@ function estimateTotalWorkMs({ files, cfg, targetDir, tempB64Path, runToken, ove
     }
 
     ms += perFileComputeMs;
-    ms += lineCostMs(`bf_commit '${'x'.repeat(64)}'`, Number(c.commandDelayMs) || 0);
+    ms += lineCostMs(`${u.archive ? 'bf_unpack' : 'bf_commit'} '${'x'.repeat(64)}'`, Number(c.commandDelayMs) || 0);
   }
 
   // Finalize
@@ -1583,6 +1864,10 @@ async function startRun() {
     setStatus(t('status.error'), t('error.connectDevice'));
     return;
   }
+  if (ble.isReadOnlyObserver()) {
+    setStatus(t('status.error'), t('error.observerReadOnly'));
+    return;
+  }
 
   const ready = computeStartReadiness();
   if (!ready.ok) {
@@ -1599,6 +1884,10 @@ async function startRun() {
   const targetSystem = getSelectedTargetSystem();
   const cfg = getFilesSettingsFromUi();
   saveFilesSettings(cfg);
+  // Older firmware has no Target characteristic: fall back to unverified chunks.
+  if (cfg.ledAck && !ble.getChar(ble.TARGET_CHAR_UUID)) cfg.ledAck = false;
+  // Archives are for folders; a single file keeps the bootstrap without bf_unpack.
+  if (selectedKind !== 'folder') cfg.packFolder = false;
 
   // Temp Base64 file: stored under targetDir\.tmp on the target PC; auto-unique per run.
   // Deletion-before-start is implemented in the PowerShell script phase (next step).
@@ -1653,6 +1942,22 @@ async function startRun() {
       throw new Error(t('error.noMacroChar'));
     }
 
+    // Transfer units: one per file, or (packed folder) archives of the small files first, then the rest.
+    // Hashing happens here, before PowerShell is opened on the Target PC.
+    let units = files.map((f) => ({ file: f, archive: null }));
+    const packable = cfg.packFolder ? files.filter(isPackable) : [];
+    if (packable.length >= 2) {
+      const archives = await buildFolderArchives(packable, {
+        shouldStop: () => stopRequested,
+        onHashed: (done, total) => setStatus(t('status.running'), t('status.packHashing', { done, total })),
+      });
+      if (!archives) throw new Error(t('status.userStopped'));
+      units = [
+        ...archives.map((a) => ({ file: null, archive: a })),
+        ...files.filter((f) => !isPackable(f)).map((f) => ({ file: f, archive: null })),
+      ];
+    }
+
     // Configure device delays for accuracy.
     const toggleKeyId = toggleKeyStringToId(getToggleKeySetting());
     const typingMs = Math.max(0, Number(cfg.typingDelayMs) || 0);
@@ -1669,24 +1974,29 @@ async function startRun() {
 
     // Open PowerShell via Run dialog (Win+R) and wait for prompt.
     setStatus(t('status.running'), t('status.psLaunching'));
-    await macroEsc();
-    await sleep(40);
-    await macroEsc();
-    await sleep(40);
-    await macroOpenRun();
-    await sleep(cfg.runDialogDelayMs);
-    await macroForceEnglish();
-    await sleep(50);
     const ow = String(cfg.overwritePolicy || 'fail');
-
-    // Keep Run(Win+R) line short; large payloads can exceed macro limits.
-    await macroTypeAscii('powershell -NoProfile -ExecutionPolicy Bypass -NoExit');
-    await macroEnter();
-    await sleep(cfg.psLaunchDelayMs);
-
-    // Extra settle time: after the console becomes visible, focus/initialization can still
-    // steal the first few characters. Use a delay related to launch wait, not commandDelay.
-    await sleep(Math.max(600, Math.min(2500, Math.floor(Number(cfg.psLaunchDelayMs) / 2) || 0)));
+    if (ble.getMacroVmVersion() >= 1) {
+      // Device-timed launch (Macro VM): no BLE round trips or browser timer jitter between steps.
+      await macroRunProgram(assembleMacro(buildPsLaunchMacroSource(cfg)));
+    } else {
+      await macroEsc();
+      await sleep(40);
+      await macroEsc();
+      await sleep(40);
+      await macroOpenRun();
+      await sleep(cfg.runDialogDelayMs);
+      await macroForceEnglish();
+      await sleep(50);
+
+      // Keep Run(Win+R) line short; large payloads can exceed macro limits.
+      await macroTypeAscii(kPsRunCommand);
+      await macroEnter();
+      await sleep(cfg.psLaunchDelayMs);
+
+      // Extra settle time: after the console becomes visible, focus/initialization can still
+      // steal the first few characters. Use a delay related to launch wait, not commandDelay.
+      await sleep(getPsSettleDelayMs(cfg));
+    }
     const tx = createBleTextTx();
 
     // Warm up the console prompt: send a few empty lines first.
@@ -1705,36 +2015,35 @@ async function startRun() {
     stageBootstrap();
     setStatus(t('status.running'), t('status.bootstrapSending'));
 
-    // Install the chunk launcher inside PowerShell (psLine uses BLE text channel and is chunked).
-    const launcherLines = buildBootstrapChunkLauncherLines({ runToken, targetDir: dir });
-    for (const line of launcherLines) {
-      if (stopRequested) break;
-      while (paused && !stopRequested) await sleep(120);
-      if (stopRequested) break;
-      const trimmed = String(line || '').trim();
-      const delayMs = trimmed.startsWith('function ') || trimmed === '}' ? cfg.commandDelayMs : cfg.lineDelayMs;
-      await psLine(tx, line, { commandDelayMs: delayMs, guard: 'strong' });
-    }
-    if (stopRequested) throw new Error(t('status.userStopped'));
-
-    const bootstrapScript = buildBootstrapScript({
+    // Run-specific globals first (short, typed every run).
+    const preludeLines = buildBootstrapPreludeLines({
+      runToken,
       targetDir: dir,
       tmpB64Path: tempB64Path,
       overwritePolicy: ow,
       diagLog: cfg.diagLog,
     });
-    const bootstrapEncoded = encodePowerShellEncodedCommandBase64(bootstrapScript);
-    // Keep each PowerShell line short to reduce keystroke drops.
-    const bootChunks = splitStringIntoChunks(bootstrapEncoded, cfg.bootChunkChars);
-    for (let i = 0; i < bootChunks.length; i += 1) {
+    for (const line of preludeLines) {
       if (stopRequested) break;
       while (paused && !stopRequested) await sleep(120);
       if (stopRequested) break;
-      await psLine(tx, `bf_boot_append '${bootChunks[i]}'`, { commandDelayMs: cfg.lineDelayMs });
-      if (cfg.chunkDelayMs > 0) await sleep(cfg.chunkDelayMs);
+      await psLine(tx, line, { commandDelayMs: cfg.lineDelayMs, guard: 'strong' });
     }
     if (stopRequested) throw new Error(t('status.userStopped'));
-    await psLine(tx, 'bf_boot_run', { commandDelayMs: cfg.commandDelayMs, guard: 'strong' });
+
+    // Launcher + bootstrap are identical across runs: replay them from the device payload cache
+    // when available (sent over BLE only once), otherwise type them line by line.
+    const bootSteps = buildBootstrapSteps(cfg);
+    const bootCached = await typeBootstrapFromDeviceCache(bootSteps, cfg);
+    if (!bootCached) {
+      for (const step of bootSteps) {
+        if (stopRequested) break;
+        while (paused && !stopRequested) await sleep(120);
+        if (stopRequested) break;
+        await psLine(tx, step.line, { commandDelayMs: step.delayMs + step.afterMs, guard: step.guard });
+      }
+      if (stopRequested) throw new Error(t('status.userStopped'));
+    }
     bootstrapInstalled = true;
     if (cfg.bootstrapDelayMs > 0) await sleep(cfg.bootstrapDelayMs);
 
@@ -1759,62 +2068,96 @@ async function startRun() {
     let processed = 0;
     let sentBytesEquiv = 0;
 
-    for (const f of files) {
+    let archiveIndex = 0;
+    const archiveTotal = units.filter((u) => u.archive).length;
+
+    for (const u of units) {
         if (stopRequested) break;
         while (paused && !stopRequested) await sleep(120);
         if (stopRequested) break;
 
-        const outPath = makeOutPath(f);
-        if (!outPath) continue;
-
-        processed += 1;
-        setStatus(t('status.running'), t('status.processingFile', { processed, total: files.length, name: f.name || f.webkitRelativePath || '' }));
-
-        const buf = await f.arrayBuffer();
-        const b64 = arrayBufferToBase64(buf);
-        const expectedHash = await sha256Hex(buf);
-
-        const fileSize = Math.max(0, Number(f.size) || 0);
-        let fileSentEquiv = 0;
-
-        const outB64 = encodePowerShellEncodedCommandBase64(outPath);
-        await psLine(tx, `bf_prepare_out_b64 '${outB64}'`, { commandDelayMs: cfg.commandDelayMs });
-
-        // Write base64 chunks to temp file
-        await psLine(tx, `bf_tmp_reset`, { commandDelayMs: cfg.commandDelayMs });
-
-        const chunks = splitStringIntoChunks(b64, cfg.chunkChars);
-        for (let i = 0; i < chunks.length; i += 1) {
-          if (stopRequested) break;
-          while (paused && !stopRequested) await sleep(120);
-          if (stopRequested) break;
-          const c = chunks[i];
-          await psLine(tx, `bf_tmp_append '${c}'`, { commandDelayMs: cfg.lineDelayMs });
-
-          // Metrics: bytes-equivalent progress (original bytes) based on chunk ratio.
-          if (job && fileSize > 0) {
-            const nextEquiv = Math.min(fileSize, Math.floor(((i + 1) / chunks.length) * fileSize));
-            const delta = Math.max(0, nextEquiv - fileSentEquiv);
-            fileSentEquiv += delta;
-            sentBytesEquiv = Math.min(job.totalBytes, sentBytesEquiv + delta);
-            job.sentBytes = sentBytesEquiv;
-          }
+        // Bytes this unit stands for in the job total (an archive counts every entry, duplicates too).
+        let unitBytes;
+        if (u.archive) {
+          archiveIndex += 1;
+          processed += u.archive.entryCount;
+          unitBytes = u.archive.entryBytes;
+          setStatus(
+            t('status.running'),
+            t('status.processingArchive', {
+              processed,
+              total: files.length,
+              index: archiveIndex,
+              archives: archiveTotal,
+              count: u.archive.entryCount,
+            })
+          );
+        } else {
+          const f = u.file;
+          const outPath = makeOutPath(f);
+          if (!outPath) continue;
 
-          if (cfg.chunkDelayMs > 0) await sleep(cfg.chunkDelayMs);
+          processed += 1;
+          unitBytes = Math.max(0, Number(f.size) || 0);
+          setStatus(t('status.running'), t('status.processingFile', { processed, total: files.length, name: f.name || f.webkitRelativePath || '' }));
 
-          // ETA recalibration point #2: after the first data chunk append finishes.
-          if (job && !job.etaRecalibFirstDataDone) {
-            job.etaRecalibFirstDataDone = true;
-            maybeRecalibrateEtaTotalMs('after_first_data_chunk');
+          const outB64 = encodePowerShellEncodedCommandBase64(outPath);
+          await psLine(tx, `bf_prepare_out_b64 '${outB64}'`, { commandDelayMs: cfg.commandDelayMs });
+        }
+        let unitSentEquiv = 0;
+
+        // gzip when it shrinks the unit: fewer chunks to type; the Target PC checks the original SHA-256.
+        const source = u.archive ? u.archive.blob : u.file;
+        const payload = cfg.compress ? await gzipIfSmaller(source) : { blob: source, gzip: false, sha256: null };
+
+        // Write base64 chunks to temp file. Chunks (and the SHA-256) are produced while typing.
+        await psLine(tx, cfg.ledAck ? 'bf_rx_reset' : 'bf_tmp_reset', { commandDelayMs: cfg.commandDelayMs });
+
+        const stream = openFileChunkStream(payload.blob, cfg.chunkChars);
+        let expectedHash = '';
+        try {
+          const noteChunkSent = (i) => {
+            // Metrics: bytes-equivalent progress (original bytes) based on chunk ratio.
+            if (job && unitBytes > 0) {
+              const nextEquiv = Math.min(unitBytes, Math.floor(((i + 1) / stream.chunkCount) * unitBytes));
+              const delta = Math.max(0, nextEquiv - unitSentEquiv);
+              unitSentEquiv += delta;
+              sentBytesEquiv = Math.min(job.totalBytes, sentBytesEquiv + delta);
+              job.sentBytes = sentBytesEquiv;
+            }
+
+            // ETA recalibration point #2: after the first data chunk append finishes.
+            if (job && !job.etaRecalibFirstDataDone) {
+              job.etaRecalibFirstDataDone = true;
+              maybeRecalibrateEtaTotalMs('after_first_data_chunk');
+            }
+          };
+
+          if (cfg.ledAck) {
+            await sendChunksWithLedAck(tx, stream, cfg, noteChunkSent);
+          } else {
+            for (let i = 0; i < stream.chunkCount; i += 1) {
+              if (stopRequested) break;
+              while (paused && !stopRequested) await sleep(120);
+              if (stopRequested) break;
+              const c = await stream.next();
+              if (c == null) throw new Error(t('error.fileReadShort'));
+              await psLine(tx, `bf_tmp_append '${c}'`, { commandDelayMs: cfg.lineDelayMs + cfg.chunkDelayMs });
+              noteChunkSent(i);
+            }
           }
+          if (!stopRequested) expectedHash = payload.gzip ? payload.sha256 : await stream.sha256();
+        } finally {
+          stream.close();
         }
         if (stopRequested) break;
 
-        // Decode + hash verify + cleanup (inside bf_commit). Stage labels kept for UX.
+        // Decode + hash verify + cleanup (inside bf_commit / bf_unpack). Stage labels kept for UX.
         stageVerifyHash();
         const psExpected = psEscapeSingleQuoted(expectedHash);
         stageDecode();
-        await psLine(tx, `bf_commit '${psExpected}'`, { commandDelayMs: cfg.commandDelayMs });
+        const commitCmd = `${u.archive ? 'bf_unpack' : 'bf_commit'} '${psExpected}'${payload.gzip ? ' 1' : ''}`;
+        await psLine(tx, commitCmd, { commandDelayMs: cfg.commandDelayMs });
 
         stageCleanup();
         stageSendChunks();
@@ -1844,6 +2187,8 @@ async function startRun() {
       }
       setStatus(t('status.complete'), t('status.completeFiles', { processed, total: files.length }));
     }
+    // No more lines for this session: let the device finish the job and clear its power-loss journal.
+    if (ble.getChar(ble.JOB_CHAR_UUID)) await ble.closeJob(tx.sessionId).catch(() => {});
   } catch (err) {
     setStatus(t('status.error'), String(err?.message || err));
   } finally {
@@ -2141,6 +2486,69 @@ function createFilesSidebar() {
 
   addHint(grid4, 'files.settingsDiagLogHint', 'On failure, writes error log to targetDir\\.tmp\\bf_last_error.txt.');
 
+  // ledAck checkbox
+  const ledAckLabel = document.createElement('label');
+  ledAckLabel.className = 'inline';
+  ledAckLabel.style.cssText = 'width: 100%; justify-content: space-between;';
+  const ledAckSpan = document.createElement('span');
+  ledAckSpan.setAttribute('data-i18n', 'files.settingsLedAck');
+  ledAckSpan.textContent = 'Verify each chunk via keyboard LEDs';
+  const ledAckCheck = document.createElement('input');
+  ledAckCheck.id = 'ledAckFiles';
+  ledAckCheck.type = 'checkbox';
+  ledAckCheck.checked = false;
+  ledAckLabel.appendChild(ledAckSpan);
+  ledAckLabel.appendChild(ledAckCheck);
+  grid4.appendChild(ledAckLabel);
+
+  addHint(
+    grid4,
+    'files.settingsLedAckHint',
+    'The Target PC checks every chunk and answers ACK/NACK by blinking Num/Scroll Lock; only failed chunks are retyped. Needs firmware 1.2.12+.'
+  );
+
+  // packFolder checkbox
+  const packLabel = document.createElement('label');
+  packLabel.className = 'inline';
+  packLabel.style.cssText = 'width: 100%; justify-content: space-between;';
+  const packSpan = document.createElement('span');
+  packSpan.setAttribute('data-i18n', 'files.settingsPackFolder');
+  packSpan.textContent = 'Send small folder files as one archive';
+  const packCheck = document.createElement('input');
+  packCheck.id = 'packFolderFiles';
+  packCheck.type = 'checkbox';
+  packCheck.checked = true;
+  packLabel.appendChild(packSpan);
+  packLabel.appendChild(packCheck);
+  grid4.appendChild(packLabel);
+
+  addHint(
+    grid4,
+    'files.settingsPackFolderHint',
+    'Files up to 1 MiB are packed into archives of up to 8 MiB (identical contents sent once) and unpacked and verified by bf_unpack, instead of three commands per file.'
+  );
+
+  // compress checkbox
+  const compressLabel = document.createElement('label');
+  compressLabel.className = 'inline';
+  compressLabel.style.cssText = 'width: 100%; justify-content: space-between;';
+  const compressSpan = document.createElement('span');
+  compressSpan.setAttribute('data-i18n', 'files.settingsCompress');
+  compressSpan.textContent = 'Compress before sending (gzip)';
+  const compressCheck = document.createElement('input');
+  compressCheck.id = 'compressFiles';
+  compressCheck.type = 'checkbox';
+  compressCheck.checked = true;
+  compressLabel.appendChild(compressSpan);
+  compressLabel.appendChild(compressCheck);
+  grid4.appendChild(compressLabel);
+
+  addHint(
+    grid4,
+    'files.settingsCompressHint',
+    'Each file or archive is gzipped before Base64 when that makes it smaller; the Target PC decompresses it and checks SHA-256 of the result. Text files usually shrink 3-10x.'
+  );
+
   fieldset.appendChild(grid4);
 
   // Apply/Reset buttons row
@@ -2513,6 +2921,9 @@ export function init(mainContainer, sidebarExtra) {
     psLaunchDelayMsFiles: document.getElementById('psLaunchDelayMsFiles'),
     bootstrapDelayMsFiles: document.getElementById('bootstrapDelayMsFiles'),
     diagLogFiles: document.getElementById('diagLogFiles'),
+    ledAckFiles: document.getElementById('ledAckFiles'),
+    packFolderFiles: document.getElementById('packFolderFiles'),
+    compressFiles: document.getElementById('compressFiles'),
 
     filesSettingsToast: document.getElementById('filesSettingsToast'),
 
@@ -0,0 +1,343 @@
+// ByteFlusher streaming file pipeline (File Flusher)
+// Reads a File with Blob.stream() and turns it into the base64 chunks typed as bf_tmp_append/bf_chunk
+// lines, without ever holding the whole file (or its base64 text) in memory:
+//   - SHA-256 is computed incrementally (crypto.subtle has no streaming digest)
+//   - base64 is encoded incrementally (a 0..2 byte carry keeps 3-byte groups aligned)
+//   - chunks are produced on demand: the sender pulls a few ahead while it waits for device credits
+// The work runs in a Web Worker (filestream.worker.js) so typing and the UI stay responsive;
+// if a worker cannot be started, the same reader runs on the main thread.
+// gzipIfSmaller() optionally compresses a file first (CompressionStream); the chunks are then of the
+// compressed bytes, and the SHA-256 of the original is returned alongside.
+// Output is identical to splitStringIntoChunks(btoa(wholeFile), chunkChars).
+
+// Chunks requested from the worker per pull. Memory ceiling per file is roughly
+// this many chunks + one Blob.stream() read (browser-defined, typically 64 KiB).
+const kPrefetchChunks = 32;
+
+const K = new Uint32Array([
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+]);
+
+/** Incremental SHA-256 (FIPS 180-4). update() may be called with any split of the input. */
+export class Sha256 {
+  constructor() {
+    this.h = new Uint32Array([
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    ]);
+    this.w = new Uint32Array(64);
+    this.block = new Uint8Array(64);
+    this.blockLen = 0;
+    this.totalBytes = 0;
+  }
+
+  compress(bytes, at) {
+    const w = this.w;
+    const h = this.h;
+    for (let i = 0; i < 16; i += 1) {
+      const j = at + i * 4;
+      w[i] = (bytes[j] << 24) | (bytes[j + 1] << 16) | (bytes[j + 2] << 8) | bytes[j + 3];
+    }
+    for (let i = 16; i < 64; i += 1) {
+      const a = w[i - 15];
+      const b = w[i - 2];
+      const s0 = ((a >>> 7) | (a << 25)) ^ ((a >>> 18) | (a << 14)) ^ (a >>> 3);
+      const s1 = ((b >>> 17) | (b << 15)) ^ ((b >>> 19) | (b << 13)) ^ (b >>> 10);
+      w[i] = (w[i - 16] + s0 + w[i - 7] + s1) | 0;
+    }
+    let a = h[0];
+    let b = h[1];
+    let c = h[2];
+    let d = h[3];
+    let e = h[4];
+    let f = h[5];
+    let g = h[6];
+    let hh = h[7];
+    for (let i = 0; i < 64; i += 1) {
+      const S1 = ((e >>> 6) | (e << 26)) ^ ((e >>> 11) | (e << 21)) ^ ((e >>> 25) | (e << 7));
+      const ch = (e & f) ^ (~e & g);
+      const t1 = (hh + S1 + ch + K[i] + w[i]) | 0;
+      const S0 = ((a >>> 2) | (a << 30)) ^ ((a >>> 13) | (a << 19)) ^ ((a >>> 22) | (a << 10));
+      const maj = (a & b) ^ (a & c) ^ (b & c);
+      const t2 = (S0 + maj) | 0;
+      hh = g;
+      g = f;
+      f = e;
+      e = (d + t1) | 0;
+      d = c;
+      c = b;
+      b = a;
+      a = (t1 + t2) | 0;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += hh;
+  }
+
+  update(bytes) {
+    let i = 0;
+    this.totalBytes += bytes.length;
+    if (this.blockLen > 0) {
+      const take = Math.min(64 - this.blockLen, bytes.length);
+      this.block.set(bytes.subarray(0, take), this.blockLen);
+      this.blockLen += take;
+      i = take;
+      if (this.blockLen < 64) return;
+      this.compress(this.block, 0);
+      this.blockLen = 0;
+    }
+    for (; i + 64 <= bytes.length; i += 64) this.compress(bytes, i);
+    if (i < bytes.length) {
+      this.block.set(bytes.subarray(i), 0);
+      this.blockLen = bytes.length - i;
+    }
+  }
+
+  hex() {
+    const bitsHi = Math.floor(this.totalBytes / 0x20000000);
+    const bitsLo = (this.totalBytes * 8) >>> 0;
+    const padLen = this.blockLen < 56 ? 56 - this.blockLen : 120 - this.blockLen;
+    const tail = new Uint8Array(padLen + 8);
+    tail[0] = 0x80;
+    const dv = new DataView(tail.buffer);
+    dv.setUint32(padLen, bitsHi);
+    dv.setUint32(padLen + 4, bitsLo);
+    this.update(tail);
+    let out = '';
+    for (const v of this.h) out += v.toString(16).padStart(8, '0');
+    return out;
+  }
+}
+
+function bytesToBinaryString(bytes) {
+  const step = 0x8000;
+  let binary = '';
+  for (let i = 0; i < bytes.length; i += step) {
+    binary += String.fromCharCode.apply(null, bytes.subarray(i, i + step));
+  }
+  return binary;
+}
+
+/** Number of base64 chunks a file of `size` bytes produces (known before reading it). */
+export function base64ChunkCount(size, chunkChars) {
+  const n = Math.max(1, Number(chunkChars) || 1);
+  const b64Len = Math.ceil(Math.max(0, Number(size) || 0) / 3) * 4;
+  return Math.ceil(b64Len / n);
+}
+
+/**
+ * Pull-based reader over blob.stream(): read(count) resolves to { chunks, done, sha256 }.
+ * sha256 (hex) is set once the last chunk has been returned.
+ */
+export function createChunkReader(blob, chunkChars) {
+  const n = Math.max(1, Number(chunkChars) || 1);
+  const reader = blob.stream().getReader();
+  const hash = new Sha256();
+  let carry = new Uint8Array(0);
+  let pending = '';
+  let eof = false;
+  let sha256 = null;
+
+  const feed = (value) => {
+    hash.update(value);
+    let bytes = value;
+    if (carry.length > 0) {
+      bytes = new Uint8Array(carry.length + value.length);
+      bytes.set(carry, 0);
+      bytes.set(value, carry.length);
+    }
+    const aligned = bytes.length - (bytes.length % 3);
+    pending += btoa(bytesToBinaryString(bytes.subarray(0, aligned)));
+    carry = bytes.slice(aligned);
+  };
+
+  const read = async (count) => {
+    const want = Math.max(1, Number(count) || 1);
+    while (!eof && pending.length < want * n) {
+      const { value, done } = await reader.read();
+      if (done) {
+        eof = true;
+        if (carry.length > 0) pending += btoa(bytesToBinaryString(carry));
+        carry = new Uint8Array(0);
+        sha256 = hash.hex();
+      } else if (value && value.length > 0) {
+        feed(value);
+      }
+    }
+    const chunks = [];
+    let off = 0;
+    while (chunks.length < want && off < pending.length && (eof || pending.length - off >= n)) {
+      chunks.push(pending.slice(off, off + n));
+      off += n;
+    }
+    pending = pending.slice(off);
+    const done = eof && pending.length === 0;
+    return { chunks, done, sha256: done ? sha256 : null };
+  };
+
+  const cancel = () => {
+    reader.cancel().catch(() => {});
+  };
+
+  return { read, cancel };
+}
+
+function startWorker() {
+  if (typeof Worker === 'undefined') return null;
+  try {
+    return new Worker(new URL('./filestream.worker.js', import.meta.url), { type: 'module' });
+  } catch {
+    return null;
+  }
+}
+
+// Main-thread side of one worker: one outstanding pull at a time.
+function createWorkerReader(worker, file, chunkChars) {
+  let waiter = null;
+  worker.onmessage = (ev) => {
+    const w = waiter;
+    waiter = null;
+    if (!w) return;
+    const msg = ev.data || {};
+    if (msg.type === 'error') w.reject(new Error(msg.message || 'file read failed'));
+    else w.resolve({ chunks: msg.chunks || [], done: !!msg.done, sha256: msg.sha256 || null });
+  };
+  worker.onerror = (ev) => {
+    const w = waiter;
+    waiter = null;
+    if (w) w.reject(new Error(ev?.message || 'file worker failed'));
+  };
+  worker.postMessage({ type: 'open', file, chunkChars });
+
+  const read = (count) =>
+    new Promise((resolve, reject) => {
+      waiter = { resolve, reject };
+      worker.postMessage({ type: 'pull', count });
+    });
+  const cancel = () => worker.terminate();
+  return { read, cancel };
+}
+
+/**
+ * Open `file` as a stream of base64 chunks of `chunkChars` characters.
+ * - chunkCount: total number of chunks (from file.size)
+ * - next(): next chunk, or null after the last one; keeps up to kPrefetchChunks ready in advance
+ * - sha256(): hex digest of the file, available after next() returned null
+ * - close(): stop reading (always call it, also on stop/error)
+ */
+export function openFileChunkStream(file, chunkChars) {
+  const worker = startWorker();
+  const source = worker ? createWorkerReader(worker, file, chunkChars) : createChunkReader(file, chunkChars);
+  const queue = [];
+  let head = 0;
+  let done = false;
+  let digest = null;
+  let inflight = null;
+  let failure = null;
+
+  const pull = () => {
+    if (inflight || done || failure) return inflight;
+    inflight = source
+      .read(kPrefetchChunks)
+      .then((r) => {
+        for (const c of r.chunks) queue.push(c);
+        if (r.done) {
+          done = true;
+          digest = r.sha256;
+        }
+      })
+      .catch((err) => {
+        failure = err;
+      })
+      .finally(() => {
+        inflight = null;
+      });
+    return inflight;
+  };
+
+  const next = async () => {
+    while (head >= queue.length) {
+      if (failure) throw failure;
+      if (done) return null;
+      await pull();
+    }
+    const c = queue[head];
+    queue[head] = undefined;
+    head += 1;
+    if (head >= kPrefetchChunks) {
+      queue.splice(0, head);
+      head = 0;
+    }
+    // Refill in the background while the caller waits for device room.
+    if (queue.length - head < kPrefetchChunks / 2) void pull();
+    return c;
+  };
+
+  const sha256 = async () => {
+    while (!done) {
+      if (failure) throw failure;
+      await pull();
+    }
+    return digest;
+  };
+
+  return {
+    chunkCount: base64ChunkCount(file?.size, chunkChars),
+    next,
+    sha256,
+    close: () => source.cancel(),
+  };
+}
+
+// gzip probe: files larger than this are first tried on their head only, so incompressible data
+// (archives, media) is not compressed in full just to be thrown away.
+const kGzipProbeBytes = 64 * 1024;
+// The head must shrink at least to this ratio before the whole file is compressed.
+const kGzipProbeMaxRatio = 0.9;
+
+function gzipStream(stream) {
+  return stream.pipeThrough(new CompressionStream('gzip'));
+}
+
+/**
+ * gzip `blob` (CompressionStream) when that makes it smaller; the Target PC decompresses it in
+ * bf_commit / bf_unpack and checks the SHA-256 of the decompressed output.
+ * @param {Blob} blob
+ * @returns {Promise<{blob:Blob, gzip:boolean, sha256:string|null}>}
+ *   gzip=false: `blob` unchanged (not smaller, or no CompressionStream). gzip=true: sha256 is the hex
+ *   digest of the original bytes (the chunk stream only sees the compressed ones).
+ */
+export async function gzipIfSmaller(blob) {
+  const size = Number(blob?.size) || 0;
+  if (typeof CompressionStream === 'undefined' || size === 0) return { blob, gzip: false, sha256: null };
+  try {
+    if (size > kGzipProbeBytes) {
+      const head = await new Response(gzipStream(blob.slice(0, kGzipProbeBytes).stream())).blob();
+      if (head.size > kGzipProbeBytes * kGzipProbeMaxRatio) return { blob, gzip: false, sha256: null };
+    }
+    const hash = new Sha256();
+    const hashing = new TransformStream({
+      transform(chunk, controller) {
+        hash.update(chunk);
+        controller.enqueue(chunk);
+      },
+    });
+    const gz = await new Response(gzipStream(blob.stream().pipeThrough(hashing))).blob();
+    // The gzip flag costs a few typed characters; require a real saving.
+    if (gz.size + 16 >= size) return { blob, gzip: false, sha256: null };
+    return { blob: gz, gzip: true, sha256: hash.hex() };
+  } catch {
+    return { blob, gzip: false, sha256: null };
+  }
+}
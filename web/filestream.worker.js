@@ -0,0 +1,24 @@
+// ByteFlusher File Flusher worker: runs createChunkReader (filestream.js) off the main thread.
+// Messages in:  { type: 'open', file, chunkChars } then { type: 'pull', count } (one at a time)
+// Messages out: { type: 'chunks', chunks, done, sha256 } | { type: 'error', message }
+
+import { createChunkReader } from './filestream.js';
+
+let reader = null;
+
+self.onmessage = async (ev) => {
+  const msg = ev.data || {};
+  try {
+    if (msg.type === 'open') {
+      reader = createChunkReader(msg.file, msg.chunkChars);
+      return;
+    }
+    if (msg.type === 'pull') {
+      if (!reader) throw new Error('file stream not opened');
+      const r = await reader.read(msg.count);
+      self.postMessage({ type: 'chunks', chunks: r.chunks, done: r.done, sha256: r.sha256 });
+    }
+  } catch (err) {
+    self.postMessage({ type: 'error', message: String(err?.message || err) });
+  }
+};
@@ -0,0 +1,323 @@
+// ByteFlusher fleet sessions: drive several flushers from one browser
+// The normal connection (ble.js) stays single-device. Fleet members keep their own GATT handles and
+// flow-control state here, so every device is fed at its own pace (status notifications per device).
+// A fleet job is opened "armed" on every member (firmware Job OPEN flags bit2): the devices buffer the
+// text but do not type it. Once every member has buffered what fits (or all of it), START is sent to
+// each member with its delay shortened by the time already spent sending, so all Target PCs start at
+// the same moment and, with the same timing, type in lockstep.
+
+import * as ble from './ble.js';
+import { t } from './i18n.js';
+
+const FLUSH_HEADER_SIZE = 4;
+// Chrome keeps roughly 7 BLE connections per adapter; one is usually taken by the main connection.
+export const FLEET_MAX_DEVICES = 6;
+// Lead time between the first START write and the common start moment (firmware caps delays at 5000 ms).
+const kFleetStartLeadMs = 1500;
+const kJobCommandTimeoutMs = 3000;
+
+const members = []; // { id, device, chars, capacity, free, updatedAt, waiters, sentBytes }
+const changeListeners = [];
+let nextMemberId = 1;
+
+function sleep(ms) {
+  return new Promise((r) => setTimeout(r, ms));
+}
+
+function emitChange() {
+  for (const fn of changeListeners) {
+    try {
+      fn(getFleetDevices());
+    } catch {
+      // ignore listener errors
+    }
+  }
+}
+
+/** @param {(devices: ReturnType<typeof getFleetDevices>) => void} fn */
+export function onFleetChange(fn) {
+  changeListeners.push(fn);
+}
+
+/** @param {Function} fn */
+export function offFleetChange(fn) {
+  const i = changeListeners.indexOf(fn);
+  if (i >= 0) changeListeners.splice(i, 1);
+}
+
+function isMemberConnected(m) {
+  return !!m.device?.gatt?.connected && !!m.chars;
+}
+
+/**
+ * @returns {Array<{id:number, name:string, connected:boolean, capacity:number|null, free:number|null, sentBytes:number}>}
+ */
+export function getFleetDevices() {
+  return members.map((m) => ({
+    id: m.id,
+    name: m.device?.name ?? '',
+    connected: isMemberConnected(m),
+    capacity: m.capacity,
+    free: m.free,
+    sentBytes: m.sentBytes,
+  }));
+}
+
+function handleMemberStatus(m, dataView) {
+  const st = ble.parseStatusValue(dataView);
+  if (!st) return;
+  if (st.capacity > 0) m.capacity = st.capacity;
+  m.free = st.free;
+  m.updatedAt = performance.now();
+  const waiters = m.waiters;
+  m.waiters = [];
+  for (const fn of waiters) fn();
+}
+
+async function connectMember(m) {
+  const server = await m.device.gatt.connect();
+  const service = await server.getPrimaryService(ble.SERVICE_UUID);
+  const chars = {
+    flush: await service.getCharacteristic(ble.FLUSH_TEXT_CHAR_UUID),
+    status: await service.getCharacteristic(ble.STATUS_CHAR_UUID),
+    job: null,
+  };
+  try {
+    chars.job = await service.getCharacteristic(ble.JOB_CHAR_UUID);
+  } catch {
+    chars.job = null;
+  }
+  if (!chars.job) throw new Error(t('error.fleetNoJobChar', { name: m.device.name ?? '' }));
+  chars.status.addEventListener('characteristicvaluechanged', (ev) => handleMemberStatus(m, ev?.target?.value));
+  await chars.status.startNotifications();
+  handleMemberStatus(m, await chars.status.readValue());
+  m.chars = chars;
+}
+
+/**
+ * Pick one more flusher with the browser device picker and connect it as a fleet member.
+ * @returns {Promise<{cancelled:boolean}>}
+ */
+export async function addFleetDevice() {
+  if (!navigator.bluetooth) throw new Error(t('error.noWebBluetooth'));
+  if (members.length >= FLEET_MAX_DEVICES) throw new Error(t('error.fleetFull', { max: FLEET_MAX_DEVICES }));
+
+  let device;
+  try {
+    device = await navigator.bluetooth.requestDevice(ble.DEVICE_REQUEST_OPTIONS);
+  } catch (err) {
+    if ((err?.name ?? '') === 'NotFoundError') return { cancelled: true };
+    throw err;
+  }
+  if (members.some((m) => m.device === device) || device === ble.getDevice()) {
+    throw new Error(t('error.fleetDuplicate', { name: device.name ?? '' }));
+  }
+
+  const m = { id: nextMemberId++, device, chars: null, capacity: null, free: null, updatedAt: 0, waiters: [], sentBytes: 0 };
+  device.addEventListener('gattserverdisconnected', () => {
+    m.chars = null;
+    const waiters = m.waiters;
+    m.waiters = [];
+    for (const fn of waiters) fn();
+    emitChange();
+  });
+  await connectMember(m);
+  members.push(m);
+  emitChange();
+  return { cancelled: false };
+}
+
+/** Disconnect and forget one member. */
+export function removeFleetDevice(id) {
+  const i = members.findIndex((m) => m.id === id);
+  if (i < 0) return;
+  const [m] = members.splice(i, 1);
+  if (m.device?.gatt?.connected) m.device.gatt.disconnect();
+  emitChange();
+}
+
+/** Disconnect and forget every member. */
+export function clearFleet() {
+  for (const m of members.splice(0)) {
+    if (m.device?.gatt?.connected) m.device.gatt.disconnect();
+  }
+  emitChange();
+}
+
+// Same read-back rule as ble.js jobCommand, on the member's own job characteristic.
+async function memberJobCommand(m, bytes) {
+  const before = ble.parseJobState(await m.chars.job.readValue());
+  if (!before) return null;
+  await m.chars.job.writeValue(bytes);
+  const startedAt = performance.now();
+  for (;;) {
+    const s = ble.parseJobState(await m.chars.job.readValue());
+    if (s && s.opCount !== before.opCount) return s;
+    if (performance.now() - startedAt > kJobCommandTimeoutMs) return null;
+    await sleep(30);
+  }
+}
+
+function waitMemberStatus(m, timeoutMs) {
+  return new Promise((resolve) => {
+    const timer = setTimeout(resolve, timeoutMs);
+    m.waiters.push(() => {
+      clearTimeout(timer);
+      resolve();
+    });
+  });
+}
+
+function buildPacket(sessionId, seq, payload) {
+  const packet = new Uint8Array(FLUSH_HEADER_SIZE + payload.length);
+  packet[0] = sessionId & 0xff;
+  packet[1] = (sessionId >> 8) & 0xff;
+  packet[2] = seq & 0xff;
+  packet[3] = (seq >> 8) & 0xff;
+  packet.set(payload, FLUSH_HEADER_SIZE);
+  return packet;
+}
+
+function makeSessionId16() {
+  const u16 = new Uint16Array(1);
+  globalThis.crypto.getRandomValues(u16);
+  return u16[0] || 1;
+}
+
+// Feed one member as fast as its device queue allows. Before START the queue fills up and the member
+// reports itself primed (nothing more fits, or everything was sent).
+async function streamToMember(m, run) {
+  let offset = 0;
+  let seq = 0;
+  m.sentBytes = 0;
+  try {
+    while (offset < run.bytes.length) {
+      if (run.failed || run.shouldStop()) return;
+      if (!isMemberConnected(m)) throw new Error(t('error.fleetDisconnected', { name: m.device.name ?? '' }));
+
+      const chunk = run.bytes.subarray(offset, offset + run.chunkSize);
+      if (!(Number.isFinite(m.free) && m.free >= chunk.length)) {
+        if (!run.started) run.markPrimed(m);
+        // notify가 누락될 수 있으니 주기적으로 read로 폴백한다.
+        if (performance.now() - m.updatedAt > 800) handleMemberStatus(m, await m.chars.status.readValue());
+        else await waitMemberStatus(m, 200);
+        continue;
+      }
+
+      await m.chars.flush.writeValue(buildPacket(run.sessionId, seq, chunk));
+      // Reserve the space until the next status arrives, so a burst does not overrun the queue.
+      m.free -= chunk.length;
+      offset += chunk.length;
+      seq += 1;
+      m.sentBytes = offset;
+      run.onProgress();
+      if (run.chunkDelayMs > 0) await sleep(run.chunkDelayMs);
+    }
+    // Upload complete: the member drops the job (and its power-loss journal) once it has typed it.
+    await m.chars.job.writeValue(ble.buildCloseJobPacket(run.sessionId));
+  } finally {
+    // Done, stopped or failed: never leave the START barrier waiting for this member.
+    run.markPrimed(m);
+  }
+}
+
+// START goes to the members one by one; each delay is shortened by the time spent so far, so every
+// device starts kFleetStartLeadMs after the first write.
+async function broadcastStart(run) {
+  const t0 = performance.now();
+  for (const m of run.members) {
+    const delayMs = kFleetStartLeadMs - (performance.now() - t0);
+    if (delayMs < 0) throw new Error(t('error.fleetStartLate'));
+    await m.chars.job.writeValue(ble.buildStartJobPacket(run.sessionId, delayMs));
+  }
+  for (const m of run.members) {
+    const s = ble.parseJobState(await m.chars.job.readValue());
+    if (!s || s.lastOp !== ble.JOB_OP.start || s.lastResult !== ble.JOB_RESULT.ok) {
+      throw new Error(t('error.fleetStartFailed', { name: m.device.name ?? '' }));
+    }
+  }
+}
+
+async function cancelOnMembers(list, sessionId) {
+  await Promise.all(list.map(async (m) => {
+    if (!isMemberConnected(m)) return;
+    try {
+      await m.chars.job.writeValue(Uint8Array.of(ble.JOB_OP.cancel, sessionId & 0xff, (sessionId >> 8) & 0xff));
+    } catch {
+      // best effort
+    }
+  }));
+}
+
+/**
+ * Type the same bytes on every fleet member, starting all Target PCs at the same moment.
+ * @param {Uint8Array} bytes
+ * @param {{timing:{typingDelayMs:number,modeSwitchDelayMs:number,keyPressDelayMs:number,toggleKeyId:number},
+ *          chunkSize:number, chunkDelayMs?:number, shouldStop?:() => boolean,
+ *          onProgress?:(p:{started:boolean, minSent:number, total:number}) => void}} options
+ * @returns {Promise<{sessionId:number, stopped:boolean}>}
+ */
+export async function runFleetJob(bytes, options) {
+  const list = members.filter(isMemberConnected);
+  if (list.length === 0) throw new Error(t('error.fleetEmpty'));
+
+  const run = {
+    bytes,
+    members: list,
+    sessionId: makeSessionId16(),
+    chunkSize: Math.max(1, Math.min(200, Number(options.chunkSize) || 20)),
+    chunkDelayMs: Math.max(0, Number(options.chunkDelayMs) || 0),
+    shouldStop: options.shouldStop ?? (() => false),
+    started: false,
+    failed: false,
+    primed: new Set(),
+    markPrimed: null,
+    onProgress: () => {
+      options.onProgress?.({
+        started: run.started,
+        minSent: Math.min(...list.map((m) => m.sentBytes)),
+        total: bytes.length,
+      });
+    },
+  };
+
+  let allPrimed;
+  const primedPromise = new Promise((resolve) => {
+    allPrimed = resolve;
+  });
+  run.markPrimed = (m) => {
+    run.primed.add(m);
+    if (run.primed.size === list.length) allPrimed();
+  };
+
+  for (const m of list) {
+    const s = await memberJobCommand(m, ble.buildOpenJobPacket(run.sessionId, { ...options.timing, armed: true }));
+    if (!s || s.lastResult !== ble.JOB_RESULT.ok) {
+      await cancelOnMembers(list, run.sessionId);
+      throw new Error(t('error.fleetOpenFailed', { name: m.device.name ?? '' }));
+    }
+  }
+
+  const senders = list.map((m) => streamToMember(m, run).catch((err) => {
+    run.failed = true;
+    throw err;
+  }));
+  try {
+    await primedPromise;
+    if (!run.failed && !run.shouldStop()) {
+      await broadcastStart(run);
+      run.started = true;
+      run.onProgress();
+    }
+    await Promise.all(senders);
+  } catch (err) {
+    run.failed = true;
+    await Promise.allSettled(senders);
+    await cancelOnMembers(list, run.sessionId);
+    throw err;
+  }
+
+  const stopped = run.shouldStop();
+  if (stopped) await cancelOnMembers(list, run.sessionId);
+  return { sessionId: run.sessionId, stopped };
+}
@@ -0,0 +1,289 @@
+// ByteFlusher Macro VM assembler
+// Assembles a small text program into the bytecode executed by the firmware Macro VM
+// (macro cmd 0x08 RUN_PROGRAM, see src/main.cpp "Macro VM").
+//
+// Syntax (one instruction per line, ';' or '#' starts a comment):
+//   label:
+//   tap <chord>            e.g. tap enter / tap gui+r / tap ctrl+shift+esc
+//   tapn <count> <chord>   repeat a chord 1..255 times
+//   down <chord>           hold keys (max 6) until 'up'
+//   up <chord> | up all
+//   type "text"            ASCII only (\" and \\ escapes); long text is split automatically
+//   sleep <ms> | sleep rN
+//   set rN <value>         registers r0..r3 (u16)
+//   djnz rN <label>        rN -= 1; jump to label while rN != 0
+//   jmp <label>
+//   english                force English input mode
+//   end
+
+export const MACRO_VM_VERSION = 1;
+export const MACRO_VM_PROGRAM_MAX = 255;
+const REGISTER_COUNT = 4;
+
+const OP = Object.freeze({
+  end: 0x00,
+  tap: 0x01,
+  down: 0x02,
+  up: 0x03,
+  type: 0x04,
+  sleep: 0x05,
+  sleepReg: 0x06,
+  set: 0x07,
+  tapn: 0x08,
+  djnz: 0x09,
+  jmp: 0x0a,
+  english: 0x0b,
+});
+
+const MODIFIERS = Object.freeze({
+  ctrl: 0x01,
+  lctrl: 0x01,
+  shift: 0x02,
+  lshift: 0x02,
+  alt: 0x04,
+  lalt: 0x04,
+  gui: 0x08,
+  win: 0x08,
+  lgui: 0x08,
+  rctrl: 0x10,
+  rshift: 0x20,
+  ralt: 0x40,
+  rgui: 0x80,
+});
+
+const NAMED_KEYS = Object.freeze({
+  enter: 0x28,
+  esc: 0x29,
+  escape: 0x29,
+  backspace: 0x2a,
+  tab: 0x2b,
+  space: 0x2c,
+  minus: 0x2d,
+  equal: 0x2e,
+  capslock: 0x39,
+  printscreen: 0x46,
+  scrolllock: 0x47,
+  pause: 0x48,
+  insert: 0x49,
+  home: 0x4a,
+  pageup: 0x4b,
+  delete: 0x4c,
+  end: 0x4d,
+  pagedown: 0x4e,
+  right: 0x4f,
+  left: 0x50,
+  down: 0x51,
+  up: 0x52,
+  menu: 0x65,
+});
+
+function keyNameToCode(name) {
+  const k = String(name ?? '').toLowerCase();
+  if (/^[a-z]$/.test(k)) return 0x04 + (k.charCodeAt(0) - 0x61);
+  if (/^[1-9]$/.test(k)) return 0x1e + (k.charCodeAt(0) - 0x31);
+  if (k === '0') return 0x27;
+  const f = /^f([1-9]|1[0-2])$/.exec(k);
+  if (f) return 0x3a + Number(f[1]) - 1;
+  if (Object.hasOwn(NAMED_KEYS, k)) return NAMED_KEYS[k];
+  return null;
+}
+
+// "ctrl+shift+esc" -> { mod, key }. A chord may be modifiers only (key=0).
+export function parseChord(text) {
+  let mod = 0;
+  let key = 0;
+  for (const part of String(text ?? '').split('+')) {
+    const p = part.trim().toLowerCase();
+    if (!p) throw new Error(`invalid chord '${text}'`);
+    if (Object.hasOwn(MODIFIERS, p)) {
+      mod |= MODIFIERS[p];
+      continue;
+    }
+    const code = keyNameToCode(p);
+    if (code == null) throw new Error(`unknown key '${part}'`);
+    if (key !== 0) throw new Error(`only one non-modifier key per chord: '${text}'`);
+    key = code;
+  }
+  return { mod, key };
+}
+
+function tokenize(line) {
+  const out = [];
+  let i = 0;
+  while (i < line.length) {
+    const ch = line[i];
+    if (ch === ' ' || ch === '\t') {
+      i += 1;
+      continue;
+    }
+    if (ch === ';' || ch === '#') break;
+    if (ch === '"') {
+      let s = '';
+      i += 1;
+      let closed = false;
+      while (i < line.length) {
+        const c = line[i];
+        if (c === '\\' && i + 1 < line.length) {
+          const n = line[i + 1];
+          s += n === 'n' ? '\n' : n === 't' ? '\t' : n;
+          i += 2;
+          continue;
+        }
+        if (c === '"') {
+          closed = true;
+          i += 1;
+          break;
+        }
+        s += c;
+        i += 1;
+      }
+      if (!closed) throw new Error('unterminated string');
+      out.push({ str: s });
+      continue;
+    }
+    let w = '';
+    while (i < line.length && !/[\s;#]/.test(line[i])) {
+      w += line[i];
+      i += 1;
+    }
+    out.push(w);
+  }
+  return out;
+}
+
+function parseRegister(tok) {
+  const m = /^r([0-9])$/i.exec(String(tok ?? ''));
+  if (!m || Number(m[1]) >= REGISTER_COUNT) throw new Error(`invalid register '${tok}'`);
+  return Number(m[1]);
+}
+
+function parseU16(tok) {
+  const n = Number(tok);
+  if (!Number.isInteger(n) || n < 0 || n > 0xffff) throw new Error(`invalid u16 '${tok}'`);
+  return n;
+}
+
+/**
+ * Assemble Macro VM source into bytecode.
+ * @param {string} source
+ * @returns {Uint8Array}
+ */
+export function assembleMacro(source) {
+  const out = [];
+  const labels = new Map();
+  const fixups = []; // { at, label, lineNo }
+
+  const lines = String(source ?? '').split(/\r?\n/);
+  for (let idx = 0; idx < lines.length; idx += 1) {
+    const lineNo = idx + 1;
+    try {
+      let toks = tokenize(lines[idx]);
+      if (toks.length === 0) continue;
+
+      // label: (optionally followed by an instruction on the same line)
+      if (typeof toks[0] === 'string' && toks[0].endsWith(':')) {
+        const name = toks[0].slice(0, -1);
+        if (!name) throw new Error('empty label');
+        if (labels.has(name)) throw new Error(`duplicate label '${name}'`);
+        labels.set(name, out.length);
+        toks = toks.slice(1);
+        if (toks.length === 0) continue;
+      }
+
+      const op = String(toks[0]).toLowerCase();
+      const args = toks.slice(1);
+      const needArgs = (n) => {
+        if (args.length !== n) throw new Error(`'${op}' expects ${n} operand(s)`);
+      };
+
+      switch (op) {
+        case 'end':
+        case 'english':
+          needArgs(0);
+          out.push(OP[op]);
+          break;
+        case 'tap':
+        case 'down': {
+          needArgs(1);
+          const c = parseChord(args[0]);
+          out.push(OP[op], c.mod, c.key);
+          break;
+        }
+        case 'up': {
+          needArgs(1);
+          const c = String(args[0]).toLowerCase() === 'all' ? { mod: 0, key: 0 } : parseChord(args[0]);
+          out.push(OP.up, c.mod, c.key);
+          break;
+        }
+        case 'tapn': {
+          needArgs(2);
+          const count = Number(args[0]);
+          if (!Number.isInteger(count) || count < 1 || count > 255) throw new Error(`invalid count '${args[0]}'`);
+          const c = parseChord(args[1]);
+          out.push(OP.tapn, c.mod, c.key, count);
+          break;
+        }
+        case 'type': {
+          needArgs(1);
+          if (typeof args[0] !== 'object') throw new Error("'type' expects a quoted string");
+          const s = args[0].str;
+          for (let i = 0; i < s.length; i += 1) {
+            if (s.charCodeAt(i) > 0x7f) throw new Error('type: ASCII only');
+          }
+          for (let off = 0; off < s.length; off += 255) {
+            const part = s.slice(off, off + 255);
+            out.push(OP.type, part.length);
+            for (let i = 0; i < part.length; i += 1) out.push(part.charCodeAt(i));
+          }
+          break;
+        }
+        case 'sleep': {
+          needArgs(1);
+          if (/^r[0-9]$/i.test(String(args[0]))) {
+            out.push(OP.sleepReg, parseRegister(args[0]));
+          } else {
+            const ms = parseU16(args[0]);
+            out.push(OP.sleep, ms & 0xff, (ms >> 8) & 0xff);
+          }
+          break;
+        }
+        case 'set': {
+          needArgs(2);
+          const r = parseRegister(args[0]);
+          const v = parseU16(args[1]);
+          out.push(OP.set, r, v & 0xff, (v >> 8) & 0xff);
+          break;
+        }
+        case 'djnz': {
+          needArgs(2);
+          out.push(OP.djnz, parseRegister(args[0]), 0);
+          fixups.push({ at: out.length - 1, label: String(args[1]), lineNo });
+          break;
+        }
+        case 'jmp': {
+          needArgs(1);
+          out.push(OP.jmp, 0);
+          fixups.push({ at: out.length - 1, label: String(args[0]), lineNo });
+          break;
+        }
+        default:
+          throw new Error(`unknown instruction '${toks[0]}'`);
+      }
+    } catch (err) {
+      throw new Error(`macro line ${lineNo}: ${err?.message ?? err}`);
+    }
+  }
+
+  for (const f of fixups) {
+    if (!labels.has(f.label)) throw new Error(`macro line ${f.lineNo}: unknown label '${f.label}'`);
+    out[f.at] = labels.get(f.label);
+  }
+
+  if (out.length > MACRO_VM_PROGRAM_MAX) {
+    throw new Error(`macro program too large (${out.length} > ${MACRO_VM_PROGRAM_MAX} bytes)`);
+  }
+  for (const target of labels.values()) {
+    if (target >= out.length) throw new Error('macro label points past the end of the program');
+  }
+  return Uint8Array.from(out);
+}
@@ -6,6 +6,8 @@
 import { t, getLocale, applyDom } from './i18n.js';
 import * as ble from './ble.js';
 import { setStatus as setAppStatus } from './app.js';
+import * as fleet from './fleet.js';
+import { buildDiffStream, hashLines, splitLines } from './diff.js';
 
 // Flush Text 패킷 포맷(LE): [sessionId(2)][seq(2)][payload...]
 const FLUSH_HEADER_SIZE = 4;
@@ -19,6 +21,20 @@ const LS_MODE_SWITCH_DELAY_MS = 'byteflusher.modeSwitchDelayMs';
 const LS_KEY_PRESS_DELAY_MS = 'byteflusher.keyPressDelayMs';
 const LS_TOGGLE_KEY = 'byteflusher.toggleKey';
 const LS_IGNORE_LEADING_WHITESPACE = 'byteflusher.ignoreLeadingWhitespace';
+const LS_CLIPBOARD_PASTE = 'byteflusher.clipboardPaste';
+const LS_USE_DEVICE_PROFILE = 'byteflusher.useDeviceProfile';
+const LS_DIFF_DOC_NAME = 'byteflusher.diffDocName';
+
+// Per-key-class delays (firmware 1.2.17+). Blank = same as the typing delay (plain keys always use it).
+// Order after plain matches the firmware table: [plain][shifted][enter][tab][jamo][afterSwitch].
+const KEY_CLASS_DELAY_FIELDS = [
+  { id: 'keyDelayShiftedMs', ls: 'byteflusher.keyDelayShiftedMs', i18n: 'settings.keyDelayShifted', label: 'Shifted key delay (ms)' },
+  { id: 'keyDelayEnterMs', ls: 'byteflusher.keyDelayEnterMs', i18n: 'settings.keyDelayEnter', label: 'Enter delay (ms)' },
+  { id: 'keyDelayTabMs', ls: 'byteflusher.keyDelayTabMs', i18n: 'settings.keyDelayTab', label: 'Tab delay (ms)' },
+  { id: 'keyDelayJamoMs', ls: 'byteflusher.keyDelayJamoMs', i18n: 'settings.keyDelayJamo', label: 'Hangul key delay (ms)' },
+  { id: 'keyDelayAfterSwitchMs', ls: 'byteflusher.keyDelayAfterSwitchMs', i18n: 'settings.keyDelayAfterSwitch', label: 'First key after KR/EN switch (ms)' },
+];
+const KEY_CLASS_DELAY_FOLLOW = 0xffff;
 
 const DEFAULT_CHUNK_SIZE = 20;
 const DEFAULT_CHUNK_DELAY = 30;
@@ -29,6 +45,8 @@ const DEFAULT_MODE_SWITCH_DELAY_MS = 100;
 const DEFAULT_KEY_PRESS_DELAY_MS = 10;
 const DEFAULT_TOGGLE_KEY = 'rightAlt';
 const DEFAULT_IGNORE_LEADING_WHITESPACE = false;
+const DEFAULT_CLIPBOARD_PASTE = false;
+const DEFAULT_USE_DEVICE_PROFILE = false;
 
 let els = {};
 
@@ -58,14 +76,23 @@ function waitForStatusUpdate(timeoutMs) {
 async function waitForDeviceRoom({ requiredBytes, maxBacklogBytes }) {
   if (!ble.getChar(ble.STATUS_CHAR_UUID)) return;
   const startedAt = performance.now();
+  let asleepShown = '';
 
   while (!stopRequested) {
     if (paused) return;
     if (!ble.isConnected()) return;
 
+    // Target PC가 잠들어 USB가 suspend되면, 장치가 깨우거나 사용자가 깨울 때까지 보내지 않는다(큐는 장치에 남는다).
+    const usb = ble.getDeviceUsbState();
     const cap = ble.getDeviceBufCapacity();
     const free = ble.getDeviceBufFree();
-    if (Number.isFinite(cap) && Number.isFinite(free)) {
+    if (usb?.suspended) {
+      const detailKey = usb.wakeupRefused ? 'status.targetAsleepWakeManually' : 'status.targetAsleepWaking';
+      if (asleepShown !== detailKey) {
+        asleepShown = detailKey;
+        setStatus(t('status.targetAsleep'), t(detailKey));
+      }
+    } else if (Number.isFinite(cap) && Number.isFinite(free)) {
       const used = Math.max(0, cap - free);
       const enoughFree = free >= requiredBytes;
       const backlogOk = used <= maxBacklogBytes;
@@ -89,6 +116,13 @@ let flushInProgress = false;
 let stopRequested = false;
 let paused = false;
 let pauseStatusShown = false;
+// sessionId registered in the device job queue for the running transfer (null = legacy session)
+let deviceJobSessionId = null;
+// Last read of the device timing profiles (null = not connected / older firmware)
+let deviceProfileState = null;
+// Fleet run (several devices, same text, synchronized start)
+let fleetRunning = false;
+let fleetStopRequested = false;
 
 let job = null;
 
@@ -212,6 +246,32 @@ function computeEstimateMs({
   };
 }
 
+// 장치 dry-run은 텍스트를 BLE로 한 번 더 보내야 하므로 큰 입력은 JS 추정으로 대신한다.
+const DEVICE_ESTIMATE_MAX_BYTES = 16 * 1024;
+
+async function refineJobEstimateOnDevice(bytes, toggleKey) {
+  // 펌웨어 디코더 자체로 키 입력/전환/지연 시간을 센다(JS 규칙과 어긋나는 경우를 없앤다).
+  if (!job || bytes.length === 0 || bytes.length > DEVICE_ESTIMATE_MAX_BYTES) return;
+  if (!ble.getChar(ble.ESTIMATE_CHAR_UUID)) return;
+  let c = null;
+  try {
+    c = await ble.estimateOnDevice(bytes);
+  } catch {
+    c = null;
+  }
+  if (!c || !job) return;
+
+  job.keystrokes = c.keystrokes;
+  job.modeSwitches = c.modeSwitches;
+  job.deviceMs = c.totalMs;
+  job.estimatedMs = Math.max(c.totalMs, job.txMs);
+  job.estimateSource = 'device';
+  if (els.estimateBasisText) {
+    els.estimateBasisText.textContent = `${job.totalBytes} bytes / ${job.keystrokes} keys, switch ${job.modeSwitches} (device dry-run: typing ${c.typingMs}ms, key ${c.keyPressMs}ms, mode ${c.modeSwitchMs}ms) / chunk=${job.chunkSize}, delay=${job.chunkDelayMs}ms / toggle=${toggleKey}`;
+  }
+  updateJobMetrics();
+}
+
 function clearJobMetrics() {
   if (els.etaText) els.etaText.textContent = '-';
   if (els.startTimeText) els.startTimeText.textContent = '-';
@@ -444,7 +504,12 @@ function updateJobMetrics() {
     // '예상'은 시간(분) 기준으로 표시한다.
     const nowPerf = job.endedWallMs != null ? null : performance.now();
     const activeElapsedMs = nowPerf != null ? Math.max(0, nowPerf - job.startedPerfMs - pausedTotalMs) : null;
-    const remainingMs = activeElapsedMs != null ? Math.max(0, job.estimatedMs - activeElapsedMs) : 0;
+    let remainingMs = activeElapsedMs != null ? Math.max(0, job.estimatedMs - activeElapsedMs) : 0;
+    // Live: 장치 대기열의 남은 시간(펌웨어 dry-run) + 아직 보내지 않은 바이트 몫.
+    const queueEtaMs = ble.getDeviceQueueEtaMs();
+    if (activeElapsedMs != null && Number.isFinite(queueEtaMs) && job.sentBytes > 0) {
+      remainingMs = queueEtaMs + Math.max(0, Number(job.deviceMs) || 0) * (1 - byteRatio);
+    }
     els.etaText.textContent = t('metric.totalMinutesRemaining', { total: formatMinutes(job.estimatedMs), remaining: formatMinutes(remainingMs) });
   }
 }
@@ -481,6 +546,7 @@ function setUiRunState({ running, paused: isPaused }) {
   if (els.deviceFieldset) {
     els.deviceFieldset.disabled = running;
   }
+  if (els.diffDocName) els.diffDocName.disabled = running;
 
   setJobPaused(isPaused);
 
@@ -564,8 +630,22 @@ function getIgnoreLeadingWhitespaceSetting() {
   return Boolean(els.ignoreLeadingWhitespace?.checked);
 }
 
+function getClipboardPasteSetting() {
+  return Boolean(els.clipboardPaste?.checked);
+}
+
+function getUseDeviceProfileSetting() {
+  return Boolean(els.useDeviceProfile?.checked);
+}
+
+function getDiffDocName() {
+  return ble.sanitizeDocName(els.diffDocName?.value);
+}
+
 function preprocessTextForFirmware(input) {
   const replacement = getUnsupportedReplacement();
+  // 클립보드 붙여넣기를 쓰면 장치가 칠 수 없는 문자가 든 구간을 붙여넣으므로 그대로 보낸다.
+  const keepUnsupported = getClipboardPasteSetting();
   let replacedCount = 0;
   let normalized = (input ?? '').toString();
   if (getIgnoreLeadingWhitespaceSetting()) {
@@ -576,7 +656,7 @@ function preprocessTextForFirmware(input) {
   for (const ch of normalized) {
     const cp = ch.codePointAt(0);
     if (cp === undefined) continue;
-    if (isSupportedCodePoint(cp)) {
+    if (keepUnsupported || isSupportedCodePoint(cp)) {
       out += ch;
     } else {
       out += replacement;
@@ -609,7 +689,17 @@ function getDeviceTimingSettings() {
   const typingDelayMs = clampNumber(els.typingDelayMs?.value, 0, 1000, DEFAULT_TYPING_DELAY_MS);
   const modeSwitchDelayMs = clampNumber(els.modeSwitchDelayMs?.value, 0, 3000, DEFAULT_MODE_SWITCH_DELAY_MS);
   const keyPressDelayMs = clampNumber(els.keyPressDelayMs?.value, 0, 300, DEFAULT_KEY_PRESS_DELAY_MS);
-  return { typingDelayMs, modeSwitchDelayMs, keyPressDelayMs };
+  return { typingDelayMs, modeSwitchDelayMs, keyPressDelayMs, keyClassDelays: getKeyClassDelays() };
+}
+
+// Firmware key-class table: plain keys follow the typing delay, the rest use their input (blank = follow).
+function getKeyClassDelays() {
+  const out = [KEY_CLASS_DELAY_FOLLOW];
+  for (const f of KEY_CLASS_DELAY_FIELDS) {
+    const raw = String(els[f.id]?.value ?? '').trim();
+    out.push(raw === '' ? KEY_CLASS_DELAY_FOLLOW : clampNumber(raw, 0, 1000, 0));
+  }
+  return out;
 }
 
 function getToggleKeySetting() {
@@ -646,12 +736,14 @@ function toggleKeyToByte(v) {
   }
 }
 
-function buildDeviceConfigPayload({ typingDelayMs, modeSwitchDelayMs, keyPressDelayMs, toggleKey }) {
-  // LE u16 * 3 + u8 + u8:
-  // [typingDelayMs][modeSwitchDelayMs][keyPressDelayMs][toggleKey][flags]
+function buildDeviceConfigPayload({ typingDelayMs, modeSwitchDelayMs, keyPressDelayMs, keyClassDelays, toggleKey }) {
+  // LE u16 * 3 + u8 + u8 + u16 * 6:
+  // [typingDelayMs][modeSwitchDelayMs][keyPressDelayMs][toggleKey][flags][keyClassDelays...]
   // toggleKey: 0=RAlt,1=LAlt,2=RCtrl,3=LCtrl,4=RGui,5=LGui,6=CapsLock
   // flags(bit0): paused
-  const buf = new Uint8Array(8);
+  // keyClassDelays: 0xFFFF = typing delay (older firmware ignores the table)
+  const classes = keyClassDelays ?? [];
+  const buf = new Uint8Array(8 + 2 * classes.length);
   buf[0] = typingDelayMs & 0xff;
   buf[1] = (typingDelayMs >> 8) & 0xff;
   buf[2] = modeSwitchDelayMs & 0xff;
@@ -660,6 +752,10 @@ function buildDeviceConfigPayload({ typingDelayMs, modeSwitchDelayMs, keyPressDe
   buf[5] = (keyPressDelayMs >> 8) & 0xff;
   buf[6] = toggleKeyToByte(toggleKey);
   buf[7] = 0;
+  classes.forEach((v, i) => {
+    buf[8 + 2 * i] = v & 0xff;
+    buf[9 + 2 * i] = (v >> 8) & 0xff;
+  });
   return buf;
 }
 
@@ -676,13 +772,18 @@ async function setDevicePaused(pausedState) {
   const toggleKey = getToggleKeySetting();
   const payload = buildDeviceConfigPayload({ ...timing, toggleKey });
   payload[7] = pausedState ? 1 : 0;
-  await ble.getChar(ble.CONFIG_CHAR_UUID).writeValue(payload);
+  await ble.writeConfig(payload);
 }
 
 async function abortDeviceQueueNow() {
   if (!ble.isConnected()) {
     return;
   }
+  // job 큐를 쓰는 전송이면 이 job만 취소한다(앞서 올린 job은 계속 타이핑된다).
+  if (deviceJobSessionId != null && ble.getChar(ble.JOB_CHAR_UUID)) {
+    await ble.cancelJob(deviceJobSessionId);
+    return;
+  }
   if (!ble.getChar(ble.CONFIG_CHAR_UUID)) {
     return;
   }
@@ -692,7 +793,7 @@ async function abortDeviceQueueNow() {
   const payload = buildDeviceConfigPayload({ ...timing, toggleKey });
   // flags: bit1 abort(즉시 폐기)
   payload[7] = 0x02;
-  await ble.getChar(ble.CONFIG_CHAR_UUID).writeValue(payload);
+  await ble.writeConfig(payload);
 }
 
 async function applyDeviceSettings() {
@@ -711,10 +812,147 @@ async function applyDeviceSettings() {
   payload[7] = paused ? 1 : 0;
 
   setStatus(t('status.applyingSettings'), `typing=${timing.typingDelayMs}ms, modeSwitch=${timing.modeSwitchDelayMs}ms, keyPress=${timing.keyPressDelayMs}ms, toggle=${toggleKey}`);
-  await ble.getChar(ble.CONFIG_CHAR_UUID).writeValue(payload);
+  await ble.writeConfig(payload);
   setStatus(t('status.settingsApplied'), `typing=${timing.typingDelayMs}ms, modeSwitch=${timing.modeSwitchDelayMs}ms, keyPress=${timing.keyPressDelayMs}ms, toggle=${toggleKey}`);
 }
 
+// 장치 job 큐에 이 세션을 등록한다(현재 타이핑 중인 job을 끊지 않고 뒤에 붙는다).
+// 타이밍은 job에 실어 보내고, 장치가 이 job의 타이핑을 시작할 때 적용한다.
+// @returns {Promise<boolean>} false면 job 큐 미지원(구버전 펌웨어: 새 세션이 기존 큐를 폐기)
+async function openDeviceJob(sessionId, timing, toggleKey) {
+  if (!ble.getChar(ble.JOB_CHAR_UUID)) return false;
+  // 장치 프로필 타이밍을 쓰면 장치가 적용 중인 프로필로 친다(아래 타이밍은 구버전 펌웨어용).
+  const deviceTiming = getUseDeviceProfileSetting() && (await refreshDeviceProfileState()) != null
+    && deviceProfileState.applied !== ble.PROFILE_NONE;
+  for (;;) {
+    if (stopRequested) return true;
+    const result = await ble.openJob(sessionId, {
+      ...timing,
+      toggleKeyId: toggleKeyToByte(toggleKey),
+      clipboardPaste: getClipboardPasteSetting(),
+      deviceTiming,
+    });
+    if (result === ble.JOB_RESULT.ok) return true;
+    if (result !== ble.JOB_RESULT.full) throw new Error(t('error.jobOpenFailed'));
+    setStatus(t('status.waitingJobSlot'), t('status.waitingJobSlotHint'));
+    await sleep(300);
+  }
+}
+
+// 장치가 리셋 전에 치던 텍스트와 같으면 마지막 줄 경계부터 이어서 칠지 묻는다(power-loss journal).
+// 같은 텍스트인지는 [0, lineOffset)의 CRC-32로 확인한다. 다른 텍스트거나 이미 끝까지 쳤으면 제안을 버린다.
+// 반쯤 친 줄은 장치가 ESC로 지운 뒤(PowerShell/cmd 입력 줄) 줄 처음부터 다시 친다.
+// @returns {Promise<{sessionId:number, offset:number}|null>}
+async function resumeFromDeviceJournal(bytes) {
+  if (!ble.getChar(ble.JOURNAL_CHAR_UUID)) return null;
+  let offer = null;
+  try {
+    offer = await ble.readResumeOffer();
+  } catch {
+    return null;
+  }
+  if (!offer || offer.kind !== ble.JOURNAL_KIND.text) return null;
+
+  const matches = offer.lineOffset > 0
+    && offer.lineOffset < bytes.length
+    && ble.crc32(bytes.subarray(0, offer.lineOffset)) === offer.lineCrc;
+  if (!matches || !window.confirm(t('confirm.resumeJournal', { offset: offer.lineOffset, total: bytes.length }))) {
+    await ble.dismissResume();
+    return null;
+  }
+
+  // 재개한 job은 타이밍 없이 열리므로 현재 설정을 먼저 적용한다.
+  await applyDeviceSettings();
+  const result = await ble.resumeJob(ble.JOURNAL_ROLLBACK.esc);
+  if (result !== ble.JOURNAL_RESULT.ok) {
+    setStatus(t('status.resumeFailed'), t('status.resumeFailedHint', { result: result ?? '-' }));
+    return null;
+  }
+  return { sessionId: offer.sessionId, offset: offer.lineOffset };
+}
+
+// Diff 재타이핑: 같은 이름으로 마지막에 끝까지 친 문서의 줄 hash가 장치에 있으면, Target 편집기에 그 문서가
+// 그대로 열려 있다고 보고 바뀐 줄만 이동 키(in-band CHORD)와 함께 친다. 없으면 전체를 친다.
+// 스냅샷은 타이핑 전에 지우고 장치가 끝까지 친 뒤 새로 저장한다(중간에 멈추면 편집기 내용을 알 수 없다).
+// @returns {Promise<{name:string, hashes:Uint32Array, docCrc:number, bytes:Uint8Array|null, detail:string}|null>}
+//   null이면 diff 재타이핑을 쓰지 않는다. bytes가 null이면 전체를 친다(끝나면 저장).
+async function planDiffRetype(text) {
+  const name = getDiffDocName();
+  if (!name || !ble.getChar(ble.DOC_CHAR_UUID) || ble.getInbandVersion() < 1) return null;
+
+  const lines = splitLines(text);
+  const plan = {
+    name,
+    hashes: hashLines(lines),
+    docCrc: ble.crc32(new TextEncoder().encode(text)),
+    bytes: null,
+    estimateText: text,
+    detail: t('status.diffNoSnapshot', { name }),
+  };
+  setStatus(t('status.diffReading'), name);
+  let old = null;
+  try {
+    old = await ble.readDocSnapshot(name);
+  } catch {
+    old = null;
+  }
+  if (!old) return plan;
+
+  if (old.docCrc === plan.docCrc && old.lineCount === lines.length) {
+    plan.bytes = new Uint8Array(0);
+    plan.detail = t('status.diffNoChanges', { name });
+  } else {
+    const diff = buildDiffStream(old.hashes, lines);
+    const fullKeys = text.length + 2;
+    if (diff.navKeys + diff.textChars < fullKeys) {
+      plan.bytes = diff.bytes;
+      // JS 추정용: 이동 키는 한 타로 센다(장치 dry-run이 다시 센다).
+      plan.estimateText = diff.typedText + ' '.repeat(diff.navKeys);
+      plan.detail = t('status.diffPlan', { name, changed: diff.changedLines, hunks: diff.hunks, keys: diff.navKeys });
+    } else {
+      // 거의 다 바뀌었으면 전체를 지우고 다시 친다(편집기에는 이전 문서가 있다).
+      const enc = new TextEncoder().encode(text);
+      const clear = [ble.inbandChord(0x01, 0x04), ble.inbandChord(0, 0x4c)];
+      plan.bytes = new Uint8Array(clear[0].length + clear[1].length + enc.length);
+      plan.bytes.set(clear[0], 0);
+      plan.bytes.set(clear[1], clear[0].length);
+      plan.bytes.set(enc, clear[0].length + clear[1].length);
+      plan.detail = t('status.diffRetypeAll', { name });
+    }
+  }
+  try {
+    await ble.deleteDocSnapshot(name);
+  } catch {
+    // 지우지 못하면 저장하지 않는다(아래 save가 덮어쓴다).
+  }
+  return plan;
+}
+
+// 보낸 바이트를 장치가 전부 칠 때까지 기다린다(멈춤/연결 끊김이면 false).
+async function waitUntilDeviceTyped() {
+  for (;;) {
+    if (stopRequested || !ble.isConnected()) return false;
+    const cap = ble.getDeviceBufCapacity();
+    if (!Number.isFinite(cap)) return false;
+    await waitForDeviceRoom({ requiredBytes: cap, maxBacklogBytes: 0 });
+    if (!paused && !stopRequested && ble.getDeviceBufFree() >= cap) return true;
+    await sleep(120);
+  }
+}
+
+async function saveDiffSnapshot(plan) {
+  setStatus(t('status.diffSaving'), plan.name);
+  let result = null;
+  try {
+    result = await ble.saveDocSnapshot(plan.name, plan.hashes, plan.docCrc);
+  } catch {
+    result = null;
+  }
+  if (result === ble.DOC_RESULT.ok) return t('status.diffSaved', { name: plan.name });
+  if (result === ble.DOC_RESULT.tooLarge) return t('status.diffTooLarge', { name: plan.name });
+  return t('status.diffSaveFailed', { name: plan.name, result: result ?? '-' });
+}
+
 function makeSessionId16() {
   let v = 0;
   if (globalThis.crypto?.getRandomValues) {
@@ -742,10 +980,12 @@ async function flushText() {
   if (!ble.getChar(ble.FLUSH_TEXT_CHAR_UUID)) {
     throw new Error(t('error.noFlushChar'));
   }
+  if (ble.isReadOnlyObserver()) {
+    throw new Error(t('error.observerReadOnly'));
+  }
 
   const rawText = els.textInput.value ?? '';
   const pre = preprocessTextForFirmware(rawText);
-  const bytes = new TextEncoder().encode(pre.text);
   // NOTE: UI에서 설정은 Start~Stop 동안 잠긴다.
   const initialChunkSize = clampNumber(els.chunkSize.value, 1, 200, DEFAULT_CHUNK_SIZE);
   const initialDelayMs = clampNumber(els.chunkDelay.value, 0, 200, DEFAULT_CHUNK_DELAY);
@@ -753,9 +993,22 @@ async function flushText() {
 
   const timing = getDeviceTimingSettings();
   const toggleKey = getToggleKeySetting();
+
+  stopRequested = false;
+  paused = false;
+  pauseStatusShown = false;
+  setUiRunState({ running: true, paused: false });
+
+  const diffPlan = await planDiffRetype(pre.text);
+  const bytes = diffPlan?.bytes ?? new TextEncoder().encode(pre.text);
+  if (diffPlan?.bytes?.length === 0) {
+    setStatus(t('status.transferComplete'), diffPlan.detail);
+    setUiRunState({ running: false, paused: false });
+    return;
+  }
   startJobMetrics({
     rawText,
-    preprocessedText: pre.text,
+    preprocessedText: diffPlan?.bytes ? diffPlan.estimateText : pre.text,
     totalBytes: bytes.length,
     chunkSize: initialChunkSize,
     chunkDelayMs: initialDelayMs,
@@ -765,11 +1018,6 @@ async function flushText() {
     toggleKey,
   });
 
-  stopRequested = false;
-  paused = false;
-  pauseStatusShown = false;
-  setUiRunState({ running: true, paused: false });
-
   // -- Tab visibility / beforeunload guards --
   const onVisibilityChange = () => {
     if (document.hidden) {
@@ -782,23 +1030,41 @@ async function flushText() {
 
   try {
 
-  const sessionId = makeSessionId16();
+  const resumed = await resumeFromDeviceJournal(bytes);
+  const sessionId = resumed ? resumed.sessionId : makeSessionId16();
   let seq = 0;
-  let offset = 0;
+  let offset = resumed ? resumed.offset : 0;
 
   const replacedNote = pre.replacedCount > 0 ? ` / ${t('text.replacedNote', { count: pre.replacedCount, replacement: pre.replacement })}` : '';
-  setStatus(t('status.transferStart'), `${bytes.length} bytes / chunk=${initialChunkSize}, delay=${initialDelayMs}ms / session=${sessionId}${replacedNote}`);
-
-  // 속도보다 안정성 우선: 전송 시작 전에 현재 장치 타이밍 설정을 한 번 적용한다.
-  // (ble.getChar(ble.CONFIG_CHAR_UUID)가 없으면 무시하고 계속 진행)
-  try {
-    if (ble.getChar(ble.CONFIG_CHAR_UUID)) {
-      await ble.getChar(ble.CONFIG_CHAR_UUID).writeValue(buildDeviceConfigPayload({ ...timing, toggleKey }));
+  const diffNote = diffPlan ? ` / ${diffPlan.detail}` : '';
+  setStatus(t('status.transferStart'), `${bytes.length} bytes / chunk=${initialChunkSize}, delay=${initialDelayMs}ms / session=${sessionId}${replacedNote}${diffNote}`);
+
+  // 장치 job 큐가 있으면 타이밍은 job에 실어 보낸다(앞선 job의 타이밍을 바꾸지 않는다).
+  // 재개한 경우 장치가 같은 sessionId로 job을 이미 열었다(seq 0부터 offset 이후 바이트를 보낸다).
+  deviceJobSessionId = null;
+  if (resumed) {
+    deviceJobSessionId = sessionId;
+    setJobProgress(offset);
+    setStatus(t('status.resumedFromJournal'), t('status.sendProgress', { offset, total: bytes.length, seq }));
+  } else if (await openDeviceJob(sessionId, timing, toggleKey)) {
+    deviceJobSessionId = sessionId;
+  } else {
+    // 속도보다 안정성 우선: 전송 시작 전에 현재 장치 타이밍 설정을 한 번 적용한다.
+    // (ble.getChar(ble.CONFIG_CHAR_UUID)가 없으면 무시하고 계속 진행)
+    try {
+      if (ble.getChar(ble.CONFIG_CHAR_UUID)) {
+        await ble.writeConfig(buildDeviceConfigPayload({ ...timing, toggleKey }));
+      }
+    } catch {
+      // 설정 적용 실패는 전송 자체를 막지 않는다.
     }
-  } catch {
-    // 설정 적용 실패는 전송 자체를 막지 않는다.
   }
 
+  // 방금 적용한 타이밍으로 장치 dry-run 추정(실패하면 JS 추정 유지).
+  await refineJobEstimateOnDevice(bytes, toggleKey);
+
+  const clipboardPasteJob = deviceJobSessionId != null && getClipboardPasteSetting();
+
   while (offset < bytes.length) {
     if (stopRequested) {
       setStatus(t('status.stopped'), `${offset}/${bytes.length} bytes`);
@@ -824,7 +1090,8 @@ async function flushText() {
     const retryDelayMs = clampNumber(els.retryDelay?.value, 0, 5000, DEFAULT_RETRY_DELAY);
 
     const chunk = bytes.slice(offset, offset + chunkSize);
-    const maxBacklogBytes = Math.max(32, chunkSize);
+    // 클립보드 붙여넣기 job은 장치 큐를 채워 둔다(장치는 큐에 있는 만큼을 한 batch로 붙여넣는다).
+    const maxBacklogBytes = clipboardPasteJob ? Infinity : Math.max(32, chunkSize);
     await waitForDeviceRoom({ requiredBytes: chunk.length, maxBacklogBytes });
     const packet = buildPacket(sessionId, seq, chunk);
 
@@ -851,11 +1118,46 @@ async function flushText() {
         // reconnectLoop가 상태/지연을 처리한다.
       }
 
+      // 장치가 청크를 거절(ATT 0x81)했으면 재시도해도 받지 않는다: 다른 탭/장치가 뒤에 job을 열었거나 큐가 리셋됐다.
+      // OPEN 없이 보내는 첫 청크(seq 0)는 아직 큐에 없으니 묻지 않는다.
+      if (ble.isConnected() && (deviceJobSessionId != null || seq > 0)) {
+        const accepts = await ble.jobAcceptsChunks(sessionId);
+        if (accepts === false) {
+          setStatus(t('status.transferError'), t('status.chunkRefused', { offset, total: bytes.length }));
+          setUiRunState({ running: false, paused: false });
+          setJobProgress(offset);
+          finishJobMetrics();
+          return;
+        }
+      }
+
       await sleep(retryDelayMs);
     }
   }
 
-  setStatus(t('status.transferComplete'), `${bytes.length} bytes / session=${sessionId}`);
+  // 업로드 끝: 장치가 마지막 바이트까지 치면 job을 끝내고 journal을 비운다(재개 제안이 남지 않게).
+  if (deviceJobSessionId != null) {
+    try {
+      await ble.closeJob(deviceJobSessionId);
+    } catch {
+      // 실패해도 타이핑은 계속된다(다음 flush가 journal을 덮어쓴다).
+    }
+  }
+
+  let savedNote = '';
+  if (diffPlan) {
+    setStatus(t('status.diffWaiting'), diffPlan.detail);
+    const typed = await waitUntilDeviceTyped();
+    if (stopRequested) {
+      // Stop 핸들러가 상태를 이미 표시했다. 스냅샷은 지운 채로 둔다(다음 flush는 전체를 친다).
+      setUiRunState({ running: false, paused: false });
+      finishJobMetrics();
+      return;
+    }
+    savedNote = ` / ${typed ? await saveDiffSnapshot(diffPlan) : t('status.diffNotSaved', { name: diffPlan.name })}`;
+  }
+
+  setStatus(t('status.transferComplete'), `${bytes.length} bytes / session=${sessionId}${savedNote}`);
   setUiRunState({ running: false, paused: false });
   setJobProgress(bytes.length);
   finishJobMetrics();
@@ -873,11 +1175,221 @@ async function flushText() {
 function onBleConnect() {
   setUiConnected(true);
   updateStartEnabled();
+  refreshDeviceProfileState().catch(() => {});
 }
 
 function onBleDisconnect() {
   setUiConnected(false);
   updateStartEnabled();
+  refreshDeviceProfileState().catch(() => {});
+}
+
+// ---------------------------------------------------------------------------
+// Device timing profiles (stored on the board, applied at boot / by Target PC)
+// ---------------------------------------------------------------------------
+
+function formatProfileFingerprint(fp) {
+  return fp ? fp.toString(16).toUpperCase().padStart(4, '0') : '-';
+}
+
+function describeDeviceProfileState(state) {
+  if (!state) return t('settings.deviceProfileUnsupported');
+  const label = (p) => p.name || `#${p.slot}`;
+  const applied = state.profiles.find((p) => p.slot === state.applied);
+  const sourceKeys = ['None', 'Boot', 'Fingerprint', 'Activate'];
+  return t('settings.deviceProfileInfo', {
+    applied: applied ? label(applied) : '-',
+    source: t(`settings.deviceProfileSource${sourceKeys[state.appliedSource] ?? 'None'}`),
+    profiles: state.profiles.map((p) => (p.fingerprint ? `${label(p)} @${formatProfileFingerprint(p.fingerprint)}` : label(p))).join(', ') || '-',
+    fingerprint: formatProfileFingerprint(state.fingerprint),
+  });
+}
+
+async function refreshDeviceProfileState() {
+  deviceProfileState = null;
+  if (ble.isConnected()) {
+    try {
+      deviceProfileState = await ble.readProfileState();
+    } catch {
+      deviceProfileState = null;
+    }
+  }
+  const supported = deviceProfileState != null;
+  for (const el of [els.btnSaveDeviceProfile, els.btnDeleteDeviceProfile, els.deviceProfileAuto]) {
+    if (el) el.disabled = !supported;
+  }
+  if (els.deviceProfileAuto) els.deviceProfileAuto.checked = Boolean(deviceProfileState?.autoSelect);
+  if (els.deviceProfileInfo) {
+    els.deviceProfileInfo.textContent = ble.isConnected() ? describeDeviceProfileState(deviceProfileState) : '';
+  }
+  return deviceProfileState;
+}
+
+function checkProfileResult(state) {
+  if (!state || state.lastResult !== ble.PROFILE_RESULT.ok) {
+    throw new Error(t('error.profileOpFailed', { result: state ? state.lastResult : '-' }));
+  }
+}
+
+// 현재 타이밍 설정을 이름으로 장치에 저장하고 부팅 프로필로 지정한다(같은 이름이면 덮어쓴다).
+async function saveDeviceProfile() {
+  const state = await refreshDeviceProfileState();
+  if (!state) throw new Error(t('error.noProfileChar'));
+  const name = ble.sanitizeNickname(els.deviceProfileName?.value);
+  if (!name) throw new Error(t('error.profileNameInvalid'));
+
+  let slot = state.profiles.find((p) => p.name === name)?.slot ?? -1;
+  for (let i = 0; slot < 0 && i < ble.PROFILE_SLOTS; i += 1) {
+    if (!state.profiles.some((p) => p.slot === i)) slot = i;
+  }
+  if (slot < 0) throw new Error(t('error.profileSlotsFull', { n: ble.PROFILE_SLOTS }));
+
+  const bind = Boolean(els.deviceProfileBind?.checked);
+  if (bind && !state.fingerprint) throw new Error(t('error.profileNoTarget'));
+
+  checkProfileResult(await ble.saveTimingProfile(slot, {
+    name,
+    ...getDeviceTimingSettings(),
+    toggleKeyId: toggleKeyToByte(getToggleKeySetting()),
+    fingerprint: bind ? state.fingerprint : 0,
+  }));
+  checkProfileResult(await ble.profileOp(ble.PROFILE_OP.activate, slot));
+  await refreshDeviceProfileState();
+}
+
+async function deleteDeviceProfile() {
+  const state = await refreshDeviceProfileState();
+  if (!state) throw new Error(t('error.noProfileChar'));
+  const name = ble.sanitizeNickname(els.deviceProfileName?.value);
+  const target = state.profiles.find((p) => p.name === name);
+  if (!target) throw new Error(t('error.profileNotFound', { name: name || '-' }));
+  checkProfileResult(await ble.profileOp(ble.PROFILE_OP.delete, target.slot));
+  await refreshDeviceProfileState();
+}
+
+// ---------------------------------------------------------------------------
+// Fleet (multi-device, synchronized start)
+// ---------------------------------------------------------------------------
+
+function renderFleetList(devices = fleet.getFleetDevices()) {
+  if (!els.fleetList) return;
+  els.fleetList.textContent = '';
+  if (devices.length === 0) {
+    els.fleetList.textContent = t('text.fleetEmpty');
+  }
+  for (const d of devices) {
+    const row = document.createElement('div');
+    row.className = 'row';
+    row.style.cssText = 'gap: 6px; align-items: center;';
+    const name = document.createElement('span');
+    name.textContent = `${d.name || 'ByteFlusher'} — ${d.connected ? t('text.fleetConnected') : t('text.fleetDisconnected')}`;
+    row.appendChild(name);
+    const remove = document.createElement('button');
+    remove.textContent = '×';
+    remove.disabled = fleetRunning;
+    remove.addEventListener('click', () => fleet.removeFleetDevice(d.id));
+    row.appendChild(remove);
+    els.fleetList.appendChild(row);
+  }
+  const connected = devices.filter((d) => d.connected).length;
+  if (els.btnFleetStart) els.btnFleetStart.disabled = fleetRunning || flushInProgress || connected === 0;
+  if (els.btnFleetStop) els.btnFleetStop.disabled = !fleetRunning;
+  if (els.btnFleetAdd) els.btnFleetAdd.disabled = fleetRunning || devices.length >= fleet.FLEET_MAX_DEVICES;
+  if (els.btnFleetClear) els.btnFleetClear.disabled = fleetRunning || devices.length === 0;
+}
+
+function setFleetStatus(text) {
+  if (els.fleetStatus) els.fleetStatus.textContent = text ?? '';
+}
+
+async function addFleetDevice() {
+  try {
+    await fleet.addFleetDevice();
+  } catch (err) {
+    setFleetStatus(err?.message ?? String(err));
+  }
+}
+
+// 같은 텍스트를 fleet 장치 전부에 올리고(armed job), 모두 준비되면 동시에 시작한다.
+async function runFleet() {
+  if (fleetRunning || flushInProgress) return;
+  const pre = preprocessTextForFirmware(els.textInput?.value ?? '');
+  const bytes = new TextEncoder().encode(pre.text);
+  if (bytes.length === 0) return;
+
+  const timing = getDeviceTimingSettings();
+  const toggleKey = getToggleKeySetting();
+  fleetRunning = true;
+  fleetStopRequested = false;
+  renderFleetList();
+  setFleetStatus(t('text.fleetBuffering'));
+  try {
+    const result = await fleet.runFleetJob(bytes, {
+      timing: { ...timing, toggleKeyId: toggleKeyToByte(toggleKey) },
+      chunkSize: clampNumber(els.chunkSize?.value, 1, 200, DEFAULT_CHUNK_SIZE),
+      chunkDelayMs: clampNumber(els.chunkDelay?.value, 0, 200, DEFAULT_CHUNK_DELAY),
+      shouldStop: () => fleetStopRequested,
+      onProgress: (p) => {
+        setFleetStatus(p.started
+          ? t('text.fleetProgress', { sent: p.minSent, total: p.total })
+          : t('text.fleetBuffering'));
+      },
+    });
+    setFleetStatus(result.stopped ? t('text.fleetStopped') : t('text.fleetDone', { total: bytes.length }));
+  } catch (err) {
+    setFleetStatus(t('text.fleetFailed', { msg: err?.message ?? String(err) }));
+  } finally {
+    fleetRunning = false;
+    renderFleetList();
+  }
+}
+
+function createFleetCard() {
+  const card = document.createElement('section');
+  card.className = 'card';
+
+  const title = document.createElement('h2');
+  title.className = 'sidebarTitle';
+  title.setAttribute('data-i18n', 'text.fleetTitle');
+  title.textContent = 'Fleet (multiple devices)';
+  card.appendChild(title);
+
+  const hint = document.createElement('p');
+  hint.className = 'muted small';
+  hint.style.cssText = 'margin: 0 0 8px;';
+  hint.setAttribute('data-i18n', 'text.fleetHint');
+  hint.textContent = 'Types the text above on every added device. Each device buffers the text first, then all of them start at the same moment with the timing settings. Needs firmware 1.2.15+.';
+  card.appendChild(hint);
+
+  const list = document.createElement('div');
+  list.id = 'fleetList';
+  list.className = 'muted small';
+  card.appendChild(list);
+
+  const row = document.createElement('div');
+  row.className = 'row';
+  row.style.marginTop = '8px';
+  const buttons = [
+    { id: 'btnFleetAdd', i18n: 'text.fleetAdd', text: 'Add device' },
+    { id: 'btnFleetClear', i18n: 'text.fleetClear', text: 'Remove all' },
+    { id: 'btnFleetStart', i18n: 'text.fleetStart', text: 'Start on all' },
+    { id: 'btnFleetStop', i18n: 'text.fleetStop', text: 'Stop' },
+  ];
+  for (const item of buttons) {
+    const btn = document.createElement('button');
+    btn.id = item.id;
+    btn.setAttribute('data-i18n', item.i18n);
+    btn.textContent = item.text;
+    row.appendChild(btn);
+  }
+  card.appendChild(row);
+
+  const status = document.createElement('p');
+  status.id = 'fleetStatus';
+  status.className = 'muted small';
+  status.style.cssText = 'margin: 6px 0 0;';
+  card.appendChild(status);
+  return card;
 }
 
 function initDeviceTimingSettingInput(el, key, min, max, fallback) {
@@ -1072,6 +1584,27 @@ function createTextSidebar() {
 
   addHint(grid2, 'settings.ignoreLeadingWhitespaceHint', 'Leading spaces/tabs on each line will not be sent (useful for IDE auto-formatting).', '9px');
 
+  // Clipboard paste checkbox
+  const clipLabel = document.createElement('label');
+  clipLabel.className = 'inline';
+  clipLabel.style.cssText = 'width: 100%; justify-content: space-between;';
+  const clipSpan = document.createElement('span');
+  clipSpan.setAttribute('data-i18n', 'settings.clipboardPaste');
+  clipSpan.textContent = 'Clipboard paste for expensive text (Windows)';
+  const clipCheck = document.createElement('input');
+  clipCheck.id = 'clipboardPaste';
+  clipCheck.type = 'checkbox';
+  clipLabel.appendChild(clipSpan);
+  clipLabel.appendChild(clipCheck);
+  grid2.appendChild(clipLabel);
+
+  addHint(
+    grid2,
+    'settings.clipboardPasteHint',
+    'The device pastes the queued text in batches through Win+R + a PowerShell Set-Clipboard receiver + Ctrl+V when that is cheaper than typing or the text has characters the keyboard cannot type (all Unicode is kept). Plain Hangul usually stays typed. Needs firmware 1.2.30+.',
+    '9px'
+  );
+
   // Typing delay
   addNumberInput(grid2, 'settings.typingDelay', 'Key typing delay (ms)', 'typingDelayMs', 0, 1000, 30);
   addHint(grid2, 'settings.typingDelayHint', 'Wait time after each keystroke. Too short may cause missed/garbled characters (especially HID/IME).');
@@ -1084,6 +1617,17 @@ function createTextSidebar() {
   addNumberInput(grid2, 'settings.keyPressDelay', 'Key press hold (ms)', 'keyPressDelayMs', 0, 300, 10);
   addHint(grid2, 'settings.keyPressDelayHint', 'How long a key is held down. Too short may not register in some environments.');
 
+  // Per-key-class delays (blank = same as the typing delay)
+  for (const f of KEY_CLASS_DELAY_FIELDS) {
+    const label = addNumberInput(grid2, f.i18n, f.label, f.id, 0, 1000, '');
+    label.querySelector('input').placeholder = '-';
+  }
+  addHint(
+    grid2,
+    'settings.keyClassDelayHint',
+    'Optional wait after these keys instead of the typing delay (blank = typing delay), e.g. a long Enter for shells with fast letters. Needs firmware 1.2.17+.'
+  );
+
   fieldset.appendChild(grid2);
 
   // Timing note
@@ -1120,9 +1664,92 @@ function createTextSidebar() {
   btnRow.appendChild(toast);
 
   fieldset.appendChild(btnRow);
+
+  // Device timing profiles (stored on the board)
+  const profileTitle = document.createElement('p');
+  profileTitle.className = 'small';
+  profileTitle.style.cssText = 'margin: 14px 0 0; font-weight: 600;';
+  profileTitle.setAttribute('data-i18n', 'settings.deviceProfile');
+  profileTitle.textContent = 'Device timing profiles';
+  fieldset.appendChild(profileTitle);
+
+  const grid3 = document.createElement('div');
+  grid3.className = 'grid2';
+  grid3.style.marginTop = '6px';
+
+  const profileNameLabel = document.createElement('label');
+  profileNameLabel.className = 'inline';
+  profileNameLabel.style.cssText = 'width: 100%; justify-content: space-between;';
+  const profileNameSpan = document.createElement('span');
+  profileNameSpan.setAttribute('data-i18n', 'settings.deviceProfileName');
+  profileNameSpan.textContent = 'Profile name';
+  const profileNameInput = document.createElement('input');
+  profileNameInput.id = 'deviceProfileName';
+  profileNameInput.type = 'text';
+  profileNameInput.maxLength = 12;
+  profileNameInput.placeholder = 'A-Z a-z 0-9 _ -';
+  profileNameLabel.appendChild(profileNameSpan);
+  profileNameLabel.appendChild(profileNameInput);
+  grid3.appendChild(profileNameLabel);
+
+  const profileChecks = [
+    { id: 'deviceProfileBind', i18n: 'settings.deviceProfileBind', text: 'Bind to this Target PC' },
+    { id: 'deviceProfileAuto', i18n: 'settings.deviceProfileAuto', text: 'Auto-select by Target PC' },
+    { id: 'useDeviceProfile', i18n: 'settings.useDeviceProfile', text: 'Type with the device profile timing' },
+  ];
+  for (const item of profileChecks) {
+    const checkLabel = document.createElement('label');
+    checkLabel.className = 'inline';
+    checkLabel.style.cssText = 'width: 100%; justify-content: space-between;';
+    const checkSpan = document.createElement('span');
+    checkSpan.setAttribute('data-i18n', item.i18n);
+    checkSpan.textContent = item.text;
+    const check = document.createElement('input');
+    check.id = item.id;
+    check.type = 'checkbox';
+    checkLabel.appendChild(checkSpan);
+    checkLabel.appendChild(check);
+    grid3.appendChild(checkLabel);
+  }
+
+  addHint(
+    grid3,
+    'settings.deviceProfileHint',
+    'Save stores the timing above on the board and uses it from boot, so typing starts at this speed without waiting for the browser. A bound profile is picked automatically when the board is plugged into the same Target PC. Needs firmware 1.2.14+.',
+    '9px'
+  );
+  fieldset.appendChild(grid3);
+
+  const profileRow = document.createElement('div');
+  profileRow.className = 'row';
+  profileRow.style.marginTop = '8px';
+
+  const saveProfileBtn = document.createElement('button');
+  saveProfileBtn.id = 'btnSaveDeviceProfile';
+  saveProfileBtn.disabled = true;
+  saveProfileBtn.setAttribute('data-i18n', 'settings.deviceProfileSave');
+  saveProfileBtn.textContent = 'Save to device';
+  profileRow.appendChild(saveProfileBtn);
+
+  const deleteProfileBtn = document.createElement('button');
+  deleteProfileBtn.id = 'btnDeleteDeviceProfile';
+  deleteProfileBtn.disabled = true;
+  deleteProfileBtn.setAttribute('data-i18n', 'settings.deviceProfileDelete');
+  deleteProfileBtn.textContent = 'Delete';
+  profileRow.appendChild(deleteProfileBtn);
+
+  const profileInfo = document.createElement('span');
+  profileInfo.id = 'deviceProfileInfo';
+  profileInfo.className = 'muted small';
+  profileRow.appendChild(profileInfo);
+
+  fieldset.appendChild(profileRow);
   settingsDetails.appendChild(fieldset);
   frag.appendChild(settingsDetails);
 
+  // ── Fleet card ──
+  frag.appendChild(createFleetCard());
+
   // ── Notes card ──
   const notesCard = document.createElement('section');
   notesCard.className = 'card';
@@ -1205,6 +1832,30 @@ function createTextMain() {
   textarea.setAttribute('data-i18n-placeholder', 'text.textareaPlaceholder');
   card.appendChild(textarea);
 
+  // Diff retyping: document name (blank = always type the whole text)
+  const docLabel = document.createElement('label');
+  docLabel.className = 'inline';
+  docLabel.style.cssText = 'width: 100%; margin-top: 10px;';
+  const docSpan = document.createElement('span');
+  docSpan.setAttribute('data-i18n', 'text.diffDocName');
+  docSpan.textContent = 'Document name (retype only changed lines)';
+  const docInput = document.createElement('input');
+  docInput.id = 'diffDocName';
+  docInput.type = 'text';
+  docInput.maxLength = 16;
+  docInput.placeholder = 'e.g. router-cfg';
+  docInput.setAttribute('data-i18n-placeholder', 'text.diffDocNamePlaceholder');
+  docLabel.appendChild(docSpan);
+  docLabel.appendChild(docInput);
+  card.appendChild(docLabel);
+
+  const docHint = document.createElement('div');
+  docHint.className = 'muted small';
+  docHint.style.marginTop = '4px';
+  docHint.setAttribute('data-i18n', 'text.diffDocNameHint');
+  docHint.textContent = 'The device remembers the last document typed under this name. Next time, leave that document open in the editor (cursor anywhere): only the changed lines are retyped. Needs firmware 1.2.21+, a plain editor and word wrap off.';
+  card.appendChild(docHint);
+
   // Button row
   const btnRow = document.createElement('div');
   btnRow.className = 'row';
@@ -1298,16 +1949,32 @@ export function init(mainContainer, sidebarExtra) {
     startHintText: document.getElementById('startHintText'),
     startChecklistText: document.getElementById('startChecklistText'),
     textInput: document.getElementById('textInput'),
+    diffDocName: document.getElementById('diffDocName'),
     chunkSize: document.getElementById('chunkSize'),
     chunkDelay: document.getElementById('chunkDelay'),
     retryDelay: document.getElementById('retryDelay'),
     unsupportedReplacement: document.getElementById('unsupportedReplacement'),
     ignoreLeadingWhitespace: document.getElementById('ignoreLeadingWhitespace'),
+    clipboardPaste: document.getElementById('clipboardPaste'),
+    deviceProfileName: document.getElementById('deviceProfileName'),
+    deviceProfileBind: document.getElementById('deviceProfileBind'),
+    deviceProfileAuto: document.getElementById('deviceProfileAuto'),
+    useDeviceProfile: document.getElementById('useDeviceProfile'),
+    btnSaveDeviceProfile: document.getElementById('btnSaveDeviceProfile'),
+    btnDeleteDeviceProfile: document.getElementById('btnDeleteDeviceProfile'),
+    deviceProfileInfo: document.getElementById('deviceProfileInfo'),
+    fleetList: document.getElementById('fleetList'),
+    fleetStatus: document.getElementById('fleetStatus'),
+    btnFleetAdd: document.getElementById('btnFleetAdd'),
+    btnFleetClear: document.getElementById('btnFleetClear'),
+    btnFleetStart: document.getElementById('btnFleetStart'),
+    btnFleetStop: document.getElementById('btnFleetStop'),
     btnResetSettings: document.getElementById('btnResetSettings'),
     typingDelayMs: document.getElementById('typingDelayMs'),
     toggleKey: document.getElementById('toggleKey'),
     modeSwitchDelayMs: document.getElementById('modeSwitchDelayMs'),
     keyPressDelayMs: document.getElementById('keyPressDelayMs'),
+    ...Object.fromEntries(KEY_CLASS_DELAY_FIELDS.map((f) => [f.id, document.getElementById(f.id)])),
     btnApplyDeviceSettings: document.getElementById('btnApplyDeviceSettings'),
     textSettingsToast: document.getElementById('textSettingsToast'),
     settingsFieldset: document.getElementById('settingsFieldset'),
@@ -1380,7 +2047,7 @@ export function init(mainContainer, sidebarExtra) {
         // ignore
       }
 
-      setStatus(t('status.stopped'), t('status.deviceQueueAborted'));
+      setStatus(t('status.stopped'), deviceJobSessionId != null ? t('status.deviceJobCancelled') : t('status.deviceQueueAborted'));
     });
   }
 
@@ -1390,6 +2057,16 @@ export function init(mainContainer, sidebarExtra) {
     });
   }
 
+  if (els.diffDocName) {
+    els.diffDocName.value = ble.sanitizeDocName(localStorage.getItem(LS_DIFF_DOC_NAME) ?? '');
+    els.diffDocName.addEventListener('change', () => {
+      const name = getDiffDocName();
+      els.diffDocName.value = name;
+      if (name) localStorage.setItem(LS_DIFF_DOC_NAME, name);
+      else localStorage.removeItem(LS_DIFF_DOC_NAME);
+    });
+  }
+
   // Transfer settings — load saved + register listeners
   if (els.chunkSize) {
     const saved = loadNumberSetting(LS_CHUNK_SIZE, DEFAULT_CHUNK_SIZE);
@@ -1438,10 +2115,67 @@ export function init(mainContainer, sidebarExtra) {
     });
   }
 
+  if (els.clipboardPaste) {
+    els.clipboardPaste.checked = loadBoolSetting(LS_CLIPBOARD_PASTE, DEFAULT_CLIPBOARD_PASTE);
+    els.clipboardPaste.addEventListener('change', () => {
+      saveBoolSetting(LS_CLIPBOARD_PASTE, getClipboardPasteSetting());
+      updatePreStartMetrics();
+    });
+  }
+
+  if (els.useDeviceProfile) {
+    els.useDeviceProfile.checked = loadBoolSetting(LS_USE_DEVICE_PROFILE, DEFAULT_USE_DEVICE_PROFILE);
+    els.useDeviceProfile.addEventListener('change', () => {
+      saveBoolSetting(LS_USE_DEVICE_PROFILE, getUseDeviceProfileSetting());
+    });
+  }
+
+  if (els.btnSaveDeviceProfile) {
+    els.btnSaveDeviceProfile.addEventListener('click', async () => {
+      try {
+        await saveDeviceProfile();
+        showTextSettingsToast(t('toast.saved'), 1000);
+      } catch (err) {
+        setStatus(t('status.error'), err?.message ?? String(err));
+      }
+    });
+  }
+
+  if (els.btnDeleteDeviceProfile) {
+    els.btnDeleteDeviceProfile.addEventListener('click', async () => {
+      try {
+        await deleteDeviceProfile();
+      } catch (err) {
+        setStatus(t('status.error'), err?.message ?? String(err));
+      }
+    });
+  }
+
+  if (els.deviceProfileAuto) {
+    els.deviceProfileAuto.addEventListener('change', async () => {
+      try {
+        checkProfileResult(await ble.profileOp(ble.PROFILE_OP.autoSelect, els.deviceProfileAuto.checked ? 1 : 0));
+      } catch (err) {
+        setStatus(t('status.error'), err?.message ?? String(err));
+      }
+      await refreshDeviceProfileState().catch(() => {});
+    });
+  }
+
   // Device timing settings — load saved + register listeners
   initDeviceTimingSettingInput(els.typingDelayMs, LS_TYPING_DELAY_MS, 0, 1000, DEFAULT_TYPING_DELAY_MS);
   initDeviceTimingSettingInput(els.modeSwitchDelayMs, LS_MODE_SWITCH_DELAY_MS, 0, 3000, DEFAULT_MODE_SWITCH_DELAY_MS);
   initDeviceTimingSettingInput(els.keyPressDelayMs, LS_KEY_PRESS_DELAY_MS, 0, 300, DEFAULT_KEY_PRESS_DELAY_MS);
+  for (const f of KEY_CLASS_DELAY_FIELDS) {
+    const el = els[f.id];
+    if (!el) continue;
+    el.value = localStorage.getItem(f.ls) ?? '';
+    el.addEventListener('input', () => {
+      const raw = String(el.value ?? '').trim();
+      if (raw === '') localStorage.removeItem(f.ls);
+      else localStorage.setItem(f.ls, String(clampNumber(raw, 0, 1000, 0)));
+    });
+  }
 
   // Update estimate preview when device timing changes.
   for (const el of [els.typingDelayMs, els.modeSwitchDelayMs, els.keyPressDelayMs]) {
@@ -1480,8 +2214,11 @@ export function init(mainContainer, sidebarExtra) {
       localStorage.removeItem(LS_TYPING_DELAY_MS);
       localStorage.removeItem(LS_MODE_SWITCH_DELAY_MS);
       localStorage.removeItem(LS_KEY_PRESS_DELAY_MS);
+      for (const f of KEY_CLASS_DELAY_FIELDS) localStorage.removeItem(f.ls);
       localStorage.removeItem(LS_TOGGLE_KEY);
       localStorage.removeItem(LS_IGNORE_LEADING_WHITESPACE);
+      localStorage.removeItem(LS_CLIPBOARD_PASTE);
+      localStorage.removeItem(LS_USE_DEVICE_PROFILE);
 
       if (els.chunkSize) els.chunkSize.value = String(DEFAULT_CHUNK_SIZE);
       if (els.chunkDelay) els.chunkDelay.value = String(DEFAULT_CHUNK_DELAY);
@@ -1491,9 +2228,12 @@ export function init(mainContainer, sidebarExtra) {
       if (els.typingDelayMs) els.typingDelayMs.value = String(DEFAULT_TYPING_DELAY_MS);
       if (els.modeSwitchDelayMs) els.modeSwitchDelayMs.value = String(DEFAULT_MODE_SWITCH_DELAY_MS);
       if (els.keyPressDelayMs) els.keyPressDelayMs.value = String(DEFAULT_KEY_PRESS_DELAY_MS);
+      for (const f of KEY_CLASS_DELAY_FIELDS) if (els[f.id]) els[f.id].value = '';
       setToggleKeySetting(DEFAULT_TOGGLE_KEY);
 
       if (els.ignoreLeadingWhitespace) els.ignoreLeadingWhitespace.checked = DEFAULT_IGNORE_LEADING_WHITESPACE;
+      if (els.clipboardPaste) els.clipboardPaste.checked = DEFAULT_CLIPBOARD_PASTE;
+      if (els.useDeviceProfile) els.useDeviceProfile.checked = DEFAULT_USE_DEVICE_PROFILE;
 
       setStatus(t('status.settingsReset'), t('status.settingsResetDetail'));
       showTextSettingsToast(t('toast.reset'), 1000);
@@ -1502,12 +2242,22 @@ export function init(mainContainer, sidebarExtra) {
 
   // 5. Set initial UI state
   setUiConnected(ble.isConnected());
+  refreshDeviceProfileState().catch(() => {});
   setUiRunState({ running: false, paused: false });
   clearJobMetrics();
 
   // 6. Subscribe to BLE events
   ble.on('connect', onBleConnect);
   ble.on('disconnect', onBleDisconnect);
+
+  els.btnFleetAdd?.addEventListener('click', addFleetDevice);
+  els.btnFleetClear?.addEventListener('click', () => fleet.clearFleet());
+  els.btnFleetStart?.addEventListener('click', runFleet);
+  els.btnFleetStop?.addEventListener('click', () => {
+    fleetStopRequested = true;
+  });
+  fleet.onFleetChange(renderFleetList);
+  renderFleetList();
 }
 
 export function destroy() {
@@ -1516,9 +2266,14 @@ export function destroy() {
     stopRequested = true;
   }
 
+  if (fleetRunning) {
+    fleetStopRequested = true;
+  }
+
   // Unsubscribe BLE events
   ble.off('connect', onBleConnect);
   ble.off('disconnect', onBleDisconnect);
+  fleet.offFleetChange(renderFleetList);
 
   // Clear job timer
   if (job?.intervalId) {